@@ -7,48 +7,95 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "CSimpleArraysTask.h"
 #include "CMatrixRotateTask.h"
+#include "CMatrixBatchTask.h"
+#include "CMatrixOutOfCoreTask.h"
+#include "CMatrixInPlaceTask.h"
 
 #include <iostream>
+#include <algorithm>
+#include <math.h>
 
 using namespace std;
 
 ///////////////////////////////////////////////////////////////////////////////
 // CAssignment1
 
+void CAssignment1::RegisterTasks()
+{
+	// Task 1: simple array addition, with the local size found by the autotuner.
+	// (3 int arrays on the device, 4 byte per element in each)
+	size_t vecAddLocalSize[3] = {256, 1, 1};
+	m_Tasks.Register("vecadd", "Vector addition", 1048576, vecAddLocalSize,
+		[this](CTaskOptions& Options) { return CreateVectorAddTask(Options, CHostBuffer::HOST_PAGEABLE, 0); },
+		3.0 * sizeof(int), sizeof(int));
+
+	// Task 1a: transfers from pinned and zero-copy host memory instead of pageable memory.
+	m_Tasks.Register("vecadd-pinned", "Vector addition with pinned host memory", 1048576, vecAddLocalSize,
+		[this](CTaskOptions& Options) { return CreateVectorAddTask(Options, CHostBuffer::HOST_PINNED, 0); },
+		3.0 * sizeof(int), sizeof(int));
+	m_Tasks.Register("vecadd-zerocopy", "Vector addition with zero-copy host memory", 1048576, vecAddLocalSize,
+		[this](CTaskOptions& Options) { return CreateVectorAddTask(Options, CHostBuffer::HOST_ZERO_COPY, 0); },
+		3.0 * sizeof(int), sizeof(int));
+
+	// Task 1b: the same addition streamed in chunks, overlapping transfers and computation.
+	m_Tasks.Register("vecadd-streamed2", "Streamed vector addition, 2 buffer sets", 16 * 1048576, vecAddLocalSize,
+		[this](CTaskOptions& Options) { return CreateVectorAddTask(Options, CHostBuffer::HOST_PINNED, 2); },
+		3.0 * sizeof(int), sizeof(int));
+	m_Tasks.Register("vecadd-streamed3", "Streamed vector addition, 3 buffer sets", 16 * 1048576, vecAddLocalSize,
+		[this](CTaskOptions& Options) { return CreateVectorAddTask(Options, CHostBuffer::HOST_PINNED, 3); },
+		3.0 * sizeof(int), sizeof(int));
+
+	// Task 2: matrix rotation. The problem size is the number of elements of a matrix with 2048 columns.
+	// (M and MR with floats, input and output of the layout transforms with up to float4)
+	size_t rotateLocalSize[3] = {32, 16, 1};
+	m_Tasks.Register("rotate", "Matrix rotation", 2048 * 1025, rotateLocalSize,
+		[](CTaskOptions& Options) -> IComputeTask* { return new CMatrixRotateTask(2048, (Options.ProblemSize + 2047) / 2048); },
+		2.0 * sizeof(float) + 2.0 * 4 * sizeof(float), 4 * sizeof(float));
+
+	// Task 2b: thousands of small matrices (16 x 16 to 128 x 128) in one launch. The problem size is the number of matrices.
+	m_Tasks.Register("rotate-batch", "Batched rotation of small matrices", 4096, rotateLocalSize,
+		[](CTaskOptions& Options) -> IComputeTask* { return new CMatrixBatchTask(std::max<size_t>(Options.ProblemSize, 1)); },
+		2.0 * 128 * 128 * sizeof(float), 128 * 128 * sizeof(float));
+
+	// Task 2c: rotation of a matrix with 8192 columns that only lives in host memory, streamed through
+	// 32 MB of device memory. The problem size is the number of elements, it is limited by the host memory.
+	m_Tasks.Register("rotate-outofcore", "Out-of-core matrix rotation", 8192 * 4096, rotateLocalSize,
+		[](CTaskOptions& Options) -> IComputeTask* { return new CMatrixOutOfCoreTask(8192, std::max<size_t>((Options.ProblemSize + 8191) / 8192, 1), 32 * 1024 * 1024); });
+
+	// Task 2d: in-place transposition and rotation of a square matrix, a single device buffer.
+	// The problem size is the number of elements, rounded down to a square.
+	m_Tasks.Register("rotate-inplace", "In-place square matrix rotation", 4096 * 4096, rotateLocalSize,
+		[](CTaskOptions& Options) -> IComputeTask* { return new CMatrixInPlaceTask(std::max(1u, (unsigned int)sqrt(double(Options.ProblemSize)))); },
+		sizeof(float), sizeof(float));
+}
+
 bool CAssignment1::DoCompute()
 {
-	// Task 1: simple array addition.
-	cout << "Running vector addition example..." << endl << endl;
-	{
-		size_t localWorkSize[3] = {64, 1, 1};
-		CSimpleArraysTask task(1048576);
-		RunComputeTask(task, localWorkSize);
-	}
-	{
-		size_t LocalWorkSize[3] = {128, 1, 1};
-		CSimpleArraysTask task(1048576);
-		RunComputeTask(task, LocalWorkSize);
-	}
-	{
-		size_t localWorkSize[3] = {256, 1, 1};
-		CSimpleArraysTask task(1048576);
-		RunComputeTask(task, localWorkSize);
-	}
-	{
-		size_t localWorkSize[3] = {512, 1, 1};
-		CSimpleArraysTask task(1048576);
-		RunComputeTask(task, localWorkSize);
-	}
+	return RunRegisteredTasks();
+}
 
-	// Task 2: matrix rotation.
-	std::cout << "Running matrix rotation example..." << std::endl << std::endl;
+IComputeTask* CAssignment1::CreateVectorAddTask(CTaskOptions& Options, CHostBuffer::EMode HostMode, unsigned int NStreamBuffers)
+{
+	// the local size is tuned once per problem size, unless it was given on the command line
+	if(!Options.LocalWorkSizeSet)
 	{
-		size_t LocalWorkSize[3] = {32, 16, 1};
-		CMatrixRotateTask task(2048, 1025);
-		RunComputeTask(task, LocalWorkSize);
+		size_t& tunedLocalSize = m_TunedVecAddLocalSize[Options.ProblemSize];
+		if(tunedLocalSize == 0)
+		{
+			tunedLocalSize = Options.LocalWorkSize[0];
+			CSimpleArraysTask task(Options.ProblemSize);
+			TuningConfiguration best;
+			if(TuneComputeTask(task, task, CSimpleArraysTask::GetTuningSpace(), best))
+				tunedLocalSize = CAutoTuner::GetValue(best, "LOCAL_SIZE", (int)tunedLocalSize);
+		}
+		Options.LocalWorkSize[0] = tunedLocalSize;
 	}
 
-	return true;
+	CSimpleArraysTask* pTask = new CSimpleArraysTask(Options.ProblemSize);
+	pTask->SetHostMemory(HostMode);
+	if(NStreamBuffers > 0)
+		pTask->SetStreaming(1048576, NStreamBuffers);
+	return pTask;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -20,7 +20,10 @@
 #ifndef _CASSIGNMENT1_H
 #define _CASSIGNMENT1_H
 
-#include "../Common/CAssignmentBase.h"
+#include "../../Common/CAssignmentBase.h"
+#include "../../Common/CHostBuffer.h"
+
+#include <map>
 
 //! Assignment1 solution
 class CAssignment1 : public CAssignmentBase
@@ -30,6 +33,14 @@ public:
 
 	//! This overloaded method contains the specific solution of A1
 	virtual bool DoCompute();
+
+protected:
+	virtual void RegisterTasks();
+
+	IComputeTask* CreateVectorAddTask(CTaskOptions& Options, CHostBuffer::EMode HostMode, unsigned int NStreamBuffers);
+
+	//problem size -> tuned local size of the vector addition
+	std::map<size_t, size_t>	m_TunedVecAddLocalSize;
 };
 
 #endif // _CASSIGNMENT1_H
@@ -0,0 +1,155 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CMatrixBatchTask.h"
+
+#include "../../Common/CLUtil.h"
+#include "../../Common/CBenchmarkReporter.h"
+#include "../../Common/CTimer.h"
+
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CMatrixBatchTask
+
+CMatrixBatchTask::CMatrixBatchTask(size_t NMatrices, unsigned int MinSize, unsigned int MaxSize)
+	: m_NMatrices(NMatrices), m_MinSize(std::max(1u, MinSize)), m_MaxSize(std::max(MinSize, MaxSize))
+{
+}
+
+CMatrixBatchTask::~CMatrixBatchTask()
+{
+	ReleaseResources();
+}
+
+bool CMatrixBatchTask::InitResources(cl_device_id Device, cl_context Context)
+{
+	//CPU resources: contiguous matrices of random sizes, the outputs at the same offsets
+	m_Matrices.resize(m_NMatrices);
+	m_TotalElements = 0;
+	for(size_t i = 0; i < m_NMatrices; i++)
+	{
+		CMatrixTransform::CBatchMatrix& m = m_Matrices[i];
+		m.SizeX = m_MinSize + rand() % (m_MaxSize - m_MinSize + 1);
+		m.SizeY = m_MinSize + rand() % (m_MaxSize - m_MinSize + 1);
+		m.InOffset = m.OutOffset = (cl_uint)m_TotalElements;
+		m_TotalElements += size_t(m.SizeX) * m.SizeY;
+	}
+
+	m_hIn.resize(m_TotalElements);
+	m_hResult.resize(m_TotalElements);
+	m_hReference.resize(m_TotalElements);
+	for(size_t i = 0; i < m_TotalElements; i++)
+		m_hIn[i] = float(rand()) / float(RAND_MAX);
+
+	//device resources
+	cl_int clError;
+	m_dIn = AcquireBuffer(Context, CL_MEM_READ_ONLY, sizeof(float) * m_TotalElements, &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dIn.");
+	m_dOut = AcquireBuffer(Context, CL_MEM_WRITE_ONLY, sizeof(float) * m_TotalElements, &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dOut.");
+	m_dMatrices = AcquireBuffer(Context, CL_MEM_READ_ONLY, sizeof(CMatrixTransform::CBatchMatrix) * m_NMatrices, &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dMatrices.");
+
+	return m_Transform.Init(Device, Context, CMatrixTransform::ELEMENT_FLOAT);
+}
+
+void CMatrixBatchTask::ReleaseResources()
+{
+	m_Matrices.clear();
+	m_hIn.clear();
+	m_hResult.clear();
+	m_hReference.clear();
+
+	m_dIn.Release();
+	m_dOut.Release();
+	m_dMatrices.Release();
+	m_Transform.Release();
+}
+
+void CMatrixBatchTask::ComputeCPU()
+{
+	CTimer timer;
+	timer.Start();
+	CMatrixTransform::TransformBatchCPU(CMatrixTransform::ROTATE_90, &m_hIn[0], &m_hReference[0], m_Matrices, sizeof(float));
+	timer.Stop();
+
+	CBenchmarkRecord record("MatrixBatch", "cpu", m_NMatrices);
+	record.SetCPU();
+	record.SetTime(timer.GetElapsedMilliseconds(), 1);
+	record.Bytes = 2.0 * double(m_TotalElements * sizeof(float));
+	CBenchmarkReporter::Report(record);
+}
+
+void CMatrixBatchTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+{
+	m_FailedVariants.clear();
+
+	cl_int clErr = clEnqueueWriteBuffer(CommandQueue, m_dIn.Get(), CL_FALSE, 0, sizeof(float) * m_TotalElements, &m_hIn[0], 0, NULL, NULL);
+	clErr |= clEnqueueWriteBuffer(CommandQueue, m_dMatrices.Get(), CL_FALSE, 0, sizeof(CMatrixTransform::CBatchMatrix) * m_NMatrices, &m_Matrices[0], 0, NULL, NULL);
+	V_RETURN_CL(clErr, "Failed to upload the matrices.");
+
+	// the packing is chosen for matrices of the average size
+	unsigned int averageSize = (m_MinSize + m_MaxSize) / 2;
+	const cl_uint matricesPerGroup[2] = { 1, m_Transform.GetMatricesPerGroup(averageSize, averageSize) };
+	const char* packingNames[2] = { "group", "packed" };
+
+	// ComputeCPU() left the rotation by 90 degrees in m_hReference
+	int referenceTransform = CMatrixTransform::ROTATE_90;
+
+	unsigned int nIterations = GetIterations(100);
+	double bytes = 2.0 * double(m_TotalElements * sizeof(float));
+	cout<<m_NMatrices<<" matrices of "<<m_MinSize<<" to "<<m_MaxSize<<" elements per side, "<<matricesPerGroup[1]<<" per group when packed"<<endl;
+
+	for(int t = 0; t < CMatrixTransform::TRANSFORM_COUNT; t++)
+	{
+		CMatrixTransform::ETransform transform = (CMatrixTransform::ETransform)t;
+		for(int p = 0; p < 2; p++)
+		{
+			string variant = string(CMatrixTransform::GetName(transform)) + "/" + packingNames[p];
+			if(!IsVariantSelected("MatrixBatch", variant))
+				continue;
+
+			size_t globalWorkSize[2], localWorkSize[3] = { 1, 1, 1 };
+			cl_kernel kernel = m_Transform.PrepareBatch(transform, m_dIn.Get(), m_dOut.Get(), m_dMatrices.Get(), (cl_uint)m_NMatrices,
+				matricesPerGroup[p], globalWorkSize, localWorkSize);
+			if(kernel == nullptr)
+			{
+				m_FailedVariants.push_back(variant);
+				continue;
+			}
+
+			double ms = CLUtil::ProfileKernel(CommandQueue, kernel, 2, globalWorkSize, localWorkSize, nIterations);
+			cout<<variant<<": "<<ms<<" ms, "<<1.0e3 * double(m_NMatrices) / ms<<" matrices/s, "<<1.0e-6 * bytes / ms<<" GB/s"<<endl;
+
+			CBenchmarkRecord record("MatrixBatch", variant, m_NMatrices);
+			record.SetLocalSize(localWorkSize, 2);
+			record.SetTime(ms, nIterations);
+			record.Bytes = bytes;
+			CBenchmarkReporter::Report(record);
+
+			clErr = clEnqueueReadBuffer(CommandQueue, m_dOut.Get(), CL_TRUE, 0, sizeof(float) * m_TotalElements, &m_hResult[0], 0, NULL, NULL);
+			if(referenceTransform != transform)
+			{
+				CMatrixTransform::TransformBatchCPU(transform, &m_hIn[0], &m_hReference[0], m_Matrices, sizeof(float));
+				referenceTransform = transform;
+			}
+			if(clErr != CL_SUCCESS || memcmp(&m_hResult[0], &m_hReference[0], sizeof(float) * m_TotalElements) != 0)
+				m_FailedVariants.push_back(variant);
+		}
+	}
+}
+
+bool CMatrixBatchTask::ValidateResults()
+{
+	for(size_t i = 0; i < m_FailedVariants.size(); i++)
+		cout<<"Results of "<<m_FailedVariants[i]<<" are incorrect!"<<endl;
+	return m_FailedVariants.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
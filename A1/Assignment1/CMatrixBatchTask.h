@@ -17,45 +17,54 @@
                                 dP                                    d8888P  
 ******************************************************************************/
 
-#ifndef _ICOMPUTE_TASK_H
-#define _ICOMPUTE_TASK_H
+#ifndef _CMATRIX_BATCH_TASK_H
+#define _CMATRIX_BATCH_TASK_H
 
-// All OpenCL headers
-#if defined(WIN32)
-    #include <CL/opencl.h>
-#elif defined (__APPLE__) || defined(MACOSX)
-    #include <OpenCL/opencl.h>
-#else
-    #include <CL/cl.h>
-#endif 
+#include "../../Common/IComputeTask.h"
+#include "../../Common/CMatrixTransform.h"
 
-#include "CommonDefs.h"
+#include <string>
+#include <vector>
 
-//! Common interface for the tasks within the assignment.
+//! A1/T2b: Rotation and transposition of many small matrices in one launch
 /*!
-	Inherit a new class for each computing task.
-	(There are usually more tasks in each assignment).
+	The matrices have random sizes between MinSize and MaxSize in both directions
+	and follow each other in memory. Every transform runs as "<Transform>/group"
+	(one work-group per matrix) and "<Transform>/packed" (as many matrices per group
+	as fit into its local memory). Throughput is reported in matrices/s and GB/s.
 */
-class IComputeTask
+class CMatrixBatchTask : public IComputeTask
 {
 public:
+	CMatrixBatchTask(size_t NMatrices, unsigned int MinSize = 16, unsigned int MaxSize = 128);
+	virtual ~CMatrixBatchTask();
 
-	virtual ~IComputeTask() {};
-	
-	//! Init any resources specific to the current task
-	virtual bool InitResources(cl_device_id Device, cl_context Context) = 0;
+	// IComputeTask
+	virtual bool InitResources(cl_device_id Device, cl_context Context);
 
-	//! Release everything allocated in InitResources()
-	virtual void ReleaseResources() = 0;
+	virtual void ReleaseResources();
 
-	//! Perform calculations on the GPU
-	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]) = 0;
+	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
 
-	//! Compute the "golden" solution on the CPU. The GPU results must be equal to this reference
-	virtual void ComputeCPU() = 0;
+	virtual void ComputeCPU();
 
-	//! Compare the GPU solution to the "golden" solution
-	virtual bool ValidateResults() = 0;
+	virtual bool ValidateResults();
+
+protected:
+	size_t				m_NMatrices;
+	unsigned int		m_MinSize;
+	unsigned int		m_MaxSize;
+
+	std::vector<CMatrixTransform::CBatchMatrix> m_Matrices;
+	//elements of all matrices
+	size_t				m_TotalElements = 0;
+
+	std::vector<float>	m_hIn, m_hResult, m_hReference;
+
+	CPooledBuffer		m_dIn, m_dOut, m_dMatrices;
+	CMatrixTransform	m_Transform;
+
+	std::vector<std::string> m_FailedVariants;
 };
 
-#endif // _ICOMPUTE_TASK_H
+#endif // _CMATRIX_BATCH_TASK_H
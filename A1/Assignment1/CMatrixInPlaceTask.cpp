@@ -0,0 +1,134 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CMatrixInPlaceTask.h"
+
+#include "../../Common/CLUtil.h"
+#include "../../Common/CBenchmarkReporter.h"
+#include "../../Common/CTimer.h"
+
+#include <string.h>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CMatrixInPlaceTask
+
+CMatrixInPlaceTask::CMatrixInPlaceTask(unsigned int N)
+	: m_N(N)
+{
+}
+
+CMatrixInPlaceTask::~CMatrixInPlaceTask()
+{
+	ReleaseResources();
+}
+
+bool CMatrixInPlaceTask::InitResources(cl_device_id Device, cl_context Context)
+{
+	//CPU resources
+	size_t elements = size_t(m_N) * m_N;
+	m_hIn.resize(elements);
+	m_hResult.resize(elements);
+	m_hReference.resize(elements);
+	for(size_t i = 0; i < elements; i++)
+		m_hIn[i] = float(rand()) / float(RAND_MAX);
+
+	//device resources: the out-of-place transforms would need a second buffer of the same size
+	cl_int clError;
+	m_dMatrix = AcquireBuffer(Context, CL_MEM_READ_WRITE, sizeof(float) * elements, &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dMatrix.");
+	cout<<"In-place matrix of "<<m_N<<" x "<<m_N<<": "<<sizeof(float) * elements / (1024 * 1024)<<" MB on the device, "
+		<<sizeof(float) * elements / (1024 * 1024)<<" MB less than out of place"<<endl;
+
+	return m_Transform.Init(Device, Context, CMatrixTransform::ELEMENT_FLOAT);
+}
+
+void CMatrixInPlaceTask::ReleaseResources()
+{
+	m_hIn.clear();
+	m_hResult.clear();
+	m_hReference.clear();
+
+	m_dMatrix.Release();
+	m_Transform.Release();
+}
+
+void CMatrixInPlaceTask::ComputeCPU()
+{
+	m_hReference = m_hIn;
+
+	CTimer timer;
+	timer.Start();
+	CMatrixTransform::TransformInPlaceCPU(CMatrixTransform::ROTATE_90, &m_hReference[0], m_N, sizeof(float));
+	timer.Stop();
+
+	CBenchmarkRecord record("MatrixInPlace", "cpu", size_t(m_N) * m_N);
+	record.SetCPU();
+	record.SetTime(timer.GetElapsedMilliseconds(), 1);
+	record.Bytes = 2.0 * double(size_t(m_N) * m_N * sizeof(float));
+	CBenchmarkReporter::Report(record);
+}
+
+void CMatrixInPlaceTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+{
+	m_FailedVariants.clear();
+
+	const size_t bytes = size_t(m_N) * m_N * sizeof(float);
+	const CMatrixTransform::ETransform transforms[3] = { CMatrixTransform::TRANSPOSE, CMatrixTransform::ROTATE_90, CMatrixTransform::ROTATE_270 };
+
+	// ComputeCPU() left the rotation by 90 degrees in m_hReference
+	int referenceTransform = CMatrixTransform::ROTATE_90;
+	unsigned int nIterations = GetIterations(100);
+
+	for(int t = 0; t < 3; t++)
+	{
+		CMatrixTransform::ETransform transform = transforms[t];
+		string variant = CMatrixTransform::GetName(transform);
+		if(!IsVariantSelected("MatrixInPlace", variant))
+			continue;
+
+		cl_int clErr = clEnqueueWriteBuffer(CommandQueue, m_dMatrix.Get(), CL_FALSE, 0, bytes, &m_hIn[0], 0, NULL, NULL);
+		size_t globalWorkSize[2], localWorkSize[3] = { 1, 1, 1 };
+		cl_kernel kernel = m_Transform.PrepareInPlace(transform, m_dMatrix.Get(), m_N, globalWorkSize, localWorkSize);
+		if(clErr != CL_SUCCESS || kernel == nullptr)
+		{
+			m_FailedVariants.push_back(variant);
+			continue;
+		}
+
+		// every launch transforms the result of the previous one, which takes just as long
+		double ms = CLUtil::ProfileKernel(CommandQueue, kernel, 2, globalWorkSize, localWorkSize, nIterations);
+		cout<<variant<<" in place: "<<ms<<" ms, "<<1.0e-6 * 2.0 * double(bytes) / ms<<" GB/s"<<endl;
+
+		CBenchmarkRecord record("MatrixInPlace", variant, size_t(m_N) * m_N);
+		record.SetLocalSize(localWorkSize, 2);
+		record.SetTime(ms, nIterations);
+		record.Bytes = 2.0 * double(bytes);
+		CBenchmarkReporter::Report(record);
+
+		// validate a single launch on the original matrix
+		clErr = clEnqueueWriteBuffer(CommandQueue, m_dMatrix.Get(), CL_FALSE, 0, bytes, &m_hIn[0], 0, NULL, NULL);
+		clErr |= m_Transform.EnqueueInPlace(CommandQueue, transform, m_dMatrix.Get(), m_N);
+		clErr |= clEnqueueReadBuffer(CommandQueue, m_dMatrix.Get(), CL_TRUE, 0, bytes, &m_hResult[0], 0, NULL, NULL);
+		if(referenceTransform != transform)
+		{
+			m_hReference = m_hIn;
+			CMatrixTransform::TransformInPlaceCPU(transform, &m_hReference[0], m_N, sizeof(float));
+			referenceTransform = transform;
+		}
+		if(clErr != CL_SUCCESS || memcmp(&m_hResult[0], &m_hReference[0], bytes) != 0)
+			m_FailedVariants.push_back(variant);
+	}
+}
+
+bool CMatrixInPlaceTask::ValidateResults()
+{
+	for(size_t i = 0; i < m_FailedVariants.size(); i++)
+		cout<<"Results of the in-place "<<m_FailedVariants[i]<<" are incorrect!"<<endl;
+	return m_FailedVariants.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
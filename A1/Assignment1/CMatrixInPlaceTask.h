@@ -17,45 +17,48 @@
                                 dP                                    d8888P  
 ******************************************************************************/
 
-#ifndef _ICOMPUTE_TASK_H
-#define _ICOMPUTE_TASK_H
+#ifndef _CMATRIX_IN_PLACE_TASK_H
+#define _CMATRIX_IN_PLACE_TASK_H
 
-// All OpenCL headers
-#if defined(WIN32)
-    #include <CL/opencl.h>
-#elif defined (__APPLE__) || defined(MACOSX)
-    #include <OpenCL/opencl.h>
-#else
-    #include <CL/cl.h>
-#endif 
+#include "../../Common/IComputeTask.h"
+#include "../../Common/CMatrixTransform.h"
 
-#include "CommonDefs.h"
+#include <string>
+#include <vector>
 
-//! Common interface for the tasks within the assignment.
+//! A1/T2d: In-place transposition and rotation of a square matrix
 /*!
-	Inherit a new class for each computing task.
-	(There are usually more tasks in each assignment).
+	Only one N x N buffer lives on the device, the kernels swap the tiles the transform
+	exchanges (see CMatrixTransform::EnqueueInPlace()). Runs "Transpose", "Rotate90" and
+	"Rotate270", validated against the cache-oblivious in-place CPU reference.
 */
-class IComputeTask
+class CMatrixInPlaceTask : public IComputeTask
 {
 public:
+	CMatrixInPlaceTask(unsigned int N);
+	virtual ~CMatrixInPlaceTask();
 
-	virtual ~IComputeTask() {};
-	
-	//! Init any resources specific to the current task
-	virtual bool InitResources(cl_device_id Device, cl_context Context) = 0;
+	// IComputeTask
+	virtual bool InitResources(cl_device_id Device, cl_context Context);
 
-	//! Release everything allocated in InitResources()
-	virtual void ReleaseResources() = 0;
+	virtual void ReleaseResources();
 
-	//! Perform calculations on the GPU
-	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]) = 0;
+	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
 
-	//! Compute the "golden" solution on the CPU. The GPU results must be equal to this reference
-	virtual void ComputeCPU() = 0;
+	virtual void ComputeCPU();
 
-	//! Compare the GPU solution to the "golden" solution
-	virtual bool ValidateResults() = 0;
+	virtual bool ValidateResults();
+
+protected:
+	unsigned int		m_N;
+
+	std::vector<float>	m_hIn, m_hResult, m_hReference;
+
+	//the only device buffer, transformed in place
+	CPooledBuffer		m_dMatrix;
+	CMatrixTransform	m_Transform;
+
+	std::vector<std::string> m_FailedVariants;
 };
 
-#endif // _ICOMPUTE_TASK_H
+#endif // _CMATRIX_IN_PLACE_TASK_H
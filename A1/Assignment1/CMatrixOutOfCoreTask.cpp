@@ -0,0 +1,133 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CMatrixOutOfCoreTask.h"
+
+#include "../../Common/CLUtil.h"
+#include "../../Common/CBenchmarkReporter.h"
+#include "../../Common/CTimer.h"
+
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CMatrixOutOfCoreTask
+
+CMatrixOutOfCoreTask::CMatrixOutOfCoreTask(size_t SizeX, size_t SizeY, size_t WorkingSetBytes, unsigned int NBuffers)
+	: m_SizeX(SizeX), m_SizeY(SizeY), m_WorkingSetBytes(WorkingSetBytes), m_NBuffers(NBuffers)
+{
+}
+
+CMatrixOutOfCoreTask::~CMatrixOutOfCoreTask()
+{
+	ReleaseResources();
+}
+
+bool CMatrixOutOfCoreTask::InitResources(cl_device_id Device, cl_context Context)
+{
+	//CPU resources
+	//(pinned memory lets the transfers overlap, but the driver might not pin this much)
+	size_t bytes = m_SizeX * m_SizeY * sizeof(float);
+	if(!m_HostIn.Allocate(Device, Context, bytes, CHostBuffer::HOST_PINNED) || !m_HostOut.Allocate(Device, Context, bytes, CHostBuffer::HOST_PINNED))
+	{
+		cout<<"Could not pin "<<2 * bytes / (1024 * 1024)<<" MB of host memory, using pageable memory."<<endl;
+		if(!m_HostIn.Allocate(Device, Context, bytes, CHostBuffer::HOST_PAGEABLE) || !m_HostOut.Allocate(Device, Context, bytes, CHostBuffer::HOST_PAGEABLE))
+		{
+			cerr<<"Failed to allocate the host matrices."<<endl;
+			return false;
+		}
+	}
+	m_hReference.resize(m_SizeX * m_SizeY);
+
+	float* pIn = m_HostIn.As<float>();
+	for(size_t i = 0; i < m_SizeX * m_SizeY; i++)
+		pIn[i] = float(rand()) / float(RAND_MAX);
+
+	//the device buffers are created per transform, only the working set lives on the device
+	return m_Transform.Init(Device, Context, CMatrixTransform::ELEMENT_FLOAT);
+}
+
+void CMatrixOutOfCoreTask::ReleaseResources()
+{
+	m_HostIn.Release();
+	m_HostOut.Release();
+	m_hReference.clear();
+	m_Transform.Release();
+}
+
+void CMatrixOutOfCoreTask::ComputeCPU()
+{
+	CTimer timer;
+	timer.Start();
+	CMatrixTransform::TransformCPU(CMatrixTransform::ROTATE_90, m_HostIn.GetPtr(), &m_hReference[0], (unsigned int)m_SizeX, (unsigned int)m_SizeY, sizeof(float));
+	timer.Stop();
+
+	CBenchmarkRecord record("MatrixOutOfCore", "cpu", m_SizeX * m_SizeY);
+	record.SetCPU();
+	record.SetTime(timer.GetElapsedMilliseconds(), 1);
+	record.Bytes = 2.0 * double(m_SizeX * m_SizeY * sizeof(float));
+	CBenchmarkReporter::Report(record);
+}
+
+void CMatrixOutOfCoreTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+{
+	m_FailedVariants.clear();
+
+	// ComputeCPU() left the rotation by 90 degrees in m_hReference
+	int referenceTransform = CMatrixTransform::ROTATE_90;
+	double bytes = 2.0 * double(m_SizeX * m_SizeY * sizeof(float));
+
+	for(int t = 0; t < CMatrixTransform::TRANSFORM_COUNT; t++)
+	{
+		CMatrixTransform::ETransform transform = (CMatrixTransform::ETransform)t;
+		string variant = CMatrixTransform::GetName(transform);
+		if(!IsVariantSelected("MatrixOutOfCore", variant))
+			continue;
+
+		CMatrixTransform::COutOfCoreStatistics statistics;
+		if(!m_Transform.TransformOutOfCore(CommandQueue, transform, m_HostIn.GetPtr(), m_HostOut.GetPtr(), m_SizeX, m_SizeY,
+			m_WorkingSetBytes, m_NBuffers, &statistics))
+		{
+			m_FailedVariants.push_back(variant);
+			continue;
+		}
+
+		double ms = statistics.Milliseconds;
+		cout<<variant<<" out-of-core: "<<statistics.NBlocks<<" blocks of "<<statistics.BlockSizeX<<" x "<<statistics.BlockSizeY
+			<<", "<<statistics.WorkingSetBytes / (1024 * 1024)<<" MB on the device"<<endl;
+		cout<<"  end-to-end time: "<<ms<<" ms, throughput: "<<1.0e-6 * bytes / ms<<" GB/s"<<endl;
+
+		// 1.0: the pipeline takes only as long as its slowest stage, 0.0: fully serialized
+		double serialMs = statistics.UploadMs + statistics.ComputeMs + statistics.DownloadMs;
+		double boundMs = std::max(statistics.UploadMs, std::max(statistics.ComputeMs, statistics.DownloadMs));
+		double efficiency = (serialMs > boundMs) ? (serialMs - ms) / (serialMs - boundMs) : 1.0;
+		cout<<"  device time upload: "<<statistics.UploadMs<<" ms, transform: "<<statistics.ComputeMs<<" ms, download: "
+			<<statistics.DownloadMs<<" ms, overlap efficiency: "<<100.0 * std::max(0.0, std::min(1.0, efficiency))<<"%"<<endl;
+
+		CBenchmarkRecord record("MatrixOutOfCore", variant, m_SizeX * m_SizeY);
+		record.SetTime(ms, 1);
+		record.Bytes = bytes;
+		CBenchmarkReporter::Report(record);
+
+		if(referenceTransform != transform)
+		{
+			CMatrixTransform::TransformCPU(transform, m_HostIn.GetPtr(), &m_hReference[0], (unsigned int)m_SizeX, (unsigned int)m_SizeY, sizeof(float));
+			referenceTransform = transform;
+		}
+		if(memcmp(m_HostOut.GetPtr(), &m_hReference[0], m_SizeX * m_SizeY * sizeof(float)) != 0)
+			m_FailedVariants.push_back(variant);
+	}
+}
+
+bool CMatrixOutOfCoreTask::ValidateResults()
+{
+	for(size_t i = 0; i < m_FailedVariants.size(); i++)
+		cout<<"Results of the out-of-core "<<m_FailedVariants[i]<<" are incorrect!"<<endl;
+	return m_FailedVariants.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
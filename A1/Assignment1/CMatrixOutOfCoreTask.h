@@ -17,45 +17,52 @@
                                 dP                                    d8888P  
 ******************************************************************************/
 
-#ifndef _ICOMPUTE_TASK_H
-#define _ICOMPUTE_TASK_H
+#ifndef _CMATRIX_OUT_OF_CORE_TASK_H
+#define _CMATRIX_OUT_OF_CORE_TASK_H
 
-// All OpenCL headers
-#if defined(WIN32)
-    #include <CL/opencl.h>
-#elif defined (__APPLE__) || defined(MACOSX)
-    #include <OpenCL/opencl.h>
-#else
-    #include <CL/cl.h>
-#endif 
+#include "../../Common/IComputeTask.h"
+#include "../../Common/CHostBuffer.h"
+#include "../../Common/CMatrixTransform.h"
 
-#include "CommonDefs.h"
+#include <string>
+#include <vector>
 
-//! Common interface for the tasks within the assignment.
+//! A1/T2c: Rotation of matrices larger than the device memory
 /*!
-	Inherit a new class for each computing task.
-	(There are usually more tasks in each assignment).
+	The matrix only lives in (pinned) host memory and streams through a device working
+	set of WorkingSetBytes, see CMatrixTransform::TransformOutOfCore(). Every transform
+	runs as its own variant, e.g. "Rotate90".
 */
-class IComputeTask
+class CMatrixOutOfCoreTask : public IComputeTask
 {
 public:
+	CMatrixOutOfCoreTask(size_t SizeX, size_t SizeY, size_t WorkingSetBytes, unsigned int NBuffers = 2);
+	virtual ~CMatrixOutOfCoreTask();
 
-	virtual ~IComputeTask() {};
-	
-	//! Init any resources specific to the current task
-	virtual bool InitResources(cl_device_id Device, cl_context Context) = 0;
+	// IComputeTask
+	virtual bool InitResources(cl_device_id Device, cl_context Context);
 
-	//! Release everything allocated in InitResources()
-	virtual void ReleaseResources() = 0;
+	virtual void ReleaseResources();
 
-	//! Perform calculations on the GPU
-	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]) = 0;
+	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
 
-	//! Compute the "golden" solution on the CPU. The GPU results must be equal to this reference
-	virtual void ComputeCPU() = 0;
+	virtual void ComputeCPU();
 
-	//! Compare the GPU solution to the "golden" solution
-	virtual bool ValidateResults() = 0;
+	virtual bool ValidateResults();
+
+protected:
+	size_t				m_SizeX;
+	size_t				m_SizeY;
+	size_t				m_WorkingSetBytes;
+	unsigned int		m_NBuffers;
+
+	//the input and the GPU result, pinned if possible
+	CHostBuffer			m_HostIn, m_HostOut;
+	std::vector<float>	m_hReference;
+
+	CMatrixTransform	m_Transform;
+
+	std::vector<std::string> m_FailedVariants;
 };
 
-#endif // _ICOMPUTE_TASK_H
+#endif // _CMATRIX_OUT_OF_CORE_TASK_H
@@ -5,9 +5,14 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "CMatrixRotateTask.h"
 
-#include "../Common/CLUtil.h"
+#include "../../Common/CLUtil.h"
+#include "../../Common/CKernelLibrary.h"
+#include "../../Common/CBenchmarkReporter.h"
+#include "../../Common/CThreadPool.h"
+#include "../../Common/CTimer.h"
 
 #include <string.h>
+#include <algorithm>
 
 using namespace std;
 
@@ -15,8 +20,8 @@ using namespace std;
 // CMatrixRotateTask
 
 CMatrixRotateTask::CMatrixRotateTask(size_t SizeX, size_t SizeY)
-	:m_SizeX(SizeX), m_SizeY(SizeY), m_hM(NULL), m_hMR(NULL), m_dM(NULL),
-	m_dMR(NULL), m_hGPUResultNaive(NULL), m_hGPUResultOpt(NULL), m_Program(NULL),
+	:m_SizeX(SizeX), m_SizeY(SizeY), m_hM(NULL), m_hMR(NULL),
+	m_hGPUResultNaive(NULL), m_hGPUResultOpt(NULL), m_Program(NULL),
 	m_NaiveKernel(NULL), m_OptimizedKernel(NULL)
 {
 }
@@ -43,19 +48,13 @@ bool CMatrixRotateTask::InitResources(cl_device_id Device, cl_context Context)
 
 	// TO DO: allocate all device resources here
 	cl_int clError;
-	m_dM = clCreateBuffer (Context, CL_MEM_READ_ONLY, sizeof(cl_int) *(m_SizeX * m_SizeY), NULL, &clError);
+	m_dM = AcquireBuffer(Context, CL_MEM_READ_ONLY, sizeof(cl_int) *(m_SizeX * m_SizeY), &clError);
 	V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dM.");
 	
-	m_dMR = clCreateBuffer(Context, CL_MEM_WRITE_ONLY, sizeof(cl_int) *(m_SizeX * m_SizeY), NULL, &clError);
+	m_dMR = AcquireBuffer(Context, CL_MEM_WRITE_ONLY, sizeof(cl_int) *(m_SizeX * m_SizeY), &clError);
 	V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dMR.");
 
-	//size_t programSize = 0;
-	string programCode;
-	
-	if (!CLUtil::LoadProgramSourceToMemory("MatrixRot.cl", programCode)) {
-		return false;
-	}
-	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode);
+	m_Program = CKernelLibrary::GetProgram(Device, Context, "MatrixRot.cl");
 	if(m_Program == nullptr) {
 		return false;
 	}
@@ -65,8 +64,8 @@ bool CMatrixRotateTask::InitResources(cl_device_id Device, cl_context Context)
 
 	//TO DO: bind kernel arguments
 	
-	clError = clSetKernelArg(m_NaiveKernel, 0, sizeof(cl_mem), (void*)&m_dM);
-	clError = clSetKernelArg(m_NaiveKernel, 1, sizeof(cl_mem), (void*)&m_dMR);
+	clError = clSetKernelArg(m_NaiveKernel, 0, sizeof(cl_mem), (void*)&m_dM.Get());
+	clError = clSetKernelArg(m_NaiveKernel, 1, sizeof(cl_mem), (void*)&m_dMR.Get());
 	clError = clSetKernelArg(m_NaiveKernel, 2, sizeof(cl_int), (void*)&m_SizeX);
 	clError = clSetKernelArg(m_NaiveKernel, 3, sizeof(cl_int), (void*)&m_SizeY);
 	V_RETURN_FALSE_CL(clError, "Failed to set KernelArgs: MatrixRotNaive");	
@@ -76,12 +75,27 @@ bool CMatrixRotateTask::InitResources(cl_device_id Device, cl_context Context)
 
 	//TO DO: bind kernel arguments
 	
-	clError = clSetKernelArg(m_OptimizedKernel, 0, sizeof(cl_mem), (void*)&m_dM);
-	clError = clSetKernelArg(m_OptimizedKernel, 1, sizeof(cl_mem), (void*)&m_dMR);
+	clError = clSetKernelArg(m_OptimizedKernel, 0, sizeof(cl_mem), (void*)&m_dM.Get());
+	clError = clSetKernelArg(m_OptimizedKernel, 1, sizeof(cl_mem), (void*)&m_dMR.Get());
 	clError = clSetKernelArg(m_OptimizedKernel, 2, sizeof(cl_int), (void*)&m_SizeX);
 	clError = clSetKernelArg(m_OptimizedKernel, 3, sizeof(cl_int), (void*)&m_SizeY);
 	V_RETURN_FALSE_CL(clError, "Failed to set KernelArgs: MatrixRot");	
 
+	// the buffers of the layout transforms are big enough for the largest element type
+	size_t transformBytes = size_t(m_SizeX) * m_SizeY * CMatrixTransform::GetElementSize(CMatrixTransform::ELEMENT_FLOAT4);
+	m_hTransformIn.resize(transformBytes);
+	for(size_t i = 0; i < transformBytes; i++)
+		m_hTransformIn[i] = (unsigned char)(rand() & 0xff);
+
+	m_dTransformIn = AcquireBuffer(Context, CL_MEM_READ_ONLY, transformBytes, &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dTransformIn.");
+	m_dTransformOut = AcquireBuffer(Context, CL_MEM_WRITE_ONLY, transformBytes, &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dTransformOut.");
+
+	for(int type = 0; type < CMatrixTransform::ELEMENT_TYPE_COUNT; type++)
+		if(!m_Transforms[type].Init(Device, Context, (CMatrixTransform::EElementType)type))
+			return false;
+
 	return true;
 }
 
@@ -94,8 +108,14 @@ void CMatrixRotateTask::ReleaseResources()
 	SAFE_DELETE_ARRAY(m_hGPUResultOpt);
 
 	// TO DO: release device resources
-	SAFE_RELEASE_MEMOBJECT(m_dM);
-	SAFE_RELEASE_MEMOBJECT(m_dMR);
+	m_dM.Release();
+	m_dMR.Release();
+
+	m_hTransformIn.clear();
+	m_dTransformIn.Release();
+	m_dTransformOut.Release();
+	for(int type = 0; type < CMatrixTransform::ELEMENT_TYPE_COUNT; type++)
+		m_Transforms[type].Release();
 }
 
 void CMatrixRotateTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
@@ -103,7 +123,7 @@ void CMatrixRotateTask::ComputeGPU(cl_context Context, cl_command_queue CommandQ
 	// TO DO: write input data to the GPU
 
 	cl_int clErr = 0;
-	clErr |= clEnqueueWriteBuffer(CommandQueue, m_dM, CL_FALSE, 0, (m_SizeX * m_SizeY) * sizeof(int), m_hM , 0, NULL, NULL);
+	clErr |= clEnqueueWriteBuffer(CommandQueue, m_dM.Get(), CL_FALSE, 0, (m_SizeX * m_SizeY) * sizeof(int), m_hM , 0, NULL, NULL);
 	V_RETURN_CL(clErr, "Failed to write buffer from m_hM to m_dM.");
 
 	//clErr |= clEnqueueWriteBuffer(CommandQueue, m_dMR, CL_FALSE, 0, (m_SizeX * m_SizeY) * sizeof(int), m_hMR , 0, NULL, NULL);
@@ -116,24 +136,30 @@ void CMatrixRotateTask::ComputeGPU(cl_context Context, cl_command_queue CommandQ
 	size_t globalWorkSize[2];	
 	size_t nGroups[2];
 	globalWorkSize[0] = CLUtil::GetGlobalWorkSize(m_SizeX, LocalWorkSize[0]);
-	globalWorkSize[1] = CLUtil::GetGlobalWorkSize(m_SizeX, LocalWorkSize[1]);
+	globalWorkSize[1] = CLUtil::GetGlobalWorkSize(m_SizeY, LocalWorkSize[1]);
 	nGroups[0] = globalWorkSize[0] / LocalWorkSize[0];
 	nGroups[1] = globalWorkSize[1] / LocalWorkSize[1];
 	
 	cout<<"Executing ("<<globalWorkSize[0]<<" x "<<globalWorkSize[1]<<") threads in ("<<nGroups[0]<<" x "<<nGroups[1]<<") groups of size ("<<LocalWorkSize[0]<<" x "<<LocalWorkSize[1]<<")."<<endl;
 
-	clErr = clEnqueueNDRangeKernel(CommandQueue, m_NaiveKernel, 2, NULL, globalWorkSize, LocalWorkSize, 0, NULL, NULL);
-	V_RETURN_CL(clErr, "Error executing NaiveKernel!.");
-
-	//Profiling
+	unsigned int nIterations = GetIterations(1000);
 	double time = 0;
-	time = CLUtil::ProfileKernel(CommandQueue, m_NaiveKernel, 2, globalWorkSize, LocalWorkSize, 1000);
-	//time /= 1000;
-	cout<<"Executed naive kernel 1000x in "<<time<<" ms."<<endl;
+
+	if(IsVariantSelected("MatrixRotate", "MatrixRotNaive"))
+	{
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_NaiveKernel, 2, NULL, globalWorkSize, LocalWorkSize, 0, NULL, NULL);
+		V_RETURN_CL(clErr, "Error executing NaiveKernel!.");
+
+		//Profiling
+		time = CLUtil::ProfileKernel(CommandQueue, m_NaiveKernel, 2, globalWorkSize, LocalWorkSize, nIterations);
+		//time /= 1000;
+		cout<<"Executed naive kernel "<<nIterations<<"x, average "<<time<<" ms."<<endl;
+		ReportTime("MatrixRotNaive", time, nIterations, LocalWorkSize);
 	
-	// TO DO: read back the results synchronously.
-	//this command has to be blocking, since we want to check the valid data
-	clErr = clEnqueueReadBuffer(CommandQueue, m_dMR, CL_TRUE, 0, (m_SizeX * m_SizeY) * sizeof(int), m_hGPUResultNaive, 0, NULL, NULL);
+		// TO DO: read back the results synchronously.
+		//this command has to be blocking, since we want to check the valid data
+		clErr = clEnqueueReadBuffer(CommandQueue, m_dMR.Get(), CL_TRUE, 0, (m_SizeX * m_SizeY) * sizeof(int), m_hGPUResultNaive, 0, NULL, NULL);
+	}
 
 
 
@@ -141,46 +167,133 @@ void CMatrixRotateTask::ComputeGPU(cl_context Context, cl_command_queue CommandQ
 
 	//optimized kernel
 	
-	// TO DO: allocate shared (local) memory for the kernel
-	clErr = clSetKernelArg(m_OptimizedKernel, 4, LocalWorkSize[0] * LocalWorkSize[1] * sizeof(float), NULL);
-	V_RETURN_CL(clErr, "Error allocating shared memory!");
+	if(IsVariantSelected("MatrixRotate", "MatrixRotOptimized"))
+	{
+		// TO DO: allocate shared (local) memory for the kernel
+		clErr = clSetKernelArg(m_OptimizedKernel, 4, LocalWorkSize[0] * LocalWorkSize[1] * sizeof(float), NULL);
+		V_RETURN_CL(clErr, "Error allocating shared memory!");
 	
-	time = 0;
-	// run kernel
-	clErr = clEnqueueNDRangeKernel(CommandQueue, m_OptimizedKernel, 2, NULL, globalWorkSize, LocalWorkSize, 0, NULL, NULL);
-	V_RETURN_CL(clErr, "Error executing OptimizedKernel!.");
-	// TO DO: time = GLUtil::ProfileKernel...
-	time = CLUtil::ProfileKernel(CommandQueue, m_OptimizedKernel, 2, globalWorkSize, LocalWorkSize, 1000);
-	cout<<"Executed optimized kernel 1000x in "<<time<<" ms."<<endl;
-
-	// TO DO: read back the data to the host
-	clErr = clEnqueueReadBuffer(CommandQueue, m_dMR, CL_TRUE, 0, (m_SizeX * m_SizeY) * sizeof(int), m_hGPUResultOpt, 0, NULL, NULL);
+		time = 0;
+		// run kernel
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_OptimizedKernel, 2, NULL, globalWorkSize, LocalWorkSize, 0, NULL, NULL);
+		V_RETURN_CL(clErr, "Error executing OptimizedKernel!.");
+		// TO DO: time = GLUtil::ProfileKernel...
+		time = CLUtil::ProfileKernel(CommandQueue, m_OptimizedKernel, 2, globalWorkSize, LocalWorkSize, nIterations);
+		cout<<"Executed optimized kernel "<<nIterations<<"x, average "<<time<<" ms."<<endl;
+		ReportTime("MatrixRotOptimized", time, nIterations, LocalWorkSize);
+
+		// TO DO: read back the data to the host
+		clErr = clEnqueueReadBuffer(CommandQueue, m_dMR.Get(), CL_TRUE, 0, (m_SizeX * m_SizeY) * sizeof(int), m_hGPUResultOpt, 0, NULL, NULL);
+	}
+
+	ComputeGPUTransforms(CommandQueue);
 }
 
-void CMatrixRotateTask::ComputeCPU()
+void CMatrixRotateTask::ComputeGPUTransforms(cl_command_queue CommandQueue)
 {
-	for(unsigned int x = 0; x < m_SizeX; x++)
+	m_FailedTransforms.clear();
+
+	cl_int clErr = clEnqueueWriteBuffer(CommandQueue, m_dTransformIn.Get(), CL_FALSE, 0, m_hTransformIn.size(), &m_hTransformIn[0], 0, NULL, NULL);
+	V_RETURN_CL(clErr, "Failed to write buffer from m_hTransformIn to m_dTransformIn.");
+
+	unsigned int nIterations = GetIterations(100);
+	vector<unsigned char> result(m_hTransformIn.size()), reference(m_hTransformIn.size());
+	for(int type = 0; type < CMatrixTransform::ELEMENT_TYPE_COUNT; type++)
 	{
-		for(unsigned int y = 0; y < m_SizeY; y++)
+		CMatrixTransform& transforms = m_Transforms[type];
+		size_t elementSize = CMatrixTransform::GetElementSize(transforms.GetElementType());
+		size_t bytes = size_t(m_SizeX) * m_SizeY * elementSize;
+
+		for(int t = 0; t < CMatrixTransform::TRANSFORM_COUNT; t++)
 		{
-			m_hMR[ x * m_SizeY + (m_SizeY - y - 1) ] = m_hM[ y * m_SizeX + x ];
+			CMatrixTransform::ETransform transform = (CMatrixTransform::ETransform)t;
+			string variant = string(CMatrixTransform::GetName(transform)) + "/" + CMatrixTransform::GetTypeName(transforms.GetElementType());
+			if(!IsVariantSelected("MatrixRotate", variant))
+				continue;
+
+			size_t globalWorkSize[2], localWorkSize[3] = { 1, 1, 1 };
+			cl_kernel kernel = transforms.Prepare(transform, m_dTransformIn.Get(), m_dTransformOut.Get(), m_SizeX, m_SizeY, globalWorkSize, localWorkSize);
+			if(kernel == nullptr)
+			{
+				m_FailedTransforms.push_back(variant);
+				continue;
+			}
+
+			double time = CLUtil::ProfileKernel(CommandQueue, kernel, 2, globalWorkSize, localWorkSize, nIterations);
+			cout<<variant<<": "<<time<<" ms, "<<1.0e-6 * 2.0 * double(bytes) / time<<" GB/s"<<endl;
+			ReportTime(variant, time, nIterations, localWorkSize, elementSize);
+
+			clErr = clEnqueueReadBuffer(CommandQueue, m_dTransformOut.Get(), CL_TRUE, 0, bytes, &result[0], 0, NULL, NULL);
+			CMatrixTransform::TransformCPU(transform, &m_hTransformIn[0], &reference[0], m_SizeX, m_SizeY, elementSize);
+			if(clErr != CL_SUCCESS || memcmp(&result[0], &reference[0], bytes) != 0)
+				m_FailedTransforms.push_back(variant);
 		}
 	}
 }
 
+void CMatrixRotateTask::ReportTime(const std::string& Variant, double Milliseconds, unsigned int Iterations, size_t LocalWorkSize[3], size_t ElementSize)
+{
+	CBenchmarkRecord record("MatrixRotate", Variant, m_SizeX * m_SizeY);
+	record.SetLocalSize(LocalWorkSize, 2);
+	record.SetTime(Milliseconds, Iterations);
+	record.Bytes = 2.0 * double(size_t(m_SizeX) * m_SizeY * ElementSize);
+	CBenchmarkReporter::Report(record);
+}
+
+void CMatrixRotateTask::ComputeCPU()
+{
+	CTimer timer;
+	timer.Start();
+
+	// blocked, so both the reads and the writes of a block stay in the cache;
+	// every thread writes whole rows of the rotated matrix
+	const unsigned int blockSize = 32;
+	const float* pM = m_hM;
+	float* pMR = m_hMR;
+	unsigned int sizeX = m_SizeX;
+	unsigned int sizeY = m_SizeY;
+	CThreadPool::ParallelFor(0, (sizeX + blockSize - 1) / blockSize, [=](size_t BlockBegin, size_t BlockEnd) {
+		for(unsigned int bx = (unsigned int)BlockBegin * blockSize; bx < BlockEnd * blockSize && bx < sizeX; bx += blockSize)
+		{
+			unsigned int xEnd = std::min(bx + blockSize, sizeX);
+			for(unsigned int by = 0; by < sizeY; by += blockSize)
+			{
+				unsigned int yEnd = std::min(by + blockSize, sizeY);
+				for(unsigned int x = bx; x < xEnd; x++)
+				{
+					for(unsigned int y = by; y < yEnd; y++)
+					{
+						pMR[ x * sizeY + (sizeY - y - 1) ] = pM[ y * sizeX + x ];
+					}
+				}
+			}
+		}
+	});
+
+	timer.Stop();
+
+	CBenchmarkRecord record("MatrixRotate", "cpu", m_SizeX * m_SizeY);
+	record.SetCPU();
+	record.SetTime(timer.GetElapsedMilliseconds(), 1);
+	record.Bytes = 2.0 * double(m_SizeX * m_SizeY * sizeof(float));
+	CBenchmarkReporter::Report(record);
+}
+
 bool CMatrixRotateTask::ValidateResults()
 {
-	if(!(memcmp(m_hMR, m_hGPUResultNaive, m_SizeX * m_SizeY * sizeof(float)) == 0))
+	if(IsVariantSelected("MatrixRotate", "MatrixRotNaive") && !(memcmp(m_hMR, m_hGPUResultNaive, m_SizeX * m_SizeY * sizeof(float)) == 0))
 	{
 		cout<<"Results of the naive kernel are incorrect!"<<endl;
 		return false;
 	}
-	if(!(memcmp(m_hMR, m_hGPUResultOpt, m_SizeX * m_SizeY * sizeof(float)) == 0))
+	if(IsVariantSelected("MatrixRotate", "MatrixRotOptimized") && !(memcmp(m_hMR, m_hGPUResultOpt, m_SizeX * m_SizeY * sizeof(float)) == 0))
 	{
 		cout<<"Results of the optimized kernel are incorrect!"<<endl;
 		return false;
 	}
-	return true;
+	for(size_t i = 0; i < m_FailedTransforms.size(); i++)
+		cout<<"Results of "<<m_FailedTransforms[i]<<" are incorrect!"<<endl;
+	return m_FailedTransforms.empty();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -20,9 +20,17 @@
 #ifndef _CMATRIX_ROTATE_TASK_H
 #define _CMATRIX_ROTATE_TASK_H
 
-#include "../Common/IComputeTask.h"
+#include "../../Common/IComputeTask.h"
+#include "../../Common/CMatrixTransform.h"
+
+#include <string>
+#include <vector>
 
 //! A1/T2: Matrix rotation
+/*!
+	Besides the two rotation kernels of the assignment, every transform of
+	CMatrixTransform runs for every element type, e.g. the variant "Rotate270/half".
+*/
 class CMatrixRotateTask : public IComputeTask
 {
 public:
@@ -41,6 +49,11 @@ public:
 	virtual bool ValidateResults();
 
 protected:
+	void ReportTime(const std::string& Variant, double Milliseconds, unsigned int Iterations, size_t LocalWorkSize[3], size_t ElementSize = sizeof(float));
+
+	//! Runs and validates the selected transforms of the layout transform library
+	void ComputeGPUTransforms(cl_command_queue CommandQueue);
+
 	//NOTE: we have two memory address spaces, so we mark pointers with a prefix
 	//to avoid confusions: 'h' - host, 'd' - device
 
@@ -53,7 +66,7 @@ protected:
 
 	//pointers on the GPU
 	//(result buffers for both kernels)
-	cl_mem				m_dM, m_dMR;
+	CPooledBuffer		m_dM, m_dMR;
 	//(..and a pointer to read back the result)
 	float				*m_hGPUResultNaive, *m_hGPUResultOpt;
 
@@ -61,6 +74,12 @@ protected:
 	cl_program			m_Program;
 	cl_kernel			m_NaiveKernel;
 	cl_kernel			m_OptimizedKernel;
+
+	//layout transform library: one instance per element type, the input is random bytes
+	CMatrixTransform	m_Transforms[CMatrixTransform::ELEMENT_TYPE_COUNT];
+	std::vector<unsigned char> m_hTransformIn;
+	CPooledBuffer		m_dTransformIn, m_dTransformOut;
+	std::vector<std::string> m_FailedTransforms;
 };
 
 #endif // _CMATRIX_ROTATE_TASK_H
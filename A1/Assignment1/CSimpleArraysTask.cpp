@@ -5,12 +5,39 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "CSimpleArraysTask.h"
 
-#include "../Common/CLUtil.h"
+#include "../../Common/CLUtil.h"
+#include "../../Common/CKernelLibrary.h"
+#include "../../Common/CTimer.h"
+#include "../../Common/CBenchmarkReporter.h"
+#include "../../Common/CThreadPool.h"
 
 #include <string.h>
+#include <vector>
+#include <algorithm>
+#include <sstream>
 
 using namespace std;
 
+// the variants of VecAdd in VectorAdd.cl: elements per work-item, grid-stride loop
+static const struct
+{
+	const char*		Name;
+	unsigned int	Width;
+	bool			GridStride;
+} g_Variants[] = {
+	{ "VecAdd4", 4, false },
+	{ "VecAdd8", 8, false },
+	{ "VecAdd16", 16, false },
+	{ "VecAddGridStride", 1, true },
+	{ "VecAdd4GridStride", 4, true },
+	{ "VecAdd8GridStride", 8, true },
+	{ "VecAdd16GridStride", 16, true },
+};
+static const unsigned int g_NVariants = sizeof(g_Variants) / sizeof(g_Variants[0]);
+
+// enough resident groups per compute unit to hide the memory latency
+static const size_t c_GroupsPerComputeUnit = 4;
+
 ///////////////////////////////////////////////////////////////////////////////
 // CSimpleArraysTask
 
@@ -27,10 +54,19 @@ CSimpleArraysTask::~CSimpleArraysTask()
 bool CSimpleArraysTask::InitResources(cl_device_id Device, cl_context Context)
 {
 	//CPU resources
-	m_hA = new int[m_ArraySize];
-	m_hB = new int[m_ArraySize];
+	//(everything that is transferred lives in pageable, pinned or zero-copy host memory)
+	size_t arrayBytes = sizeof(cl_int) * m_ArraySize;
+	if(!m_HostA.Allocate(Device, Context, arrayBytes, m_HostMode) ||
+		!m_HostB.Allocate(Device, Context, arrayBytes, m_HostMode) ||
+		!m_HostResult.Allocate(Device, Context, arrayBytes, m_HostMode))
+	{
+		cerr<<"Failed to allocate "<<CHostBuffer::GetModeName(m_HostMode)<<" host memory."<<endl;
+		return false;
+	}
+	m_hA = m_HostA.As<int>();
+	m_hB = m_HostB.As<int>();
 	m_hC = new int[m_ArraySize];
-	m_hGPUResult = new int[m_ArraySize];
+	m_hGPUResult = m_HostResult.As<int>();
 	
 	//fill A and B with random integers
 	for(unsigned int i = 0; i < m_ArraySize; i++)
@@ -45,14 +81,29 @@ bool CSimpleArraysTask::InitResources(cl_device_id Device, cl_context Context)
 	// Sect. 4.5
 	
 	cl_int clError;
-	m_dA = clCreateBuffer (Context, CL_MEM_READ_ONLY, sizeof(cl_int) *m_ArraySize, NULL, &clError);
-	V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dA.");
+	cl_mem dA, dB, dC;
+	if(m_HostA.GetMode() == CHostBuffer::HOST_ZERO_COPY)
+	{
+		// the kernel works on the host arrays directly
+		dA = m_HostA.GetDeviceBuffer();
+		dB = m_HostB.GetDeviceBuffer();
+		dC = m_HostResult.GetDeviceBuffer();
+	}
+	else
+	{
+		m_dA = AcquireBuffer(Context, CL_MEM_READ_ONLY, sizeof(cl_int) *m_ArraySize, &clError);
+		V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dA.");
+
+		m_dB = AcquireBuffer(Context, CL_MEM_READ_ONLY, sizeof(cl_int) *m_ArraySize, &clError);
+		V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dB.");
 
-	m_dB = clCreateBuffer(Context, CL_MEM_READ_ONLY, sizeof(cl_int) *m_ArraySize, NULL, &clError);
-	V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dB.");
+		m_dC = AcquireBuffer(Context, CL_MEM_WRITE_ONLY, sizeof(cl_int) *m_ArraySize, &clError);
+		V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dC.");
 
-	m_dC = clCreateBuffer(Context, CL_MEM_WRITE_ONLY, sizeof(cl_int) *m_ArraySize, NULL, &clError);
-	V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dC.");
+		dA = m_dA.Get();
+		dB = m_dB.Get();
+		dC = m_dC.Get();
+	}
 
 	
 
@@ -61,13 +112,7 @@ bool CSimpleArraysTask::InitResources(cl_device_id Device, cl_context Context)
 	// Sect. 4.6.
 	
 	//TO DO: load and compile kernels
-	//size_t programSize = 0;
-	string programCode;
-	
-	if (!CLUtil::LoadProgramSourceToMemory("VectorAdd.cl", programCode)) {
-		return false;
-	}
-	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode);
+	m_Program = CKernelLibrary::GetProgram(Device, Context, "VectorAdd.cl");
 	if(m_Program == nullptr) {
 		return false;
 	}
@@ -77,12 +122,42 @@ bool CSimpleArraysTask::InitResources(cl_device_id Device, cl_context Context)
 
 	//TO DO: bind kernel arguments
 	
-	clError = clSetKernelArg(m_Kernel, 0, sizeof(cl_mem), (void*)&m_dA);
-	clError = clSetKernelArg(m_Kernel, 1, sizeof(cl_mem), (void*)&m_dB);
-	clError = clSetKernelArg(m_Kernel, 2, sizeof(cl_mem), (void*)&m_dC);
+	clError = clSetKernelArg(m_Kernel, 0, sizeof(cl_mem), (void*)&dA);
+	clError = clSetKernelArg(m_Kernel, 1, sizeof(cl_mem), (void*)&dB);
+	clError = clSetKernelArg(m_Kernel, 2, sizeof(cl_mem), (void*)&dC);
 	clError = clSetKernelArg(m_Kernel, 3, sizeof(cl_int), (void*)&m_ArraySize);
 	V_RETURN_FALSE_CL(clError, "Failed to set KernelArgs: VecAdd");	
 
+	// the variants get their own output buffer, so the result of the scalar kernel stays intact
+	m_dVariantC = AcquireBuffer(Context, CL_MEM_WRITE_ONLY, sizeof(cl_int) * m_ArraySize, &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create buffer for m_dVariantC.");
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &m_ComputeUnits, NULL), "Failed to query the compute units.");
+
+	cl_int numElements = (cl_int)m_ArraySize;
+	cl_mem dVariantC = m_dVariantC.Get();
+	for(unsigned int v = 0; v < g_NVariants; v++)
+	{
+		cl_kernel kernel = clCreateKernel(m_Program, g_Variants[v].Name, &clError);
+		V_RETURN_FALSE_CL(clError, (string("Failed to create Kernel: ") + g_Variants[v].Name).c_str());
+		m_VariantKernels.push_back(kernel);
+
+		clError = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&dA);
+		clError |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&dB);
+		clError |= clSetKernelArg(kernel, 2, sizeof(cl_mem), (void*)&dVariantC);
+		clError |= clSetKernelArg(kernel, 3, sizeof(cl_int), (void*)&numElements);
+		V_RETURN_FALSE_CL(clError, (string("Failed to set KernelArgs: ") + g_Variants[v].Name).c_str());
+	}
+
+	if(m_StreamChunkSize > 0)
+	{
+		if(!m_HostStreamResult.Allocate(Device, Context, arrayBytes, m_HostMode == CHostBuffer::HOST_PAGEABLE ? CHostBuffer::HOST_PAGEABLE : CHostBuffer::HOST_PINNED))
+			return false;
+		m_hStreamResult = m_HostStreamResult.As<int>();
+
+		m_ChunkKernel = clCreateKernel(m_Program, "VecAddChunk", &clError);
+		V_RETURN_FALSE_CL(clError, "Failed to create Kernel: VecAddChunk");
+	}
+
 
 	return true;
 }
@@ -90,24 +165,58 @@ bool CSimpleArraysTask::InitResources(cl_device_id Device, cl_context Context)
 void CSimpleArraysTask::ReleaseResources()
 {
 	//CPU resources
-	SAFE_DELETE_ARRAY(m_hA);
-	SAFE_DELETE_ARRAY(m_hB);
 	SAFE_DELETE_ARRAY(m_hC);
-	SAFE_DELETE_ARRAY(m_hGPUResult);
+	m_hA = m_hB = m_hGPUResult = m_hStreamResult = nullptr;
 
 	/////////////////////////////////////////////////
 	// Sect. 4.5., 4.6.	
-	SAFE_RELEASE_MEMOBJECT(m_dA);
-	SAFE_RELEASE_MEMOBJECT(m_dB);
-	SAFE_RELEASE_MEMOBJECT(m_dC);
+	m_dA.Release();
+	m_dB.Release();
+	m_dC.Release();
+	m_dVariantC.Release();
+
+	m_HostA.Release();
+	m_HostB.Release();
+	m_HostResult.Release();
+	m_HostStreamResult.Release();
+
+	SAFE_RELEASE_KERNEL(m_Kernel);
+	SAFE_RELEASE_KERNEL(m_ChunkKernel);
+	for(size_t v = 0; v < m_VariantKernels.size(); v++)
+		SAFE_RELEASE_KERNEL(m_VariantKernels[v]);
+	m_VariantKernels.clear();
+	SAFE_RELEASE_PROGRAM(m_Program);
+}
+
+void CSimpleArraysTask::SetStreaming(size_t ChunkSize, unsigned int NBuffers)
+{
+	m_StreamChunkSize = ChunkSize;
+	m_StreamBuffers = std::max(2u, std::min(NBuffers, 3u));
 }
 
 void CSimpleArraysTask::ComputeCPU()
 {
-	for(unsigned int i = 0; i < m_ArraySize; i++)
-	{
-		m_hC[i] = m_hA[i] + m_hB[m_ArraySize - i - 1];
-	}
+	CTimer timer;
+	timer.Start();
+
+	// local copies, so the compiler knows the loop does not modify them and can vectorize it
+	const int* pA = m_hA;
+	const int* pB = m_hB;
+	int* pC = m_hC;
+	size_t n = m_ArraySize;
+	CThreadPool::ParallelFor(0, n, [=](size_t Begin, size_t End) {
+		for(size_t i = Begin; i < End; i++)
+			pC[i] = pA[i] + pB[n - i - 1];
+	}, 16384);
+
+	timer.Stop();
+
+	CBenchmarkRecord record("VecAdd", "cpu", m_ArraySize);
+	record.SetCPU();
+	record.SetTime(timer.GetElapsedMilliseconds(), 1);
+	record.Bytes = 3.0 * double(m_ArraySize * sizeof(int));
+	record.Flops = double(m_ArraySize);
+	CBenchmarkReporter::Report(record);
 }
 
 void CSimpleArraysTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
@@ -115,11 +224,24 @@ void CSimpleArraysTask::ComputeGPU(cl_context Context, cl_command_queue CommandQ
 	/////////////////////////////////////////////////
 	// Sect. 4.5
 	cl_int clErr = 0;
-	clErr |= clEnqueueWriteBuffer(CommandQueue, m_dA, CL_FALSE, 0, m_ArraySize * sizeof(int), m_hA , 0, NULL, NULL);
-	V_RETURN_CL(clErr, "Failed to write buffer from m_hA to m_dA.");
+	bool zeroCopy = (m_HostA.GetMode() == CHostBuffer::HOST_ZERO_COPY);
+	cl_event uploadEvents[2] = { nullptr, nullptr };
+	cl_event downloadEvent = nullptr;
+
+	if(zeroCopy)
+	{
+		// nothing to transfer, just hand the arrays over to the device
+		if(!m_HostA.UnmapForDevice(CommandQueue) || !m_HostB.UnmapForDevice(CommandQueue) || !m_HostResult.UnmapForDevice(CommandQueue))
+			return;
+	}
+	else
+	{
+		clErr |= clEnqueueWriteBuffer(CommandQueue, m_dA.Get(), CL_FALSE, 0, m_ArraySize * sizeof(int), m_hA , 0, NULL, &uploadEvents[0]);
+		V_RETURN_CL(clErr, "Failed to write buffer from m_hA to m_dA.");
 
-	clErr |= clEnqueueWriteBuffer(CommandQueue, m_dB, CL_FALSE, 0, m_ArraySize * sizeof(int), m_hB , 0, NULL, NULL);
-	V_RETURN_CL(clErr, "Failed to write buffer from m_hB to m_dB.");
+		clErr |= clEnqueueWriteBuffer(CommandQueue, m_dB.Get(), CL_FALSE, 0, m_ArraySize * sizeof(int), m_hB , 0, NULL, &uploadEvents[1]);
+		V_RETURN_CL(clErr, "Failed to write buffer from m_hB to m_dB.");
+	}
 
 
 
@@ -138,22 +260,312 @@ void CSimpleArraysTask::ComputeGPU(cl_context Context, cl_command_queue CommandQ
 	size_t nGroups = globalWorkSize / LocalWorkSize[0];
 	cout<<"Executing "<<globalWorkSize<<" threads in "<<nGroups<<" groups of size "<<LocalWorkSize[0]<<endl;
 
+	unsigned int nIterations = GetIterations(100);
 	double ms = CLUtil::ProfileKernel(CommandQueue, m_Kernel, 1, 
-		&globalWorkSize, LocalWorkSize, 100);
+		&globalWorkSize, LocalWorkSize, nIterations);
 	cout<<"Average execution time: "<<ms<<"ms"<<endl;
 
+	CBenchmarkRecord record("VecAdd", string("VecAdd/") + CHostBuffer::GetModeName(m_HostA.GetMode()), m_ArraySize);
+	record.SetLocalSize(LocalWorkSize, 1);
+	record.SetTime(ms, nIterations);
+	record.Bytes = 3.0 * double(m_ArraySize * sizeof(int));
+	record.Flops = double(m_ArraySize);
+	CBenchmarkReporter::Report(record);
+
 	clErr = clEnqueueNDRangeKernel(CommandQueue, m_Kernel, 1, NULL, &globalWorkSize, LocalWorkSize, 0, NULL, NULL);
 	V_RETURN_CL(clErr, "Error executing kernel!.");
 
+	// while zero-copy inputs are still owned by the device
+	ComputeGPUVariants(CommandQueue, LocalWorkSize, ms);
+
 
 	// TO DO: read back results synchronously.
 	//This command has to be blocking, since we need the data
-	clErr = clEnqueueReadBuffer(CommandQueue, m_dC, CL_TRUE, 0, m_ArraySize * sizeof(int), m_hGPUResult, 0, NULL, NULL);
+	if(zeroCopy)
+	{
+		// mapping the result is blocking and makes the device writes visible to the host
+		if(!m_HostResult.MapForHost(CommandQueue) || !m_HostA.MapForHost(CommandQueue) || !m_HostB.MapForHost(CommandQueue))
+			return;
+		m_hA = m_HostA.As<int>();
+		m_hB = m_HostB.As<int>();
+		m_hGPUResult = m_HostResult.As<int>();
+		cout<<"Zero-copy host memory: no transfers"<<endl;
+	}
+	else
+	{
+		clErr = clEnqueueReadBuffer(CommandQueue, m_dC.Get(), CL_TRUE, 0, m_ArraySize * sizeof(int), m_hGPUResult, 0, NULL, &downloadEvent);
+		V_RETURN_CL(clErr, "Failed to read buffer from m_dC to m_hGPUResult.");
+
+		// transfer bandwidth, measured separately from the kernel time above
+		double uploadMs = CLUtil::GetEventMilliseconds(uploadEvents[0]) + CLUtil::GetEventMilliseconds(uploadEvents[1]);
+		double downloadMs = CLUtil::GetEventMilliseconds(downloadEvent);
+		double arrayGB = 1.0e-9 * double(m_ArraySize * sizeof(int));
+		if(uploadMs > 0.0 && downloadMs > 0.0)
+		{
+			cout<<"Transfers from "<<CHostBuffer::GetModeName(m_HostA.GetMode())<<" host memory: upload "<<uploadMs<<" ms ("<<2.0 * arrayGB / (1.0e-3 * uploadMs)<<" GB/s), "
+				<<"download "<<downloadMs<<" ms ("<<arrayGB / (1.0e-3 * downloadMs)<<" GB/s)"<<endl;
+		}
+
+		clReleaseEvent(uploadEvents[0]);
+		clReleaseEvent(uploadEvents[1]);
+		clReleaseEvent(downloadEvent);
+	}
+
+	if(m_StreamChunkSize > 0)
+		ComputeGPUStreamed(Context, CommandQueue, LocalWorkSize);
+}
+
+void CSimpleArraysTask::ComputeGPUVariants(cl_command_queue CommandQueue, size_t LocalWorkSize[3], double ScalarMs)
+{
+	unsigned int nIterations = GetIterations(100);
+	double bytes = 3.0 * double(m_ArraySize * sizeof(int));
+	double bestMs = ScalarMs;
+	string bestVariant = "VecAdd";
+	m_FailedVariants.clear();
+
+	vector<int> result(m_ArraySize);
+	for(unsigned int v = 0; v < m_VariantKernels.size(); v++)
+	{
+		const char* name = g_Variants[v].Name;
+		if(!IsVariantSelected("VecAdd", name))
+			continue;
+
+		// one vector per work-item, or a fixed grid that loops over the vectors
+		size_t nItems = std::max<size_t>(m_ArraySize / g_Variants[v].Width, 1);
+		size_t globalWorkSize = CLUtil::GetGlobalWorkSize(nItems, LocalWorkSize[0]);
+		if(g_Variants[v].GridStride)
+			globalWorkSize = std::min(globalWorkSize, LocalWorkSize[0] * m_ComputeUnits * c_GroupsPerComputeUnit);
+
+		double ms = CLUtil::ProfileKernel(CommandQueue, m_VariantKernels[v], 1, &globalWorkSize, LocalWorkSize, nIterations);
+
+		CBenchmarkRecord record("VecAdd", string(name) + "/" + CHostBuffer::GetModeName(m_HostA.GetMode()), m_ArraySize);
+		record.SetLocalSize(LocalWorkSize, 1);
+		record.SetTime(ms, nIterations);
+		record.Bytes = bytes;
+		record.Flops = double(m_ArraySize);
+		CBenchmarkReporter::Report(record);
+
+		cout<<name<<": "<<globalWorkSize / LocalWorkSize[0]<<" groups, "<<ms<<" ms, "<<1.0e-6 * bytes / ms<<" GB/s, "
+			<<ScalarMs / ms<<"x the scalar kernel"<<endl;
+
+		// the CPU result is already there, a wrong variant never becomes the best one
+		cl_int clErr = clEnqueueReadBuffer(CommandQueue, m_dVariantC.Get(), CL_TRUE, 0, m_ArraySize * sizeof(int), &result[0], 0, NULL, NULL);
+		if(clErr != CL_SUCCESS || memcmp(&result[0], m_hC, m_ArraySize * sizeof(int)) != 0)
+		{
+			m_FailedVariants.push_back(name);
+			continue;
+		}
+		if(ms < bestMs)
+		{
+			bestMs = ms;
+			bestVariant = name;
+		}
+	}
+
+	cout<<"Best VecAdd kernel on this device: "<<bestVariant<<" ("<<1.0e-6 * bytes / bestMs<<" GB/s, scalar: "
+		<<1.0e-6 * bytes / ScalarMs<<" GB/s)"<<endl;
+}
+
+// Returns the START..END interval of a profiled command in ns
+static bool GetCommandInterval(cl_event Event, cl_ulong& Start, cl_ulong& End)
+{
+	cl_int clErr = clGetEventProfilingInfo(Event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &Start, NULL);
+	clErr |= clGetEventProfilingInfo(Event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &End, NULL);
+	return clErr == CL_SUCCESS;
+}
+
+void CSimpleArraysTask::ComputeGPUStreamed(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+{
+	const size_t chunkSize = std::min(m_StreamChunkSize, m_ArraySize);
+	const size_t nChunks = (m_ArraySize + chunkSize - 1) / chunkSize;
+	const unsigned int nBuffers = m_StreamBuffers;
+
+	cl_device_id device;
+	V_RETURN_CL(clGetCommandQueueInfo(CommandQueue, CL_QUEUE_DEVICE, sizeof(cl_device_id), &device, NULL), "Failed to query the device of the command queue.");
+
+	// one in-order queue per pipeline stage: upload, compute, download
+	cl_int clErr;
+	cl_command_queue queues[3] = { nullptr, nullptr, nullptr };
+	for(int q = 0; q < 3; q++)
+	{
+		queues[q] = clCreateCommandQueue(Context, device, CL_QUEUE_PROFILING_ENABLE, &clErr);
+		V_RETURN_CL(clErr, "Failed to create the streaming command queues.");
+	}
+	cl_command_queue uploadQueue = queues[0], computeQueue = queues[1], downloadQueue = queues[2];
+
+	// nBuffers sets of chunk buffers, chunk i uses set i % nBuffers
+	std::vector<CPooledBuffer> dA(nBuffers), dB(nBuffers), dC(nBuffers);
+	const size_t chunkBytes = chunkSize * sizeof(cl_int);
+	clErr = CL_SUCCESS;
+	for(unsigned int k = 0; k < nBuffers; k++)
+	{
+		cl_int e;
+		dA[k] = AcquireBuffer(Context, CL_MEM_READ_ONLY, chunkBytes, &e); clErr |= e;
+		dB[k] = AcquireBuffer(Context, CL_MEM_READ_ONLY, chunkBytes, &e); clErr |= e;
+		dC[k] = AcquireBuffer(Context, CL_MEM_WRITE_ONLY, chunkBytes, &e); clErr |= e;
+	}
+
+	// two uploads (A and B) per chunk
+	std::vector<cl_event> evUpload(2 * nChunks, nullptr), evCompute(nChunks, nullptr), evDownload(nChunks, nullptr);
+
+	CTimer timer;
+	timer.Start();
+
+	for(size_t i = 0; i < nChunks && clErr == CL_SUCCESS; i++)
+	{
+		unsigned int k = (unsigned int)(i % nBuffers);
+		size_t first = i * chunkSize;
+		cl_int len = (cl_int)std::min(chunkSize, m_ArraySize - first);
+		size_t lenBytes = len * sizeof(cl_int);
+
+		// the buffer set can be reused as soon as the chunk that used it before has been downloaded
+		cl_event uploadEvents[1];
+		cl_uint nWait = 0;
+		if(i >= nBuffers)
+			uploadEvents[nWait++] = evDownload[i - nBuffers];
+
+		// c[first .. first+len) reads b[N-first-len .. N-first), see VecAddChunk
+		clErr |= clEnqueueWriteBuffer(uploadQueue, dA[k].Get(), CL_FALSE, 0, lenBytes, m_hA + first, nWait, nWait ? uploadEvents : NULL, &evUpload[2 * i]);
+		clErr |= clEnqueueWriteBuffer(uploadQueue, dB[k].Get(), CL_FALSE, 0, lenBytes, m_hB + (m_ArraySize - first - len), nWait, nWait ? uploadEvents : NULL, &evUpload[2 * i + 1]);
+
+		clErr |= clSetKernelArg(m_ChunkKernel, 0, sizeof(cl_mem), (void*)&dA[k].Get());
+		clErr |= clSetKernelArg(m_ChunkKernel, 1, sizeof(cl_mem), (void*)&dB[k].Get());
+		clErr |= clSetKernelArg(m_ChunkKernel, 2, sizeof(cl_mem), (void*)&dC[k].Get());
+		clErr |= clSetKernelArg(m_ChunkKernel, 3, sizeof(cl_int), (void*)&len);
+		size_t globalWorkSize = CLUtil::GetGlobalWorkSize(len, LocalWorkSize[0]);
+		clErr |= clEnqueueNDRangeKernel(computeQueue, m_ChunkKernel, 1, NULL, &globalWorkSize, LocalWorkSize, 2, &evUpload[2 * i], &evCompute[i]);
+
+		clErr |= clEnqueueReadBuffer(downloadQueue, dC[k].Get(), CL_FALSE, 0, lenBytes, m_hStreamResult + first, 1, &evCompute[i], &evDownload[i]);
+
+		// make sure all three stages are submitted to the device right away
+		for(int q = 0; q < 3; q++)
+			clFlush(queues[q]);
+	}
+
+	for(int q = 0; q < 3; q++)
+		clErr |= clFinish(queues[q]);
+
+	timer.Stop();
+
+	if(clErr != CL_SUCCESS)
+	{
+		cerr<<"Error in the streamed vector addition: "<<CLUtil::GetCLErrorString(clErr)<<endl;
+	}
+	else
+	{
+		// sum up the device time of each stage and find the span of the whole pipeline
+		double stageMs[3] = { 0.0, 0.0, 0.0 };
+		cl_ulong pipelineStart = ~(cl_ulong)0, pipelineEnd = 0;
+		bool profiled = true;
+		for(size_t i = 0; i < nChunks && profiled; i++)
+		{
+			cl_event events[4] = { evUpload[2 * i], evUpload[2 * i + 1], evCompute[i], evDownload[i] };
+			const int stages[4] = { 0, 0, 1, 2 };
+			for(int e = 0; e < 4; e++)
+			{
+				cl_ulong start, end;
+				if(!GetCommandInterval(events[e], start, end))
+				{
+					profiled = false;
+					break;
+				}
+				stageMs[stages[e]] += 1.0e-6 * double(end - start);
+				pipelineStart = std::min(pipelineStart, start);
+				pipelineEnd = std::max(pipelineEnd, end);
+			}
+		}
+
+		double ms = timer.GetElapsedMilliseconds();
+		double bytes = 3.0 * double(m_ArraySize) * sizeof(cl_int);
+		cout<<"Streamed: "<<nChunks<<" chunks of "<<chunkSize<<" elements, "<<nBuffers<<" buffer sets"<<endl;
+		cout<<"  end-to-end time: "<<ms<<" ms, throughput: "<<1.0e-6 * bytes / ms<<" GB/s, "
+			<<1.0e-6 * double(m_ArraySize) / ms<<" Gelem/s"<<endl;
+
+		stringstream variant;
+		variant<<"VecAddChunk/streamed-"<<nBuffers<<"x"<<chunkSize;
+		CBenchmarkRecord record("VecAdd", variant.str(), m_ArraySize);
+		record.SetLocalSize(LocalWorkSize, 1);
+		record.SetTime(ms, 1);
+		record.Bytes = bytes;
+		record.Flops = double(m_ArraySize);
+		CBenchmarkReporter::Report(record);
+
+		if(profiled)
+		{
+			// 1.0: the pipeline takes only as long as its slowest stage, 0.0: fully serialized
+			double serialMs = stageMs[0] + stageMs[1] + stageMs[2];
+			double boundMs = std::max(stageMs[0], std::max(stageMs[1], stageMs[2]));
+			double spanMs = 1.0e-6 * double(pipelineEnd - pipelineStart);
+			double efficiency = (serialMs > boundMs) ? (serialMs - spanMs) / (serialMs - boundMs) : 1.0;
+			cout<<"  device time upload: "<<stageMs[0]<<" ms, compute: "<<stageMs[1]<<" ms, download: "<<stageMs[2]<<" ms"<<endl;
+			cout<<"  pipeline span: "<<spanMs<<" ms (serialized: "<<serialMs<<" ms), overlap efficiency: "
+				<<100.0 * std::max(0.0, std::min(1.0, efficiency))<<"%"<<endl;
+		}
+	}
+
+	for(size_t i = 0; i < nChunks; i++)
+	{
+		if(evUpload[2 * i]) clReleaseEvent(evUpload[2 * i]);
+		if(evUpload[2 * i + 1]) clReleaseEvent(evUpload[2 * i + 1]);
+		if(evCompute[i]) clReleaseEvent(evCompute[i]);
+		if(evDownload[i]) clReleaseEvent(evDownload[i]);
+	}
+	for(int q = 0; q < 3; q++)
+		clReleaseCommandQueue(queues[q]);
+}
+
+std::string CSimpleArraysTask::GetTuningKey() const
+{
+	stringstream key;
+	key<<"VecAdd/"<<m_ArraySize;
+	return key.str();
+}
+
+CTuningSpace CSimpleArraysTask::GetTuningSpace()
+{
+	const int localSizes[] = { 32, 64, 128, 256, 512, 1024 };
+
+	CTuningSpace space;
+	space.AddParameter("LOCAL_SIZE", vector<int>(localSizes, localSizes + sizeof(localSizes) / sizeof(localSizes[0])));
+	return space;
+}
+
+bool CSimpleArraysTask::MeasureConfiguration(const TuningConfiguration& Configuration, cl_device_id Device,
+	cl_context Context, cl_command_queue CommandQueue, double& Milliseconds)
+{
+	size_t localWorkSize = CAutoTuner::GetValue(Configuration, "LOCAL_SIZE", 256);
+	if(!CAutoTuner::FitsDevice(m_Kernel, Device, &localWorkSize, 1))
+		return false;
+
+	// the kernel arguments are bound in InitResources(), the input does not matter for the timing
+	size_t globalWorkSize = CLUtil::GetGlobalWorkSize(m_ArraySize, localWorkSize);
+	CKernelProfile profile;
+	if(!CLUtil::ProfileKernelEvents(CommandQueue, m_Kernel, 1, &globalWorkSize, &localWorkSize, 20, 3, profile))
+		return false;
+
+	Milliseconds = profile.Execution.GetMedian();
+	return true;
+}
+
+void CSimpleArraysTask::ApplyConfiguration(const TuningConfiguration& Configuration)
+{
+	// the local size is passed to ComputeGPU() by the assignment, see CAssignment1::DoCompute()
 }
 
 bool CSimpleArraysTask::ValidateResults()
 {
-	return (memcmp(m_hC, m_hGPUResult, m_ArraySize * sizeof(float)) == 0);
+	bool success = (memcmp(m_hC, m_hGPUResult, m_ArraySize * sizeof(float)) == 0);
+	if(m_hStreamResult && memcmp(m_hC, m_hStreamResult, m_ArraySize * sizeof(int)) != 0)
+	{
+		cout<<"Validation of the streamed vector addition failed."<<endl;
+		success = false;
+	}
+	for(size_t v = 0; v < m_FailedVariants.size(); v++)
+	{
+		cout<<"Validation of kernel "<<m_FailedVariants[v]<<" failed."<<endl;
+		success = false;
+	}
+	return success;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -20,10 +20,12 @@
 #ifndef _CSIMPLE_ARRAYS_TASK_H
 #define _CSIMPLE_ARRAYS_TASK_H
 
-#include "../Common/IComputeTask.h"
+#include "../../Common/IComputeTask.h"
+#include "../../Common/CHostBuffer.h"
+#include "../../Common/CAutoTuner.h"
 
 //! A1/T1: Simple vector addition
-class CSimpleArraysTask : public IComputeTask
+class CSimpleArraysTask : public IComputeTask, public ITunableTask
 {
 public:
 	CSimpleArraysTask(size_t ArraySize);
@@ -41,7 +43,37 @@ public:
 
 	virtual bool ValidateResults();
 
+	// ITunableTask
+
+	virtual std::string GetTuningKey() const;
+
+	virtual bool MeasureConfiguration(const TuningConfiguration& Configuration, cl_device_id Device,
+		cl_context Context, cl_command_queue CommandQueue, double& Milliseconds);
+
+	virtual void ApplyConfiguration(const TuningConfiguration& Configuration);
+
+	//! The local sizes searched by the autotuner (parameter "LOCAL_SIZE")
+	static CTuningSpace GetTuningSpace();
+
+	//! Enables the streamed mode in addition to the plain one
+	/*!
+		The arrays are split into chunks of ChunkSize elements. Upload, compute and
+		download run on three in-order queues synchronized with events, so that the
+		upload of chunk i+1, the computation of chunk i and the download of chunk i-1
+		can overlap. NBuffers (2 or 3) sets of chunk buffers are cycled.
+	*/
+	void SetStreaming(size_t ChunkSize, unsigned int NBuffers = 3);
+
+	//! Selects the host memory the transfers use (pageable by default), see CHostBuffer
+	void SetHostMemory(CHostBuffer::EMode Mode) { m_HostMode = Mode; }
+
 protected:
+	void ComputeGPUStreamed(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
+
+	//! Runs the vectorized (int4/8/16) and grid-stride variants of VecAdd and compares them to the scalar kernel
+	//! (only reported, the other runs keep the scalar kernel)
+	void ComputeGPUVariants(cl_command_queue CommandQueue, size_t LocalWorkSize[3], double ScalarMs);
+
 	//NOTE: we have two memory address spaces, so we mark pointers with a prefix
 	//to avoid confusions: 'h' - host, 'd' - device
 	
@@ -52,12 +84,29 @@ protected:
 	int					*m_hA = nullptr, *m_hB = nullptr, *m_hC = nullptr;
 
 	//integer arrays on the GPU (and a buffer to read the result back to the host)
-	cl_mem				m_dA = nullptr, m_dB = nullptr, m_dC = nullptr;
+	CPooledBuffer		m_dA, m_dB, m_dC;
 	int					*m_hGPUResult = nullptr;
 
+	//memory behind m_hA, m_hB and m_hGPUResult: pageable, pinned or zero-copy
+	CHostBuffer::EMode	m_HostMode = CHostBuffer::HOST_PAGEABLE;
+	CHostBuffer			m_HostA, m_HostB, m_HostResult, m_HostStreamResult;
+
 	//OpenCL program and kernels
 	cl_program			m_Program = nullptr;
 	cl_kernel			m_Kernel = nullptr;
+
+	//streamed mode (disabled if the chunk size is 0)
+	size_t				m_StreamChunkSize = 0;
+	unsigned int		m_StreamBuffers = 3;
+	int					*m_hStreamResult = nullptr;
+	cl_kernel			m_ChunkKernel = nullptr;
+
+	//kernel variants (same order as in CSimpleArraysTask.cpp), they write to m_dVariantC
+	std::vector<cl_kernel>	m_VariantKernels;
+	CPooledBuffer		m_dVariantC;
+	//the grid-stride variants launch a fixed number of groups per compute unit
+	cl_uint				m_ComputeUnits = 1;
+	std::vector<std::string> m_FailedVariants;
 };
 
 #endif // _CSIMPLE_ARRAYS_TASK_H
@@ -10,3 +10,72 @@ __kernel void VecAdd(__global const int* a, __global const int* b, __global int*
 		c[GID] = a[GID]+ b[numElements - GID - 1];
 	}
 }
+
+// Streamed variant: processes one chunk c[0..len) of the output.
+// For the output range [s, s+len) the reversed access b[numElements - GID - 1]
+// touches exactly the input range [numElements - s - len, numElements - s), so the
+// host uploads that range and the kernel reads it back to front.
+__kernel void VecAddChunk(__global const int* a, __global const int* bReversed, __global int* c, int len) 
+{
+	int GID = get_global_id(0);
+	if (GID < len) {
+		c[GID] = a[GID] + bReversed[len - GID - 1];
+	}
+}
+
+// Vectorized variants: each work-item adds W consecutive elements with one vloadW/vstoreW.
+// The W elements of b that belong to c[W*i .. W*i+W) are b[N-W*i-W .. N-W*i) in reverse
+// order, so they are loaded as one vector starting at N-W*(i+1) and reversed with shuffle().
+// vloadW only needs the alignment of int, so N does not have to be a multiple of W; the
+// N % W elements at the end are added by the first work-item.
+
+#define REVERSE_4	(uint4)(3, 2, 1, 0)
+#define REVERSE_8	(uint8)(7, 6, 5, 4, 3, 2, 1, 0)
+#define REVERSE_16	(uint16)(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+
+#define VECADD_VECTOR(W, i) \
+	vstore##W(vload##W(i, a) + shuffle(vload##W(0, b + numElements - (i + 1) * W), REVERSE_##W), i, c)
+
+void VecAddTail(__global const int* a, __global const int* b, __global int* c, int first, int numElements)
+{
+	for (int i = first; i < numElements; i++)
+		c[i] = a[i] + b[numElements - i - 1];
+}
+
+// one vector per work-item
+#define VECADD_KERNEL(W) \
+__kernel void VecAdd##W(__global const int* a, __global const int* b, __global int* c, int numElements) \
+{ \
+	int GID = get_global_id(0); \
+	int nVectors = numElements / W; \
+	if (GID < nVectors) \
+		VECADD_VECTOR(W, GID); \
+	if (GID == 0) \
+		VecAddTail(a, b, c, nVectors * W, numElements); \
+}
+
+// Grid-stride variants: the host launches a fixed number of work-groups (a few per compute
+// unit) and each work-item loops over the array with the stride of the whole NDRange.
+#define VECADD_GRID_STRIDE_KERNEL(W) \
+__kernel void VecAdd##W##GridStride(__global const int* a, __global const int* b, __global int* c, int numElements) \
+{ \
+	int nVectors = numElements / W; \
+	for (int i = get_global_id(0); i < nVectors; i += get_global_size(0)) \
+		VECADD_VECTOR(W, i); \
+	if (get_global_id(0) == 0) \
+		VecAddTail(a, b, c, nVectors * W, numElements); \
+}
+
+VECADD_KERNEL(4)
+VECADD_KERNEL(8)
+VECADD_KERNEL(16)
+
+__kernel void VecAddGridStride(__global const int* a, __global const int* b, __global int* c, int numElements)
+{
+	for (int i = get_global_id(0); i < numElements; i += get_global_size(0))
+		c[i] = a[i] + b[numElements - i - 1];
+}
+
+VECADD_GRID_STRIDE_KERNEL(4)
+VECADD_GRID_STRIDE_KERNEL(8)
+VECADD_GRID_STRIDE_KERNEL(16)
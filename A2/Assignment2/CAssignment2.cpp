@@ -15,28 +15,26 @@ using namespace std;
 ///////////////////////////////////////////////////////////////////////////////
 // CAssignment2
 
-bool CAssignment2::DoCompute()
+void CAssignment2::RegisterTasks()
 {
+	size_t LocalWorkSize[3] = {256, 1, 1};
+
 	// Task 1: parallel reduction
-	cout<<"########################################"<<endl;
-	cout<<"Running parallel reduction task..."<<endl<<endl;
-	{
-		size_t LocalWorkSize[3] = {256, 1, 1};
-		CReductionTask reduction(1024 * 1024 * 16);
-		RunComputeTask(reduction, LocalWorkSize);
-	}
+	// (ping-pong arrays on the device)
+	m_Tasks.Register("reduction", "Parallel reduction", 1024 * 1024 * 16, LocalWorkSize,
+		[](CTaskOptions& Options) -> IComputeTask* { return new CReductionTask(Options.ProblemSize); },
+		2.0 * sizeof(cl_uint), sizeof(cl_uint));
 
 	// Task 2: parallel prefix sum
-	cout<<"########################################"<<endl;
-	cout<<"Running parallel prefix sum task..."<<endl<<endl;
-	{
-		size_t LocalWorkSize[3] = {256, 1, 1};
-		CScanTask scan(1024 * 1024 * 64, LocalWorkSize[0]);
-		RunComputeTask(scan, LocalWorkSize);
-	}
-
+	// (ping-pong arrays plus the level arrays of the work-efficient scan)
+	m_Tasks.Register("scan", "Parallel prefix sum", 1024 * 1024 * 64, LocalWorkSize,
+		[](CTaskOptions& Options) -> IComputeTask* { return new CScanTask(Options.ProblemSize, Options.LocalWorkSize[0]); },
+		3.0 * sizeof(cl_uint), sizeof(cl_uint));
+}
 
-	return true;
+bool CAssignment2::DoCompute()
+{
+	return RunRegisteredTasks();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
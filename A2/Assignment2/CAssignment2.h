@@ -20,7 +20,7 @@
 #ifndef _CASSIGNMENT2_H
 #define _CASSIGNMENT2_H
 
-#include "../Common/CAssignmentBase.h"
+#include "../../Common/CAssignmentBase.h"
 
 //! Assignment2 solution
 class CAssignment2 : public CAssignmentBase
@@ -30,6 +30,9 @@ public:
 
 	//! This overloaded method contains the specific solution of A2
 	virtual bool DoCompute();
+
+protected:
+	virtual void RegisterTasks();
 };
 
 #endif // _CASSIGNMENT2_H
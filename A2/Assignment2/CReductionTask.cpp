@@ -5,8 +5,16 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "CReductionTask.h"
 
-#include "../Common/CLUtil.h"
-#include "../Common/CTimer.h"
+#include "../../Common/CLUtil.h"
+#include "../../Common/CDeviceMemoryTracker.h"
+#include "../../Common/CKernelLibrary.h"
+#include "../../Common/CTimer.h"
+#include "../../Common/CBenchmarkReporter.h"
+#include "../../Common/CThreadPool.h"
+#include "../../Common/CTracer.h"
+
+#include <vector>
+#include <algorithm>
 
 using namespace std;
 
@@ -25,8 +33,10 @@ CReductionTask::CReductionTask(size_t ArraySize)
 	m_dPingArray(NULL),
 	m_dPongArray(NULL),
 	m_Program(NULL), 
-	m_InterleavedAddressingKernel(NULL), m_SequentialAddressingKernel(NULL), m_DecompKernel(NULL), m_DecompUnrollKernel(NULL)
+	m_InterleavedAddressingKernel(NULL), m_SequentialAddressingKernel(NULL), m_DecompKernel(NULL), m_DecompUnrollKernel(NULL),
+	m_pLaunchEvents(NULL)
 {
+	m_DecompRecordedLocalWorkSize[0] = m_DecompRecordedLocalWorkSize[1] = 0;
 }
 
 CReductionTask::~CReductionTask()
@@ -37,7 +47,10 @@ CReductionTask::~CReductionTask()
 bool CReductionTask::InitResources(cl_device_id Device, cl_context Context)
 {
 	//CPU resources
-	m_hInput = new unsigned int[m_N];
+	//(pinned, so the input uploads in ExecuteTask() and TestPerformance() can use DMA directly)
+	if(!m_HostInput.Allocate(Device, Context, sizeof(cl_uint) * m_N, CHostBuffer::HOST_PINNED))
+		return false;
+	m_hInput = m_HostInput.As<unsigned int>();
 
 	//fill the array with some values
 	for(unsigned int i = 0; i < m_N; i++) 
@@ -46,17 +59,14 @@ bool CReductionTask::InitResources(cl_device_id Device, cl_context Context)
 
 	//device resources
 	cl_int clError, clError2;
-	m_dPingArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2);
+	m_dPingArray = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2, "reduction ping array");
 	clError = clError2;
-	m_dPongArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2);
+	m_dPongArray = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2, "reduction pong array");
 	clError |= clError2;
 	V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
 
 	//load and compile kernels
-	string programCode;
-
-	CLUtil::LoadProgramSourceToMemory("Reduction.cl", programCode);
-	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode);
+	m_Program = CKernelLibrary::GetProgram(Device, Context, "Reduction.cl");
 	if(m_Program == nullptr) return false;
 
 	//create kernels
@@ -82,9 +92,16 @@ bool CReductionTask::InitResources(cl_device_id Device, cl_context Context)
 void CReductionTask::ReleaseResources()
 {
 	// host resources
-	SAFE_DELETE_ARRAY(m_hInput);
+	m_HostInput.Release();
+	m_hInput = NULL;
 
 	// device resources
+	for(int v = 0; v < 2; v++)
+	{
+		m_DecompRecordings[v][0].Clear();
+		m_DecompRecordings[v][1].Clear();
+	}
+
 	SAFE_RELEASE_MEMOBJECT(m_dPingArray);
 	SAFE_RELEASE_MEMOBJECT(m_dPongArray);
 
@@ -98,16 +115,13 @@ void CReductionTask::ReleaseResources()
 
 void CReductionTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
 {
-	ExecuteTask(Context, CommandQueue, LocalWorkSize, 0);
-	ExecuteTask(Context, CommandQueue, LocalWorkSize, 1);
-	ExecuteTask(Context, CommandQueue, LocalWorkSize, 2);
-	ExecuteTask(Context, CommandQueue, LocalWorkSize, 3);
-
-	TestPerformance(Context, CommandQueue, LocalWorkSize, 0);
-	TestPerformance(Context, CommandQueue, LocalWorkSize, 1);
-	TestPerformance(Context, CommandQueue, LocalWorkSize, 2);
-	TestPerformance(Context, CommandQueue, LocalWorkSize, 3);
+	for(unsigned int i = 0; i < 4; i++)
+		if(IsVariantSelected("Reduction", g_kernelNames[i]))
+			ExecuteTask(Context, CommandQueue, LocalWorkSize, i);
 
+	for(unsigned int i = 0; i < 4; i++)
+		if(IsVariantSelected("Reduction", g_kernelNames[i]))
+			TestPerformance(Context, CommandQueue, LocalWorkSize, i);
 }
 
 void CReductionTask::ComputeCPU()
@@ -115,18 +129,37 @@ void CReductionTask::ComputeCPU()
 	CTimer timer;
 	timer.Start();
 
+	// one partial sum per chunk; unsigned additions wrap around, so the order
+	// of the summation does not change the result
+	const unsigned int* pInput = m_hInput;
+	size_t nChunks = std::max<size_t>(1, std::min<size_t>(CThreadPool::GetShared().GetThreadCount(), m_N / 65536));
+	vector<unsigned int> partialSums(nChunks);
+
 	unsigned int nIterations = 10;
 	for(unsigned int j = 0; j < nIterations; j++) {
-		m_resultCPU = m_hInput[0];
-		for(unsigned int i = 1; i < m_N; i++) {
-			m_resultCPU += m_hInput[i]; 
-		}
+		CThreadPool::ParallelChunks(m_N, nChunks, [&](size_t Chunk, size_t Begin, size_t End) {
+			unsigned int sum = 0;
+			for(size_t i = Begin; i < End; i++)
+				sum += pInput[i];
+			partialSums[Chunk] = sum;
+		});
+
+		m_resultCPU = 0;
+		for(size_t c = 0; c < nChunks; c++)
+			m_resultCPU += partialSums[c];
 	}
 
 	timer.Stop();
 
 	double ms = timer.GetElapsedMilliseconds() / double(nIterations);
 	cout << "  average time: " << ms << " ms, throughput: " << 1.0e-6 * (double)m_N / ms << " Gelem/s" <<endl;
+
+	CBenchmarkRecord record("Reduction", "cpu", m_N);
+	record.SetCPU();
+	record.SetTime(ms, nIterations);
+	record.Bytes = double(m_N * sizeof(cl_uint));
+	record.Flops = double(m_N);
+	CBenchmarkReporter::Report(record);
 }
 
 bool CReductionTask::ValidateResults()
@@ -134,7 +167,7 @@ bool CReductionTask::ValidateResults()
 	bool success = true;
 
 	for(int i = 0; i < 4; i++)
-		if(m_resultGPU[i] != m_resultCPU)
+		if(IsVariantSelected("Reduction", g_kernelNames[i]) && m_resultGPU[i] != m_resultCPU)
 		{
 			cout<<"GPU:"<<m_resultGPU[i]<<" CPU:"<<m_resultCPU<<endl;
 			cout<<"Validation of reduction kernel "<<g_kernelNames[i]<<" failed." << endl;
@@ -160,7 +193,7 @@ void CReductionTask::Reduction_InterleavedAddressing(cl_context Context, cl_comm
 		clErr = clSetKernelArg(m_InterleavedAddressingKernel, 1, sizeof(cl_uint), (void*)&stride);
 		V_RETURN_CL(clErr, "Failed to set KernelArgs: InterleavedAddressingKernel");	
 		//cout<<stride<<" : "<<globalWorkSize[0]<<" : "<<localWorkSize[0]<<endl;
-		clErr = clEnqueueNDRangeKernel(CommandQueue, m_InterleavedAddressingKernel, 1, NULL, globalWorkSize, localWorkSize, 0, NULL, NULL);
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_InterleavedAddressingKernel, 1, NULL, globalWorkSize, localWorkSize, 0, NULL, NextLaunchEvent("interleavedAddressing"));
 	V_RETURN_CL(clErr, "Error executing InterleavedAddressingKernel!");
 	}
 
@@ -183,7 +216,7 @@ void CReductionTask::Reduction_SequentialAddressing(cl_context Context, cl_comma
 		clErr = clSetKernelArg(m_SequentialAddressingKernel, 1, sizeof(cl_uint), (void*)&stride);
 		V_RETURN_CL(clErr, "Failed to set KernelArgs: SequentialAddressingKernel");	
 		//cout<<stride<<" : "<<globalWorkSize[0]<<" : "<<localWorkSize[0]<<endl;
-		clErr = clEnqueueNDRangeKernel(CommandQueue, m_SequentialAddressingKernel, 1, NULL, globalWorkSize, localWorkSize, 0, NULL, NULL);
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_SequentialAddressingKernel, 1, NULL, globalWorkSize, localWorkSize, 0, NULL, NextLaunchEvent("sequentialAddressing"));
 	V_RETURN_CL(clErr, "Error executing SequentialAddressingKernel!");
 	}
 }
@@ -198,28 +231,7 @@ void CReductionTask::Reduction_Decomp(cl_context Context, cl_command_queue Comma
 	// (CReductionTask::ExecuteTask)
 	//
 	// hint: for example, you can use swap(m_dPingArray, m_dPongArray) at the end of your for loop...
-	cl_int clErr;
-	//unsigned int stride;
-	unsigned int size;
-	size_t globalWorkSize[1];
-	size_t localWorkSize[1];
-	localWorkSize[0] = LocalWorkSize[0];
-	clErr = clSetKernelArg(m_DecompKernel, 3, localWorkSize[0] * sizeof(cl_uint), NULL);
-
-	for (size = m_N; size > 1; size /= (localWorkSize[0]*2)) {
-		
-		globalWorkSize[0] = size / 2;
-		localWorkSize[0] = std::min(globalWorkSize[0], localWorkSize[0]);
-		clErr = clSetKernelArg(m_DecompKernel, 0, sizeof(cl_mem), (void*)&m_dPingArray);
-		clErr |= clSetKernelArg(m_DecompKernel, 1, sizeof(cl_mem), (void*)&m_dPongArray);
-		clErr |= clSetKernelArg(m_DecompKernel, 2, sizeof(cl_uint), (void*)&size);
-		
-		V_RETURN_CL(clErr, "Failed to set KernelArgs: DecompKernel");	
-		//cout<<stride<<" : "<<globalWorkSize[0]<<" : "<<localWorkSize[0]<<endl;
-		clErr = clEnqueueNDRangeKernel(CommandQueue, m_DecompKernel, 1, NULL, globalWorkSize, localWorkSize, 0, NULL, NULL);
-	V_RETURN_CL(clErr, "Error executing DecompKernel!");
-	std::swap(m_dPingArray, m_dPongArray);
-	}
+	Reduction_Decomposition(CommandQueue, 0, LocalWorkSize[0]);
 }
 
 void CReductionTask::Reduction_DecompUnroll(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
@@ -232,28 +244,58 @@ void CReductionTask::Reduction_DecompUnroll(cl_context Context, cl_command_queue
 	// (CReductionTask::ExecuteTask)
 	//
 	// hint: for example, you can use swap(m_dPingArray, m_dPongArray) at the end of your for loop...
-	cl_int clErr;
-	//unsigned int stride;
-	unsigned int size;
-	size_t globalWorkSize[1];
-	size_t localWorkSize[1];
-	localWorkSize[0] = 256; 
-	clErr = clSetKernelArg(m_DecompUnrollKernel, 3, localWorkSize[0] * sizeof(cl_uint), NULL);
 
-	for (size = m_N; size > 1; size /= (localWorkSize[0]*2)) {
-		
-		globalWorkSize[0] = size / 2;
-		localWorkSize[0] = std::min(globalWorkSize[0], localWorkSize[0]);
-		clErr = clSetKernelArg(m_DecompUnrollKernel, 0, sizeof(cl_mem), (void*)&m_dPingArray);
-		clErr |= clSetKernelArg(m_DecompUnrollKernel, 1, sizeof(cl_mem), (void*)&m_dPongArray);
-		clErr |= clSetKernelArg(m_DecompUnrollKernel, 2, sizeof(cl_uint), (void*)&size);
-		
-		V_RETURN_CL(clErr, "Failed to set KernelArgs: DecompKernel");	
-		//cout<<" : "<<globalWorkSize[0]<<" : "<<localWorkSize[0]<<endl;
-		clErr = clEnqueueNDRangeKernel(CommandQueue, m_DecompUnrollKernel, 1, NULL, globalWorkSize, localWorkSize, 0, NULL, NULL);
-	V_RETURN_CL(clErr, "Error executing DecompKernel!");
-	std::swap(m_dPingArray, m_dPongArray);
+	// the unrolled kernel is written for 256 work-items
+	Reduction_Decomposition(CommandQueue, 1, 256);
+}
+
+void CReductionTask::Reduction_Decomposition(cl_command_queue CommandQueue, unsigned int Variant, size_t LocalWorkSize)
+{
+	cl_kernel kernel = Variant ? m_DecompUnrollKernel : m_DecompKernel;
+	const char* name = Variant ? "kernelDecompositionUnroll" : "kernelDecomposition";
+
+	if(m_DecompRecordedLocalWorkSize[Variant] != LocalWorkSize)
+	{
+		m_DecompRecordings[Variant][0].Clear();
+		m_DecompRecordings[Variant][1].Clear();
+		m_DecompRecordedLocalWorkSize[Variant] = LocalWorkSize;
+	}
+
+	// the arguments of every launch only depend on which of the two buffers holds the input
+	CCommandRecording& recording = m_DecompRecordings[Variant][m_dPingArray < m_dPongArray ? 0 : 1];
+	if(!recording.IsRecorded())
+	{
+		cl_mem ping = m_dPingArray;
+		cl_mem pong = m_dPongArray;
+		size_t globalWorkSize[1];
+		size_t localWorkSize[1];
+		localWorkSize[0] = LocalWorkSize;
+
+		recording.Begin(CommandQueue);
+		recording.SetKernelArg(kernel, 3, localWorkSize[0] * sizeof(cl_uint), NULL);
+		for(unsigned int size = m_N; size > 1; size /= (localWorkSize[0]*2))
+		{
+			globalWorkSize[0] = size / 2;
+			localWorkSize[0] = std::min(globalWorkSize[0], localWorkSize[0]);
+			recording.SetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&ping);
+			recording.SetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&pong);
+			recording.SetKernelArg(kernel, 2, sizeof(cl_uint), (void*)&size);
+			recording.AddKernel(name, kernel, 1, globalWorkSize, localWorkSize);
+			std::swap(ping, pong);
+		}
+		if(!recording.End())
+		{
+			cerr << "Error: failed to record the launches of " << name << "." << endl;
+			return;
+		}
 	}
+
+	if(!recording.Replay(CommandQueue, m_pLaunchEvents))
+		return;
+
+	// every launch swapped the buffers
+	if(recording.GetLaunchCount() % 2)
+		std::swap(m_dPingArray, m_dPongArray);
 }
 
 void CReductionTask::ExecuteTask(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3], unsigned int Task)
@@ -289,15 +331,25 @@ void CReductionTask::TestPerformance(cl_context Context, cl_command_queue Comman
 	cout << "Testing performance of task " << g_kernelNames[Task] << endl;
 
 	//write input data to the GPU
-	V_RETURN_CL(clEnqueueWriteBuffer(CommandQueue, m_dPingArray, CL_FALSE, 0, m_N * sizeof(cl_uint), m_hInput, 0, NULL, NULL), "Error copying data from host to device!");
+	cl_event uploadEvent;
+	V_RETURN_CL(clEnqueueWriteBuffer(CommandQueue, m_dPingArray, CL_FALSE, 0, m_N * sizeof(cl_uint), m_hInput, 0, NULL, &uploadEvent), "Error copying data from host to device!");
 	//finish all before we start meassuring the time
 	V_RETURN_CL(clFinish(CommandQueue), "Error finishing the queue!");
 
+	//the upload is reported separately from the kernel time
+	double uploadMs = CLUtil::GetEventMilliseconds(uploadEvent);
+	TRACE_CL_EVENT("upload", uploadEvent);
+	clReleaseEvent(uploadEvent);
+	if(uploadMs > 0.0)
+		cout << "  upload: " << uploadMs << " ms, " << 1.0e-6 * double(m_N * sizeof(cl_uint)) / uploadMs << " GB/s" << endl;
+
+	TRACE_SCOPE("Reduction::TestPerformance");
+
 	CTimer timer;
 	timer.Start();
 
 	//run the kernel N times
-	unsigned int nIterations = 100;
+	unsigned int nIterations = GetIterations(100);
 	for(unsigned int i = 0; i < nIterations; i++) {
 		//run selected task
 		switch (Task){
@@ -323,6 +375,100 @@ void CReductionTask::TestPerformance(cl_context Context, cl_command_queue Comman
 
 	double ms = timer.GetElapsedMilliseconds() / double(nIterations);
 	cout << "  average time: " << ms << " ms, throughput: " << 1.0e-6 * (double)m_N / ms << " Gelem/s" <<endl;
+
+	CBenchmarkRecord record("Reduction", g_kernelNames[Task], m_N);
+	record.SetLocalSize(LocalWorkSize, 1);
+	record.SetTime(ms, nIterations);
+	record.Bytes = double(m_N * sizeof(cl_uint));
+	record.Flops = double(m_N);
+	CBenchmarkReporter::Report(record);
+
+	if(CLUtil::IsProfilingEnabled(CommandQueue))
+		ProfileLaunches(Context, CommandQueue, LocalWorkSize, Task);
+}
+
+cl_event* CReductionTask::NextLaunchEvent(const char* Name)
+{
+	// the launches are traced unless ProfileLaunches() collects the events itself
+	if(!m_pLaunchEvents)
+		return TRACE_CL(Name);
+	m_pLaunchEvents->push_back(NULL);
+	return &m_pLaunchEvents->back();
+}
+
+void CReductionTask::ProfileLaunches(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3], unsigned int Task)
+{
+	// the warm-up already happened in TestPerformance()
+	const unsigned int nIterations = 20;
+
+	CKernelProfile launchProfile;
+	CTimingStatistics reductionTime;
+	CTimingStatistics reductionBusy;
+	size_t launchesPerReduction = 0;
+
+	std::vector<cl_event> events;
+	m_pLaunchEvents = &events;
+
+	for(unsigned int i = 0; i < nIterations; i++)
+	{
+		events.clear();
+		// the device waited for the host between the reductions
+		launchProfile.BeginSequence();
+		switch (Task){
+			case 0:
+				Reduction_InterleavedAddressing(Context, CommandQueue, LocalWorkSize);
+				break;
+			case 1:
+				Reduction_SequentialAddressing(Context, CommandQueue, LocalWorkSize);
+				break;
+			case 2:
+				Reduction_Decomp(Context, CommandQueue, LocalWorkSize);
+				break;
+			case 3:
+				Reduction_DecompUnroll(Context, CommandQueue, LocalWorkSize);
+				break;
+		}
+		clFinish(CommandQueue);
+
+		// device time of the whole reduction (first start to last end) vs. time the device actually computed
+		cl_ulong firstStart = 0, lastEnd = 0;
+		double busy = 0.0;
+		for(size_t e = 0; e < events.size(); e++)
+		{
+			if(!events[e])
+				continue;
+			cl_ulong start = 0, end = 0;
+			clGetEventProfilingInfo(events[e], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+			clGetEventProfilingInfo(events[e], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+			if(e == 0)
+				firstStart = start;
+			lastEnd = std::max(lastEnd, end);
+			busy += 1.0e-6 * double(end - start);
+
+			launchProfile.AddEvent(events[e]);
+			clReleaseEvent(events[e]);
+		}
+		launchesPerReduction = events.size();
+		reductionTime.AddSample(lastEnd > firstStart ? 1.0e-6 * double(lastEnd - firstStart) : 0.0);
+		reductionBusy.AddSample(busy);
+	}
+
+	m_pLaunchEvents = NULL;
+
+	launchProfile.Evaluate();
+	reductionTime.Evaluate();
+	reductionBusy.Evaluate();
+
+	cout << "  device timers, " << launchesPerReduction << " launches per reduction:" << endl;
+	reductionTime.Print(cout, "reduction:");
+	reductionBusy.Print(cout, "kernels only:");
+	cout << "  per launch:" << endl;
+	launchProfile.Print(cout, true);
+
+	// if the device idles between the launches for a significant fraction of the time, we are launch-bound
+	double idle = reductionTime.GetMedian() - reductionBusy.GetMedian();
+	if(reductionTime.GetMedian() > 0.0)
+		cout << "  idle between launches: " << idle << " ms (" << 100.0 * idle / reductionTime.GetMedian() << "% of the reduction)" << endl;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -20,7 +20,11 @@
 #ifndef _CREDUCTION_TASK_H
 #define _CREDUCTION_TASK_H
 
-#include "../Common/IComputeTask.h"
+#include "../../Common/IComputeTask.h"
+#include "../../Common/CHostBuffer.h"
+#include "../../Common/CCommandRecording.h"
+
+#include <vector>
 
 //! A2/T1: Parallel reduction
 class CReductionTask : public IComputeTask
@@ -49,9 +53,18 @@ protected:
 	void Reduction_Decomp(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
 	void Reduction_DecompUnroll(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
 
+	//! Runs the launch sequence of a decomposition variant (0: plain, 1: unrolled) from a recording
+	void Reduction_Decomposition(cl_command_queue CommandQueue, unsigned int Variant, size_t LocalWorkSize);
+
 	void ExecuteTask(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3], unsigned int task);
 	void TestPerformance(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3], unsigned int task);
 
+	//! Measures every kernel launch of a reduction with the device timers, to separate the idle gaps between the launches from execution
+	void ProfileLaunches(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3], unsigned int task);
+
+	//! Returns where to store the event of the next launch, or NULL if launches are not recorded
+	cl_event* NextLaunchEvent(const char* Name);
+
 	//NOTE: we have two memory address spaces, so we mark pointers with a prefix
 	//to avoid confusions: 'h' - host, 'd' - device
 
@@ -59,6 +72,7 @@ protected:
 
 	// input data
 	unsigned int		*m_hInput;
+	CHostBuffer			m_HostInput;
 	// results
 	unsigned int		m_resultCPU;
 	unsigned int		m_resultGPU[4];
@@ -73,6 +87,13 @@ protected:
 	cl_kernel			m_DecompKernel;
 	cl_kernel			m_DecompUnrollKernel;
 
+	// recorded launch sequences of the decomposition variants, one per buffer that holds the input
+	CCommandRecording	m_DecompRecordings[2][2];
+	size_t				m_DecompRecordedLocalWorkSize[2];
+
+	// events of the recorded kernel launches, NULL if not recording
+	std::vector<cl_event>* m_pLaunchEvents;
+
 };
 
 #endif // _CREDUCTION_TASK_H
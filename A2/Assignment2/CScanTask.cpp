@@ -5,10 +5,17 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "CScanTask.h"
 
-#include "../Common/CLUtil.h"
-#include "../Common/CTimer.h"
+#include "../../Common/CLUtil.h"
+#include "../../Common/CDeviceMemoryTracker.h"
+#include "../../Common/CKernelLibrary.h"
+#include "../../Common/CTimer.h"
+#include "../../Common/CBenchmarkReporter.h"
+#include "../../Common/CThreadPool.h"
+#include "../../Common/CTracer.h"
 
 #include <string.h>
+#include <vector>
+#include <algorithm>
 
 using namespace std;
 
@@ -28,7 +35,7 @@ const string g_kernelNames[2] =
 
 CScanTask::CScanTask(size_t ArraySize, size_t MinLocalWorkSize)
 	: m_N(ArraySize), m_hArray(NULL), m_hResultCPU(NULL), m_hResultGPU(NULL),
-	m_dPingArray(NULL), m_dPongArray(NULL),
+	m_dPingArray(NULL), m_dPongArray(NULL), m_NaiveRecordedLocalWorkSize(0),
 	m_Program(NULL), 
 	m_ScanNaiveKernel(NULL), m_ScanWorkEfficientKernel(NULL), m_ScanWorkEfficientAddKernel(NULL)
 {
@@ -68,26 +75,23 @@ bool CScanTask::InitResources(cl_device_id Device, cl_context Context)
 	//device resources
 	// ping-pong buffers
 	cl_int clError, clError2;
-	m_dPingArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2);
+	m_dPingArray = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2, "scan ping array");
 	clError = clError2;
-	m_dPongArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2);
+	m_dPongArray = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2, "scan pong array");
 	clError |= clError2;
 
 	// level buffer
 	m_dLevelArrays = new cl_mem[m_nLevels];
 	unsigned int N = m_N;
 	for (unsigned int i = 0; i < m_nLevels; i++) {
-		m_dLevelArrays[i] = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * N, NULL, &clError2);
+		m_dLevelArrays[i] = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * N, NULL, &clError2, "scan level array");
 		clError |= clError2;
 		N = max(N / (2 * m_MinLocalWorkSize), m_MinLocalWorkSize);
 	}
 	V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
 
 	//load and compile kernels
-	string programCode;
-
-	CLUtil::LoadProgramSourceToMemory("Scan.cl", programCode);
-	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode);
+	m_Program = CKernelLibrary::GetProgram(Device, Context, "Scan.cl");
 	if(m_Program == nullptr) return false;
 
 	//create kernels
@@ -112,6 +116,9 @@ void CScanTask::ReleaseResources()
 	SAFE_DELETE_ARRAY(m_hResultGPU);
 
 	// device resources
+	m_NaiveRecordings[0].Clear();
+	m_NaiveRecordings[1].Clear();
+
 	SAFE_RELEASE_MEMOBJECT(m_dPingArray);
 	SAFE_RELEASE_MEMOBJECT(m_dPongArray);
 
@@ -132,13 +139,15 @@ void CScanTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, si
 {
 	cout << endl;
 
-	ValidateTask(Context, CommandQueue, LocalWorkSize, 0);
-	ValidateTask(Context, CommandQueue, LocalWorkSize, 1);
+	for(unsigned int i = 0; i < 2; i++)
+		if(IsVariantSelected("Scan", g_kernelNames[i]))
+			ValidateTask(Context, CommandQueue, LocalWorkSize, i);
 
 	cout << endl;
 
-	TestPerformance(Context, CommandQueue, LocalWorkSize, 0);
-	TestPerformance(Context, CommandQueue, LocalWorkSize, 1);
+	for(unsigned int i = 0; i < 2; i++)
+		if(IsVariantSelected("Scan", g_kernelNames[i]))
+			TestPerformance(Context, CommandQueue, LocalWorkSize, i);
 
 	cout << endl;
 }
@@ -148,18 +157,48 @@ void CScanTask::ComputeCPU()
 	CTimer timer;
 	timer.Start();
 
+	// two passes over contiguous chunks: sum up every chunk, then scan each chunk
+	// starting at the (serially scanned) sum of all chunks before it
+	const unsigned int* pArray = m_hArray;
+	unsigned int* pResult = m_hResultCPU;
+	size_t nChunks = std::max<size_t>(1, std::min<size_t>(CThreadPool::GetShared().GetThreadCount(), m_N / 65536));
+	vector<unsigned int> chunkOffsets(nChunks);
+
 	unsigned int nIterations = 1;
 	for(unsigned int j = 0; j < nIterations; j++) {
-		unsigned int sum = 0;
-		for(unsigned int i = 0; i < m_N; i++) {
-			sum += m_hArray[i];
-			m_hResultCPU[i] = sum; 
+		CThreadPool::ParallelChunks(m_N, nChunks, [&](size_t Chunk, size_t Begin, size_t End) {
+			unsigned int sum = 0;
+			for(size_t i = Begin; i < End; i++)
+				sum += pArray[i];
+			chunkOffsets[Chunk] = sum;
+		});
+
+		unsigned int offset = 0;
+		for(size_t c = 0; c < nChunks; c++) {
+			unsigned int chunkSum = chunkOffsets[c];
+			chunkOffsets[c] = offset;
+			offset += chunkSum;
 		}
+
+		CThreadPool::ParallelChunks(m_N, nChunks, [&](size_t Chunk, size_t Begin, size_t End) {
+			unsigned int sum = chunkOffsets[Chunk];
+			for(size_t i = Begin; i < End; i++) {
+				sum += pArray[i];
+				pResult[i] = sum;
+			}
+		});
 	}
 
 	timer.Stop();
 	double ms = timer.GetElapsedMilliseconds() / double(nIterations);
 	cout << "  average time: " << ms << " ms, throughput: " << 1.0e-6 * (double)m_N / ms << " Gelem/s" <<endl;
+
+	CBenchmarkRecord record("Scan", "cpu", m_N);
+	record.SetCPU();
+	record.SetTime(ms, nIterations);
+	record.Bytes = 2.0 * double(m_N * sizeof(cl_uint));
+	record.Flops = double(m_N);
+	CBenchmarkReporter::Report(record);
 }
 
 bool CScanTask::ValidateResults()
@@ -167,7 +206,7 @@ bool CScanTask::ValidateResults()
 	bool success = true;
 
 	for(int i = 0; i < 2; i++)
-		if(!m_bValidationResults[i])
+		if(IsVariantSelected("Scan", g_kernelNames[i]) && !m_bValidationResults[i])
 		{
 			cout<<"Validation of reduction kernel "<<g_kernelNames[i]<<" failed." << endl;
 			success = false;
@@ -186,27 +225,47 @@ void CScanTask::Scan_Naive(cl_context Context, cl_command_queue CommandQueue, si
 	// (CReductionTask::ValidateTask)
 	//
 	// hint: for example, you can use swap(m_dPingArray, m_dPongArray) at the end of your for loop...
-	cl_int clErr;
-	unsigned int offset;
-	size_t globalWorkSize[1];
-	size_t localWorkSize[1];
-	localWorkSize[0] = LocalWorkSize[0];
-	clErr = clSetKernelArg(m_ScanNaiveKernel, 2, sizeof(cl_uint), (void*)&offset);
+	if(m_NaiveRecordedLocalWorkSize != LocalWorkSize[0])
+	{
+		m_NaiveRecordings[0].Clear();
+		m_NaiveRecordings[1].Clear();
+		m_NaiveRecordedLocalWorkSize = LocalWorkSize[0];
+	}
 
-	for (offset = 1; offset < m_N; offset *= 2) {
-		
-		globalWorkSize[0] = m_N;
-		localWorkSize[0] = std::min(globalWorkSize[0], localWorkSize[0]);
-		clErr = clSetKernelArg(m_ScanNaiveKernel, 0, sizeof(cl_mem), (void*)&m_dPingArray);
-		clErr |= clSetKernelArg(m_ScanNaiveKernel, 1, sizeof(cl_mem), (void*)&m_dPongArray);
-		clErr |= clSetKernelArg(m_ScanNaiveKernel, 3, sizeof(cl_uint), (void*)&offset);
-		V_RETURN_CL(clErr, "Failed to set KernelArgs: ScanNaiveKernel");	
-		//cout<<offset<<" : "<<globalWorkSize[0]<<" : "<<localWorkSize[0]<<endl;
-		clErr = clEnqueueNDRangeKernel(CommandQueue, m_ScanNaiveKernel, 1, NULL, globalWorkSize, localWorkSize, 0, NULL, NULL);
-	V_RETURN_CL(clErr, "Error executing ScanNaiveKernel!");
-	std::swap(m_dPingArray, m_dPongArray);
+	// log2(N) launches that only differ in the offset: record them once per input buffer
+	CCommandRecording& recording = m_NaiveRecordings[m_dPingArray < m_dPongArray ? 0 : 1];
+	if(!recording.IsRecorded())
+	{
+		cl_mem ping = m_dPingArray;
+		cl_mem pong = m_dPongArray;
+		cl_uint n = (cl_uint)m_N;
+		size_t globalWorkSize[1];
+		size_t localWorkSize[1];
+		localWorkSize[0] = LocalWorkSize[0];
+
+		recording.Begin(CommandQueue);
+		recording.SetKernelArg(m_ScanNaiveKernel, 2, sizeof(cl_uint), (void*)&n);
+		for (unsigned int offset = 1; offset < m_N; offset *= 2) {
+			globalWorkSize[0] = m_N;
+			localWorkSize[0] = std::min(globalWorkSize[0], localWorkSize[0]);
+			recording.SetKernelArg(m_ScanNaiveKernel, 0, sizeof(cl_mem), (void*)&ping);
+			recording.SetKernelArg(m_ScanNaiveKernel, 1, sizeof(cl_mem), (void*)&pong);
+			recording.SetKernelArg(m_ScanNaiveKernel, 3, sizeof(cl_uint), (void*)&offset);
+			recording.AddKernel("scanNaive", m_ScanNaiveKernel, 1, globalWorkSize, localWorkSize);
+			std::swap(ping, pong);
+		}
+		if(!recording.End())
+		{
+			cerr << "Error: failed to record the launches of the naive scan." << endl;
+			return;
+		}
 	}
-	
+
+	if(!recording.Replay(CommandQueue))
+		return;
+
+	if(recording.GetLaunchCount() % 2)
+		std::swap(m_dPingArray, m_dPongArray);
 }
 
 void CScanTask::Scan_WorkEfficient(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
@@ -230,7 +289,7 @@ void CScanTask::Scan_WorkEfficient(cl_context Context, cl_command_queue CommandQ
 		V_RETURN_CL(clErr, "Failed to set KernelArgs: ScanNaiveKernel");
 		level++;	
 			//cout<<globalWorkSize[0]<<" : "<<localWorkSize[0]<<endl;
-		clErr = clEnqueueNDRangeKernel(CommandQueue, m_ScanWorkEfficientKernel, 1, NULL, globalWorkSize, localWorkSize, 0, NULL, NULL);
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_ScanWorkEfficientKernel, 1, NULL, globalWorkSize, localWorkSize, 0, NULL, TRACE_CL("scanWorkEfficient"));
 		V_RETURN_CL(clErr, "Error executing ScanWorkEfficientKernel!");
 
 	}
@@ -250,7 +309,7 @@ void CScanTask::Scan_WorkEfficient(cl_context Context, cl_command_queue CommandQ
 		V_RETURN_CL(clErr, "Failed to set KernelArgs: ScanNaiveKernel");
 
 			//cout<<globalWorkSize[0]<<" : "<<localWorkSize[0]<<endl;
-		clErr = clEnqueueNDRangeKernel(CommandQueue, m_ScanWorkEfficientAddKernel, 1, NULL, globalWorkSize, localWorkSize, 0, NULL, NULL);
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_ScanWorkEfficientAddKernel, 1, NULL, globalWorkSize, localWorkSize, 0, NULL, TRACE_CL("scanWorkEfficientAdd"));
 		V_RETURN_CL(clErr, "Error executing ScanWorkEfficientKernel!");
 		level--;
 	}
@@ -289,11 +348,13 @@ void CScanTask::TestPerformance(cl_context Context, cl_command_queue CommandQueu
 	//finish all before we start meassuring the time
 	V_RETURN_CL(clFinish(CommandQueue), "Error finishing the queue!");
 
+	TRACE_SCOPE("Scan::TestPerformance");
+
 	CTimer timer;
 	timer.Start();
 
 	//run the kernel N times
-	unsigned int nIterations = 100;
+	unsigned int nIterations = GetIterations(100);
 	for(unsigned int i = 0; i < nIterations; i++) {
 		//run selected task
 		switch (Task){
@@ -313,6 +374,14 @@ void CScanTask::TestPerformance(cl_context Context, cl_command_queue CommandQueu
 
 	double ms = timer.GetElapsedMilliseconds() / double(nIterations);
 	cout << "  average time: " << ms << " ms, throughput: " << 1.0e-6 * (double)m_N / ms << " Gelem/s" <<endl;
+
+	//the scan reads and writes every element once
+	CBenchmarkRecord record("Scan", g_kernelNames[Task], m_N);
+	record.SetLocalSize(LocalWorkSize, 1);
+	record.SetTime(ms, nIterations);
+	record.Bytes = 2.0 * double(m_N * sizeof(cl_uint));
+	record.Flops = double(m_N);
+	CBenchmarkReporter::Report(record);
 }
 
 
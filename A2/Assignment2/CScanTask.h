@@ -20,7 +20,8 @@
 #ifndef _CSCAN_TASK_H
 #define _CSCAN_TASK_H
 
-#include "../Common/IComputeTask.h"
+#include "../../Common/IComputeTask.h"
+#include "../../Common/CCommandRecording.h"
 
 //! A2 / T2 Parallel prefix sum (scan)
 class CScanTask : public IComputeTask
@@ -63,6 +64,10 @@ protected:
 	cl_mem				m_dPingArray;
 	cl_mem				m_dPongArray;
 
+	// recorded launches of the naive scan, one per buffer that holds the input
+	CCommandRecording	m_NaiveRecordings[2];
+	size_t				m_NaiveRecordedLocalWorkSize;
+
 	// arrays for each level of the work-efficient scan
 	size_t				m_MinLocalWorkSize;
 	unsigned int		m_nLevels;
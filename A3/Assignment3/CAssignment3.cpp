@@ -11,6 +11,7 @@ GPU Computing / GPGPU Praktikum source code.
 #include "CHistogramTask.h"
 
 #include <iostream>
+#include <vector>
 
 using namespace std;
 
@@ -26,92 +27,105 @@ bool CAssignment3::DoCompute()
 	cout<<"The CPU 'gold' test is only suitable to catch trivial errors,"<<endl;
 	cout<<"A low MSE (mean squared error) might still happen with a few corrupted pixels."<<endl;
 
-	cout<<"########################################"<<endl;
-	cout<<"Task 1: 3x3 convolution"<<endl<<endl;
-	{
-		size_t TileSize[2] = {32, 16};
+	return RunRegisteredTasks();
+}
+
+void CAssignment3::RegisterTasks()
+{
+	// Task 1: 3x3 convolution
+	size_t TileSize[3] = {32, 16, 1};
+	CTaskEntry conv3x3;
+	conv3x3.Name = "conv3x3";
+	conv3x3.Description = "3x3 convolution";
+	conv3x3.DefaultInputFile = "Images/input.pfm";
+	conv3x3.Factory = [](CTaskOptions& Options) -> IComputeTask* {
 		float ConvKernel[3][3] = {
 			{ -1.0f / 8.0f, -1.0f / 8.0f, -1.0f / 8.0f },
 			{ -1.0f / 8.0f,  1.0f,        -1.0f / 8.0f },
 			{ -1.0f / 8.0f, -1.0f / 8.0f, -1.0f / 8.0f },
 		};
-		CConvolution3x3Task convTask("Images/input.pfm", TileSize, ConvKernel, true, 0.0f);
-		RunComputeTask(convTask, TileSize);
-	}
-
-
-	cout<<endl<<"########################################"<<endl;
-	cout<<"Task 2: Separable convolution"<<endl<<endl;
+		return new CConvolution3x3Task(Options.InputFile, Options.LocalWorkSize, ConvKernel, true, 0.0f);
+	};
+	for(int i = 0; i < 3; i++)
+		conv3x3.DefaultLocalWorkSize[i] = TileSize[i];
+	m_Tasks.Register(conv3x3);
+
+	// Task 2: separable convolution
+	// for the horizontal and vertical passes different local sizes might be used, they are tuned per filter
+	// unless a local size is given on the command line
 	{
-		size_t HGroupSize[2] = {32, 16};
-		size_t VGroupSize[2] = {32, 16};
-
-	
-		{
-			//simple box filter
-			float ConvKernel[9];
-			for(int i = 0; i < 9; i++)
-				ConvKernel[i] = 1.0f / 9.0f;
-
-			CConvolutionSeparableTask convTask("box_4x4", "Images/input.pfm", HGroupSize, VGroupSize,
-				4, 4, 4, ConvKernel, ConvKernel);
-			// note: the last argument is ignored, but our framework requires it
-			// for the horizontal and vertical passes different local sizes might be used
-			RunComputeTask(convTask, HGroupSize);
-		}
-
-		{
-			//simple box filter
-			float ConvKernel[17];
-			for(int i = 0; i < 17; i++)
-				ConvKernel[i] = 1.0f / 17.0f;
-
-			CConvolutionSeparableTask convTask("box_8x8", "Images/input.pfm", HGroupSize, VGroupSize,
-				4, 4, 8, ConvKernel, ConvKernel);
-			RunComputeTask(convTask, HGroupSize);
-		}
-
-		{
-			// Gaussian blur
-			float ConvKernel[7] = {
-				0.000817774f, 0.0286433f, 0.235018f, 0.471041f, 0.235018f, 0.0286433f, 0.000817774f
-			};
-			CConvolutionSeparableTask convTask("gauss_3x3", "Images/input.pfm", HGroupSize, VGroupSize,
-				4, 4, 3, ConvKernel, ConvKernel);
-			RunComputeTask(convTask, HGroupSize);
-		}
-	}
+		//simple box filter
+		vector<float> box4(9, 1.0f / 9.0f);
+		RegisterSeparableTask("separable-box4", "Separable convolution, 9x9 box filter", "box_4x4", box4);
 
+		//simple box filter
+		vector<float> box8(17, 1.0f / 17.0f);
+		RegisterSeparableTask("separable-box8", "Separable convolution, 17x17 box filter", "box_8x8", box8);
 
-	cout<<endl<<"########################################"<<endl;
-	cout<<"Task 3: Separable bilateral convolution"<<endl<<endl;
-	{
-		size_t HGroupSize[2] = {32, 4};
-		size_t VGroupSize[2] = {32, 4};
+		// Gaussian blur
+		const float gauss[7] = {
+			0.000817774f, 0.0286433f, 0.235018f, 0.471041f, 0.235018f, 0.0286433f, 0.000817774f
+		};
+		RegisterSeparableTask("separable-gauss3", "Separable convolution, 7x7 Gaussian blur", "gauss_3x3", vector<float>(gauss, gauss + 7));
+	}
 
+	// Task 3: separable bilateral convolution
+	CTaskEntry bilateral;
+	bilateral.Name = "bilateral";
+	bilateral.Description = "Separable bilateral convolution";
+	bilateral.DefaultInputFile = "Images/color.pfm";
+	bilateral.DefaultLocalWorkSize[0] = 32;
+	bilateral.DefaultLocalWorkSize[1] = 4;
+	bilateral.Factory = [](CTaskOptions& Options) -> IComputeTask* {
 		float ConvKernel[9] = {0.010284844f,	0.0417071f,	0.113371652f,	0.206576619f,	0.252313252f,	0.206576619f,	0.113371652f,	0.0417071f,	0.010284844f};
-
-		CConvolutionBilateralTask convTask("Images/color.pfm", "Images/normals.pfm", "Images/depth.pfm", HGroupSize, VGroupSize,
+		return new CConvolutionBilateralTask(Options.InputFile, "Images/normals.pfm", "Images/depth.pfm", Options.LocalWorkSize, Options.LocalWorkSize,
 			4, 4, 4, ConvKernel, ConvKernel);
-		RunComputeTask(convTask, HGroupSize);
-	}
+	};
+	m_Tasks.Register(bilateral);
 
-	cout<<endl<<"########################################"<<endl;
-	cout<<"Task 4: Histogram"<<endl<<endl;
+	// Task 4: histogram
+	for(int useLocalMemory = 0; useLocalMemory <= 1; useLocalMemory++)
 	{
-		size_t group_size[2] = {16, 16};
-		{
-			CHistogramTask histogram(0.25f, 0.26f, false, "Images/input.pfm");
-			RunComputeTask(histogram, group_size);
-		}
-
-		{
-			CHistogramTask histogram(0.25f, 0.26f, true, "Images/input.pfm");
-			RunComputeTask(histogram, group_size);
-		}
+		CTaskEntry histogram;
+		histogram.Name = useLocalMemory ? "histogram-local" : "histogram";
+		histogram.Description = useLocalMemory ? "Histogram (local memory)" : "Histogram";
+		histogram.DefaultInputFile = "Images/input.pfm";
+		histogram.DefaultLocalWorkSize[0] = 16;
+		histogram.DefaultLocalWorkSize[1] = 16;
+		histogram.Factory = [useLocalMemory](CTaskOptions& Options) -> IComputeTask* {
+			return new CHistogramTask(0.25f, 0.26f, useLocalMemory != 0, Options.InputFile);
+		};
+		m_Tasks.Register(histogram);
 	}
+}
 
-	return true;
+void CAssignment3::RegisterSeparableTask(const std::string& Name, const std::string& Description, const std::string& OutFileName, const std::vector<float>& ConvKernel)
+{
+	CTaskEntry entry;
+	entry.Name = Name;
+	entry.Description = Description;
+	entry.DefaultInputFile = "Images/input.pfm";
+	entry.DefaultLocalWorkSize[0] = 32;
+	entry.DefaultLocalWorkSize[1] = 16;
+	entry.Factory = [this, OutFileName, ConvKernel](CTaskOptions& Options) -> IComputeTask* {
+		std::vector<float> kernel = ConvKernel;
+		int kernelRadius = (int)kernel.size() / 2;
+		CConvolutionSeparableTask* pTask = new CConvolutionSeparableTask(OutFileName, Options.InputFile, Options.LocalWorkSize, Options.LocalWorkSize,
+			4, 4, kernelRadius, &kernel[0], &kernel[0]);
+		if(!Options.LocalWorkSizeSet)
+			TuneSeparableConvolution(*pTask);
+		return pTask;
+	};
+	m_Tasks.Register(entry);
+}
+
+void CAssignment3::TuneSeparableConvolution(CConvolutionSeparableTask& Task)
+{
+	// the passes are independent, so two searches over 27 configurations replace one over 729;
+	// if nothing fits, the task simply keeps the group sizes it was constructed with
+	TuningConfiguration best;
+	TuneComputeTask(Task, Task, CConvolutionSeparableTask::GetTuningSpace(true), best);
+	TuneComputeTask(Task, Task, CConvolutionSeparableTask::GetTuningSpace(false), best);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -17,10 +17,15 @@
                                 dP                                    d8888P  
 ******************************************************************************/
 
-#ifndef _CASSIGNMENT2_H
-#define _CASSIGNMENT2_H
+#ifndef _CASSIGNMENT3_H
+#define _CASSIGNMENT3_H
 
-#include "../Common/CAssignmentBase.h"
+#include "../../Common/CAssignmentBase.h"
+
+#include <string>
+#include <vector>
+
+class CConvolutionSeparableTask;
 
 //! Assignment3 solution
 class CAssignment3 : public CAssignmentBase
@@ -29,6 +34,14 @@ public:
 	virtual ~CAssignment3() {};
 
 	virtual bool DoCompute();
+
+protected:
+	virtual void RegisterTasks();
+
+	//! Tunes the horizontal, then the vertical pass of the task
+	void TuneSeparableConvolution(CConvolutionSeparableTask& Task);
+
+	void RegisterSeparableTask(const std::string& Name, const std::string& Description, const std::string& OutFileName, const std::vector<float>& ConvKernel);
 };
 
-#endif // _CASSIGNMENT2_H
+#endif // _CASSIGNMENT3_H
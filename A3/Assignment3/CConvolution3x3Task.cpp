@@ -5,8 +5,11 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "CConvolution3x3Task.h"
 
-#include "../Common/CLUtil.h"
-#include "../Common/CTimer.h"
+#include "../../Common/CLUtil.h"
+#include "../../Common/CDeviceMemoryTracker.h"
+#include "../../Common/CKernelLibrary.h"
+#include "../../Common/CTimer.h"
+#include "../../Common/CThreadPool.h"
 
 using namespace std;
 
@@ -64,14 +67,11 @@ bool CConvolution3x3Task::InitResources(cl_device_id Device, cl_context Context)
 	kernelConstants[9] = m_KernelWeight;
 	kernelConstants[10] = m_Offset;
 
-	m_dKernelConstants = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, 11 * sizeof(cl_float), 
-		kernelConstants, &clError);
+	m_dKernelConstants = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, 11 * sizeof(cl_float), 
+		kernelConstants, &clError, "3x3 filter constants");
 	V_RETURN_FALSE_CL(clError, "Error allocating device kernel constants.");
 
-	string programCode;
-
-	CLUtil::LoadProgramSourceToMemory("Convolution3x3.cl", programCode);
-	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode);
+	m_Program = CKernelLibrary::GetProgram(Device, Context, "Convolution3x3.cl");
 	if(m_Program == nullptr) return false;
 
 	//create kernel(s)
@@ -102,27 +102,18 @@ void CConvolution3x3Task::ComputeGPU(cl_context Context, cl_command_queue Comman
 {
 	// This time we can take a bit less iterations than before, since the image processing itself
 	// is more time consuming than the previous tasks
-	const int nIterations = 1000;
+	const int nIterations = GetIterations(1000);
 
 	//do 1 or 3 convolution steps, based on the number of color channels to process
 	unsigned int numChannels = m_Monochrome ? 1 : 3;
 
-	size_t dataSize = m_Pitch * m_Height * sizeof(cl_float);
-
-	//perform the convolution and measure the performance
-	double runTime = 0.0f;
-	for(unsigned int iChannel = 0; iChannel < numChannels; iChannel++)	
-		runTime += ConvolutionChannelGPU(iChannel, Context, CommandQueue, nIterations);
-
+	//perform the convolution of all channels concurrently, measure the performance and copy the results back to the CPU
+	double runTime = ComputeChannelsGPU(CommandQueue, numChannels, nIterations);
+	if(runTime < 0.0)
+		return;
 
 	cout<<"  Average GPU time: "<<runTime<<" ms, throughput: "<< 1.0e-6 * m_Width * m_Height / runTime << " Gpixels/s" <<endl;
-
-	for(unsigned int iChannel = 0; iChannel < numChannels; iChannel++)
-	{
-		//copy the results back to the CPU
-		V_RETURN_CL( clEnqueueReadBuffer(CommandQueue, m_dResultChannels[iChannel], CL_TRUE, 0, dataSize,
-									m_hGPUResultChannels[iChannel], 0, NULL, NULL), "Error reading back results from the device!" );
-	}
+	ReportGPUTime("3x3", runTime, nIterations, numChannels, m_TileSize);
 
 
 	SaveImage("Images/GPUResult3x3.pfm", m_hGPUResultChannels);
@@ -141,6 +132,7 @@ void CConvolution3x3Task::ComputeCPU()
 	}
 
 	cout<<"  CPU time: "<<runTime<<" ms, throughput: "<< 1.0e-6 * m_Width * m_Height / runTime << " Gpixels/s" <<endl;
+	ReportCPUTime("3x3", runTime, 10, numChannels);
 
 	SaveImage("Images/CPUResult3x3.pfm", m_hCPUResultChannels);
 }
@@ -157,45 +149,47 @@ double CConvolution3x3Task::ConvolutionChannelCPU(unsigned int Channel)
 	for(int iter = 0; iter < nIterations; iter++)
 	{
 
-		for(unsigned int y = 0; y < m_Height; y++)
-		{
-			for(unsigned int x = 0; x < m_Width; x++)
+		// the rows are independent, every thread computes a contiguous range of them
+		CThreadPool::ParallelFor(0, m_Height, [&](size_t RowBegin, size_t RowEnd) {
+			for(unsigned int y = (unsigned int)RowBegin; y < RowEnd; y++)
 			{
-				float value = 0;
-				//apply convolution kernel
-				for(int offsetY = -1; offsetY < 2; offsetY ++)
+				for(unsigned int x = 0; x < m_Width; x++)
 				{
-					int sy = y + offsetY;
-					if(sy >= 0 && sy < int(m_Height))
-						for(int offsetX = -1; offsetX < 2; offsetX++)
-						{
-							int sx = x + offsetX;
-							if(sx >= 0 && sx < int(m_Width))
-								value += m_hSourceChannels[Channel][sy * m_Pitch + sx] * m_hConvolutionKernel[1 + offsetY][1 + offsetX];
-						}
+					float value = 0;
+					//apply convolution kernel
+					for(int offsetY = -1; offsetY < 2; offsetY ++)
+					{
+						int sy = y + offsetY;
+						if(sy >= 0 && sy < int(m_Height))
+							for(int offsetX = -1; offsetX < 2; offsetX++)
+							{
+								int sx = x + offsetX;
+								if(sx >= 0 && sx < int(m_Width))
+									value += m_hSourceChannels[Channel][sy * m_Pitch + sx] * m_hConvolutionKernel[1 + offsetY][1 + offsetX];
+							}
+					}
+					m_hCPUResultChannels[Channel][y * m_Pitch + x] = value * m_KernelWeight + m_Offset;		
 				}
-				m_hCPUResultChannels[Channel][y * m_Pitch + x] = value * m_KernelWeight + m_Offset;		
 			}
-		}
+		});
 
 	}
 
 	timer.Stop();
 
-	return timer.GetElapsedMilliseconds();
+	return timer.GetElapsedMilliseconds() / double(nIterations);
 }
 
-double CConvolution3x3Task::ConvolutionChannelGPU(unsigned int Channel, cl_context Context, 
-												cl_command_queue CommandQueue, int NIterations)
+int CConvolution3x3Task::AddChannelNodes(CCommandGraph& Graph, unsigned int Channel, const std::vector<int>& Dependencies)
 {
 	size_t globalWorkSize[2] = {CLUtil::GetGlobalWorkSize(m_Width, m_TileSize[0]), CLUtil::GetGlobalWorkSize(m_Height, m_TileSize[1])};
-	
-	cl_int clErr;
-	clErr  = clSetKernelArg(m_ConvolutionKernel, 0, sizeof(cl_mem), (void*)&m_dResultChannels[Channel]);
-	clErr |= clSetKernelArg(m_ConvolutionKernel, 1, sizeof(cl_mem), (void*)&m_dSourceChannels[Channel]);
-	V_RETURN_0_CL(clErr, "Error setting kernel arguments!");
 
-	return CLUtil::ProfileKernel(CommandQueue, m_ConvolutionKernel, 2, globalWorkSize, m_TileSize, NIterations);
+	//the channels share the kernel, the graph sets the buffers of each channel before its launch
+	int node = Graph.AddKernel("Convolution3x3", m_ConvolutionKernel, 2, globalWorkSize, m_TileSize, Dependencies);
+	if(!Graph.SetKernelArg(node, 0, sizeof(cl_mem), &m_dResultChannels[Channel]) ||
+		!Graph.SetKernelArg(node, 1, sizeof(cl_mem), &m_dSourceChannels[Channel]))
+		return -1;
+	return node;
 }
 
 
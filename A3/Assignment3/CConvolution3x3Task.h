@@ -49,10 +49,12 @@ public:
 
 protected:
 	
+	// 9 multiply-adds, the scale and the offset
+	virtual double GetFlopsPerPixel() const { return 20.0; }
+
 	// the return value is the run time in milliseconds
 	double ConvolutionChannelCPU(unsigned int Channel);
-	//the last parameter is for timing, and the returned value is the average run time in milliseconds
-	double ConvolutionChannelGPU(unsigned int Channel, cl_context Context, cl_command_queue CommandQueue, int NIterations);
+	virtual int AddChannelNodes(CCommandGraph& Graph, unsigned int Channel, const std::vector<int>& Dependencies);
 
 	size_t			m_TileSize[2];
 
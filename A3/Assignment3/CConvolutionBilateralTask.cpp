@@ -5,8 +5,10 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "CConvolutionBilateralTask.h"
 
-#include "../Common/CLUtil.h"
-#include "../Common/CTimer.h"
+#include "../../Common/CLUtil.h"
+#include "../../Common/CDeviceMemoryTracker.h"
+#include "../../Common/CTimer.h"
+#include "../../Common/CThreadPool.h"
 #include "Pfm.h"
 
 #include <sstream>
@@ -89,9 +91,9 @@ bool CConvolutionBilateralTask::InitResources(cl_device_id Device, cl_context Co
 	cl_int clError = 0;
 	cl_int clErr;
 
-	m_dDiscBuffer = clCreateBuffer(Context, CL_MEM_READ_WRITE, m_Pitch * m_Height * sizeof(cl_int),  NULL, &clErr);
+	m_dDiscBuffer = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, m_Pitch * m_Height * sizeof(cl_int),  NULL, &clErr, "discontinuity buffer");
 	clError = clErr;
-	m_dNormDepthBuffer = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, m_Pitch * m_Height * sizeof(cl_float4),  m_hNormDepthBuffer, &clErr);
+	m_dNormDepthBuffer = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, m_Pitch * m_Height * sizeof(cl_float4),  m_hNormDepthBuffer, &clErr, "normal/depth buffer");
 	clError |= clErr;
 	V_RETURN_FALSE_CL(clError, "Error allocating device memory.");
 
@@ -164,39 +166,18 @@ void CConvolutionBilateralTask::ReleaseResources()
 
 void CConvolutionBilateralTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
 {
-	size_t dataSize = m_Pitch * m_Height * sizeof(cl_float);
-	int nIterations = 100;
+	int nIterations = GetIterations(100);
 
 	unsigned int numChannels = 3;
 
-	double runTime = 0.0f;
-
-	// detect discontinuities
-	size_t globalWorkSizeH[2] = {CLUtil::GetGlobalWorkSize(m_Width / m_StepsHorizontal, m_LocalSizeHorizontal[0]), CLUtil::GetGlobalWorkSize(m_Height, m_LocalSizeHorizontal[1])};	
-	runTime += CLUtil::ProfileKernel(CommandQueue, m_HorizontalDiscKernel, 2, globalWorkSizeH, LocalWorkSize, nIterations);
-
-	size_t globalWorkSizeV[2] = {CLUtil::GetGlobalWorkSize(m_Width, m_LocalSizeVertical[0]), CLUtil::GetGlobalWorkSize(m_Height / m_StepsVertical, m_LocalSizeVertical[1])};
-	runTime += CLUtil::ProfileKernel(CommandQueue, m_VerticalDiscKernel, 2, globalWorkSizeV, LocalWorkSize, nIterations);
-
-
-	for(unsigned int iChannel = 0; iChannel < numChannels; iChannel++)
-	{
-		runTime += ConvolutionChannelGPU(iChannel, Context, CommandQueue, nIterations);
-	}
+	//detect the discontinuities, then filter the channels concurrently
+	double runTime = ComputeChannelsGPU(CommandQueue, numChannels, nIterations);
+	if(runTime < 0.0)
+		return;
 
 	cout<<"  Average GPU time: "<<runTime<<" ms, throughput: "<< 1.0e-6 * m_Width * m_Height / runTime << " Gpixels/s" <<endl;
+	ReportGPUTime("Bilateral", runTime, nIterations, numChannels, m_LocalSizeHorizontal);
 
-	for(unsigned int iChannel = 0; iChannel < numChannels; iChannel++)
-	{
-		//copy the results back to the CPU
-		//(this time the data is in the same buffer as the input was, because of the 2 convolution passes)
-		V_RETURN_CL( clEnqueueReadBuffer(CommandQueue, m_dResultChannels[iChannel], CL_TRUE, 0, dataSize,
-									m_hGPUResultChannels[iChannel], 0, NULL, NULL), "Error reading back results from the device!" );
-
-	}
-	V_RETURN_CL( clEnqueueReadBuffer(CommandQueue, m_dDiscBuffer, CL_TRUE, 0, m_Width * m_Height * sizeof(int), 
-		m_hGPUDiscBuffer, 0, NULL, NULL), "Error reading back results from the device!" );
-	
 	SaveImage("Images/GPUResultBilateral.pfm", m_hGPUResultChannels);
 	SaveIntImage("Images/GPUDiscontinuities.pfm", m_hGPUDiscBuffer);
 }
@@ -209,46 +190,48 @@ void CConvolutionBilateralTask::ComputeCPU()
 	timer.Start();
 	
 	// Detect discontinuities
-	for(unsigned int y = 0; y < m_Height; y++)
-		for(unsigned int x = 0; x < m_Width; x++)
-		{
-			cl_float4 myNormDepth = m_hNormDepthBuffer[y*m_Pitch + x];
-			int flag = 0;
-
-			// Left neighbor
-			if (x > 0) {
-				cl_float4 normDepth = m_hNormDepthBuffer[y*m_Pitch + x - 1];
-				if (IsNormalDiscontinuity(myNormDepth, normDepth) || IsDepthDiscontinuity(myNormDepth.s[3], normDepth.s[3]))
+	CThreadPool::ParallelFor(0, m_Height, [&](size_t RowBegin, size_t RowEnd) {
+		for(unsigned int y = (unsigned int)RowBegin; y < RowEnd; y++)
+			for(unsigned int x = 0; x < m_Width; x++)
+			{
+				cl_float4 myNormDepth = m_hNormDepthBuffer[y*m_Pitch + x];
+				int flag = 0;
+
+				// Left neighbor
+				if (x > 0) {
+					cl_float4 normDepth = m_hNormDepthBuffer[y*m_Pitch + x - 1];
+					if (IsNormalDiscontinuity(myNormDepth, normDepth) || IsDepthDiscontinuity(myNormDepth.s[3], normDepth.s[3]))
+						flag |= 1;
+				} else
 					flag |= 1;
-			} else
-				flag |= 1;
 
-			// Right neighbor
-			if (x < m_Width - 1) {
-				cl_float4 normDepth  = m_hNormDepthBuffer[y*m_Pitch + x + 1];
-				if (IsNormalDiscontinuity(myNormDepth, normDepth) || IsDepthDiscontinuity(myNormDepth.s[3], normDepth.s[3]))
+				// Right neighbor
+				if (x < m_Width - 1) {
+					cl_float4 normDepth  = m_hNormDepthBuffer[y*m_Pitch + x + 1];
+					if (IsNormalDiscontinuity(myNormDepth, normDepth) || IsDepthDiscontinuity(myNormDepth.s[3], normDepth.s[3]))
+						flag |= 2;
+				} else
 					flag |= 2;
-			} else
-				flag |= 2;
 
-			// Upper neighbor
-			if (y > 0) {
-				cl_float4 normDepth = m_hNormDepthBuffer[(y-1)*m_Pitch + x];
-				if (IsNormalDiscontinuity(myNormDepth, normDepth) || IsDepthDiscontinuity(myNormDepth.s[3], normDepth.s[3]))
+				// Upper neighbor
+				if (y > 0) {
+					cl_float4 normDepth = m_hNormDepthBuffer[(y-1)*m_Pitch + x];
+					if (IsNormalDiscontinuity(myNormDepth, normDepth) || IsDepthDiscontinuity(myNormDepth.s[3], normDepth.s[3]))
+						flag |= 4;
+				} else
 					flag |= 4;
-			} else
-				flag |= 4;
 
-			// Lower neighbor
-			if (y < m_Height - 1) {
-				cl_float4 normDepth  = m_hNormDepthBuffer[(y+1)*m_Pitch + x];
-				if (IsNormalDiscontinuity(myNormDepth, normDepth) || IsDepthDiscontinuity(myNormDepth.s[3], normDepth.s[3]))
+				// Lower neighbor
+				if (y < m_Height - 1) {
+					cl_float4 normDepth  = m_hNormDepthBuffer[(y+1)*m_Pitch + x];
+					if (IsNormalDiscontinuity(myNormDepth, normDepth) || IsDepthDiscontinuity(myNormDepth.s[3], normDepth.s[3]))
+						flag |= 8;
+				} else
 					flag |= 8;
-			} else
-				flag |= 8;
 
-			m_hCPUDiscBuffer[y * m_Pitch + x] = flag;
-		}
+				m_hCPUDiscBuffer[y * m_Pitch + x] = flag;
+			}
+	});
 
 	timer.Stop();
 
@@ -259,6 +242,7 @@ void CConvolutionBilateralTask::ComputeCPU()
 		runTime += ConvolutionChannelCPU(iChannel);
 
 	cout<<"  CPU time: "<<runTime<<" ms, throughput: "<< 1.0e-6 * m_Width * m_Height / runTime << " Gpixels/s" <<endl;
+	ReportCPUTime("Bilateral", runTime, 1, 3);
 
 	// Store CPU results
 	SaveImage("Images/CPUResultBilateral.pfm", m_hCPUResultChannels);
@@ -271,133 +255,135 @@ double CConvolutionBilateralTask::ConvolutionChannelCPU(unsigned int Channel)
 	timer.Start();
 
 	// HORIZONTAL PASS
-	for(unsigned int y = 0; y < m_Height; y++) 
-	{
-		for(unsigned int x = 0; x < m_Width; x++)
+	CThreadPool::ParallelFor(0, m_Height, [&](size_t RowBegin, size_t RowEnd) {
+		for(unsigned int y = (unsigned int)RowBegin; y < RowEnd; y++)
 		{
-			float sum = 0.f;
-			float weight = 0.f;
+			for(unsigned int x = 0; x < m_Width; x++)
+			{
+				float sum = 0.f;
+				float weight = 0.f;
 
-			// Middle pixel
-			weight	= m_hKernelHorizontal[m_KernelRadius];
-			sum		= m_hSourceChannels[Channel][y * m_Pitch + x] * weight;
+				// Middle pixel
+				weight	= m_hKernelHorizontal[m_KernelRadius];
+				sum		= m_hSourceChannels[Channel][y * m_Pitch + x] * weight;
 
-			// Left neighborhood
-			for(int k = 0; k > -m_KernelRadius; ) {
+				// Left neighborhood
+				for(int k = 0; k > -m_KernelRadius; ) {
 
-				int flag = m_hCPUDiscBuffer[y * m_Pitch + x + k];
-				// If discontinuity on the left detected, bail out
-				if (flag & 1 ||  (int)x+k <= 0)
-					break;
+					int flag = m_hCPUDiscBuffer[y * m_Pitch + x + k];
+					// If discontinuity on the left detected, bail out
+					if (flag & 1 ||  (int)x+k <= 0)
+						break;
 
-				k--; 
+					k--; 
 
-				float w = m_hKernelHorizontal[m_KernelRadius - k];
-				sum += m_hSourceChannels[Channel][y * m_Pitch + x + k] * w;
-				weight += w;
-			}
+					float w = m_hKernelHorizontal[m_KernelRadius - k];
+					sum += m_hSourceChannels[Channel][y * m_Pitch + x + k] * w;
+					weight += w;
+				}
 
-			// Right neighborhood
-			for(int k = 0; k < m_KernelRadius; ) {
+				// Right neighborhood
+				for(int k = 0; k < m_KernelRadius; ) {
 
-				int flag = m_hCPUDiscBuffer[y * m_Pitch + x + k];
-				// If discontinuity on the right is detected, bail out
-				if (flag & 2 || (int)x+k >= (int)m_Width-1)
-					break;
+					int flag = m_hCPUDiscBuffer[y * m_Pitch + x + k];
+					// If discontinuity on the right is detected, bail out
+					if (flag & 2 || (int)x+k >= (int)m_Width-1)
+						break;
 
-				k++; 
+					k++; 
 
-				float w = m_hKernelHorizontal[m_KernelRadius - k];
-				sum += m_hSourceChannels[Channel][y * m_Pitch + x + k] * w;
-				weight += w;
-			}
+					float w = m_hKernelHorizontal[m_KernelRadius - k];
+					sum += m_hSourceChannels[Channel][y * m_Pitch + x + k] * w;
+					weight += w;
+				}
 
-			// Re-normalize
-			if (weight != 0.f)
-				sum /= weight;
-			else
-				sum = 0.f;
+				// Re-normalize
+				if (weight != 0.f)
+					sum /= weight;
+				else
+					sum = 0.f;
 
-			m_hCPUWorkingBuffer[y * m_Pitch + x] = sum;
+				m_hCPUWorkingBuffer[y * m_Pitch + x] = sum;
+			}
 		}
-	}
+	});
 
 	//VERTICAL PASS
-	for(unsigned int x = 0; x < m_Width; x++)
-	{
-		for(unsigned int y = 0; y < m_Height; y++)
+	//(row by row, which reads the working buffer along the rows; every pixel is computed as before)
+	CThreadPool::ParallelFor(0, m_Height, [&](size_t RowBegin, size_t RowEnd) {
+		for(unsigned int y = (unsigned int)RowBegin; y < RowEnd; y++)
 		{
-			float sum = 0.f;
-			float weight = 0.f;
+			for(unsigned int x = 0; x < m_Width; x++)
+			{
+				float sum = 0.f;
+				float weight = 0.f;
 
-			// Middle pixel
-			weight	= m_hKernelHorizontal[m_KernelRadius];
-			sum		= m_hCPUWorkingBuffer[y * m_Pitch + x] * weight;
+				// Middle pixel
+				weight	= m_hKernelHorizontal[m_KernelRadius];
+				sum		= m_hCPUWorkingBuffer[y * m_Pitch + x] * weight;
 
-			// Upper neighborhood
-			for(int k = 0; k > -m_KernelRadius; ) {
+				// Upper neighborhood
+				for(int k = 0; k > -m_KernelRadius; ) {
 
-				int flag = m_hCPUDiscBuffer[(y+k) * m_Pitch + x];
-				// If discontinuity on the left detected, bail out
-				if (flag & 4 || y+k <= 0)
-					break;
+					int flag = m_hCPUDiscBuffer[(y+k) * m_Pitch + x];
+					// If discontinuity on the left detected, bail out
+					if (flag & 4 || y+k <= 0)
+						break;
 
-				k--; 
+					k--; 
 
-				float w = m_hKernelHorizontal[m_KernelRadius - k];
-				sum += m_hCPUWorkingBuffer[(y+k) * m_Pitch + x] * w;
-				weight += w;
-			}
+					float w = m_hKernelHorizontal[m_KernelRadius - k];
+					sum += m_hCPUWorkingBuffer[(y+k) * m_Pitch + x] * w;
+					weight += w;
+				}
 
-			// Lower neighborhood
-			for(int k = 0; k < m_KernelRadius; ) {
+				// Lower neighborhood
+				for(int k = 0; k < m_KernelRadius; ) {
 
-				int flag = m_hCPUDiscBuffer[(y+k) * m_Pitch + x];
-				// If discontinuity on the right is detected, bail out
-				if (flag & 8 || (int)y+k >= (int)m_Height-1)
-					break;
+					int flag = m_hCPUDiscBuffer[(y+k) * m_Pitch + x];
+					// If discontinuity on the right is detected, bail out
+					if (flag & 8 || (int)y+k >= (int)m_Height-1)
+						break;
 
-				k++; 
+					k++; 
 
-				float w = m_hKernelHorizontal[m_KernelRadius - k];
-				sum += m_hCPUWorkingBuffer[(y+k) * m_Pitch + x] * w;
-				weight += w;
-			}
+					float w = m_hKernelHorizontal[m_KernelRadius - k];
+					sum += m_hCPUWorkingBuffer[(y+k) * m_Pitch + x] * w;
+					weight += w;
+				}
 
-			// Re-normalize
-			if (weight != 0.f)
-				sum /= weight;
-			else
-				sum = 0.f;
+				// Re-normalize
+				if (weight != 0.f)
+					sum /= weight;
+				else
+					sum = 0.f;
 
-			m_hCPUResultChannels[Channel][y * m_Pitch + x] = sum;
+				m_hCPUResultChannels[Channel][y * m_Pitch + x] = sum;
+			}
 		}
-	}
+	});
 	
 
 	timer.Stop();
 	return timer.GetElapsedMilliseconds();
 }
 
-double CConvolutionBilateralTask::ConvolutionChannelGPU(unsigned int Channel, cl_context Context, cl_command_queue CommandQueue, int NIterations)
+std::vector<int> CConvolutionBilateralTask::AddSharedNodes(CCommandGraph& Graph)
 {
-	cl_int clErr;
-
-	double runTime = 0;
-
-	clErr  = clSetKernelArg(m_HorizontalKernel, 1, sizeof(cl_mem), (void*)&m_dSourceChannels[Channel]);
-	clErr |= clSetKernelArg(m_HorizontalKernel, 0, sizeof(cl_mem), (void*)&m_dGPUWorkingBuffer);
-	V_RETURN_0_CL(clErr, "Error setting horizontal kernel arguments");
-
-	size_t globalWorkSizeH[2] = {CLUtil::GetGlobalWorkSize(m_Width / m_StepsHorizontal, m_LocalSizeHorizontal[0]), CLUtil::GetGlobalWorkSize(m_Height, m_LocalSizeHorizontal[1])};	
-	runTime += CLUtil::ProfileKernel(CommandQueue, m_HorizontalKernel, 2, globalWorkSizeH, m_LocalSizeHorizontal, NIterations);
+	size_t globalWorkSizeH[2] = {CLUtil::GetGlobalWorkSize(m_Width / m_StepsHorizontal, m_LocalSizeHorizontal[0]), CLUtil::GetGlobalWorkSize(m_Height, m_LocalSizeHorizontal[1])};
+	size_t globalWorkSizeV[2] = {CLUtil::GetGlobalWorkSize(m_Width, m_LocalSizeVertical[0]), CLUtil::GetGlobalWorkSize(m_Height / m_StepsVertical, m_LocalSizeVertical[1])};
 
-	clErr  = clSetKernelArg(m_VerticalKernel, 1, sizeof(cl_mem), (void*)&m_dGPUWorkingBuffer);
-	clErr |= clSetKernelArg(m_VerticalKernel, 0, sizeof(cl_mem), (void*)&m_dResultChannels[Channel]);
-	V_RETURN_0_CL(clErr, "Error setting vertical kernel arguments");
+	//the vertical pass adds its flags to the ones of the horizontal pass, so they cannot overlap
+	int horizontal = Graph.AddKernel("DiscontinuityHorizontal", m_HorizontalDiscKernel, 2, globalWorkSizeH, m_LocalSizeHorizontal);
+	int vertical = Graph.AddKernel("DiscontinuityVertical", m_VerticalDiscKernel, 2, globalWorkSizeV, m_LocalSizeVertical, {horizontal});
+	if(vertical < 0)
+		return std::vector<int>(1, -1);
 
-	size_t globalWorkSizeV[2] = {CLUtil::GetGlobalWorkSize(m_Width, m_LocalSizeVertical[0]), CLUtil::GetGlobalWorkSize(m_Height / m_StepsVertical, m_LocalSizeVertical[1])};
-	runTime += CLUtil::ProfileKernel(CommandQueue, m_VerticalKernel, 2, globalWorkSizeV, m_LocalSizeVertical, NIterations);
+	return std::vector<int>(1, vertical);
+}
 
-	return runTime;
+void CConvolutionBilateralTask::AddResultNodes(CCommandGraph& Graph, const std::vector<int>& SharedNodes)
+{
+	//the discontinuities are only read by the channels, so their download overlaps the filtering
+	Graph.AddRead("ReadDiscontinuities", m_dDiscBuffer, 0, m_Width * m_Height * sizeof(int), m_hGPUDiscBuffer, SharedNodes);
 }
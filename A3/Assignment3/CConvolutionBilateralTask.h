@@ -57,10 +57,14 @@ public:
 
 protected:
 
+	// per tap and pass: range difference, weight and the weighted sum, plus the normalization
+	virtual double GetFlopsPerPixel() const { return 2.0 * (3 * (2 * m_KernelRadius + 1) + 1); }
+
 	// the return value is the run time in milliseconds
 	double ConvolutionChannelCPU(unsigned int Channel);
-	// the return value is the run time in milliseconds
-	double ConvolutionChannelGPU(unsigned int Channel, cl_context Context, cl_command_queue CommandQueue, int NIterations);
+	//the discontinuity detection, which all channels depend on
+	virtual std::vector<int> AddSharedNodes(CCommandGraph& Graph);
+	virtual void AddResultNodes(CCommandGraph& Graph, const std::vector<int>& SharedNodes);
 
 	// These helper methods are used to build the discontinuity buffer
 	inline bool IsNormalDiscontinuity(const cl_float4 &n1, const cl_float4 &n2) {
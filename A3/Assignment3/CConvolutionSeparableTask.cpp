@@ -5,8 +5,10 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "CConvolutionSeparableTask.h"
 
-#include "../Common/CLUtil.h"
-#include "../Common/CTimer.h"
+#include "../../Common/CLUtil.h"
+#include "../../Common/CDeviceMemoryTracker.h"
+#include "../../Common/CTimer.h"
+#include "../../Common/CThreadPool.h"
 
 #include <sstream>
 #include <cstring>
@@ -44,7 +46,8 @@ CConvolutionSeparableTask::CConvolutionSeparableTask(
 	memcpy(m_hKernelHorizontal, pKernelHorizontal, kernelSize * sizeof(float));
 	memcpy(m_hKernelVertical, pKernelVertical, kernelSize * sizeof(float));
 
-	m_dGPUWorkingBuffer = nullptr;
+	for(int i = 0; i < 3; i++)
+		m_dGPUWorkingBuffers[i] = nullptr;
 	m_hCPUWorkingBuffer = nullptr;
 
 	m_FileNamePostfix = "Separable_" + OutFileName;
@@ -71,40 +74,46 @@ bool CConvolutionSeparableTask::InitResources(cl_device_id Device, cl_context Co
 
 	cl_int clError = 0;
 	cl_int clErr;
-	m_dKernelHorizontal = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, kernelSize * sizeof(cl_float), 
-		m_hKernelHorizontal, &clErr);
+	m_dKernelHorizontal = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, kernelSize * sizeof(cl_float), 
+		m_hKernelHorizontal, &clErr, "horizontal filter kernel");
 	clError |= clErr;
-	m_dKernelVertical = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, kernelSize * sizeof(cl_float), 
-		m_hKernelVertical, &clErr);
+	m_dKernelVertical = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, kernelSize * sizeof(cl_float), 
+		m_hKernelVertical, &clErr, "vertical filter kernel");
 	clError |= clErr;
 	V_RETURN_FALSE_CL(clError, "Error allocating device kernel constants.");
 
-	m_dGPUWorkingBuffer = clCreateBuffer(Context, CL_MEM_READ_WRITE, m_Pitch * m_Height * sizeof(cl_float), NULL, &clError);
-	V_RETURN_FALSE_CL(clError, "Error allocating device working array");
+	//one working array per channel, so the channels can be computed concurrently
+	for(int i = 0; i < 3; i++)
+	{
+		m_dGPUWorkingBuffers[i] = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, m_Pitch * m_Height * sizeof(cl_float), NULL, &clError, "separable working buffer");
+		V_RETURN_FALSE_CL(clError, "Error allocating device working array");
+	}
 
 	m_hCPUWorkingBuffer = new float[m_Height * m_Pitch];
 
-	string programCode;
-
-	CLUtil::LoadProgramSourceToMemory(m_ProgramName, programCode);
-
-	//This time we define several kernel-specific constants that we did not know during
-	//implementing the kernel, but we need to include during compile time.
-	stringstream compileOptions;
-	compileOptions<<"-cl-fast-relaxed-math"
-	<<" -D KERNEL_RADIUS="<<m_KernelRadius
-	<<" -D H_GROUPSIZE_X="<<m_LocalSizeHorizontal[0]<<" -D H_GROUPSIZE_Y="<<m_LocalSizeHorizontal[1]
-	<<" -D H_RESULT_STEPS="<<m_StepsHorizontal
-	<<" -D V_GROUPSIZE_X="<<m_LocalSizeVertical[0]<<" -D V_GROUPSIZE_Y="<<m_LocalSizeVertical[1]
-	<<" -D V_RESULT_STEPS="<<m_StepsVertical;
-
-	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode, compileOptions.str());
+	m_Program = CKernelLibrary::GetProgram(Device, Context, m_ProgramName,
+		GetSpecialization(m_LocalSizeHorizontal, m_LocalSizeVertical, m_StepsHorizontal, m_StepsVertical));
 	if(m_Program == nullptr) return false;
 
 
 	return InitKernels();
 }
 
+CKernelSpecialization CConvolutionSeparableTask::GetSpecialization(const size_t LocalSizeHorizontal[2], const size_t LocalSizeVertical[2],
+	int StepsHorizontal, int StepsVertical) const
+{
+	//This time we define several kernel-specific constants that we did not know during
+	//implementing the kernel, but we need to include during compile time.
+	CKernelSpecialization specialization;
+	specialization.AddOption("-cl-fast-relaxed-math")
+		.Set("KERNEL_RADIUS", m_KernelRadius)
+		.Set("H_GROUPSIZE_X", LocalSizeHorizontal[0]).Set("H_GROUPSIZE_Y", LocalSizeHorizontal[1])
+		.Set("H_RESULT_STEPS", StepsHorizontal)
+		.Set("V_GROUPSIZE_X", LocalSizeVertical[0]).Set("V_GROUPSIZE_Y", LocalSizeVertical[1])
+		.Set("V_RESULT_STEPS", StepsVertical);
+	return specialization;
+}
+
 bool CConvolutionSeparableTask::InitKernels()
 {
 	cl_int clError;
@@ -136,7 +145,8 @@ void CConvolutionSeparableTask::ReleaseResources()
 {
 	SAFE_DELETE_ARRAY( m_hCPUWorkingBuffer );
 
-	SAFE_RELEASE_MEMOBJECT(m_dGPUWorkingBuffer);
+	for(int i = 0; i < 3; i++)
+		SAFE_RELEASE_MEMOBJECT(m_dGPUWorkingBuffers[i]);
 	SAFE_RELEASE_MEMOBJECT(m_dKernelHorizontal);
 	SAFE_RELEASE_MEMOBJECT(m_dKernelVertical);
 
@@ -147,28 +157,18 @@ void CConvolutionSeparableTask::ReleaseResources()
 
 void CConvolutionSeparableTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
 {
-	size_t dataSize = m_Pitch * m_Height * sizeof(cl_float);
-	int nIterations = 100;
+	int nIterations = GetIterations(100);
 
 	unsigned int numChannels = 3;
 
-	double runTime = 0.0f;
-	for(unsigned int iChannel = 0; iChannel < numChannels; iChannel++)
-	{
-		runTime += ConvolutionChannelGPU(iChannel, Context, CommandQueue, nIterations);
-	}
+	//the channels run concurrently, the results are copied back to the CPU in the last pass
+	double runTime = ComputeChannelsGPU(CommandQueue, numChannels, nIterations);
+	if(runTime < 0.0)
+		return;
 
 	cout<<"  Average GPU time: "<<runTime<<" ms, throughput: "<< 1.0e-6 * m_Width * m_Height / runTime << " Gpixels/s" <<endl;
+	ReportGPUTime("Separable_" + m_OutFileName, runTime, nIterations, numChannels, m_LocalSizeHorizontal);
 
-	for(unsigned int iChannel = 0; iChannel < numChannels; iChannel++)
-	{
-		//copy the results back to the CPU
-		//(this time the data is in the same buffer as the input was, because of the 2 convolution passes)
-		V_RETURN_CL( clEnqueueReadBuffer(CommandQueue, m_dResultChannels[iChannel], CL_TRUE, 0, dataSize,
-									m_hGPUResultChannels[iChannel], 0, NULL, NULL), "Error reading back results from the device!" );
-
-	}
-	
 	SaveImage("Images/GPUResultSeparable_" + m_OutFileName + ".pfm", m_hGPUResultChannels);
 }
 
@@ -181,6 +181,7 @@ void CConvolutionSeparableTask::ComputeCPU()
 	}
 
 	cout<<"  CPU time: "<<runTime<<" ms, throughput: "<< 1.0e-6 * m_Width * m_Height / runTime << " Gpixels/s" <<endl;
+	ReportCPUTime("Separable_" + m_OutFileName, runTime, 1, 3);
 
 	SaveImage("Images/CPUResultSeparable_" + m_OutFileName + ".pfm", m_hCPUResultChannels);
 }
@@ -191,68 +192,184 @@ double CConvolutionSeparableTask::ConvolutionChannelCPU(unsigned int Channel)
 	timer.Start();
 
 	//horizontal pass
-	for(int y = 0; y < (int)m_Height; y++)
-		for(int x = 0; x < (int)m_Width; x++)
-		{
-			float value = 0;
-			//apply horizontal kernel
-			for(int k = -m_KernelRadius; k <= m_KernelRadius; k++)
+	CThreadPool::ParallelFor(0, m_Height, [&](size_t RowBegin, size_t RowEnd) {
+		for(int y = (int)RowBegin; y < (int)RowEnd; y++)
+			for(int x = 0; x < (int)m_Width; x++)
 			{
-				int sx = x + k;
-				if(sx >= 0 && sx < (int)m_Width)
-					value += m_hSourceChannels[Channel][y * m_Pitch + sx] * m_hKernelHorizontal[m_KernelRadius - k];
+				float value = 0;
+				//apply horizontal kernel
+				for(int k = -m_KernelRadius; k <= m_KernelRadius; k++)
+				{
+					int sx = x + k;
+					if(sx >= 0 && sx < (int)m_Width)
+						value += m_hSourceChannels[Channel][y * m_Pitch + sx] * m_hKernelHorizontal[m_KernelRadius - k];
+				}
+				m_hCPUWorkingBuffer[y * m_Pitch + x] = value;
 			}
-			m_hCPUWorkingBuffer[y * m_Pitch + x] = value;
-		}
+	});
 
 	//vertical pass
-	for(int x = 0; x < (int)m_Width; x++)
-		for(int y = 0; y < (int)m_Height; y++)
-		{
-			float value = 0;
-			//apply horizontal kernel
-			for(int k = -m_KernelRadius; k <= m_KernelRadius; k++)
+	//(row by row: consecutive x read consecutive addresses, so the loop over x can be vectorized.
+	// The taps of each pixel are still summed in the same order.)
+	CThreadPool::ParallelFor(0, m_Height, [&](size_t RowBegin, size_t RowEnd) {
+		for(int y = (int)RowBegin; y < (int)RowEnd; y++)
+			for(int x = 0; x < (int)m_Width; x++)
 			{
-				int sy = y + k;
-				if(sy >= 0 && sy < (int)m_Height)
-					value += m_hCPUWorkingBuffer[sy * m_Pitch + x] * m_hKernelVertical[m_KernelRadius - k];
+				float value = 0;
+				//apply horizontal kernel
+				for(int k = -m_KernelRadius; k <= m_KernelRadius; k++)
+				{
+					int sy = y + k;
+					if(sy >= 0 && sy < (int)m_Height)
+						value += m_hCPUWorkingBuffer[sy * m_Pitch + x] * m_hKernelVertical[m_KernelRadius - k];
+				}
+				m_hCPUResultChannels[Channel][y * m_Pitch + x] = value;
 			}
-			m_hCPUResultChannels[Channel][y * m_Pitch + x] = value;
-		}
+	});
 
 	timer.Stop();
 
 	return timer.GetElapsedMilliseconds();
 }
 
-double CConvolutionSeparableTask::ConvolutionChannelGPU(unsigned int Channel, cl_context Context, cl_command_queue CommandQueue, int NIterations)
+int CConvolutionSeparableTask::AddChannelNodes(CCommandGraph& Graph, unsigned int Channel, const std::vector<int>& Dependencies)
 {
-	cl_int clErr;
-
-	clErr  = clSetKernelArg(m_HorizontalKernel, 0, sizeof(cl_mem), (void*)&m_dGPUWorkingBuffer);
-	clErr |= clSetKernelArg(m_HorizontalKernel, 1, sizeof(cl_mem), (void*)&m_dSourceChannels[Channel]);
-	V_RETURN_0_CL(clErr, "Error setting horizontal kernel arguments");
-
-	clErr  = clSetKernelArg(m_VerticalKernel, 0, sizeof(cl_mem), (void*)&m_dResultChannels[Channel]);
-	clErr |= clSetKernelArg(m_VerticalKernel, 1, sizeof(cl_mem), (void*)&m_dGPUWorkingBuffer);
-	V_RETURN_0_CL(clErr, "Error setting vertical kernel arguments");
-
-
-	double runTime;	
-	
 	size_t globalWorkSizeH[2] = {
 		CLUtil::GetGlobalWorkSize(m_Width / m_StepsHorizontal, m_LocalSizeHorizontal[0]),
 		CLUtil::GetGlobalWorkSize(m_Height, m_LocalSizeHorizontal[1])
-	};	
-	runTime = CLUtil::ProfileKernel(CommandQueue, m_HorizontalKernel, 2, globalWorkSizeH, m_LocalSizeHorizontal, NIterations);
-
+	};
 	size_t globalWorkSizeV[2] = {
 		CLUtil::GetGlobalWorkSize(m_Width, m_LocalSizeVertical[0]),
 		CLUtil::GetGlobalWorkSize(m_Height / m_StepsVertical, m_LocalSizeVertical[1])
 	};
-	runTime += CLUtil::ProfileKernel(CommandQueue, m_VerticalKernel, 2, globalWorkSizeV, m_LocalSizeVertical, NIterations);
-	
-	return runTime;
+
+	//the channels share the kernels, the graph sets the buffers of each channel before its launch
+	int horizontal = Graph.AddKernel("ConvHorizontal", m_HorizontalKernel, 2, globalWorkSizeH, m_LocalSizeHorizontal, Dependencies);
+	if(!Graph.SetKernelArg(horizontal, 0, sizeof(cl_mem), &m_dGPUWorkingBuffers[Channel]) ||
+		!Graph.SetKernelArg(horizontal, 1, sizeof(cl_mem), &m_dSourceChannels[Channel]))
+		return -1;
+
+	int vertical = Graph.AddKernel("ConvVertical", m_VerticalKernel, 2, globalWorkSizeV, m_LocalSizeVertical, {horizontal});
+	if(!Graph.SetKernelArg(vertical, 0, sizeof(cl_mem), &m_dResultChannels[Channel]) ||
+		!Graph.SetKernelArg(vertical, 1, sizeof(cl_mem), &m_dGPUWorkingBuffers[Channel]))
+		return -1;
+
+	return vertical;
+}
+
+std::string CConvolutionSeparableTask::GetTuningKey() const
+{
+	stringstream key;
+	key<<"ConvolutionSeparable/r"<<m_KernelRadius<<"/"<<m_Width<<"x"<<m_Height;
+	return key.str();
+}
+
+CTuningSpace CConvolutionSeparableTask::GetTuningSpace(bool Horizontal)
+{
+	const int groupSizesX[] = { 16, 32, 64 };
+	const int groupSizesY[] = { 4, 8, 16 };
+	const int resultSteps[] = { 2, 4, 8 };
+	const string prefix = Horizontal ? "H_" : "V_";
+
+	CTuningSpace space;
+	space.AddParameter(prefix + "GROUPSIZE_X", vector<int>(groupSizesX, groupSizesX + 3));
+	space.AddParameter(prefix + "GROUPSIZE_Y", vector<int>(groupSizesY, groupSizesY + 3));
+	space.AddParameter(prefix + "RESULT_STEPS", vector<int>(resultSteps, resultSteps + 3));
+	return space;
+}
+
+bool CConvolutionSeparableTask::MeasureConfiguration(const TuningConfiguration& Configuration, cl_device_id Device,
+	cl_context Context, cl_command_queue CommandQueue, double& Milliseconds)
+{
+	// parameters missing in the configuration keep their current values
+	size_t localSizeH[2] = {
+		(size_t)CAutoTuner::GetValue(Configuration, "H_GROUPSIZE_X", (int)m_LocalSizeHorizontal[0]),
+		(size_t)CAutoTuner::GetValue(Configuration, "H_GROUPSIZE_Y", (int)m_LocalSizeHorizontal[1])
+	};
+	size_t localSizeV[2] = {
+		(size_t)CAutoTuner::GetValue(Configuration, "V_GROUPSIZE_X", (int)m_LocalSizeVertical[0]),
+		(size_t)CAutoTuner::GetValue(Configuration, "V_GROUPSIZE_Y", (int)m_LocalSizeVertical[1])
+	};
+	int stepsH = CAutoTuner::GetValue(Configuration, "H_RESULT_STEPS", m_StepsHorizontal);
+	int stepsV = CAutoTuner::GetValue(Configuration, "V_RESULT_STEPS", m_StepsVertical);
+
+	// each work-item loads one halo pixel, so the radius must not exceed the group size in the direction of the kernel
+	if(m_KernelRadius > (int)localSizeH[0] || m_KernelRadius > (int)localSizeV[1])
+		return false;
+
+	size_t globalWorkSizeH[2] = {
+		CLUtil::GetGlobalWorkSize(m_Width / stepsH, localSizeH[0]),
+		CLUtil::GetGlobalWorkSize(m_Height, localSizeH[1])
+	};
+	size_t globalWorkSizeV[2] = {
+		CLUtil::GetGlobalWorkSize(m_Width, localSizeV[0]),
+		CLUtil::GetGlobalWorkSize(m_Height / stepsV, localSizeV[1])
+	};
+
+	// the kernels only check the bounds in the direction of the convolution:
+	// the groups have to cover the image exactly in the other direction and completely in the convolved one
+	if(globalWorkSizeH[1] != m_Height || globalWorkSizeV[0] > m_Pitch ||
+		globalWorkSizeH[0] * stepsH < m_Width || globalWorkSizeV[1] * stepsV < m_Height)
+		return false;
+
+	// built past the kernel library, which would keep every rejected candidate until the context is released;
+	// the binary cache still has the winner when InitResources() gets it from the library
+	string sourceCode;
+	if(!CKernelLibrary::LoadSource("ConvolutionSeparable.cl", sourceCode))
+		return false;
+	cl_program program = CLUtil::BuildCLProgramFromMemory(Device, Context, sourceCode,
+		GetSpecialization(localSizeH, localSizeV, stepsH, stepsV).GetCompileOptions());
+	if(program == nullptr)
+		return false;
+
+	cl_int clError, clErr;
+	cl_kernel horizontalKernel = clCreateKernel(program, "ConvHorizontal", &clError);
+	cl_kernel verticalKernel = clCreateKernel(program, "ConvVertical", &clErr);
+	clError |= clErr;
+
+	bool success = false;
+	if(clError == CL_SUCCESS &&
+		CAutoTuner::FitsDevice(horizontalKernel, Device, localSizeH, 2) &&
+		CAutoTuner::FitsDevice(verticalKernel, Device, localSizeV, 2))
+	{
+		// same bindings as in InitKernels() and AddChannelNodes(), for the first channel
+		clError  = clSetKernelArg(horizontalKernel, 0, sizeof(cl_mem), (void*)&m_dGPUWorkingBuffers[0]);
+		clError |= clSetKernelArg(horizontalKernel, 1, sizeof(cl_mem), (void*)&m_dSourceChannels[0]);
+		clError |= clSetKernelArg(horizontalKernel, 2, sizeof(cl_mem), (void*)&m_dKernelHorizontal);
+		clError |= clSetKernelArg(horizontalKernel, 3, sizeof(cl_uint), (void*)&m_Width);
+		clError |= clSetKernelArg(horizontalKernel, 4, sizeof(cl_uint), (void*)&m_Pitch);
+		clError |= clSetKernelArg(verticalKernel, 0, sizeof(cl_mem), (void*)&m_dResultChannels[0]);
+		clError |= clSetKernelArg(verticalKernel, 1, sizeof(cl_mem), (void*)&m_dGPUWorkingBuffers[0]);
+		clError |= clSetKernelArg(verticalKernel, 2, sizeof(cl_mem), (void*)&m_dKernelVertical);
+		clError |= clSetKernelArg(verticalKernel, 3, sizeof(cl_uint), (void*)&m_Height);
+		clError |= clSetKernelArg(verticalKernel, 4, sizeof(cl_uint), (void*)&m_Pitch);
+
+		CKernelProfile profileH, profileV;
+		if(clError == CL_SUCCESS &&
+			CLUtil::ProfileKernelEvents(CommandQueue, horizontalKernel, 2, globalWorkSizeH, localSizeH, 20, 3, profileH) &&
+			CLUtil::ProfileKernelEvents(CommandQueue, verticalKernel, 2, globalWorkSizeV, localSizeV, 20, 3, profileV))
+		{
+			Milliseconds = profileH.Execution.GetMedian() + profileV.Execution.GetMedian();
+			success = true;
+		}
+	}
+
+	SAFE_RELEASE_KERNEL(horizontalKernel);
+	SAFE_RELEASE_KERNEL(verticalKernel);
+	SAFE_RELEASE_PROGRAM(program);
+
+	return success;
+}
+
+void CConvolutionSeparableTask::ApplyConfiguration(const TuningConfiguration& Configuration)
+{
+	// takes effect with the next InitResources()
+	m_LocalSizeHorizontal[0] = CAutoTuner::GetValue(Configuration, "H_GROUPSIZE_X", (int)m_LocalSizeHorizontal[0]);
+	m_LocalSizeHorizontal[1] = CAutoTuner::GetValue(Configuration, "H_GROUPSIZE_Y", (int)m_LocalSizeHorizontal[1]);
+	m_StepsHorizontal = CAutoTuner::GetValue(Configuration, "H_RESULT_STEPS", m_StepsHorizontal);
+	m_LocalSizeVertical[0] = CAutoTuner::GetValue(Configuration, "V_GROUPSIZE_X", (int)m_LocalSizeVertical[0]);
+	m_LocalSizeVertical[1] = CAutoTuner::GetValue(Configuration, "V_GROUPSIZE_Y", (int)m_LocalSizeVertical[1]);
+	m_StepsVertical = CAutoTuner::GetValue(Configuration, "V_RESULT_STEPS", m_StepsVertical);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
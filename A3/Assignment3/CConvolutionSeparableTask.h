@@ -21,11 +21,13 @@
 #define _CCONVOLUTION_SEPARABLE_TASK_H
 
 #include "CConvolutionTaskBase.h"
+#include "../../Common/CAutoTuner.h"
+#include "../../Common/CKernelLibrary.h"
 
 #include <string>
 
 //! A3 / T2 separable convolution
-class CConvolutionSeparableTask : public CConvolutionTaskBase
+class CConvolutionSeparableTask : public CConvolutionTaskBase, public ITunableTask
 {
 public:
 	CConvolutionSeparableTask(
@@ -52,11 +54,30 @@ public:
 
 	virtual void ComputeCPU();
 
+	// ITunableTask
+	// (the measurements always use the plain separable kernels, also in derived tasks)
+
+	virtual std::string GetTuningKey() const;
+
+	virtual bool MeasureConfiguration(const TuningConfiguration& Configuration, cl_device_id Device,
+		cl_context Context, cl_command_queue CommandQueue, double& Milliseconds);
+
+	virtual void ApplyConfiguration(const TuningConfiguration& Configuration);
+
+	//! Work-group size and result steps of one pass: H_GROUPSIZE_X/Y, H_RESULT_STEPS or the V_ equivalents
+	static CTuningSpace GetTuningSpace(bool Horizontal);
+
 protected:
+	CKernelSpecialization GetSpecialization(const size_t LocalSizeHorizontal[2], const size_t LocalSizeVertical[2],
+		int StepsHorizontal, int StepsVertical) const;
+
+	// one multiply-add per tap in each of the two passes
+	virtual double GetFlopsPerPixel() const { return 4.0 * (2 * m_KernelRadius + 1); }
+
+
 	// the return value is the run time in milliseconds
 	double ConvolutionChannelCPU(unsigned int Channel);
-	// the return value is the run time in milliseconds
-	double ConvolutionChannelGPU(unsigned int Channel, cl_context Context, cl_command_queue CommandQueue, int NIterations);
+	virtual int AddChannelNodes(CCommandGraph& Graph, unsigned int Channel, const std::vector<int>& Dependencies);
 
 	std::string m_OutFileName;
 
@@ -73,7 +94,7 @@ protected:
 	int				m_KernelRadius = 0;
 
 	// device data
-	cl_mem			m_dGPUWorkingBuffer;
+	cl_mem			m_dGPUWorkingBuffers[3];
 	float*			m_hCPUWorkingBuffer;
 
 	//kernel coefficients
@@ -5,7 +5,9 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "CConvolutionTaskBase.h"
 
-#include "../Common/CLUtil.h"
+#include "../../Common/CLUtil.h"
+#include "../../Common/CDeviceMemoryTracker.h"
+#include "../../Common/CBenchmarkReporter.h"
 
 #include "Pfm.h"
 
@@ -92,10 +94,10 @@ bool CConvolutionTaskBase::InitResources(cl_device_id , cl_context Context)
 	cl_int clError;
 	for(int i = 0; i < 3; i++)
 	{
-		m_dSourceChannels[i] = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, dataSize, m_hSourceChannels[i], &clError);
+		m_dSourceChannels[i] = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, dataSize, m_hSourceChannels[i], &clError, "convolution source channel");
 		V_RETURN_FALSE_CL(clError, "Error allocating device input array");
 
-		m_dResultChannels[i] = clCreateBuffer(Context, CL_MEM_WRITE_ONLY, dataSize, NULL, &clError);
+		m_dResultChannels[i] = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_WRITE_ONLY, dataSize, NULL, &clError, "convolution result channel");
 		V_RETURN_FALSE_CL(clError, "Error allocating device output array");
 	}
 
@@ -290,6 +292,58 @@ void CConvolutionTaskBase::SaveIntImage(const std::string& FileName, int* Channe
 	}
 }
 
+void CConvolutionTaskBase::ReportGPUTime(const std::string& Variant, double Milliseconds, int NIterations, unsigned int NumChannels, const size_t LocalWorkSize[2])
+{
+	//the problem size is the number of pixels, as in the Gpixels/s printed by the tasks
+	CBenchmarkRecord record("Convolution", Variant, m_Width * m_Height);
+	record.SetLocalSize(LocalWorkSize, 2);
+	record.SetTime(Milliseconds, NIterations);
+	record.Bytes = 2.0 * NumChannels * double(m_Width * m_Height * sizeof(float));
+	record.Flops = GetFlopsPerPixel() * NumChannels * double(m_Width * m_Height);
+	CBenchmarkReporter::Report(record);
+}
+
+void CConvolutionTaskBase::ReportCPUTime(const std::string& Variant, double Milliseconds, int NIterations, unsigned int NumChannels)
+{
+	CBenchmarkRecord record("Convolution", "cpu/" + Variant, m_Width * m_Height);
+	record.SetCPU();
+	record.SetTime(Milliseconds, NIterations);
+	record.Bytes = 2.0 * NumChannels * double(m_Width * m_Height * sizeof(float));
+	record.Flops = GetFlopsPerPixel() * NumChannels * double(m_Width * m_Height);
+	CBenchmarkReporter::Report(record);
+}
+
+double CConvolutionTaskBase::ComputeChannelsGPU(cl_command_queue CommandQueue, unsigned int NumChannels, int NIterations)
+{
+	CCommandGraph graph;
+	if(!graph.Init(CommandQueue))
+		return -1.0;
+
+	vector<int> sharedNodes = AddSharedNodes(graph);
+	int channelNodes[3];
+	for(unsigned int iChannel = 0; iChannel < NumChannels; iChannel++)
+	{
+		channelNodes[iChannel] = AddChannelNodes(graph, iChannel, sharedNodes);
+		if(channelNodes[iChannel] < 0)
+			return -1.0;
+	}
+
+	double runTime;
+	if(!graph.Run(NIterations, runTime))
+		return -1.0;
+
+	//the download of one channel overlaps the computation of the others
+	size_t dataSize = m_Pitch * m_Height * sizeof(cl_float);
+	for(unsigned int iChannel = 0; iChannel < NumChannels; iChannel++)
+		graph.AddRead("ReadResultChannel", m_dResultChannels[iChannel], 0, dataSize, m_hGPUResultChannels[iChannel], {channelNodes[iChannel]});
+	AddResultNodes(graph, sharedNodes);
+
+	if(!graph.Enqueue() || !graph.Finish())
+		return -1.0;
+
+	return runTime;
+}
+
 float CConvolutionTaskBase::RGBToGrayScale(float R, float G, float B)
 {
 	return 0.3f * R + 0.59f * G + 0.11f * B;
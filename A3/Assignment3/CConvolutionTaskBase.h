@@ -20,9 +20,11 @@
 #ifndef _CCONVOLUTION_TASK_BASE_H
 #define _CCONVOLUTION_TASK_BASE_H
 
-#include "../Common/IComputeTask.h"
+#include "../../Common/IComputeTask.h"
+#include "../../Common/CCommandGraph.h"
 
 #include <string>
+#include <vector>
 
 //! Abstract base class for all convolution tasks
 /*!
@@ -49,6 +51,29 @@ protected:
 	void SaveImage(const std::string& FileName, float* Channels[3]);
 	void SaveIntImage(const std::string& FileName, int* Channel);
 
+	//! Passes the GPU time of all channels to the CBenchmarkReporter, counting one read and one write of each channel
+	void ReportGPUTime(const std::string& Variant, double Milliseconds, int NIterations, unsigned int NumChannels, const size_t LocalWorkSize[2]);
+
+	//! Same for the CPU reference, recorded as variant "cpu/<Variant>"
+	void ReportCPUTime(const std::string& Variant, double Milliseconds, int NIterations, unsigned int NumChannels);
+
+	//! Arithmetic operations per pixel and channel, used for the GFLOP/s and roofline numbers of the records
+	virtual double GetFlopsPerPixel() const { return 0.0; }
+
+	//! Computes the channels as independent branches of a command graph, NIterations times,
+	//! and downloads the results to m_hGPUResultChannels in one more pass.
+	//! Returns the average time of one pass without the downloads in ms, or a negative value on errors.
+	double ComputeChannelsGPU(cl_command_queue CommandQueue, unsigned int NumChannels, int NIterations);
+
+	//! Nodes that all channels depend on (e.g. a discontinuity detection), returns the ones to wait for
+	virtual std::vector<int> AddSharedNodes(CCommandGraph& ) { return std::vector<int>(); }
+
+	//! Adds the commands computing m_dResultChannels[Channel] and returns the last node (or -1)
+	virtual int AddChannelNodes(CCommandGraph& Graph, unsigned int Channel, const std::vector<int>& Dependencies) = 0;
+
+	//! Additional downloads of the final pass
+	virtual void AddResultNodes(CCommandGraph& , const std::vector<int>& ) {}
+
 	// helper functions:
 	
 	// one grayscale floating point value out of RGB
@@ -1,6 +1,10 @@
 #include "CHistogramTask.h"
-#include "../Common/CLUtil.h"
-#include "../Common/CTimer.h"
+#include "../../Common/CLUtil.h"
+#include "../../Common/CDeviceMemoryTracker.h"
+#include "../../Common/CKernelLibrary.h"
+#include "../../Common/CTimer.h"
+#include "../../Common/CBenchmarkReporter.h"
+#include "../../Common/CThreadPool.h"
 #include "Pfm.h"
 #include <string.h>
 #include <cassert>
@@ -43,24 +47,20 @@ InitResources(cl_device_id dev, cl_context ctx)
 		   	s += img.pImg[(y * img.width + x) * 3 + 2] * 0.11f;
 		}
 	}
-	m_d_pixels = clCreateBuffer(ctx,
+	m_d_pixels = CDeviceMemoryTracker::CreateBuffer(ctx,
 			CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
 			sizeof(float) * m_pixels.size(),
 			m_pixels.data(),
-			&err);
+			&err, "histogram pixels");
 	V_RETURN_FALSE_CL(err, "Failed to allocate device memory");
 
 	std::vector<int> zeroes(NUM_HIST_BINS, 0);
-	m_d_hist = clCreateBuffer(ctx, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, NUM_HIST_BINS * sizeof(int),
-			zeroes.data(), &err);
+	m_d_hist = CDeviceMemoryTracker::CreateBuffer(ctx, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, NUM_HIST_BINS * sizeof(int),
+			zeroes.data(), &err, "histogram bins");
 	V_RETURN_FALSE_CL(err, "Failed to allocate device memory");
 
 
-	std::string src;
-	if(!CLUtil::LoadProgramSourceToMemory("histogram.cl", src))
-		return false;
-
-	m_program = CLUtil::BuildCLProgramFromMemory(dev, ctx, src);
+	m_program = CKernelLibrary::GetProgram(dev, ctx, "histogram.cl");
 	if(!m_program)
 		return false;
 
@@ -151,7 +151,7 @@ ComputeGPU(cl_context ctx, cl_command_queue cmdq, size_t lws[3])
 	clFinish(cmdq);
 	timer.Start();
 	cout<<" gws: "<<global_size[0]<<" x "<<global_size[1]<<", lws: "<<lws[0]<<" x "<<lws[1]<<endl;
-	const int num_iterations = 100;
+	const int num_iterations = GetIterations(100);
 	for(int i = 0; i < num_iterations; i++) {
 		clEnqueueNDRangeKernel(cmdq, m_kernel_set_to_val, 1, NULL, &global_size_clear, &local_size_clear, 0, NULL, NULL);
  	
@@ -165,6 +165,13 @@ ComputeGPU(cl_context ctx, cl_command_queue cmdq, size_t lws[3])
 		: "  Histogram GPU time (no local memory): ";
 	std::cout << prefix << timer.GetElapsedMilliseconds() / float(num_iterations) << " ms\n";
 
+	// every pixel is read once, the bins are negligible
+	CBenchmarkRecord record("Histogram", m_use_local_memory ? "local" : "global", size_t(m_img_width) * m_img_height);
+	record.SetLocalSize(lws, 2);
+	record.SetTime(timer.GetElapsedMilliseconds() / double(num_iterations), num_iterations);
+	record.Bytes = double(m_img_width) * m_img_height * sizeof(float);
+	CBenchmarkReporter::Report(record);
+
 	m_histogram_gpu.resize(NUM_HIST_BINS);
 
 	clEnqueueReadBuffer(cmdq, m_d_hist, CL_TRUE, 0, sizeof(int) * NUM_HIST_BINS,
@@ -178,16 +185,35 @@ ComputeCPU()
 	m_histogram.assign(NUM_HIST_BINS, 0);
 	CTimer timer;
 	timer.Start();
-	for(int y = 0; y < m_img_height; y++) {
-		for(int x = 0; x < m_img_width; x++) {
-			float p = m_pixels[y * m_img_stride + x] * float(NUM_HIST_BINS);
-			int h_idx = std::min<int>(NUM_HIST_BINS - 1, std::max<int>(0, int(p)));
-			m_histogram[h_idx]++;
+
+	// one private histogram per chunk of rows, merged afterwards
+	size_t num_chunks = std::max<size_t>(1, std::min<size_t>(
+			CThreadPool::GetShared().GetThreadCount(), size_t(m_img_height) / 16));
+	std::vector<int> partial(num_chunks * NUM_HIST_BINS, 0);
+	CThreadPool::ParallelChunks(m_img_height, num_chunks,
+			[&](size_t chunk, size_t y_begin, size_t y_end) {
+		int *hist = &partial[chunk * NUM_HIST_BINS];
+		for(int y = int(y_begin); y < int(y_end); y++) {
+			for(int x = 0; x < m_img_width; x++) {
+				float p = m_pixels[y * m_img_stride + x] * float(NUM_HIST_BINS);
+				int h_idx = std::min<int>(NUM_HIST_BINS - 1, std::max<int>(0, int(p)));
+				hist[h_idx]++;
+			}
 		}
+	});
+	for(size_t c = 0; c < num_chunks; c++) {
+		for(int i = 0; i < NUM_HIST_BINS; i++)
+			m_histogram[i] += partial[c * NUM_HIST_BINS + i];
 	}
 	timer.Stop();
 
 	std::cout << "  Histogram CPU time: " << timer.GetElapsedMilliseconds() << " ms\n";
+
+	CBenchmarkRecord record("Histogram", "cpu", size_t(m_img_width) * m_img_height);
+	record.SetCPU();
+	record.SetTime(timer.GetElapsedMilliseconds(), 1);
+	record.Bytes = double(m_img_width) * m_img_height * sizeof(float);
+	CBenchmarkReporter::Report(record);
 }
 
 bool CHistogramTask::
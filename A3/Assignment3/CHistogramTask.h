@@ -3,7 +3,7 @@
 
 #include <string>
 #include <vector>
-#include "../Common/IComputeTask.h"
+#include "../../Common/IComputeTask.h"
 
 class CHistogramTask : public IComputeTask
 {
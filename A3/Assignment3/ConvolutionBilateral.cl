@@ -1,5 +1,5 @@
 
-#define KERNEL_LENGTH (2 * KERNEL_RADIUS + 1)
+#include "ConvolutionCommon.cl"
 
 #define DEPTH_THRESHOLD	0.025f
 #define NORM_THRESHOLD	0.9f
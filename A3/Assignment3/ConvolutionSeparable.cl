@@ -9,23 +9,7 @@
 
 //for unrolling loops, these values have to be known at compile time
 
-/* These macros will be defined dynamically during building the program
-
-#define KERNEL_RADIUS 2
-
-//horizontal kernel
-#define H_GROUPSIZE_X		32
-#define H_GROUPSIZE_Y		4
-#define H_RESULT_STEPS		8
-
-//vertical kernel
-#define V_GROUPSIZE_X		32
-#define V_GROUPSIZE_Y		16
-#define V_RESULT_STEPS		9
-
-*/
-
-#define KERNEL_LENGTH (2 * KERNEL_RADIUS + 1)
+#include "ConvolutionCommon.cl"
 
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////
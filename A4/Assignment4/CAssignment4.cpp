@@ -10,10 +10,15 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "GLCommon.h"
 
-#include "../Common/CLUtil.h"
+#include "../../Common/CLUtil.h"
+#include "../../Common/CProgramBinaryCache.h"
+#include "../../Common/CDeviceMemoryTracker.h"
+#include "../../Common/CBenchmarkReporter.h"
+#include "../../Common/CTracer.h"
 #include <CL/cl_gl.h>
 
 #ifdef __linux__
@@ -37,33 +42,78 @@ CAssignment4* CAssignment4::GetSingleton()
 }
 
 CAssignment4::CAssignment4()
-	: m_Window(nullptr), m_WindowWidth(1024), m_WindowHeight(768), m_PrevTime(-1.0)
+	: m_Window(nullptr), m_WindowWidth(1024), m_WindowHeight(768), m_pCurrentTask(nullptr), m_PrevTime(-1.0)
 {
-	// select task here...
-	// This time you have to do it during compile time
-	
-#if 0
-	cout<<"########################################"<<endl;
-	cout<<"TASK 1: Particle System"<<endl<<endl;
+	m_LocalWorkSize[0] = m_LocalWorkSize[1] = m_LocalWorkSize[2] = 1;
+}
 
-	std::string meshPath = "Assets/cubeJump.obj";
-	// Uncomment this to test your application with more triangles!
-	// meshPath = "Assets/cubeMonkey.obj";
+void CAssignment4::RegisterTasks()
+{
+	// TASK 1: Particle System
+	// (the problem size is the number of particles, the input the collision mesh,
+	// try "Assets/cubeMonkey.obj" to test your application with more triangles!)
+	CTaskEntry particles;
+	particles.Name = "particles";
+	particles.Description = "TASK 1: Particle System";
+	particles.DefaultSize = 1024 * 192;
+	particles.DefaultLocalWorkSize[0] = 192;
+	particles.DefaultInputFile = "Assets/cubeJump.obj";
+	particles.Factory = [](CTaskOptions& Options) -> IComputeTask* {
+		return new CParticleSystemTask(Options.InputFile, (unsigned int)Options.ProblemSize, Options.LocalWorkSize);
+	};
+	m_Tasks.Register(particles);
+
+	// TASK 2: Cloth Simulation
+	// (the problem size is the resolution of the cloth in both directions)
+	CTaskEntry cloth;
+	cloth.Name = "cloth";
+	cloth.Description = "TASK 2: Cloth Simulation";
+	cloth.DefaultSize = 64;
+	cloth.DefaultLocalWorkSize[0] = 16;
+	cloth.DefaultLocalWorkSize[1] = 16;
+	cloth.Factory = [](CTaskOptions& Options) -> IComputeTask* {
+		return new CClothSimulationTask((unsigned int)Options.ProblemSize, (unsigned int)Options.ProblemSize);
+	};
+	m_Tasks.Register(cloth);
+}
+
+bool CAssignment4::CreateTask()
+{
+	// only one task can be displayed, the cloth simulation unless selected otherwise with --tasks
+	vector<string> names = m_CommandLine.GetList("tasks");
+	const CTaskEntry* pEntry = m_Tasks.Find(names.empty() ? "cloth" : names[0]);
+	if(!pEntry)
+	{
+		cerr<<"Unknown task '"<<names[0]<<"', use --list to see the available tasks."<<endl;
+		return false;
+	}
+
+	CTaskOptions options;
+	options.ProblemSize = pEntry->DefaultSize;
+	if(m_CommandLine.Has("sizes") && !CCommandLine::ParseSize(m_CommandLine.GetString("sizes"), options.ProblemSize))
+	{
+		cerr<<"Invalid size '"<<m_CommandLine.GetString("sizes")<<"', the simulation takes a single size."<<endl;
+		return false;
+	}
+	options.InputFile = m_CommandLine.GetString("input", pEntry->DefaultInputFile);
+	for(int i = 0; i < 3; i++)
+		options.LocalWorkSize[i] = pEntry->DefaultLocalWorkSize[i];
+	if(m_CommandLine.Has("local-size") && !m_CommandLine.GetLocalWorkSize("local-size", options.LocalWorkSize))
+	{
+		cerr<<"Invalid local size '"<<m_CommandLine.GetString("local-size")<<"'."<<endl;
+		return false;
+	}
 
-	m_LocalWorkSize[0] = 192;
-	m_LocalWorkSize[1] = 1;
-	m_LocalWorkSize[2] = 1;
-	m_pCurrentTask = new CParticleSystemTask(meshPath, 1024 * 192, m_LocalWorkSize);
-#else
 	cout<<"########################################"<<endl;
-	cout<<"TASK 2: Cloth Simulation"<<endl<<endl;
+	cout<<pEntry->Description<<endl<<endl;
 
-	m_LocalWorkSize[0] = 16;
-	m_LocalWorkSize[1] = 16;
-	m_LocalWorkSize[2] = 1;
-	m_pCurrentTask = new CClothSimulationTask(64, 64);
-#endif
+	for(int i = 0; i < 3; i++)
+		m_LocalWorkSize[i] = options.LocalWorkSize[i];
+	m_pCurrentTask = dynamic_cast<IGUIEnabledComputeTask*>(pEntry->Factory(options));
+	// the only task of the run owns all device memory allocated from now on
+	CDeviceMemoryTracker::SetOwner(pEntry->Name);
 
+	return m_pCurrentTask != nullptr;
 }
 
 CAssignment4::~CAssignment4()
@@ -77,6 +127,36 @@ CAssignment4::~CAssignment4()
 
 bool CAssignment4::EnterMainLoop(int argc, char** argv)
 {
+	vector<string> options;
+	GetOptionNames(options);
+	if(!m_CommandLine.Parse(argc, argv, options))
+		return false;
+	if(m_CommandLine.Has("help"))
+	{
+		PrintUsage(argv[0]);
+		return true;
+	}
+	if(m_CommandLine.Has("output"))
+		CBenchmarkReporter::SetOutputPath(m_CommandLine.GetString("output"));
+	if(m_CommandLine.Has("trace"))
+		CTracer::Start(m_CommandLine.GetString("trace"));
+	else
+		CTracer::InitFromEnvironment();
+
+	RegisterTasks();
+	if(m_CommandLine.Has("list"))
+	{
+		cout<<"Available tasks:"<<endl;
+		m_Tasks.Print(cout);
+		return true;
+	}
+
+	if(!CreateTask())
+		return false;
+
+	// a typo must not silently benchmark the default device
+	if(!m_DeviceSelector.ParseEnvironment() || !m_DeviceSelector.ParseCommandLine(argc, argv))
+		return false;
 
 	// create CL context with GL context sharing
 	if(InitGL(argc, argv) && InitCLContext())
@@ -87,6 +167,7 @@ bool CAssignment4::EnterMainLoop(int argc, char** argv)
 		// the main event loop...
 		while(!glfwWindowShouldClose(m_Window))
 		{
+			TRACE_SCOPE("Frame");
 			OnIdle();
 			Render();
 
@@ -95,6 +176,10 @@ bool CAssignment4::EnterMainLoop(int argc, char** argv)
 
 		if(m_pCurrentTask)
 			m_pCurrentTask->ReleaseResources();
+
+		CProgramBinaryCache::PrintStatistics();
+		CBenchmarkReporter::Flush();
+		CTracer::Flush();
 	}
 	else
 	{
@@ -120,42 +205,13 @@ bool CAssignment4::DoCompute()
 
 bool CAssignment4::InitCLContext()
 {
-	// 1. get all platform IDs
-
-	std::vector<cl_platform_id> platformIds;
-	const cl_uint c_MaxPlatforms = 16;
-	platformIds.resize(c_MaxPlatforms);
-	
-	cl_uint countPlatforms;
-	V_RETURN_FALSE_CL(clGetPlatformIDs(c_MaxPlatforms, &platformIds[0], &countPlatforms), "Failed to get CL platform ID");
-	platformIds.resize(countPlatforms);
-
-	// 2. find all available GPU devices
-	std::vector<cl_device_id> deviceIds;
-	const int maxDevices = 16;
-	deviceIds.resize(maxDevices);
-	int countAllDevices = 0;
-
-
-	cl_device_type deviceType = CL_DEVICE_TYPE_GPU;
-
-	for (size_t i = 0; i < platformIds.size(); i++)
-	{
-		// Getting the available devices.
-		cl_uint countDevices;
-		clGetDeviceIDs(platformIds[i], deviceType, 1, &deviceIds[countAllDevices], &countDevices);
-		countAllDevices += countDevices;
-	}
-	deviceIds.resize(countAllDevices);
-
-	if (countAllDevices == 0)
-	{
-		std::cout << "No device of the selected type with OpenCL support was found.";
+	// 1. + 2. enumerate the devices of all platforms and pick one according to
+	// the selection policy (GPGPU_DEVICE or --device, see CDeviceSelector).
+	// The device has to be able to share buffers with the GL context.
+	CDeviceSelector selector = m_DeviceSelector;
+	selector.RequireGLSharing = true;
+	if(!selector.Select(m_CLPlatform, m_CLDevice))
 		return false;
-	}
-	// Choosing the first available device.
-	m_CLDevice = deviceIds[0];
-	clGetDeviceInfo(m_CLDevice, CL_DEVICE_PLATFORM, sizeof(cl_platform_id), &m_CLPlatform, NULL);
 
 	// Printing platform and device data.
 	const int maxBufferSize = 1024;
@@ -215,9 +271,13 @@ bool CAssignment4::InitCLContext()
 	// from the CPU into this queue. This way the host program can continue the execution until some results
 	// from that device are needed.
 
-	m_CLCommandQueue = clCreateCommandQueue(m_CLContext, m_CLDevice, 0, &clError);
+	// profiling is cheap enough to keep enabled all the time, it enables the
+	// device-side timing in CLUtil::ProfileKernel()
+	m_CLCommandQueue = clCreateCommandQueue(m_CLContext, m_CLDevice, CL_QUEUE_PROFILING_ENABLE, &clError);
 	V_RETURN_FALSE_CL(clError, "Failed to create the command queue in the context");
 
+	CBenchmarkReporter::SetDevice(m_CLDevice);
+
 	return true;
 }
 
@@ -283,6 +343,7 @@ void CAssignment4::CleanupGL()
 
 void CAssignment4::Render()
 {
+	TRACE_SCOPE("Render");
 	if(m_pCurrentTask)
 		m_pCurrentTask->Render();
 	
@@ -314,6 +375,7 @@ void CAssignment4::OnIdle()
 		if(m_pCurrentTask)
 			m_pCurrentTask->OnIdle(time, elapsedTime);
 
+		TRACE_SCOPE("Simulate");
 		DoCompute();
 	}
 }
@@ -20,9 +20,9 @@
 #ifndef _CASSIGNMENT4_H
 #define _CASSIGNMENT4_H
 
-#include "../Common/CAssignmentBase.h"
-#include "../Common/IGUIEnabledComputeTask.h"
-#include "../Common/CTimer.h"
+#include "../../Common/CAssignmentBase.h"
+#include "../../Common/IGUIEnabledComputeTask.h"
+#include "../../Common/CTimer.h"
 
 #include "GLCommon.h"
 
@@ -60,6 +60,11 @@ protected:
 	// for OpenCL - OpenGL interop
 	virtual bool InitCLContext();
 
+	virtual void RegisterTasks();
+
+	//! Creates the task selected on the command line (--tasks, --sizes, --local-size, --input)
+	bool CreateTask();
+
 	virtual void Render();
 
 	virtual void OnKeyboard(GLFWwindow* pWindow, int Key, int ScanCode, int Action, int Mods);
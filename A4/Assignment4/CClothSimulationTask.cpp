@@ -5,7 +5,10 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "CClothSimulationTask.h"
 
-#include "../Common/CLUtil.h"
+#include "../../Common/CLUtil.h"
+#include "../../Common/CDeviceMemoryTracker.h"
+#include "../../Common/CKernelLibrary.h"
+#include "../../Common/CTracer.h"
 
 #ifdef min // these macros are defined under windows, but collide with our math utility
 #	undef min
@@ -135,20 +138,18 @@ bool CClothSimulationTask::InitResources(cl_device_id Device, cl_context Context
 
 	cl_int clError, clError2;
 
-	m_clPosArray = clCreateFromGLBuffer(Context, CL_MEM_READ_WRITE, m_pClothModel->GetVertexBuffer(), &clError);
-	m_clNormalArray = clCreateFromGLBuffer(Context, CL_MEM_READ_WRITE, m_pClothModel->GetNormalBuffer(), &clError2);
+	m_clPosArray = CDeviceMemoryTracker::CreateFromGLBuffer(Context, CL_MEM_READ_WRITE, m_pClothModel->GetVertexBuffer(), &clError, "cloth positions (GL)");
+	m_clNormalArray = CDeviceMemoryTracker::CreateFromGLBuffer(Context, CL_MEM_READ_WRITE, m_pClothModel->GetNormalBuffer(), &clError2, "cloth normals (GL)");
 	clError |= clError2;
 
-	m_clPosArrayAux = clCreateBuffer(Context, CL_MEM_READ_WRITE, m_ClothResX * m_ClothResY * sizeof(hlsl::float4), 0, &clError2);
+	m_clPosArrayAux = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, m_ClothResX * m_ClothResY * sizeof(hlsl::float4), 0, &clError2, "cloth auxiliary positions");
 	clError |= clError2;
-	m_clPosArrayOld = clCreateBuffer(Context, CL_MEM_READ_WRITE, m_ClothResX * m_ClothResY * sizeof(hlsl::float4), 0, &clError2);
+	m_clPosArrayOld = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, m_ClothResX * m_ClothResY * sizeof(hlsl::float4), 0, &clError2, "cloth old positions");
 	clError |= clError2;
 
 	V_RETURN_FALSE_CL(clError, "Error allocating device arrays.");
 
-	string programCode;
-	CLUtil::LoadProgramSourceToMemory("clothsim.cl", programCode);
-	m_ClothSimProgram = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode);
+	m_ClothSimProgram = CKernelLibrary::GetProgram(Device, Context, "clothsim.cl");
 	if(m_ClothSimProgram == nullptr)
 		return false;
 
@@ -164,7 +165,7 @@ bool CClothSimulationTask::InitResources(cl_device_id Device, cl_context Context
 
 	// Compute the rest distance between two particles.
 	// We scale the distance by 0.9 to get a nicer look for the cloth (more folds).
-	float restDistance = 1.f / ((float)m_ClothResX)*0.9f;
+	m_RestDistance = 1.f / ((float)m_ClothResX)*0.9f;
 
 	////////////////////////////////////////////////////////////////////////
 	// Specify the arguments for each kernel
@@ -176,7 +177,7 @@ bool CClothSimulationTask::InitResources(cl_device_id Device, cl_context Context
 
 	clError  = clSetKernelArg(m_ConstraintKernel, 0, sizeof(unsigned int), &m_ClothResX);
 	clError |= clSetKernelArg(m_ConstraintKernel, 1, sizeof(unsigned int), &m_ClothResY);
-	clError |= clSetKernelArg(m_ConstraintKernel, 2, sizeof(float), &restDistance);
+	clError |= clSetKernelArg(m_ConstraintKernel, 2, sizeof(float), &m_RestDistance);
 	// The rest of parameters is set before kernel launch (ping-ponging)
 	V_RETURN_FALSE_CL(clError, "Failed to set constraint kernel params");
 
@@ -215,6 +216,8 @@ void CClothSimulationTask::ReleaseResources()
 		m_pSphere = 0;
 	}
 
+	m_ConstraintRecording.Clear();
+
 	SAFE_RELEASE_MEMOBJECT(m_clPosArrayAux);
 	SAFE_RELEASE_MEMOBJECT(m_clPosArrayOld);
 	SAFE_RELEASE_MEMOBJECT(m_clNormalArray);
@@ -245,9 +248,12 @@ void CClothSimulationTask::ComputeGPU(cl_context , cl_command_queue CommandQueue
 	globalWorkSize[0] = CLUtil::GetGlobalWorkSize(m_ClothResX, LocalWorkSize[0]);
 	globalWorkSize[1] = CLUtil::GetGlobalWorkSize(m_ClothResY, LocalWorkSize[1]);
 
-	glFinish();
-	V_RETURN_CL(clEnqueueAcquireGLObjects(CommandQueue, 1, &m_clPosArray, 0, NULL, NULL),  "Error acquiring OpenGL vertex buffer.");
-	V_RETURN_CL(clEnqueueAcquireGLObjects(CommandQueue, 1, &m_clNormalArray, 0, NULL, NULL), "Error acquiring OpenGL normal buffer.");
+	{
+		TRACE_SCOPE("glFinish");
+		glFinish();
+	}
+	V_RETURN_CL(clEnqueueAcquireGLObjects(CommandQueue, 1, &m_clPosArray, 0, NULL, TRACE_CL("acquire positions")),  "Error acquiring OpenGL vertex buffer.");
+	V_RETURN_CL(clEnqueueAcquireGLObjects(CommandQueue, 1, &m_clNormalArray, 0, NULL, TRACE_CL("acquire normals")), "Error acquiring OpenGL normal buffer.");
 	
 	clErr  = clSetKernelArg(m_IntegrateKernel, 0, sizeof(unsigned int), &m_ClothResX);
 	clErr |= clSetKernelArg(m_IntegrateKernel, 1, sizeof(unsigned int), &m_ClothResY);
@@ -262,46 +268,80 @@ void CClothSimulationTask::ComputeGPU(cl_context , cl_command_queue CommandQueue
 	// ADD YOUR CODE HERE
 
 	// Execute the integration kernel
-	clErr = clEnqueueNDRangeKernel(CommandQueue, m_IntegrateKernel, 2, NULL, globalWorkSize, LocalWorkSize, 0, NULL, NULL);
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_IntegrateKernel, 2, NULL, globalWorkSize, LocalWorkSize, 0, NULL, TRACE_CL("Integrate"));
 	V_RETURN_CL(clErr, "Error executing m_IntegrateKernel!");
 
 	// Check for collisions
 	clErr = clSetKernelArg(m_CollisionsKernel, 3, sizeof(cl_float4), &m_SpherePos);
 	clErr |= clSetKernelArg(m_CollisionsKernel, 4, sizeof(cl_float), &m_SphereRadius);
-	clErr |= clEnqueueNDRangeKernel(CommandQueue, m_CollisionsKernel, 2, NULL, globalWorkSize, LocalWorkSize, 0, NULL, NULL);
+	clErr |= clEnqueueNDRangeKernel(CommandQueue, m_CollisionsKernel, 2, NULL, globalWorkSize, LocalWorkSize, 0, NULL, TRACE_CL("Collisions"));
 	V_RETURN_CL(clErr, "Error executing m_CollisionsKernel!");
 	
-	// Constraint relaxation: use the ping-pong technique and perform the relaxation in several iterations
-	for (unsigned int i = 0; i < 2.0 * m_ClothResX; i++){
-		clErr = clSetKernelArg(m_ConstraintKernel, 3, sizeof(cl_mem), (void*) &m_clPosArrayAux);
-		clErr |= clSetKernelArg(m_ConstraintKernel, 4, sizeof(cl_mem), (void*) &m_clPosArray);
-		clErr |= clEnqueueNDRangeKernel(CommandQueue, m_ConstraintKernel, 2, NULL, globalWorkSize, LocalWorkSize, 0, NULL, NULL);
-		V_RETURN_CL(clErr, "Error executing m_ConstraintKernel!");
-			if(i % 1 == 0) {
-				clErr = clSetKernelArg(m_CollisionsKernel, 3, sizeof(cl_float4), &m_SpherePos);
-				clErr |= clSetKernelArg(m_CollisionsKernel, 4, sizeof(cl_float), &m_SphereRadius);
-				clErr |= clEnqueueNDRangeKernel(CommandQueue, m_CollisionsKernel, 2, NULL, globalWorkSize, LocalWorkSize, 0, NULL, NULL);
-	V_RETURN_CL(clErr, "Error executing m_CollisionsKernel!");
-			}
-		swap(m_clPosArrayAux, m_clPosArray);
+	// Constraint relaxation: use the ping-pong technique and perform the relaxation in several iterations.
+	// The launches are the same every frame, so they are recorded once and replayed.
+	if(m_ConstraintRecording.IsRecorded() &&
+		(m_ConstraintRecordedLocalWorkSize[0] != LocalWorkSize[0] || m_ConstraintRecordedLocalWorkSize[1] != LocalWorkSize[1]))
+		m_ConstraintRecording.Clear();
+
+	if(!m_ConstraintRecording.IsRecorded())
+	{
+		// the collision kernel always works on the shared buffer, like the final collision check
+		m_ConstraintRecording.Begin(CommandQueue);
+		m_ConstraintRecording.SetKernelArg(m_ConstraintKernel, 0, sizeof(unsigned int), &m_ClothResX);
+		m_ConstraintRecording.SetKernelArg(m_ConstraintKernel, 1, sizeof(unsigned int), &m_ClothResY);
+		m_ConstraintRecording.SetKernelArg(m_ConstraintKernel, 2, sizeof(float), &m_RestDistance);
+		m_ConstraintRecording.SetKernelArg(m_CollisionsKernel, 0, sizeof(unsigned int), &m_ClothResX);
+		m_ConstraintRecording.SetKernelArg(m_CollisionsKernel, 1, sizeof(unsigned int), &m_ClothResY);
+		m_ConstraintRecording.SetKernelArg(m_CollisionsKernel, 2, sizeof(cl_mem), (void*) &m_clPosArray);
+		m_ConstraintRecording.SetKernelArg(m_CollisionsKernel, 3, sizeof(cl_float4), &m_SpherePos);
+		m_ConstraintRecording.SetKernelArg(m_CollisionsKernel, 4, sizeof(cl_float), &m_SphereRadius);
+
+		cl_mem pos = m_clPosArray;
+		cl_mem aux = m_clPosArrayAux;
+		for (unsigned int i = 0; i < 2 * m_ClothResX; i++){
+			m_ConstraintRecording.SetKernelArg(m_ConstraintKernel, 3, sizeof(cl_mem), (void*) &aux);
+			m_ConstraintRecording.SetKernelArg(m_ConstraintKernel, 4, sizeof(cl_mem), (void*) &pos);
+			m_ConstraintRecording.AddKernel("SatisfyConstraints", m_ConstraintKernel, 2, globalWorkSize, LocalWorkSize);
+			m_ConstraintRecording.AddKernel("Collisions", m_CollisionsKernel, 2, globalWorkSize, LocalWorkSize);
+			swap(aux, pos);
+		}
+		if(!m_ConstraintRecording.End())
+		{
+			cerr << "Error: failed to record the constraint relaxation." << endl;
+			return;
+		}
+		m_ConstraintRecordedLocalWorkSize[0] = LocalWorkSize[0];
+		m_ConstraintRecordedLocalWorkSize[1] = LocalWorkSize[1];
+	}
+	else
+	{
+		m_ConstraintRecording.UpdateKernelArg(m_CollisionsKernel, 3, sizeof(cl_float4), &m_SpherePos);
+		m_ConstraintRecording.UpdateKernelArg(m_CollisionsKernel, 4, sizeof(cl_float), &m_SphereRadius);
 	}
+
+	// an even number of iterations, the result ends up in the shared buffer again
+	if(!m_ConstraintRecording.Replay(CommandQueue))
+		return;
 	
 	// You can check for collisions here again, to make sure there is no intersection with the cloth in the end
 	clErr = clSetKernelArg(m_CollisionsKernel, 3, sizeof(cl_float4), &m_SpherePos);
 	clErr |= clSetKernelArg(m_CollisionsKernel, 4, sizeof(cl_float), &m_SphereRadius);
-	clErr |= clEnqueueNDRangeKernel(CommandQueue, m_CollisionsKernel, 2, NULL, globalWorkSize, LocalWorkSize, 0, NULL, NULL);
+	clErr |= clEnqueueNDRangeKernel(CommandQueue, m_CollisionsKernel, 2, NULL, globalWorkSize, LocalWorkSize, 0, NULL, TRACE_CL("Collisions"));
 	V_RETURN_CL(clErr, "Error executing m_CollisionsKernel!");
 
 
 	//compute correct normals
-	clErr = clEnqueueNDRangeKernel(CommandQueue, m_NormalKernel, 2, 0, globalWorkSize, LocalWorkSize, 0, 0, 0);
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_NormalKernel, 2, 0, globalWorkSize, LocalWorkSize, 0, 0, TRACE_CL("ComputeNormals"));
 	V_RETURN_CL(clErr, "Error executing normal computation kernel");
 
 
-	V_RETURN_CL(clEnqueueReleaseGLObjects(CommandQueue, 1, &m_clPosArray, 0, NULL, NULL),  "Error releasing OpenGL vertex buffer.");
-	V_RETURN_CL(clEnqueueReleaseGLObjects(CommandQueue, 1, &m_clNormalArray, 0, NULL, NULL), "Error releasing OpenGL normal buffer.");
+	V_RETURN_CL(clEnqueueReleaseGLObjects(CommandQueue, 1, &m_clPosArray, 0, NULL, TRACE_CL("release positions")),  "Error releasing OpenGL vertex buffer.");
+	V_RETURN_CL(clEnqueueReleaseGLObjects(CommandQueue, 1, &m_clNormalArray, 0, NULL, TRACE_CL("release normals")), "Error releasing OpenGL normal buffer.");
 
-	clFinish(CommandQueue);
+	{
+		TRACE_SCOPE("clFinish");
+		clFinish(CommandQueue);
+	}
 	m_FrameCounter++;
 	m_PrevElapsedTime = m_ElapsedTime;
 	m_ElapsedTime = 0;
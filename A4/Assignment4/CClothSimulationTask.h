@@ -20,7 +20,8 @@
 #ifndef _CCLOTH_SIMULATION_TASK_H
 #define _CCLOTH_SIMULATION_TASK_H
 
-#include "../Common/IGUIEnabledComputeTask.h"
+#include "../../Common/IGUIEnabledComputeTask.h"
+#include "../../Common/CCommandRecording.h"
 
 #include "CTriMesh.h"
 #include "CGLTexture.h"
@@ -97,6 +98,11 @@ protected:
 	cl_kernel				m_ConstraintKernel = nullptr;
 	cl_kernel				m_CollisionsKernel = nullptr;
 
+	// the 2 * m_ClothResX constraint and collision launches of a frame, recorded once
+	CCommandRecording		m_ConstraintRecording;
+	size_t					m_ConstraintRecordedLocalWorkSize[2];
+	float					m_RestDistance = 0.0f;
+
 	float					m_ElapsedTime = 0.0f;
 	float					m_PrevElapsedTime = 0.0f;
 	float					m_simulationTime = 0.0f;
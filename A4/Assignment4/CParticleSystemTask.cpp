@@ -5,7 +5,10 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "CParticleSystemTask.h"
 
-#include "../Common/CLUtil.h"
+#include "../../Common/CLUtil.h"
+#include "../../Common/CDeviceMemoryTracker.h"
+#include "../../Common/CKernelLibrary.h"
+#include "../../Common/CTracer.h"
 
 #ifdef min // these macros are defined under windows, but collide with our math utility
 #	undef min
@@ -176,26 +179,26 @@ bool CParticleSystemTask::InitResources(cl_device_id Device, cl_context Context)
 	cl_int clError, clError2;
 
 	// Particle arrrays
-	m_clPosLife[0] = clCreateFromGLBuffer(Context, CL_MEM_READ_WRITE, m_glPosLife[0], &clError2);
+	m_clPosLife[0] = CDeviceMemoryTracker::CreateFromGLBuffer(Context, CL_MEM_READ_WRITE, m_glPosLife[0], &clError2, "particle position/life 0 (GL)");
 	clError = clError2;
-	m_clPosLife[1] = clCreateFromGLBuffer(Context, CL_MEM_READ_WRITE, m_glPosLife[1], &clError2);
+	m_clPosLife[1] = CDeviceMemoryTracker::CreateFromGLBuffer(Context, CL_MEM_READ_WRITE, m_glPosLife[1], &clError2, "particle position/life 1 (GL)");
 	clError |= clError2;
-	m_clVelMass[0] = clCreateFromGLBuffer(Context, CL_MEM_READ_WRITE, m_glVelMass[0], &clError2);
+	m_clVelMass[0] = CDeviceMemoryTracker::CreateFromGLBuffer(Context, CL_MEM_READ_WRITE, m_glVelMass[0], &clError2, "particle velocity/mass 0 (GL)");
 	clError |= clError2;
-	m_clVelMass[1] = clCreateFromGLBuffer(Context, CL_MEM_READ_WRITE, m_glVelMass[1], &clError2);
+	m_clVelMass[1] = CDeviceMemoryTracker::CreateFromGLBuffer(Context, CL_MEM_READ_WRITE, m_glVelMass[1], &clError2, "particle velocity/mass 1 (GL)");
 	clError |= clError2;
-	m_clAlive = clCreateBuffer(Context, CL_MEM_READ_WRITE, m_nParticles * sizeof(cl_uint) * 2, NULL, &clError2);
+	m_clAlive = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, m_nParticles * sizeof(cl_uint) * 2, NULL, &clError2, "particle alive flags");
 	clError |= clError2;
 
 	float *pTriangles;
 	m_pMesh->GetTriangleSoup(&pTriangles, &m_nTriangles);
-	m_clTriangleSoup = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, m_nTriangles * 3 * sizeof(cl_float4), pTriangles, &clError2);
+	m_clTriangleSoup = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, m_nTriangles * 3 * sizeof(cl_float4), pTriangles, &clError2, "triangle soup");
 	clError |= clError2;
 	delete pTriangles;
 
-	m_clPingArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, m_nParticles * sizeof(cl_uint) * 2, NULL, &clError2);
+	m_clPingArray = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, m_nParticles * sizeof(cl_uint) * 2, NULL, &clError2, "particle ping array");
 	clError |= clError2;
-	m_clPongArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, m_nParticles * sizeof(cl_uint) * 2, NULL, &clError2);
+	m_clPongArray = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, m_nParticles * sizeof(cl_uint) * 2, NULL, &clError2, "particle pong array");
 	clError |= clError2;
 	V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
 
@@ -206,7 +209,7 @@ bool CParticleSystemTask::InitResources(cl_device_id Device, cl_context Context)
 	// Scan arrays
 	unsigned int N = m_nParticles * 2;
 	for (unsigned int i = 0; i < m_nLevels; i++) {
-		m_clLevelArrays[i] = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * N, NULL, &clError2);
+		m_clLevelArrays[i] = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * N, NULL, &clError2, "particle scan level array");
 		clError |= clError2;
 		N = std::max(N / (2 * m_LocalWorkSize[0]), m_LocalWorkSize[0]);
 	}
@@ -272,9 +275,7 @@ bool CParticleSystemTask::InitResources(cl_device_id Device, cl_context Context)
 	glUniform1i(texForceField, 0);
 
 	// Particle kernels
-	string programCode;
-	CLUtil::LoadProgramSourceToMemory("ParticleSystem.cl", programCode);
-	m_PSystemProgram = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode);
+	m_PSystemProgram = CKernelLibrary::GetProgram(Device, Context, "ParticleSystem.cl");
 	if(!m_PSystemProgram)
 		return false;
 
@@ -285,17 +286,16 @@ bool CParticleSystemTask::InitResources(cl_device_id Device, cl_context Context)
 	m_ReorganizeKernel = clCreateKernel(m_PSystemProgram, "Reorganize", &clError);
 	V_RETURN_FALSE_CL(clError, "Failed to create Reorganize kernel.");
 
-	// Scan kernels
-	CLUtil::LoadProgramSourceToMemory("Scan.cl", programCode);
-	m_ScanProgram = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode);
+	// Scan kernels, the same as in Assignment 2 (from the shared kernel library)
+	m_ScanProgram = CKernelLibrary::GetProgram(Device, Context, "Scan.cl");
 	if(!m_ScanProgram)
 		return false;
 
-	m_ScanKernel = clCreateKernel(m_ScanProgram, "Scan", &clError);
+	m_ScanKernel = clCreateKernel(m_ScanProgram, "Scan_WorkEfficient", &clError);
 	V_RETURN_FALSE_CL(clError, "Failed to create Scan kernel.");
-	m_ScanAddKernel = clCreateKernel(m_ScanProgram, "ScanAdd", &clError);
+	m_ScanAddKernel = clCreateKernel(m_ScanProgram, "Scan_WorkEfficientAdd", &clError);
 	V_RETURN_FALSE_CL(clError, "Failed to create ScanAdd kernel.");
-	m_ScanNaiveKernel = clCreateKernel(m_ScanProgram, "ScanNaive", &clError);
+	m_ScanNaiveKernel = clCreateKernel(m_ScanProgram, "Scan_Naive", &clError);
 	V_RETURN_FALSE_CL(clError, "Failed to create Scan kernel.");
 
 	// Load volume data
@@ -363,6 +363,7 @@ bool CParticleSystemTask::InitResources(cl_device_id Device, cl_context Context)
 									(m_volumeRes[0] * sizeof(cl_float4)), (m_volumeRes[0] * m_volumeRes[1] * sizeof(cl_float4)),
 									pVolume, &clError);
 	V_RETURN_FALSE_CL(clError, "Failed to create OpenCL 3D texture.");
+	CDeviceMemoryTracker::Track(m_clVolTex3D, "collision volume (3D image)");
 
 	SAFE_DELETE(pVolume);
 
@@ -452,8 +453,11 @@ void CParticleSystemTask::ReleaseResources()
 
 void CParticleSystemTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
 {
-	glFinish();
-	V_RETURN_CL(clEnqueueAcquireGLObjects(CommandQueue, 1, &m_clPosLife[0], 0, NULL, NULL),  "Error acquiring OpenGL buffer.");
+	{
+		TRACE_SCOPE("glFinish");
+		glFinish();
+	}
+	V_RETURN_CL(clEnqueueAcquireGLObjects(CommandQueue, 1, &m_clPosLife[0], 0, NULL, TRACE_CL("acquire GL buffers")),  "Error acquiring OpenGL buffer.");
 	V_RETURN_CL(clEnqueueAcquireGLObjects(CommandQueue, 1, &m_clVelMass[0], 0, NULL, NULL), "Error acquiring OpenGL buffer.");
 	V_RETURN_CL(clEnqueueAcquireGLObjects(CommandQueue, 1, &m_clPosLife[1], 0, NULL, NULL),  "Error acquiring OpenGL buffer.");
 	V_RETURN_CL(clEnqueueAcquireGLObjects(CommandQueue, 1, &m_clVelMass[1], 0, NULL, NULL), "Error acquiring OpenGL buffer.");
@@ -477,9 +481,12 @@ void CParticleSystemTask::ComputeGPU(cl_context Context, cl_command_queue Comman
 	V_RETURN_CL(clEnqueueReleaseGLObjects(CommandQueue, 1, &m_clPosLife[0], 0, NULL, NULL),  "Error releasing OpenGL buffer.");
 	V_RETURN_CL(clEnqueueReleaseGLObjects(CommandQueue, 1, &m_clVelMass[0], 0, NULL, NULL), "Error releasing OpenGL buffer.");
 	V_RETURN_CL(clEnqueueReleaseGLObjects(CommandQueue, 1, &m_clPosLife[1], 0, NULL, NULL),  "Error releasing OpenGL buffer.");
-	V_RETURN_CL(clEnqueueReleaseGLObjects(CommandQueue, 1, &m_clVelMass[1], 0, NULL, NULL), "Error releasing OpenGL buffer.");
+	V_RETURN_CL(clEnqueueReleaseGLObjects(CommandQueue, 1, &m_clVelMass[1], 0, NULL, TRACE_CL("release GL buffers")), "Error releasing OpenGL buffer.");
 
-	clFinish(CommandQueue);
+	{
+		TRACE_SCOPE("clFinish");
+		clFinish(CommandQueue);
+	}
 
 }
 
@@ -690,7 +697,7 @@ void CParticleSystemTask::Integrate(cl_context , cl_command_queue CommandQueue,
 	clErr |= clSetKernelArg(m_IntegrateKernel, 8, sizeof(cl_mem), (void*)&m_clVelMass[0]);
 	clErr |= clSetKernelArg(m_IntegrateKernel, 9, sizeof(cl_float), (void*)&dT);
 	V_RETURN_CL(clErr, "Failed to set args for m_IntegrateKernel");
-	clErr = clEnqueueNDRangeKernel(CommandQueue, m_IntegrateKernel, 1, NULL, globalWorkSize, LocalWorkSize, 0, NULL, NULL);
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_IntegrateKernel, 1, NULL, globalWorkSize, LocalWorkSize, 0, NULL, TRACE_CL("Integrate"));
 	V_RETURN_CL(clErr, "Error executing m_IntegrateKernel!");
 }
 
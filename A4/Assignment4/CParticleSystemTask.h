@@ -20,7 +20,7 @@
 #ifndef _CPARTICLE_SYSTEM_TASK_H
 #define _CPARTICLE_SYSTEM_TASK_H
 
-#include "../Common/IGUIEnabledComputeTask.h"
+#include "../../Common/IGUIEnabledComputeTask.h"
 
 #include "CTriMesh.h"
 #include "CGLTexture.h"
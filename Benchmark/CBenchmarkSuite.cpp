@@ -0,0 +1,340 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CBenchmarkSuite.h"
+
+#include "../Common/CBenchmarkReporter.h"
+#include "../Common/CDeviceMemoryTracker.h"
+#include "../Common/CTracer.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <memory>
+#include <algorithm>
+
+#ifdef _WIN32
+	#include <direct.h>
+	#define GET_WORKING_DIRECTORY(buffer, size) _getcwd(buffer, size)
+	#define CHANGE_DIRECTORY(path) _chdir(path)
+#else
+	#include <unistd.h>
+	#define GET_WORKING_DIRECTORY(buffer, size) getcwd(buffer, size)
+	#define CHANGE_DIRECTORY(path) chdir(path)
+#endif
+
+// the source directories of the assignments, set by the CMake project
+#ifndef GPGPU_A1_DIR
+	#define GPGPU_A1_DIR "../A1/Assignment1"
+#endif
+#ifndef GPGPU_A2_DIR
+	#define GPGPU_A2_DIR "../A2/Assignment2"
+#endif
+#ifndef GPGPU_A3_DIR
+	#define GPGPU_A3_DIR "../A3/Assignment3"
+#endif
+
+using namespace std;
+
+// Changes the working directory for the lifetime of the object
+class CScopedWorkingDirectory
+{
+public:
+	CScopedWorkingDirectory(const std::string& Path) : m_Changed(false)
+	{
+		char buffer[4096];
+		if(GET_WORKING_DIRECTORY(buffer, sizeof(buffer)) == nullptr)
+			return;
+		m_Previous = buffer;
+		m_Changed = (CHANGE_DIRECTORY(Path.c_str()) == 0);
+	}
+
+	~CScopedWorkingDirectory()
+	{
+		if(m_Changed && CHANGE_DIRECTORY(m_Previous.c_str()) != 0)
+			cerr<<"Failed to return to the working directory '"<<m_Previous<<"'."<<endl;
+	}
+
+	bool IsChanged() const { return m_Changed; }
+
+protected:
+	std::string	m_Previous;
+	bool		m_Changed;
+};
+
+static unsigned int GetDimensions(const size_t LocalWorkSize[3])
+{
+	return LocalWorkSize[2] > 1 ? 3 : (LocalWorkSize[1] > 1 ? 2 : 1);
+}
+
+static std::string LocalWorkSizeToString(const size_t LocalWorkSize[3])
+{
+	stringstream ss;
+	ss<<LocalWorkSize[0];
+	for(unsigned int i = 1; i < GetDimensions(LocalWorkSize); i++)
+		ss<<"x"<<LocalWorkSize[i];
+	return ss.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CBenchmarkSuite
+
+void CBenchmarkSuite::RegisterTasks()
+{
+	// A4 only has OpenGL tasks (cloth and particle simulation), they need a window and are left out
+	AddAssignment(m_Assignment1, GPGPU_A1_DIR);
+	AddAssignment(m_Assignment2, GPGPU_A2_DIR);
+	AddAssignment(m_Assignment3, GPGPU_A3_DIR);
+}
+
+void CBenchmarkSuite::AddAssignment(CAssignmentBase& Assignment, const std::string& Directory)
+{
+	Assignment.RegisterTasks();
+
+	const vector<CTaskEntry>& tasks = Assignment.GetTaskRegistry().GetTasks();
+	for(size_t i = 0; i < tasks.size(); i++)
+	{
+		m_Tasks.Register(tasks[i]);
+		m_Directories[tasks[i].Name] = Directory;
+	}
+}
+
+bool CBenchmarkSuite::DoCompute()
+{
+	vector<string> filters = m_CommandLine.GetList("filter");
+	unsigned int warmupRuns = 1;
+	unsigned int repetitions = 3;
+	unsigned int iterations = 10;
+	if(!m_CommandLine.GetUInt("warmup", warmupRuns) || !m_CommandLine.GetUInt("repetitions", repetitions)
+		|| !m_CommandLine.GetUInt("iterations", iterations))
+		return false;
+	repetitions = std::max(1u, repetitions);
+
+	size_t firstRecord = CBenchmarkReporter::GetRecords().size();
+	unsigned int nConfigurations = 0;
+	bool success = true;
+
+	const vector<CTaskEntry>& tasks = m_Tasks.GetTasks();
+	for(size_t t = 0; t < tasks.size(); t++)
+	{
+		const CTaskEntry& entry = tasks[t];
+
+		bool selected = filters.empty();
+		for(size_t i = 0; i < filters.size() && !selected; i++)
+			selected = CCommandLine::MatchPattern(filters[i], entry.Name);
+		if(!selected)
+			continue;
+
+		size_t maxSize = m_Tasks.GetMaxProblemSize(entry, m_CLDevice);
+		vector<size_t> sizes(1, entry.DefaultSize);
+		if(m_CommandLine.Has("sizes") && maxSize > 0 && !m_CommandLine.GetSizes("sizes", maxSize, sizes))
+		{
+			cerr<<"Invalid size list '"<<m_CommandLine.GetString("sizes")<<"'."<<endl;
+			return false;
+		}
+
+		vector<vector<size_t> > localWorkSizes;
+		if(!GetLocalWorkSizes(entry, localWorkSizes))
+			return false;
+
+		for(size_t s = 0; s < sizes.size(); s++)
+		{
+			if(maxSize > 0 && sizes[s] > maxSize)
+			{
+				cout<<"Skipping "<<entry.Name<<" with "<<CCommandLine::SizeToString(sizes[s])
+					<<" elements, the device memory holds at most "<<CCommandLine::SizeToString(maxSize)<<"."<<endl;
+				continue;
+			}
+
+			for(size_t l = 0; l < localWorkSizes.size(); l++)
+			{
+				CTaskOptions options;
+				options.ProblemSize = sizes[s];
+				// the tasks' own defaults (up to 1000 launches) take ages on CPU devices,
+				// the suite repeats whole runs instead
+				options.Iterations = iterations;
+				options.InputFile = entry.DefaultInputFile;
+				for(int i = 0; i < 3; i++)
+					options.LocalWorkSize[i] = localWorkSizes[l][i];
+				// measure exactly the requested configuration, no autotuning
+				options.LocalWorkSizeSet = true;
+
+				success &= RunConfiguration(entry, options, warmupRuns, repetitions);
+				nConfigurations++;
+			}
+		}
+	}
+
+	if(nConfigurations == 0)
+	{
+		cerr<<"No task matches the filter '"<<m_CommandLine.GetString("filter")<<"', use --list to see the available tasks."<<endl;
+		return false;
+	}
+
+	PrintSummary(firstRecord, repetitions);
+	return success;
+}
+
+bool CBenchmarkSuite::GetLocalWorkSizes(const CTaskEntry& Entry, std::vector<std::vector<size_t> >& LocalWorkSizes) const
+{
+	LocalWorkSizes.clear();
+
+	size_t maxWorkGroupSize = 0;
+	size_t maxWorkItemSizes[3] = { 0, 0, 0 };
+	clGetDeviceInfo(m_CLDevice, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &maxWorkGroupSize, NULL);
+	clGetDeviceInfo(m_CLDevice, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(maxWorkItemSizes), maxWorkItemSizes, NULL);
+
+	unsigned int taskDimensions = GetDimensions(Entry.DefaultLocalWorkSize);
+	vector<string> items = m_CommandLine.GetList("local-sizes");
+	for(size_t i = 0; i < items.size(); i++)
+	{
+		vector<size_t> localWorkSize(3, 1);
+		unsigned int dimensions = 0;
+		if(!CCommandLine::ParseLocalWorkSize(items[i], &localWorkSize[0], &dimensions))
+		{
+			cerr<<"Invalid local size '"<<items[i]<<"'."<<endl;
+			return false;
+		}
+		// "256" only applies to 1D tasks, "16x16" only to 2D tasks
+		if(dimensions != taskDimensions)
+			continue;
+
+		bool fits = localWorkSize[0] * localWorkSize[1] * localWorkSize[2] <= maxWorkGroupSize;
+		for(int d = 0; d < 3; d++)
+			fits &= (maxWorkItemSizes[d] == 0 || localWorkSize[d] <= maxWorkItemSizes[d]);
+		if(!fits)
+		{
+			cout<<"Skipping local size "<<items[i]<<" for "<<Entry.Name<<", the device supports at most "<<maxWorkGroupSize<<" work-items per group."<<endl;
+			continue;
+		}
+		LocalWorkSizes.push_back(localWorkSize);
+	}
+
+	if(LocalWorkSizes.empty())
+		LocalWorkSizes.push_back(vector<size_t>(Entry.DefaultLocalWorkSize, Entry.DefaultLocalWorkSize + 3));
+	return true;
+}
+
+bool CBenchmarkSuite::RunConfiguration(const CTaskEntry& Entry, const CTaskOptions& Options, unsigned int WarmupRuns, unsigned int Repetitions)
+{
+	// the kernels and input images are loaded relative to the assignment
+	CScopedWorkingDirectory workingDirectory(m_Directories[Entry.Name]);
+	if(!workingDirectory.IsChanged())
+	{
+		cerr<<"Cannot change to the directory '"<<m_Directories[Entry.Name]<<"' of task "<<Entry.Name<<"."<<endl;
+		return false;
+	}
+
+	vector<string> variants = m_CommandLine.GetList("variants");
+	bool success = true;
+
+	for(unsigned int run = 0; run < WarmupRuns + Repetitions; run++)
+	{
+		bool warmup = run < WarmupRuns;
+
+		cout<<"########################################"<<endl;
+		cout<<Entry.Description;
+		if(Entry.DeviceBytesPerElement > 0.0)
+			cout<<" ("<<CCommandLine::SizeToString(Options.ProblemSize)<<" elements)";
+		cout<<", local size "<<LocalWorkSizeToString(Options.LocalWorkSize)<<", ";
+		if(warmup)
+			cout<<"warm-up "<<run + 1<<"/"<<WarmupRuns;
+		else
+			cout<<"run "<<run - WarmupRuns + 1<<"/"<<Repetitions;
+		cout<<endl<<endl;
+
+		// the factory may adjust the options
+		CTaskOptions options = Options;
+		unique_ptr<IComputeTask> pTask(Entry.Factory(options));
+		if(!pTask)
+		{
+			cerr<<"Failed to create task "<<Entry.Name<<"."<<endl;
+			return false;
+		}
+		pTask->SetIterations(options.Iterations);
+		pTask->SetVariantFilter(variants);
+
+		size_t nRecords = CBenchmarkReporter::GetRecords().size();
+		{
+			TRACE_SCOPE(Entry.Name.c_str());
+			CDeviceMemoryOwner memoryOwner(Entry.Name);
+			success &= RunComputeTask(*pTask, options.LocalWorkSize);
+		}
+		if(warmup)
+			CBenchmarkReporter::Truncate(nRecords);
+	}
+
+	return success;
+}
+
+void CBenchmarkSuite::PrintSummary(size_t FirstRecord, unsigned int Repetitions) const
+{
+	const vector<CBenchmarkRecord>& records = CBenchmarkReporter::GetRecords();
+
+	// the repetitions of a configuration only differ in their timing, keep the fastest
+	vector<size_t> best;
+	for(size_t i = FirstRecord; i < records.size(); i++)
+	{
+		const CBenchmarkRecord& record = records[i];
+		size_t b = 0;
+		for(; b < best.size(); b++)
+		{
+			const CBenchmarkRecord& other = records[best[b]];
+			if(other.Task == record.Task && other.Variant == record.Variant && other.Device == record.Device &&
+				other.ProblemSize == record.ProblemSize && equal(other.LocalSize, other.LocalSize + 3, record.LocalSize))
+				break;
+		}
+		if(b == best.size())
+			best.push_back(i);
+		else if(record.MedianMs < records[best[b]].MedianMs)
+			best[b] = i;
+	}
+
+	if(best.empty())
+		return;
+
+	cout<<endl<<"########################################"<<endl;
+	cout<<"Benchmark summary (best of "<<Repetitions<<" runs)"<<endl<<endl;
+	cout<<left<<setw(48)<<"task/variant"<<setw(10)<<"size"<<setw(10)<<"local"<<right<<setw(12)<<"ms"<<setw(12)<<"GB/s"<<endl;
+	for(size_t b = 0; b < best.size(); b++)
+	{
+		const CBenchmarkRecord& record = records[best[b]];
+		bool cpu = record.Device.compare(0, 3, "CPU") == 0;
+		cout<<left<<setw(48)<<(record.Task + "/" + record.Variant)
+			<<setw(10)<<CCommandLine::SizeToString(record.ProblemSize)
+			<<setw(10)<<(cpu ? string("-") : LocalWorkSizeToString(record.LocalSize))
+			<<right<<setw(12)<<record.MedianMs<<setw(12)<<record.GetGBPerSecond()<<endl;
+	}
+	cout<<endl;
+}
+
+void CBenchmarkSuite::GetOptionNames(std::vector<std::string>& Names) const
+{
+	const char* names[] = { "help", "list", "filter", "variants", "sizes", "local-sizes", "warmup", "repetitions",
+		"iterations", "device", "output", "measure-peaks", "no-peaks", "trace" };
+	Names.insert(Names.end(), names, names + sizeof(names) / sizeof(names[0]));
+}
+
+void CBenchmarkSuite::PrintUsage(const char* ProgramName)
+{
+	cout<<"Usage: "<<ProgramName<<" [options]"<<endl<<endl;
+	cout<<"  --list                 list the tasks of all assignments"<<endl;
+	cout<<"  --filter=a,b*,...      run only the tasks matching one of the patterns ('*' and '?' wildcards)"<<endl;
+	cout<<"  --variants=a,b*,...    run only the kernel variants matching one of the patterns,"<<endl;
+	cout<<"                         e.g. scanNaive or Reduction/*Decomposition*"<<endl;
+	cout<<"  --sizes=LIST           problem sizes, e.g. 16M or 1K,4K or 1K..64M or 1K..max:4"<<endl;
+	cout<<"  --local-sizes=LIST     local sizes to sweep, e.g. 64,128,256,16x16,32x8"<<endl;
+	cout<<"                         (each task uses those with its number of dimensions)"<<endl;
+	cout<<"  --warmup=N             untimed runs of every configuration (default 1)"<<endl;
+	cout<<"  --repetitions=N        timed runs of every configuration (default 3)"<<endl;
+	cout<<"  --iterations=N         kernel launches per timed run (default 10)"<<endl;
+	cout<<"  --device=SPEC          device selection, e.g. type=cpu or type=gpu,platform=NVIDIA"<<endl;
+	cout<<"  --output=FILE          write all benchmark records to FILE (.json or .csv)"<<endl;
+	cout<<"  --measure-peaks        measure the device peaks again instead of using DevicePeaks.txt"<<endl;
+	cout<<"  --no-peaks             do not relate the results to the device peaks"<<endl;
+	cout<<"  --trace[=FILE]         record a timeline of host and device activity for chrome://tracing"<<endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
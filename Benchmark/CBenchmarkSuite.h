@@ -0,0 +1,82 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CBENCHMARK_SUITE_H
+#define _CBENCHMARK_SUITE_H
+
+#include "../Common/CAssignmentBase.h"
+
+#include "CAssignment1.h"
+#include "CAssignment2.h"
+#include "CAssignment3.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+//! Runs the compute tasks of all assignments (except the OpenGL ones of A4) as one benchmark
+/*!
+	The tasks are registered by the assignments themselves and each one runs
+	in the source directory of its assignment, where its kernels and input
+	images are. Every task runs for each combination of the sizes (--sizes)
+	and local sizes (--local-sizes) it accepts: first the warm-up runs, whose
+	records are dropped, then the timed repetitions. --filter selects tasks and
+	--variants the kernel variants within a task (see IComputeTask::SetVariantFilter()),
+	both by wildcard patterns.
+
+	The local sizes are always given explicitly, so the assignments never
+	autotune in the suite. Nothing needs OpenGL, so the suite also runs on CPU
+	OpenCL implementations (--device=type=cpu).
+*/
+class CBenchmarkSuite : public CAssignmentBase
+{
+public:
+	virtual ~CBenchmarkSuite() {};
+
+	virtual bool DoCompute();
+
+protected:
+	virtual void RegisterTasks();
+
+	virtual void PrintUsage(const char* ProgramName);
+
+	virtual void GetOptionNames(std::vector<std::string>& Names) const;
+
+	//! Adds the tasks of an assignment, they are run with Directory as the working directory
+	void AddAssignment(CAssignmentBase& Assignment, const std::string& Directory);
+
+	//! The entries of --local-sizes with as many dimensions as the default local size of the task
+	//! and within the device limits, or just the default if there are none
+	bool GetLocalWorkSizes(const CTaskEntry& Entry, std::vector<std::vector<size_t> >& LocalWorkSizes) const;
+
+	//! Warm-up runs followed by the timed repetitions of one configuration
+	bool RunConfiguration(const CTaskEntry& Entry, const CTaskOptions& Options, unsigned int WarmupRuns, unsigned int Repetitions);
+
+	//! The best repetition of every kernel variant and configuration reported since FirstRecord
+	void PrintSummary(size_t FirstRecord, unsigned int Repetitions) const;
+
+	CAssignment1						m_Assignment1;
+	CAssignment2						m_Assignment2;
+	CAssignment3						m_Assignment3;
+
+	//task name -> working directory
+	std::map<std::string, std::string>	m_Directories;
+};
+
+#endif // _CBENCHMARK_SUITE_H
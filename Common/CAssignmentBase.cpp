@@ -0,0 +1,405 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CAssignmentBase.h"
+
+#include "CLUtil.h"
+#include "CTimer.h"
+#include "CProgramBinaryCache.h"
+#include "CKernelLibrary.h"
+#include "CKernelReport.h"
+#include "CDeviceMemoryTracker.h"
+#include "CBenchmarkReporter.h"
+#include "CTracer.h"
+#include "CMicrobenchmarks.h"
+
+#include <vector>
+#include <memory>
+
+using namespace std;
+
+#if defined (__APPLE__) || defined(MACOSX)
+   #define GL_SHARING_EXTENSION "cl_APPLE_gl_sharing"
+#else
+   #define GL_SHARING_EXTENSION "cl_khr_gl_sharing"
+#endif
+
+// required for OpenGL interop
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+#ifdef linux
+    #if defined (__APPLE__) || defined(MACOSX)
+        #include <OpenGL/OpenGL.h>
+    #else
+        #include <GL/glx.h>
+    #endif
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// CAssignmentBase
+
+CAssignmentBase::CAssignmentBase()
+	: m_CLPlatform(nullptr), m_CLDevice(nullptr), m_CLContext(nullptr), m_CLCommandQueue(nullptr), m_pBufferPool(nullptr)
+{
+}
+
+CAssignmentBase::~CAssignmentBase()
+{
+	ReleaseCLContext();
+}
+
+bool CAssignmentBase::EnterMainLoop(int argc, char** argv)
+{
+	vector<string> options;
+	GetOptionNames(options);
+	if(!m_CommandLine.Parse(argc, argv, options))
+		return false;
+	if(m_CommandLine.Has("help"))
+	{
+		PrintUsage(argv[0]);
+		return true;
+	}
+	if(m_CommandLine.Has("output"))
+		CBenchmarkReporter::SetOutputPath(m_CommandLine.GetString("output"));
+	if(m_CommandLine.Has("trace"))
+		CTracer::Start(m_CommandLine.GetString("trace"));
+	else
+		CTracer::InitFromEnvironment();
+
+	RegisterTasks();
+	if(m_CommandLine.Has("list"))
+	{
+		cout << "Available tasks:" << endl;
+		m_Tasks.Print(cout);
+		return true;
+	}
+
+	// a typo must not silently benchmark the default device
+	if(!m_DeviceSelector.ParseEnvironment() || !m_DeviceSelector.ParseCommandLine(argc, argv))
+		return false;
+
+	if(!InitCLContext())
+		return false;
+
+	MeasureDevicePeaks();
+
+	bool success = DoCompute();
+
+	CKernelLibrary::PrintStatistics();
+	CKernelReport::Print(cout);
+	CProgramBinaryCache::PrintStatistics();
+	CBenchmarkReporter::Flush();
+	CTracer::Flush();
+
+	ReleaseCLContext();
+
+	return success;
+}
+
+#define PRINT_INFO(title, buffer, bufferSize, maxBufferSize, expr) { expr; buffer[bufferSize] = '\0'; std::cout << title << ": " << buffer << std::endl; }
+
+bool CAssignmentBase::InitCLContext()
+{
+	//////////////////////////////////////////////////////
+	//(Sect 4.3)
+
+	// 1. + 2. enumerate the devices of all platforms and pick one according to
+	// the selection policy (GPGPU_DEVICE or --device, see CDeviceSelector)
+	if(!m_DeviceSelector.Select(m_CLPlatform, m_CLDevice))
+		return false;
+
+	// Printing platform and device data.
+	const int maxBufferSize = 1024;
+	char buffer[maxBufferSize];
+	size_t bufferSize;
+	std::cout << "OpenCL platform:" << std::endl << std::endl;
+	PRINT_INFO("Name", buffer, bufferSize, maxBufferSize, clGetPlatformInfo(m_CLPlatform, CL_PLATFORM_NAME, maxBufferSize, (void*)buffer, &bufferSize));
+	PRINT_INFO("Vendor", buffer, bufferSize, maxBufferSize, clGetPlatformInfo(m_CLPlatform, CL_PLATFORM_VENDOR, maxBufferSize, (void*)buffer, &bufferSize));
+	PRINT_INFO("Version", buffer, bufferSize, maxBufferSize, clGetPlatformInfo(m_CLPlatform, CL_PLATFORM_VERSION, maxBufferSize, (void*)buffer, &bufferSize));
+	PRINT_INFO("Profile", buffer, bufferSize, maxBufferSize, clGetPlatformInfo(m_CLPlatform, CL_PLATFORM_PROFILE, maxBufferSize, (void*)buffer, &bufferSize));
+	std::cout << std::endl << "Device:" << std::endl << std::endl;
+	PRINT_INFO("Name", buffer, bufferSize, maxBufferSize, clGetDeviceInfo(m_CLDevice, CL_DEVICE_NAME, maxBufferSize, (void*)buffer, &bufferSize));
+	PRINT_INFO("Vendor", buffer, bufferSize, maxBufferSize, clGetDeviceInfo(m_CLDevice, CL_DEVICE_VENDOR, maxBufferSize, (void*)buffer, &bufferSize));
+	PRINT_INFO("Driver version", buffer, bufferSize, maxBufferSize, clGetDeviceInfo(m_CLDevice, CL_DRIVER_VERSION, maxBufferSize, (void*)buffer, &bufferSize));
+	cl_ulong localMemorySize;
+	clGetDeviceInfo(m_CLDevice, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &localMemorySize, &bufferSize);
+	std::cout << "Local memory size: " << localMemorySize << " Byte" << std::endl;
+	std::cout << std::endl << "******************************" << std::endl << std::endl;
+
+        
+	cl_int clError;
+
+	m_CLContext = clCreateContext(NULL, 1, &m_CLDevice, NULL, NULL, &clError);
+		
+	V_RETURN_FALSE_CL(clError, "Failed to create OpenCL context.");
+
+	// Finally, create a command queue. All the asynchronous commands to the device will be issued
+	// from the CPU into this queue. This way the host program can continue the execution until some results
+	// from that device are needed.
+
+	// profiling is cheap enough to keep enabled all the time, it enables the
+	// device-side timing in CLUtil::ProfileKernel()
+	m_CLCommandQueue = clCreateCommandQueue(m_CLContext, m_CLDevice, CL_QUEUE_PROFILING_ENABLE, &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create the command queue in the context");
+
+	// device buffers are recycled across all tasks of the assignment
+	m_pBufferPool = new CDeviceBufferPool(m_CLContext);
+
+	// all benchmark records of this run are measured on this device
+	CBenchmarkReporter::SetDevice(m_CLDevice);
+
+	return true;
+}
+
+void CAssignmentBase::ReleaseCLContext()
+{
+	if (m_pBufferPool != nullptr)
+	{
+		m_pBufferPool->PrintStatistics();
+		SAFE_DELETE(m_pBufferPool);
+	}
+
+	// the cached programs must not outlive their context
+	CKernelLibrary::ReleasePrograms(m_CLContext);
+
+	// all tasks released their resources by now, whatever is still allocated leaked
+	// (only once, the destructor calls this again)
+	if (m_CLCommandQueue != nullptr)
+	{
+		clFinish(m_CLCommandQueue);
+		CDeviceMemoryTracker::PrintStatistics(m_CLDevice);
+		CDeviceMemoryTracker::CheckLeaks();
+	}
+
+	if (m_CLCommandQueue != nullptr)
+	{
+		clReleaseCommandQueue(m_CLCommandQueue);
+		m_CLCommandQueue = nullptr;
+	}
+
+	if (m_CLContext != nullptr)
+	{
+		clReleaseContext(m_CLContext);
+		m_CLContext = nullptr;
+	}
+}
+
+bool CAssignmentBase::RunComputeTask(IComputeTask& Task, size_t LocalWorkSize[3])
+{
+	if(m_CLContext == nullptr)
+	{
+		std::cerr<<"Error: RunComputeTask() cannot execute because the OpenCL context has not been created first."<<endl;
+	}
+	
+	Task.SetBufferPool(m_pBufferPool);
+
+	bool initialized;
+	{
+		TRACE_SCOPE("InitResources");
+		initialized = Task.InitResources(m_CLDevice, m_CLContext);
+	}
+	if(!initialized)
+	{
+		std::cerr << "Error during resource allocation. Aborting execution." <<endl;
+		Task.ReleaseResources();
+		return false;
+	}
+
+	// Compute the golden result.
+	cout << "Computing CPU reference result...";
+	{
+		TRACE_SCOPE("ComputeCPU");
+		Task.ComputeCPU();
+	}
+	cout << "DONE" << endl;
+
+	// Running the same task on the GPU.
+	cout << "Computing GPU result...";
+
+	// Runing the kernel N times. This make the measurement of the execution time more accurate.
+	{
+		TRACE_SCOPE("ComputeGPU");
+		Task.ComputeGPU(m_CLContext, m_CLCommandQueue, LocalWorkSize);
+	}
+	cout << "DONE" << endl;
+
+	// Validating results.
+	if (Task.ValidateResults())
+	{
+		cout << "GOLD TEST PASSED!" << endl;
+	}
+	else
+	{
+		cout << "INVALID RESULTS!" << endl;
+	}
+	
+	// Cleaning up.
+	Task.ReleaseResources();
+
+	return true;
+}
+
+bool CAssignmentBase::RunRegisteredTasks()
+{
+	// the selection keeps the order given on the command line
+	vector<const CTaskEntry*> selected;
+	vector<string> names = m_CommandLine.GetList("tasks");
+	for(size_t i = 0; i < names.size(); i++)
+	{
+		const CTaskEntry* pEntry = m_Tasks.Find(names[i]);
+		if(!pEntry)
+		{
+			cerr << "Unknown task '" << names[i] << "', use --list to see the available tasks." << endl;
+			return false;
+		}
+		selected.push_back(pEntry);
+	}
+	if(names.empty())
+		for(size_t i = 0; i < m_Tasks.GetTasks().size(); i++)
+			selected.push_back(&m_Tasks.GetTasks()[i]);
+
+	bool success = true;
+	for(size_t t = 0; t < selected.size(); t++)
+	{
+		const CTaskEntry& entry = *selected[t];
+		size_t maxSize = m_Tasks.GetMaxProblemSize(entry, m_CLDevice);
+
+		vector<size_t> sizes(1, entry.DefaultSize);
+		if(m_CommandLine.Has("sizes"))
+		{
+			if(maxSize == 0)
+				cout << "Task " << entry.Name << " has a fixed problem size, ignoring --sizes." << endl;
+			else if(!m_CommandLine.GetSizes("sizes", maxSize, sizes))
+			{
+				cerr << "Invalid size list '" << m_CommandLine.GetString("sizes") << "'." << endl;
+				return false;
+			}
+		}
+
+		for(size_t s = 0; s < sizes.size(); s++)
+		{
+			CTaskOptions options;
+			options.ProblemSize = sizes[s];
+			if(!m_CommandLine.GetUInt("iterations", options.Iterations))
+				return false;
+			options.InputFile = m_CommandLine.GetString("input", entry.DefaultInputFile);
+			for(int i = 0; i < 3; i++)
+				options.LocalWorkSize[i] = entry.DefaultLocalWorkSize[i];
+			if(m_CommandLine.Has("local-size"))
+			{
+				if(!m_CommandLine.GetLocalWorkSize("local-size", options.LocalWorkSize))
+				{
+					cerr << "Invalid local size '" << m_CommandLine.GetString("local-size") << "'." << endl;
+					return false;
+				}
+				options.LocalWorkSizeSet = true;
+			}
+
+			if(maxSize > 0 && options.ProblemSize > maxSize)
+			{
+				cout << "Skipping " << entry.Name << " with " << CCommandLine::SizeToString(options.ProblemSize)
+					<< " elements, the device memory holds at most " << CCommandLine::SizeToString(maxSize) << "." << endl;
+				continue;
+			}
+
+			cout << "########################################" << endl;
+			cout << entry.Description;
+			if(maxSize > 0)
+				cout << " (" << CCommandLine::SizeToString(options.ProblemSize) << " elements)";
+			cout << endl << endl;
+
+			unique_ptr<IComputeTask> pTask(entry.Factory(options));
+			if(!pTask)
+			{
+				cerr << "Failed to create task " << entry.Name << "." << endl;
+				success = false;
+				continue;
+			}
+			pTask->SetIterations(options.Iterations);
+
+			TRACE_SCOPE(entry.Name.c_str());
+			CDeviceMemoryOwner memoryOwner(entry.Name);
+			success &= RunComputeTask(*pTask, options.LocalWorkSize);
+		}
+	}
+
+	return success;
+}
+
+void CAssignmentBase::MeasureDevicePeaks()
+{
+	if(m_CommandLine.Has("no-peaks"))
+		return;
+
+	CDevicePeaks peaks;
+	if(CMicrobenchmarks::GetPeaks(m_CLDevice, m_CLContext, m_CLCommandQueue, peaks, m_CommandLine.Has("measure-peaks")))
+	{
+		peaks.Print(cout);
+		CBenchmarkReporter::SetDevicePeaks(peaks);
+	}
+	cout << endl;
+}
+
+void CAssignmentBase::GetOptionNames(std::vector<std::string>& Names) const
+{
+	const char* names[] = { "help", "list", "tasks", "sizes", "iterations", "local-size", "input",
+		"device", "output", "trace", "measure-peaks", "no-peaks" };
+	Names.insert(Names.end(), names, names + sizeof(names) / sizeof(names[0]));
+}
+
+void CAssignmentBase::PrintUsage(const char* ProgramName)
+{
+	cout << "Usage: " << ProgramName << " [options]" << endl << endl;
+	cout << "  --list                 list the tasks of this assignment" << endl;
+	cout << "  --tasks=a,b,...        run only these tasks, in this order" << endl;
+	cout << "  --sizes=LIST           problem sizes, e.g. 16M or 1K,4K or 1K..64M or 1K..max:4" << endl;
+	cout << "                         (\"max\" is the largest size that fits into device memory)" << endl;
+	cout << "  --iterations=N         timed repetitions of each kernel" << endl;
+	cout << "  --local-size=X[xY[xZ]] work-group size (disables autotuning)" << endl;
+	cout << "  --input=FILE           input file of the task (image, mesh)" << endl;
+	cout << "  --device=SPEC          device selection, e.g. type=gpu,platform=NVIDIA,index=0" << endl;
+	cout << "  --output=FILE          write the benchmark results to FILE (.json or .csv)" << endl;
+	cout << "  --measure-peaks        measure the device peaks again instead of using DevicePeaks.txt" << endl;
+	cout << "  --no-peaks             do not relate the results to the device peaks" << endl;
+	cout << "  --trace[=FILE]         record a timeline of host and device activity for chrome://tracing" << endl;
+	cout << "                         (default trace.json)" << endl;
+}
+
+bool CAssignmentBase::TuneComputeTask(IComputeTask& Task, ITunableTask& Tunable, const CTuningSpace& Space, TuningConfiguration& Best)
+{
+	if(m_CLContext == nullptr)
+	{
+		std::cerr<<"Error: TuneComputeTask() cannot execute because the OpenCL context has not been created first."<<endl;
+		return false;
+	}
+
+	if(!m_AutoTuner.Lookup(Tunable, Space, m_CLDevice, Best))
+	{
+		Task.SetBufferPool(m_pBufferPool);
+
+		if(!Task.InitResources(m_CLDevice, m_CLContext))
+		{
+			std::cerr << "Error during resource allocation. Aborting tuning." <<endl;
+			Task.ReleaseResources();
+			return false;
+		}
+
+		bool success = m_AutoTuner.Tune(Tunable, Space, m_CLDevice, m_CLContext, m_CLCommandQueue, Best);
+		Task.ReleaseResources();
+		if(!success)
+			return false;
+	}
+	else
+	{
+		cout << "Tuning " << Tunable.GetTuningKey() << ": using stored configuration " << CAutoTuner::ConfigurationToString(Best) << endl;
+	}
+
+	Tunable.ApplyConfiguration(Best);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -21,6 +21,10 @@
 #define _CASSIGNMENT_BASE_H
 
 #include "IComputeTask.h"
+#include "CDeviceSelector.h"
+#include "CAutoTuner.h"
+#include "CCommandLine.h"
+#include "CTaskRegistry.h"
 
 #include "CommonDefs.h"
 
@@ -34,6 +38,9 @@
 
 	Internally the assignment class should initialize the context,
 	run one or more compute tasks and then release the context.
+	Assignments register their tasks in RegisterTasks() and run them
+	with RunRegisteredTasks(), which applies the command line options
+	(see PrintUsage()).
 */
 class CAssignmentBase
 {
@@ -48,6 +55,12 @@ public:
 	//! You need to overload this to define a specific behavior for your assignments
 	virtual bool DoCompute() = 0;
 
+	//! Adds the tasks of the assignment to m_Tasks, called by EnterMainLoop() before the context is created
+	virtual void RegisterTasks() {}
+
+	//! The tasks added by RegisterTasks(), e.g. to run them from another program
+	const CTaskRegistry& GetTaskRegistry() const { return m_Tasks; }
+
 protected:	
 	virtual bool InitCLContext();
 
@@ -55,10 +68,39 @@ protected:
 
 	virtual bool RunComputeTask(IComputeTask& Task, size_t LocalWorkSize[3]);
 
+	//! Runs the tasks selected with --tasks (default: all) for every size given with --sizes
+	virtual bool RunRegisteredTasks();
+
+	virtual void PrintUsage(const char* ProgramName);
+
+	//! The options accepted on the command line (without "--"), see PrintUsage()
+	virtual void GetOptionNames(std::vector<std::string>& Names) const;
+
+	//! Loads or measures the peak bandwidth and throughput of the device (CMicrobenchmarks) for the roofline output
+	virtual void MeasureDevicePeaks();
+
+	//! Finds the best configuration of a task in Space (stored or measured) and applies it to the task
+	/*!
+		Task and Tunable are usually the same object. The resources of the task
+		are only initialized if there is no stored result for this device.
+	*/
+	virtual bool TuneComputeTask(IComputeTask& Task, ITunableTask& Tunable, const CTuningSpace& Space, TuningConfiguration& Best);
+
 	cl_platform_id		m_CLPlatform;
 	cl_device_id		m_CLDevice;
 	cl_context			m_CLContext;
 	cl_command_queue	m_CLCommandQueue;
+
+	//! Device selection policy, read from the environment and the command line in EnterMainLoop()
+	CDeviceSelector		m_DeviceSelector;
+
+	CCommandLine		m_CommandLine;
+	CTaskRegistry		m_Tasks;
+
+	//! Shared by all tasks run with RunComputeTask(), created with the context
+	CDeviceBufferPool*	m_pBufferPool;
+
+	CAutoTuner			m_AutoTuner;
 };
 
 #endif // _CASSIGNMENT_BASE_H
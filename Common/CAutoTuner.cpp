@@ -0,0 +1,283 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CAutoTuner.h"
+
+#include "CLUtil.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CTuningSpace
+
+void CTuningSpace::AddParameter(const std::string& Name, const std::vector<int>& Values)
+{
+	m_Names.push_back(Name);
+	m_Values.push_back(Values);
+}
+
+size_t CTuningSpace::GetSize() const
+{
+	if(m_Names.empty())
+		return 0;
+
+	size_t size = 1;
+	for(size_t i = 0; i < m_Values.size(); i++)
+		size *= m_Values[i].size();
+	return size;
+}
+
+TuningConfiguration CTuningSpace::GetConfiguration(size_t Index) const
+{
+	// mixed radix decomposition of the index, the last parameter varies fastest
+	TuningConfiguration configuration;
+	for(size_t i = m_Names.size(); i-- > 0; )
+	{
+		size_t count = m_Values[i].size();
+		configuration[m_Names[i]] = m_Values[i][Index % count];
+		Index /= count;
+	}
+	return configuration;
+}
+
+std::string CTuningSpace::GetSignature() const
+{
+	string signature;
+	for(size_t i = 0; i < m_Names.size(); i++)
+	{
+		if(i > 0)
+			signature += ",";
+		signature += m_Names[i];
+	}
+	return signature;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CAutoTuner
+
+CAutoTuner::CAutoTuner()
+	: m_DatabasePath("TuningDB.txt"), m_ForceRetune(false), m_Loaded(false)
+{
+	const char* pEnv = getenv("GPGPU_TUNING_DB");
+	if(pEnv && *pEnv)
+		m_DatabasePath = pEnv;
+
+	pEnv = getenv("GPGPU_RETUNE");
+	if(pEnv && *pEnv && string(pEnv) != "0")
+		m_ForceRetune = true;
+}
+
+std::string CAutoTuner::GetDatabaseKey(const ITunableTask& Task, const CTuningSpace& Space, cl_device_id Device) const
+{
+	// tabs separate the columns of the database file
+	string key = CLUtil::GetDeviceInfoString(Device, CL_DEVICE_NAME) + "|" + CLUtil::GetDeviceInfoString(Device, CL_DRIVER_VERSION)
+		+ "|" + Task.GetTuningKey() + "|" + Space.GetSignature();
+	for(size_t i = 0; i < key.size(); i++)
+		if(key[i] == '\t' || key[i] == '\n' || key[i] == '\r')
+			key[i] = ' ';
+	return key;
+}
+
+void CAutoTuner::LoadDatabase()
+{
+	if(m_Loaded)
+		return;
+	m_Loaded = true;
+
+	ifstream file(m_DatabasePath.c_str());
+	if(!file.is_open())
+		return;
+
+	string line;
+	while(getline(file, line))
+	{
+		if(!line.empty() && line[line.size() - 1] == '\r')
+			line.resize(line.size() - 1);
+
+		size_t tab1 = line.find('\t');
+		size_t tab2 = (tab1 == string::npos) ? string::npos : line.find('\t', tab1 + 1);
+		if(tab2 == string::npos)
+			continue;
+
+		TuningResult result;
+		result.Configuration = line.substr(tab1 + 1, tab2 - tab1 - 1);
+		result.Milliseconds = atof(line.substr(tab2 + 1).c_str());
+		m_Database[line.substr(0, tab1)] = result;
+	}
+}
+
+bool CAutoTuner::SaveDatabase() const
+{
+	string tmpPath = m_DatabasePath + ".tmp";
+	{
+		ofstream file(tmpPath.c_str(), ios::trunc);
+		if(!file.is_open())
+		{
+			cerr<<"Failed to write the tuning database '"<<tmpPath<<"'."<<endl;
+			return false;
+		}
+		for(map<string, TuningResult>::const_iterator it = m_Database.begin(); it != m_Database.end(); ++it)
+			file<<it->first<<"\t"<<it->second.Configuration<<"\t"<<it->second.Milliseconds<<"\n";
+	}
+
+	remove(m_DatabasePath.c_str());
+	if(rename(tmpPath.c_str(), m_DatabasePath.c_str()) != 0)
+	{
+		remove(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool CAutoTuner::Lookup(const ITunableTask& Task, const CTuningSpace& Space, cl_device_id Device, TuningConfiguration& Best)
+{
+	if(m_ForceRetune)
+		return false;
+
+	LoadDatabase();
+
+	map<string, TuningResult>::const_iterator it = m_Database.find(GetDatabaseKey(Task, Space, Device));
+	if(it == m_Database.end())
+		return false;
+
+	TuningConfiguration configuration;
+	if(!ParseConfiguration(it->second.Configuration, configuration))
+		return false;
+
+	// a stored result must still assign every parameter of the space
+	TuningConfiguration reference = Space.GetConfiguration(0);
+	for(TuningConfiguration::const_iterator it = reference.begin(); it != reference.end(); ++it)
+		if(configuration.find(it->first) == configuration.end())
+			return false;
+
+	Best = configuration;
+	return true;
+}
+
+bool CAutoTuner::Tune(ITunableTask& Task, const CTuningSpace& Space, cl_device_id Device,
+	cl_context Context, cl_command_queue CommandQueue, TuningConfiguration& Best)
+{
+	if(Lookup(Task, Space, Device, Best))
+	{
+		cout<<"Tuning "<<Task.GetTuningKey()<<": using stored configuration "<<ConfigurationToString(Best)<<endl;
+		return true;
+	}
+
+	cout<<"Tuning "<<Task.GetTuningKey()<<" over "<<Space.GetSize()<<" configurations:"<<endl;
+
+	bool found = false;
+	double bestTime = 0.0;
+	unsigned int skipped = 0;
+
+	for(size_t i = 0; i < Space.GetSize(); i++)
+	{
+		TuningConfiguration configuration = Space.GetConfiguration(i);
+
+		double ms = 0.0;
+		if(!Task.MeasureConfiguration(configuration, Device, Context, CommandQueue, ms))
+		{
+			skipped++;
+			continue;
+		}
+
+		cout<<"  "<<setw(48)<<left<<ConfigurationToString(configuration)<<right<<setw(10)<<fixed<<setprecision(4)<<ms<<" ms";
+		if(!found || ms < bestTime)
+		{
+			found = true;
+			bestTime = ms;
+			Best = configuration;
+			cout<<" *";
+		}
+		cout<<endl;
+	}
+	cout.unsetf(ios::fixed);
+	cout<<setprecision(6);
+
+	if(!found)
+	{
+		cerr<<"No configuration of "<<Task.GetTuningKey()<<" can be launched on this device."<<endl;
+		return false;
+	}
+
+	cout<<"  best: "<<ConfigurationToString(Best)<<" ("<<bestTime<<" ms), "<<skipped<<" configurations did not fit the device"<<endl;
+
+	LoadDatabase();
+	TuningResult result;
+	result.Configuration = ConfigurationToString(Best);
+	result.Milliseconds = bestTime;
+	m_Database[GetDatabaseKey(Task, Space, Device)] = result;
+	SaveDatabase();
+
+	return true;
+}
+
+bool CAutoTuner::FitsDevice(cl_kernel Kernel, cl_device_id Device, const size_t* pLocalWorkSize, cl_uint Dimensions, size_t DynamicLocalMem)
+{
+	size_t kernelMaxGroupSize = 0;
+	cl_ulong kernelLocalMem = 0;
+	V_RETURN_FALSE_CL(clGetKernelWorkGroupInfo(Kernel, Device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &kernelMaxGroupSize, NULL), "Failed to query the kernel work-group size.");
+	V_RETURN_FALSE_CL(clGetKernelWorkGroupInfo(Kernel, Device, CL_KERNEL_LOCAL_MEM_SIZE, sizeof(cl_ulong), &kernelLocalMem, NULL), "Failed to query the kernel local memory size.");
+
+	size_t maxItemSizes[3] = {0, 0, 0};
+	cl_ulong deviceLocalMem = 0;
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(maxItemSizes), maxItemSizes, NULL), "Failed to query the max. work-item sizes.");
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &deviceLocalMem, NULL), "Failed to query the local memory size.");
+
+	size_t groupSize = 1;
+	for(cl_uint i = 0; i < Dimensions && i < 3; i++)
+	{
+		if(pLocalWorkSize[i] > maxItemSizes[i])
+			return false;
+		groupSize *= pLocalWorkSize[i];
+	}
+
+	if(groupSize > kernelMaxGroupSize)
+		return false;
+
+	// CL_KERNEL_LOCAL_MEM_SIZE may already include __local arguments that were set before, so this is conservative
+	return kernelLocalMem + DynamicLocalMem <= deviceLocalMem;
+}
+
+std::string CAutoTuner::ConfigurationToString(const TuningConfiguration& Configuration)
+{
+	stringstream ss;
+	for(TuningConfiguration::const_iterator it = Configuration.begin(); it != Configuration.end(); ++it)
+	{
+		if(it != Configuration.begin())
+			ss<<";";
+		ss<<it->first<<"="<<it->second;
+	}
+	return ss.str();
+}
+
+bool CAutoTuner::ParseConfiguration(const std::string& String, TuningConfiguration& Configuration)
+{
+	Configuration.clear();
+
+	stringstream ss(String);
+	string item;
+	while(getline(ss, item, ';'))
+	{
+		size_t eq = item.find('=');
+		if(eq == string::npos || eq == 0)
+			return false;
+		Configuration[item.substr(0, eq)] = atoi(item.substr(eq + 1).c_str());
+	}
+	return !Configuration.empty();
+}
+
+int CAutoTuner::GetValue(const TuningConfiguration& Configuration, const std::string& Name, int Default)
+{
+	TuningConfiguration::const_iterator it = Configuration.find(Name);
+	return (it == Configuration.end()) ? Default : it->second;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,142 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CAUTO_TUNER_H
+#define _CAUTO_TUNER_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include "CommonDefs.h"
+
+#include <map>
+#include <vector>
+#include <string>
+
+//! One point of a tuning space: parameter name -> value (e.g. "LOCAL_SIZE_X" -> 32)
+typedef std::map<std::string, int> TuningConfiguration;
+
+//! Cartesian product of the candidate values of all tuning parameters
+class CTuningSpace
+{
+public:
+	void AddParameter(const std::string& Name, const std::vector<int>& Values);
+
+	size_t GetParameterCount() const { return m_Names.size(); }
+
+	//! Number of configurations, i.e. the product of the number of candidates of each parameter
+	size_t GetSize() const;
+
+	//! Returns the Index-th configuration (0 <= Index < GetSize())
+	TuningConfiguration GetConfiguration(size_t Index) const;
+
+	//! Parameter names joined with ',', part of the tuning database key
+	std::string GetSignature() const;
+
+protected:
+	std::vector<std::string>		m_Names;
+	std::vector<std::vector<int> >	m_Values;
+};
+
+//! Interface of tasks whose launch parameters can be tuned
+class ITunableTask
+{
+public:
+	virtual ~ITunableTask() {};
+
+	//! Identifies the problem (kernel, problem size, ...) the tuning result is valid for
+	virtual std::string GetTuningKey() const = 0;
+
+	//! Runs the kernel(s) with the given configuration and returns the device time in Milliseconds.
+	/*!
+		Called between InitResources() and ReleaseResources(). Returns false if the
+		configuration cannot be launched on this device (see CAutoTuner::FitsDevice()),
+		which simply removes it from the search.
+	*/
+	virtual bool MeasureConfiguration(const TuningConfiguration& Configuration, cl_device_id Device,
+		cl_context Context, cl_command_queue CommandQueue, double& Milliseconds) = 0;
+
+	//! Makes the task use the configuration in the following ComputeGPU() calls
+	virtual void ApplyConfiguration(const TuningConfiguration& Configuration) = 0;
+};
+
+//! Exhaustive search over a CTuningSpace with a persistent result database
+/*!
+	The best configuration is stored per device in a small text file, so the
+	search only runs once per device, driver version and problem. The file
+	defaults to "TuningDB.txt" in the working directory and can be changed
+	with the environment variable GPGPU_TUNING_DB. Setting GPGPU_RETUNE=1
+	ignores stored results and searches again.
+
+	Every line of the database is "<key>\t<NAME=value;NAME=value;...>\t<ms>".
+*/
+class CAutoTuner
+{
+public:
+	CAutoTuner();
+
+	//! Looks up a stored result without measuring anything
+	bool Lookup(const ITunableTask& Task, const CTuningSpace& Space, cl_device_id Device, TuningConfiguration& Best);
+
+	//! Returns the stored result or searches the whole space and stores the fastest configuration
+	bool Tune(ITunableTask& Task, const CTuningSpace& Space, cl_device_id Device,
+		cl_context Context, cl_command_queue CommandQueue, TuningConfiguration& Best);
+
+	//! Checks a work-group size against the kernel's and the device's limits
+	/*!
+		Checks CL_KERNEL_WORK_GROUP_SIZE (which already accounts for register
+		pressure), the per-dimension CL_DEVICE_MAX_WORK_ITEM_SIZES and whether the
+		static local memory of the kernel plus DynamicLocalMem bytes passed as
+		__local kernel arguments fit into CL_DEVICE_LOCAL_MEM_SIZE.
+	*/
+	static bool FitsDevice(cl_kernel Kernel, cl_device_id Device, const size_t* pLocalWorkSize, cl_uint Dimensions, size_t DynamicLocalMem = 0);
+
+	static std::string ConfigurationToString(const TuningConfiguration& Configuration);
+
+	static bool ParseConfiguration(const std::string& String, TuningConfiguration& Configuration);
+
+	//! Returns the value of a parameter, or Default if the configuration does not contain it
+	static int GetValue(const TuningConfiguration& Configuration, const std::string& Name, int Default);
+
+protected:
+	std::string GetDatabaseKey(const ITunableTask& Task, const CTuningSpace& Space, cl_device_id Device) const;
+
+	void LoadDatabase();
+
+	bool SaveDatabase() const;
+
+	struct TuningResult
+	{
+		std::string		Configuration;
+		double			Milliseconds;
+	};
+
+	std::string							m_DatabasePath;
+	bool								m_ForceRetune;
+	bool								m_Loaded;
+	std::map<std::string, TuningResult>	m_Database;
+};
+
+#endif // _CAUTO_TUNER_H
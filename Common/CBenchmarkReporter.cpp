@@ -0,0 +1,381 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CBenchmarkReporter.h"
+#include "CLUtil.h"
+#include "CThreadPool.h"
+#include "CKernelReport.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+bool							CBenchmarkReporter::s_Initialized = false;
+std::string						CBenchmarkReporter::s_OutputPath;
+std::string						CBenchmarkReporter::s_Device = "unknown";
+CDevicePeaks					CBenchmarkReporter::s_Peaks;
+std::vector<CBenchmarkRecord>	CBenchmarkReporter::s_Records;
+
+static std::string EscapeJSON(const std::string& Value)
+{
+	string escaped;
+	for(size_t i = 0; i < Value.size(); i++)
+	{
+		char c = Value[i];
+		if(c == '"' || c == '\\')
+		{
+			escaped += '\\';
+			escaped += c;
+		}
+		else if((unsigned char)c < 0x20)
+		{
+			char code[8];
+			sprintf(code, "\\u%04x", (unsigned int)c);
+			escaped += code;
+		}
+		else
+			escaped += c;
+	}
+	return escaped;
+}
+
+static std::string EscapeCSV(const std::string& Value)
+{
+	if(Value.find_first_of(",\"\n\r") == string::npos)
+		return Value;
+
+	string escaped = "\"";
+	for(size_t i = 0; i < Value.size(); i++)
+	{
+		if(Value[i] == '"')
+			escaped += '"';
+		escaped += Value[i];
+	}
+	return escaped + "\"";
+}
+
+static std::string LocalSizeToString(const size_t LocalSize[3])
+{
+	stringstream ss;
+	ss<<LocalSize[0]<<"x"<<LocalSize[1]<<"x"<<LocalSize[2];
+	return ss.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CBenchmarkRecord
+
+CBenchmarkRecord::CBenchmarkRecord(const std::string& TaskName, const std::string& VariantName, size_t Size)
+	: Task(TaskName), Variant(VariantName), ProblemSize(Size), Timing("average"), Samples(0),
+	MinMs(0.0), MedianMs(0.0), MeanMs(0.0), StdDevMs(0.0), P95Ms(0.0), Bytes(0.0), Elements(double(Size)), Flops(0.0)
+{
+	LocalSize[0] = LocalSize[1] = LocalSize[2] = 1;
+}
+
+void CBenchmarkRecord::SetTime(double AverageMilliseconds, unsigned int Iterations)
+{
+	Timing = "average";
+	Samples = Iterations;
+	MinMs = MedianMs = MeanMs = P95Ms = AverageMilliseconds;
+	StdDevMs = 0.0;
+}
+
+void CBenchmarkRecord::SetTime(const CTimingStatistics& Statistics)
+{
+	Timing = "events";
+	Samples = Statistics.GetSampleCount();
+	MinMs = Statistics.GetMin();
+	MedianMs = Statistics.GetMedian();
+	MeanMs = Statistics.GetMean();
+	StdDevMs = Statistics.GetStdDev();
+	P95Ms = Statistics.GetPercentile(95.0);
+}
+
+void CBenchmarkRecord::SetLocalSize(const size_t* pLocalWorkSize, unsigned int Dimensions)
+{
+	for(unsigned int i = 0; i < 3; i++)
+		LocalSize[i] = (i < Dimensions) ? pLocalWorkSize[i] : 1;
+}
+
+void CBenchmarkRecord::SetCPU()
+{
+	stringstream device;
+	device << "CPU (" << CThreadPool::GetShared().GetThreadCount() << " threads)";
+	Device = device.str();
+}
+
+double CBenchmarkRecord::GetGBPerSecond() const
+{
+	return (MedianMs > 0.0) ? 1.0e-6 * Bytes / MedianMs : 0.0;
+}
+
+double CBenchmarkRecord::GetGFlopsPerSecond() const
+{
+	return (MedianMs > 0.0) ? 1.0e-6 * Flops / MedianMs : 0.0;
+}
+
+double CBenchmarkRecord::GetArithmeticIntensity() const
+{
+	return (Bytes > 0.0) ? Flops / Bytes : 0.0;
+}
+
+double CBenchmarkRecord::GetGElementsPerSecond() const
+{
+	return (MedianMs > 0.0) ? 1.0e-6 * Elements / MedianMs : 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CBenchmarkReporter
+
+void CBenchmarkReporter::InitFromEnvironment()
+{
+	if(s_Initialized)
+		return;
+	s_Initialized = true;
+
+	const char* pEnv = getenv("GPGPU_BENCHMARK_OUTPUT");
+	if(pEnv && *pEnv)
+		s_OutputPath = pEnv;
+}
+
+void CBenchmarkReporter::SetDevice(cl_device_id Device)
+{
+	string name = CLUtil::GetDeviceInfoString(Device, CL_DEVICE_NAME);
+	if(!name.empty())
+		s_Device = name;
+}
+
+void CBenchmarkReporter::SetOutputPath(const std::string& Path)
+{
+	InitFromEnvironment();
+	s_OutputPath = Path;
+}
+
+const std::string& CBenchmarkReporter::GetOutputPath()
+{
+	InitFromEnvironment();
+	return s_OutputPath;
+}
+
+void CBenchmarkReporter::Report(const CBenchmarkRecord& Record)
+{
+	s_Records.push_back(Record);
+	if(s_Records.back().Device.empty())
+	{
+		s_Records.back().Device = s_Device;
+		// the peaks only apply to the OpenCL device, not to the CPU references
+		if(s_Peaks.IsValid())
+			PrintRoofline(s_Records.back(), cout);
+	}
+}
+
+void CBenchmarkReporter::PrintRoofline(const CBenchmarkRecord& Record, std::ostream& Stream)
+{
+	if(Record.Bytes <= 0.0 || Record.MedianMs <= 0.0)
+		return;
+
+	double bandwidth = Record.GetGBPerSecond();
+	Stream<<"  "<<Record.Variant<<": "<<bandwidth<<" GB/s = "<<GetPeakBandwidthPercent(Record)<<"% of peak bandwidth";
+	if(Record.Flops > 0.0)
+	{
+		double intensity = Record.GetArithmeticIntensity();
+		Stream<<", "<<Record.GetGFlopsPerSecond()<<" GFLOP/s = "<<GetPeakFlopsPercent(Record)<<"% of peak"
+			<<", intensity "<<intensity<<" flop/byte";
+		Stream<<(intensity < s_Peaks.GetRidgePoint() ? " (memory-bound)" : " (compute-bound)");
+	}
+	else
+		Stream<<" (memory-bound)";
+	Stream<<endl;
+}
+
+// percentages of the device peaks, 0 if the peaks are unknown or the record was measured on the CPU
+double CBenchmarkReporter::GetPeakBandwidthPercent(const CBenchmarkRecord& Record)
+{
+	if(!s_Peaks.IsValid() || Record.Device != s_Device)
+		return 0.0;
+	return 100.0 * Record.GetGBPerSecond() / s_Peaks.GetBandwidth();
+}
+
+double CBenchmarkReporter::GetPeakFlopsPercent(const CBenchmarkRecord& Record)
+{
+	if(!s_Peaks.IsValid() || Record.Device != s_Device)
+		return 0.0;
+	return 100.0 * Record.GetGFlopsPerSecond() / s_Peaks.GFlops;
+}
+
+void CBenchmarkReporter::Clear()
+{
+	s_Records.clear();
+}
+
+void CBenchmarkReporter::Truncate(size_t Count)
+{
+	if(Count < s_Records.size())
+		s_Records.erase(s_Records.begin() + Count, s_Records.end());
+}
+
+void CBenchmarkReporter::WriteJSON(std::ostream& Stream)
+{
+	Stream<<"{"<<endl<<"  \"schema\": \"gpgpu-benchmark/3\","<<endl;
+	if(s_Peaks.IsValid())
+	{
+		Stream<<"  \"device_peaks\": {"
+			<<"\"copy_gb_per_s\": "<<s_Peaks.CopyGBs<<", "
+			<<"\"scale_gb_per_s\": "<<s_Peaks.ScaleGBs<<", "
+			<<"\"triad_gb_per_s\": "<<s_Peaks.TriadGBs<<", "
+			<<"\"local_gb_per_s\": "<<s_Peaks.LocalGBs<<", "
+			<<"\"gflop_per_s\": "<<s_Peaks.GFlops<<"},"<<endl;
+	}
+	Stream<<"  \"records\": ["<<endl;
+	for(size_t i = 0; i < s_Records.size(); i++)
+	{
+		const CBenchmarkRecord& r = s_Records[i];
+		Stream<<"    {"
+			<<"\"task\": \""<<EscapeJSON(r.Task)<<"\", "
+			<<"\"variant\": \""<<EscapeJSON(r.Variant)<<"\", "
+			<<"\"problem_size\": "<<r.ProblemSize<<", "
+			<<"\"local_size\": ["<<r.LocalSize[0]<<", "<<r.LocalSize[1]<<", "<<r.LocalSize[2]<<"], "
+			<<"\"device\": \""<<EscapeJSON(r.Device)<<"\", "
+			<<"\"timing\": \""<<r.Timing<<"\", "
+			<<"\"samples\": "<<r.Samples<<", "
+			<<"\"min_ms\": "<<r.MinMs<<", "
+			<<"\"median_ms\": "<<r.MedianMs<<", "
+			<<"\"mean_ms\": "<<r.MeanMs<<", "
+			<<"\"stddev_ms\": "<<r.StdDevMs<<", "
+			<<"\"p95_ms\": "<<r.P95Ms<<", "
+			<<"\"bytes\": "<<r.Bytes<<", "
+			<<"\"elements\": "<<r.Elements<<", "
+			<<"\"flops\": "<<r.Flops<<", "
+			<<"\"gb_per_s\": "<<r.GetGBPerSecond()<<", "
+			<<"\"gelem_per_s\": "<<r.GetGElementsPerSecond()<<", "
+			<<"\"gflop_per_s\": "<<r.GetGFlopsPerSecond()<<", "
+			<<"\"arithmetic_intensity\": "<<r.GetArithmeticIntensity()<<", "
+			<<"\"peak_bandwidth_pct\": "<<GetPeakBandwidthPercent(r)<<", "
+			<<"\"peak_flops_pct\": "<<GetPeakFlopsPercent(r)
+			<<"}"<<(i + 1 < s_Records.size() ? "," : "")<<endl;
+	}
+	Stream<<"  ],"<<endl;
+
+	// resources of the built kernels and the estimated occupancy of the launches (see CKernelReport)
+	const vector<CKernelResources>& kernels = CKernelReport::GetKernels();
+	Stream<<"  \"kernels\": ["<<endl;
+	for(size_t i = 0; i < kernels.size(); i++)
+	{
+		const CKernelResources& k = kernels[i];
+		Stream<<"    {"
+			<<"\"kernel\": \""<<EscapeJSON(k.Name)<<"\", "
+			<<"\"device\": \""<<EscapeJSON(k.Device)<<"\", "
+			<<"\"max_work_group_size\": "<<k.MaxWorkGroupSize<<", "
+			<<"\"preferred_multiple\": "<<k.PreferredMultiple<<", "
+			<<"\"local_mem_bytes\": "<<k.LocalMemBytes<<", "
+			<<"\"private_mem_bytes\": "<<k.PrivateMemBytes
+			<<"}"<<(i + 1 < kernels.size() ? "," : "")<<endl;
+	}
+	Stream<<"  ],"<<endl;
+
+	const vector<CKernelOccupancy>& launches = CKernelReport::GetLaunches();
+	Stream<<"  \"launches\": ["<<endl;
+	for(size_t i = 0; i < launches.size(); i++)
+	{
+		const CKernelOccupancy& l = launches[i];
+		Stream<<"    {"
+			<<"\"kernel\": \""<<EscapeJSON(l.Name)<<"\", "
+			<<"\"device\": \""<<EscapeJSON(l.Device)<<"\", "
+			<<"\"global_size\": ["<<l.GlobalSize[0]<<", "<<l.GlobalSize[1]<<", "<<l.GlobalSize[2]<<"], "
+			<<"\"local_size\": ["<<l.LocalSize[0]<<", "<<l.LocalSize[1]<<", "<<l.LocalSize[2]<<"], "
+			<<"\"local_mem_bytes\": "<<l.LocalMemBytes<<", "
+			<<"\"work_groups\": "<<l.NumGroups<<", "
+			<<"\"groups_per_compute_unit\": "<<l.GroupsPerComputeUnit<<", "
+			<<"\"limiter\": \""<<l.Limiter<<"\", "
+			<<"\"occupancy\": "<<l.Occupancy<<", "
+			<<"\"lane_utilization\": "<<l.LaneUtilization<<", "
+			<<"\"warnings\": [";
+		for(size_t w = 0; w < l.Warnings.size(); w++)
+			Stream<<(w > 0 ? ", " : "")<<"\""<<EscapeJSON(l.Warnings[w])<<"\"";
+		Stream<<"]}"<<(i + 1 < launches.size() ? "," : "")<<endl;
+	}
+	Stream<<"  ]"<<endl<<"}"<<endl;
+}
+
+void CBenchmarkReporter::WriteLaunchesCSV(std::ostream& Stream)
+{
+	Stream<<"kernel,device,global_size,local_size,max_work_group_size,preferred_multiple,local_mem_bytes,private_mem_bytes,"
+		<<"work_groups,groups_per_compute_unit,limiter,occupancy,lane_utilization,warnings"<<endl;
+	const vector<CKernelOccupancy>& launches = CKernelReport::GetLaunches();
+	for(size_t i = 0; i < launches.size(); i++)
+	{
+		const CKernelOccupancy& l = launches[i];
+		const CKernelResources* pKernel = CKernelReport::FindKernel(l.Name, l.Device);
+		string warnings;
+		for(size_t w = 0; w < l.Warnings.size(); w++)
+			warnings += (w > 0 ? "; " : "") + l.Warnings[w];
+
+		Stream<<EscapeCSV(l.Name)<<","<<EscapeCSV(l.Device)<<","<<LocalSizeToString(l.GlobalSize)<<","<<LocalSizeToString(l.LocalSize)<<","
+			<<(pKernel ? pKernel->MaxWorkGroupSize : 0)<<","<<(pKernel ? pKernel->PreferredMultiple : 0)<<","
+			<<l.LocalMemBytes<<","<<(pKernel ? pKernel->PrivateMemBytes : 0)<<","
+			<<l.NumGroups<<","<<l.GroupsPerComputeUnit<<","<<l.Limiter<<","<<l.Occupancy<<","<<l.LaneUtilization<<","
+			<<EscapeCSV(warnings)<<endl;
+	}
+}
+
+void CBenchmarkReporter::WriteCSV(std::ostream& Stream)
+{
+	Stream<<"task,variant,problem_size,local_size,device,timing,samples,min_ms,median_ms,mean_ms,stddev_ms,p95_ms,bytes,elements,flops,"
+		<<"gb_per_s,gelem_per_s,gflop_per_s,arithmetic_intensity,peak_bandwidth_pct,peak_flops_pct"<<endl;
+	for(size_t i = 0; i < s_Records.size(); i++)
+	{
+		const CBenchmarkRecord& r = s_Records[i];
+		Stream<<EscapeCSV(r.Task)<<","<<EscapeCSV(r.Variant)<<","<<r.ProblemSize<<","<<LocalSizeToString(r.LocalSize)<<","
+			<<EscapeCSV(r.Device)<<","<<r.Timing<<","<<r.Samples<<","
+			<<r.MinMs<<","<<r.MedianMs<<","<<r.MeanMs<<","<<r.StdDevMs<<","<<r.P95Ms<<","
+			<<r.Bytes<<","<<r.Elements<<","<<r.Flops<<","<<r.GetGBPerSecond()<<","<<r.GetGElementsPerSecond()<<","
+			<<r.GetGFlopsPerSecond()<<","<<r.GetArithmeticIntensity()<<","<<GetPeakBandwidthPercent(r)<<","<<GetPeakFlopsPercent(r)<<endl;
+	}
+}
+
+bool CBenchmarkReporter::Flush()
+{
+	InitFromEnvironment();
+	if(s_OutputPath.empty() || s_Records.empty())
+		return true;
+
+	ofstream file(s_OutputPath.c_str(), ios::trunc);
+	if(!file.is_open())
+	{
+		cerr<<"Failed to write the benchmark results to '"<<s_OutputPath<<"'."<<endl;
+		return false;
+	}
+
+	// enough digits for sub-microsecond timings and byte counts of large arrays
+	file<<setprecision(10);
+
+	bool csv = s_OutputPath.size() >= 4 && s_OutputPath.compare(s_OutputPath.size() - 4, 4, ".csv") == 0;
+	if(csv)
+		WriteCSV(file);
+	else
+		WriteJSON(file);
+
+	cout<<"Wrote "<<s_Records.size()<<" benchmark records to "<<s_OutputPath<<endl;
+	if(!csv || CKernelReport::GetLaunches().empty())
+		return file.good();
+
+	// a CSV file holds a single table: the launch configurations go next to it
+	string launchesPath = s_OutputPath.substr(0, s_OutputPath.size() - 4) + "_launches.csv";
+	ofstream launchesFile(launchesPath.c_str(), ios::trunc);
+	if(!launchesFile.is_open())
+	{
+		cerr<<"Failed to write the kernel launch report to '"<<launchesPath<<"'."<<endl;
+		return false;
+	}
+	launchesFile<<setprecision(10);
+	WriteLaunchesCSV(launchesFile);
+	cout<<"Wrote "<<CKernelReport::GetLaunches().size()<<" kernel launch configurations to "<<launchesPath<<endl;
+	return file.good() && launchesFile.good();
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,157 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CBENCHMARK_REPORTER_H
+#define _CBENCHMARK_REPORTER_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include "CTimingStatistics.h"
+#include "CMicrobenchmarks.h"
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+//! One measurement of one kernel variant
+/*!
+	Bytes is the compulsory global memory traffic of a single run (every input
+	read once, every output written once), so GB/s can be compared against the
+	peak bandwidth of the device regardless of how often a variant re-reads its
+	data. Elements is the number of items processed per run (array elements,
+	pixels, particles, ...). Flops counts the arithmetic operations of a single
+	run that the algorithm needs (integer additions count as well), so
+	Flops / Bytes is the arithmetic intensity of the task.
+*/
+struct CBenchmarkRecord
+{
+	CBenchmarkRecord(const std::string& TaskName, const std::string& VariantName, size_t Size);
+
+	//! Average over Iterations runs (CLUtil::ProfileKernel(), host timers): only the mean is known
+	void SetTime(double AverageMilliseconds, unsigned int Iterations);
+
+	//! Statistics of individually profiled runs (must be evaluated)
+	void SetTime(const CTimingStatistics& Statistics);
+
+	void SetLocalSize(const size_t* pLocalWorkSize, unsigned int Dimensions);
+
+	//! Marks the record as a CPU reference measurement: the device is "CPU (<n> threads)"
+	//! with the thread count of the shared CThreadPool
+	void SetCPU();
+
+	//! Throughput based on the median time
+	double GetGBPerSecond() const;
+	double GetGElementsPerSecond() const;
+	double GetGFlopsPerSecond() const;
+
+	//! Flops per byte of compulsory memory traffic
+	double GetArithmeticIntensity() const;
+
+	std::string		Task;
+	std::string		Variant;
+	size_t			ProblemSize;
+	size_t			LocalSize[3];
+	//! "events" for statistics of individual runs, "average" if only the mean is known
+	std::string		Timing;
+	size_t			Samples;
+	double			MinMs;
+	double			MedianMs;
+	double			MeanMs;
+	double			StdDevMs;
+	double			P95Ms;
+	double			Bytes;
+	double			Elements;
+	double			Flops;
+	//! Filled in by CBenchmarkReporter::Report() if left empty
+	std::string		Device;
+};
+
+//! Central sink for the performance results of all tasks
+/*!
+	Tasks create a CBenchmarkRecord for every variant they time and pass it to
+	Report(); the console output of the tasks stays as it is. Flush() writes all
+	records collected so far, CAssignmentBase calls it after DoCompute().
+
+	If the peaks of the device are known (SetDevicePeaks(), see
+	CMicrobenchmarks), Report() prints the achieved fraction of the peak
+	bandwidth and throughput of every GPU record and whether its arithmetic
+	intensity makes it memory- or compute-bound.
+
+	The output file is set with SetOutputPath() or the environment variable
+	GPGPU_BENCHMARK_OUTPUT. Files ending in ".csv" are written as CSV (one row
+	per record, with a header), everything else as JSON. Without an output
+	file the records are only collected. The resources of the built kernels and
+	the estimated occupancy of their launches (CKernelReport) are written as
+	well: into the JSON file or into "<name>_launches.csv".
+*/
+class CBenchmarkReporter
+{
+public:
+	//! Stores the name of the device the following records were measured on
+	static void SetDevice(cl_device_id Device);
+
+	//! Measured ceilings of the device set with SetDevice()
+	static void SetDevicePeaks(const CDevicePeaks& Peaks) { s_Peaks = Peaks; }
+	static const CDevicePeaks& GetDevicePeaks() { return s_Peaks; }
+
+	//! Prints achieved bandwidth and throughput of a record relative to the device peaks
+	static void PrintRoofline(const CBenchmarkRecord& Record, std::ostream& Stream);
+
+	static void SetOutputPath(const std::string& Path);
+	static const std::string& GetOutputPath();
+
+	static void Report(const CBenchmarkRecord& Record);
+
+	static const std::vector<CBenchmarkRecord>& GetRecords() { return s_Records; }
+
+	static void Clear();
+
+	//! Drops all records after the first Count, e.g. those of warm-up runs
+	static void Truncate(size_t Count);
+
+	//! Writes all records to the output file (overwriting it). Returns false on I/O errors.
+	static bool Flush();
+
+	static void WriteJSON(std::ostream& Stream);
+	static void WriteCSV(std::ostream& Stream);
+
+	//! The launch configurations of CKernelReport, written next to a CSV output file ("<name>_launches.csv")
+	static void WriteLaunchesCSV(std::ostream& Stream);
+
+protected:
+	static void InitFromEnvironment();
+
+	static double GetPeakBandwidthPercent(const CBenchmarkRecord& Record);
+	static double GetPeakFlopsPercent(const CBenchmarkRecord& Record);
+
+	static bool							s_Initialized;
+	static std::string					s_OutputPath;
+	static std::string					s_Device;
+	static CDevicePeaks					s_Peaks;
+	static std::vector<CBenchmarkRecord>	s_Records;
+};
+
+#endif // _CBENCHMARK_REPORTER_H
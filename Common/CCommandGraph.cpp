@@ -0,0 +1,373 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CCommandGraph.h"
+
+#include "CLUtil.h"
+#include "CTimer.h"
+#include "CTracer.h"
+#include "CKernelReport.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+// in-order queues used if the device has no out-of-order queue: enough for the three color channels
+static const size_t		c_DefaultQueueCount = 3;
+
+///////////////////////////////////////////////////////////////////////////////
+// CCommandGraph
+
+CCommandGraph::CCommandGraph()
+	: m_Context(nullptr), m_OutOfOrder(false), m_Profiling(false), m_NextQueue(0)
+{
+}
+
+CCommandGraph::~CCommandGraph()
+{
+	Release();
+}
+
+bool CCommandGraph::Init(cl_command_queue CommandQueue)
+{
+	Release();
+
+	cl_device_id device;
+	cl_command_queue_properties properties = 0;
+	V_RETURN_FALSE_CL(clGetCommandQueueInfo(CommandQueue, CL_QUEUE_CONTEXT, sizeof(cl_context), &m_Context, NULL), "Failed to query the queue context.");
+	V_RETURN_FALSE_CL(clGetCommandQueueInfo(CommandQueue, CL_QUEUE_DEVICE, sizeof(cl_device_id), &device, NULL), "Failed to query the queue device.");
+	V_RETURN_FALSE_CL(clGetCommandQueueInfo(CommandQueue, CL_QUEUE_PROPERTIES, sizeof(properties), &properties, NULL), "Failed to query the queue properties.");
+	m_Profiling = (properties & CL_QUEUE_PROFILING_ENABLE) != 0;
+
+	cl_command_queue_properties deviceProperties = 0;
+	clGetDeviceInfo(device, CL_DEVICE_QUEUE_PROPERTIES, sizeof(deviceProperties), &deviceProperties, NULL);
+
+	size_t numQueues = 0;
+	const char* pEnv = getenv("GPGPU_GRAPH_QUEUES");
+	if(pEnv && *pEnv)
+		numQueues = (size_t)max(1, atoi(pEnv));
+
+	cl_command_queue_properties queueProperties = m_Profiling ? CL_QUEUE_PROFILING_ENABLE : 0;
+	cl_int clError;
+	if(numQueues == 0 && (deviceProperties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE))
+	{
+		cl_command_queue queue = clCreateCommandQueue(m_Context, device, queueProperties | CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE, &clError);
+		if(clError == CL_SUCCESS)
+		{
+			m_Queues.push_back(queue);
+			m_OutOfOrder = true;
+			return true;
+		}
+	}
+
+	if(numQueues == 0)
+		numQueues = c_DefaultQueueCount;
+	for(size_t i = 0; i < numQueues; i++)
+	{
+		cl_command_queue queue = clCreateCommandQueue(m_Context, device, queueProperties, &clError);
+		V_RETURN_FALSE_CL(clError, "Failed to create a command queue for the graph.");
+		m_Queues.push_back(queue);
+	}
+	return true;
+}
+
+void CCommandGraph::Release()
+{
+	if(!m_Passes.empty())
+		Finish();
+
+	for(size_t i = 0; i < m_Queues.size(); i++)
+		clReleaseCommandQueue(m_Queues[i]);
+	m_Queues.clear();
+	m_Nodes.clear();
+	m_OutOfOrder = false;
+	m_NextQueue = 0;
+}
+
+int CCommandGraph::AddNode(CNode& Node, const std::vector<int>& Dependencies)
+{
+	if(m_Queues.empty())
+	{
+		cerr << "Error: the command graph has to be initialized before adding '" << Node.Name << "'." << endl;
+		return -1;
+	}
+
+	int id = (int)m_Nodes.size();
+	for(size_t i = 0; i < Dependencies.size(); i++)
+	{
+		// this also rules out cycles
+		if(Dependencies[i] < 0 || Dependencies[i] >= id)
+		{
+			cerr << "Error: invalid dependency " << Dependencies[i] << " of graph node '" << Node.Name << "'." << endl;
+			return -1;
+		}
+	}
+	Node.Dependencies = Dependencies;
+	Node.Successors = 0;
+
+	// continue a branch on its queue, start new branches on the next queue
+	if(!Dependencies.empty() && m_Nodes[Dependencies[0]].Successors == 0)
+		Node.Queue = m_Nodes[Dependencies[0]].Queue;
+	else
+		Node.Queue = m_NextQueue++ % m_Queues.size();
+
+	for(size_t i = 0; i < Dependencies.size(); i++)
+		m_Nodes[Dependencies[i]].Successors++;
+
+	m_Nodes.push_back(Node);
+	return id;
+}
+
+int CCommandGraph::AddKernel(const std::string& Name, cl_kernel Kernel, cl_uint Dimensions,
+	const size_t* pGlobalWorkSize, const size_t* pLocalWorkSize, const std::vector<int>& Dependencies)
+{
+	CNode node = CNode();
+	node.Type = NODE_KERNEL;
+	node.Name = Name;
+	node.Kernel = Kernel;
+	node.Dimensions = min(Dimensions, (cl_uint)3);
+	node.HasLocalWorkSize = pLocalWorkSize != nullptr;
+	for(cl_uint i = 0; i < node.Dimensions; i++)
+	{
+		node.GlobalWorkSize[i] = pGlobalWorkSize[i];
+		node.LocalWorkSize[i] = pLocalWorkSize ? pLocalWorkSize[i] : 0;
+	}
+	return AddNode(node, Dependencies);
+}
+
+bool CCommandGraph::SetKernelArg(int Node, cl_uint Index, size_t Size, const void* pValue)
+{
+	if(Node < 0 || Node >= (int)m_Nodes.size() || m_Nodes[Node].Type != NODE_KERNEL)
+		return false;
+
+	CKernelArg arg;
+	arg.Index = Index;
+	arg.IsNull = pValue == nullptr;
+	arg.Value.resize(Size);
+	if(pValue)
+		memcpy(&arg.Value[0], pValue, Size);
+	m_Nodes[Node].Args.push_back(arg);
+	return true;
+}
+
+int CCommandGraph::AddRead(const std::string& Name, cl_mem Buffer, size_t Offset, size_t Size, void* pHostPtr,
+	const std::vector<int>& Dependencies)
+{
+	CNode node = CNode();
+	node.Type = NODE_READ;
+	node.Name = Name;
+	node.Buffer = Buffer;
+	node.Offset = Offset;
+	node.Size = Size;
+	node.pHostPtr = pHostPtr;
+	return AddNode(node, Dependencies);
+}
+
+int CCommandGraph::AddWrite(const std::string& Name, cl_mem Buffer, size_t Offset, size_t Size, const void* pHostPtr,
+	const std::vector<int>& Dependencies)
+{
+	CNode node = CNode();
+	node.Type = NODE_WRITE;
+	node.Name = Name;
+	node.Buffer = Buffer;
+	node.Offset = Offset;
+	node.Size = Size;
+	node.pHostPtr = const_cast<void*>(pHostPtr);
+	return AddNode(node, Dependencies);
+}
+
+int CCommandGraph::AddCopy(const std::string& Name, cl_mem Source, cl_mem Destination, size_t Size,
+	const std::vector<int>& Dependencies)
+{
+	CNode node = CNode();
+	node.Type = NODE_COPY;
+	node.Name = Name;
+	node.Buffer = Source;
+	node.Destination = Destination;
+	node.Size = Size;
+	return AddNode(node, Dependencies);
+}
+
+cl_int CCommandGraph::EnqueueNode(const CNode& Node, cl_uint NumEvents, const cl_event* pWaitList, cl_event* pEvent)
+{
+	cl_command_queue queue = m_Queues[Node.Queue];
+	switch(Node.Type)
+	{
+	case NODE_KERNEL:
+		{
+			cl_int clError = CL_SUCCESS;
+			for(size_t i = 0; i < Node.Args.size(); i++)
+			{
+				const CKernelArg& arg = Node.Args[i];
+				clError |= clSetKernelArg(Node.Kernel, arg.Index, arg.Value.size(), arg.IsNull ? NULL : &arg.Value[0]);
+			}
+			if(clError != CL_SUCCESS)
+				return clError;
+			return clEnqueueNDRangeKernel(queue, Node.Kernel, Node.Dimensions, NULL, Node.GlobalWorkSize,
+				Node.HasLocalWorkSize ? Node.LocalWorkSize : NULL, NumEvents, pWaitList, pEvent);
+		}
+	case NODE_READ:
+		return clEnqueueReadBuffer(queue, Node.Buffer, CL_FALSE, Node.Offset, Node.Size, Node.pHostPtr, NumEvents, pWaitList, pEvent);
+	case NODE_WRITE:
+		return clEnqueueWriteBuffer(queue, Node.Buffer, CL_FALSE, Node.Offset, Node.Size, Node.pHostPtr, NumEvents, pWaitList, pEvent);
+	case NODE_COPY:
+		return clEnqueueCopyBuffer(queue, Node.Buffer, Node.Destination, 0, 0, Node.Size, NumEvents, pWaitList, pEvent);
+	}
+	return CL_INVALID_VALUE;
+}
+
+bool CCommandGraph::Enqueue()
+{
+	// the first nodes of this pass wait for the last nodes of the previous one
+	vector<cl_event> previousSinks;
+	if(!m_Passes.empty())
+	{
+		const vector<cl_event>& previous = m_Passes.back();
+		for(size_t i = 0; i < m_Nodes.size(); i++)
+			if(m_Nodes[i].Successors == 0)
+				previousSinks.push_back(previous[i]);
+	}
+
+	m_Passes.push_back(vector<cl_event>(m_Nodes.size(), (cl_event)nullptr));
+	vector<cl_event>& events = m_Passes.back();
+
+	vector<cl_event> waitList;
+	for(size_t i = 0; i < m_Nodes.size(); i++)
+	{
+		CNode& node = m_Nodes[i];
+		if(node.Dependencies.empty())
+			waitList = previousSinks;
+		else
+		{
+			waitList.clear();
+			for(size_t j = 0; j < node.Dependencies.size(); j++)
+				waitList.push_back(events[node.Dependencies[j]]);
+		}
+
+		cl_int clError = EnqueueNode(node, (cl_uint)waitList.size(), waitList.empty() ? NULL : &waitList[0], &events[i]);
+		if(clError != CL_SUCCESS)
+		{
+			cerr << "Error: failed to enqueue graph node '" << node.Name << "' [" << CLUtil::GetCLErrorString(clError) << "]" << endl;
+			return false;
+		}
+		TRACE_CL_EVENT(CTracer::Intern(node.Name), events[i]);
+
+		// only now the arguments of the node are set
+		if(node.Type == NODE_KERNEL && !node.Analyzed)
+		{
+			CKernelReport::Analyze(node.Kernel, m_Queues[node.Queue], node.Dimensions, node.GlobalWorkSize,
+				node.HasLocalWorkSize ? node.LocalWorkSize : NULL);
+			node.Analyzed = true;
+		}
+	}
+
+	// independent branches only overlap if all queues are submitted
+	for(size_t i = 0; i < m_Queues.size(); i++)
+		clFlush(m_Queues[i]);
+
+	return true;
+}
+
+void CCommandGraph::ReleasePass(std::vector<cl_event>& Events)
+{
+	for(size_t i = 0; i < Events.size(); i++)
+		if(Events[i])
+			clReleaseEvent(Events[i]);
+	Events.clear();
+}
+
+bool CCommandGraph::Finish()
+{
+	cl_int clError = CL_SUCCESS;
+	for(size_t i = 0; i < m_Queues.size(); i++)
+		clError |= clFinish(m_Queues[i]);
+
+	for(size_t p = 0; p < m_Passes.size(); p++)
+	{
+		vector<cl_event>& events = m_Passes[p];
+		if(m_Profiling && clError == CL_SUCCESS)
+		{
+			cl_ulong first = ~(cl_ulong)0, last = 0;
+			bool valid = !events.empty();
+			for(size_t i = 0; i < events.size() && valid; i++)
+			{
+				cl_ulong start, end;
+				valid = events[i] &&
+					clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL) == CL_SUCCESS &&
+					clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL) == CL_SUCCESS;
+				if(valid)
+				{
+					first = min(first, start);
+					last = max(last, end);
+				}
+			}
+			if(valid)
+				m_PassTimes.AddSample(double(last - first) * 1.0e-6);
+		}
+		ReleasePass(events);
+	}
+	m_Passes.clear();
+
+	V_RETURN_FALSE_CL(clError, "Failed to execute the command graph.");
+	return true;
+}
+
+bool CCommandGraph::Run(int NIterations, double& Milliseconds)
+{
+	// one warm-up pass, which is not measured
+	if(!Enqueue() || !Finish())
+		return false;
+	m_PassTimes.Clear();
+
+	CTimer timer;
+	timer.Start();
+	for(int i = 0; i < NIterations; i++)
+	{
+		if(!Enqueue())
+		{
+			Finish();
+			return false;
+		}
+	}
+	if(!Finish())
+		return false;
+	timer.Stop();
+
+	m_PassTimes.Evaluate();
+	if(m_PassTimes.GetSampleCount() > 0)
+		Milliseconds = m_PassTimes.GetMean();
+	else
+		Milliseconds = timer.GetElapsedMilliseconds() / double(max(NIterations, 1));
+	return true;
+}
+
+void CCommandGraph::Print(std::ostream& Stream) const
+{
+	Stream << "Command graph: " << m_Nodes.size() << " nodes on ";
+	if(m_OutOfOrder)
+		Stream << "an out-of-order queue" << endl;
+	else
+		Stream << m_Queues.size() << " in-order queues" << endl;
+
+	for(size_t i = 0; i < m_Nodes.size(); i++)
+	{
+		const CNode& node = m_Nodes[i];
+		Stream << "  [" << i << "] " << node.Name;
+		if(!m_OutOfOrder)
+			Stream << " (queue " << node.Queue << ")";
+		if(!node.Dependencies.empty())
+		{
+			Stream << " <-";
+			for(size_t j = 0; j < node.Dependencies.size(); j++)
+				Stream << " " << node.Dependencies[j];
+		}
+		Stream << endl;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
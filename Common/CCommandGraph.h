@@ -0,0 +1,168 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CCOMMAND_GRAPH_H
+#define _CCOMMAND_GRAPH_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include "CommonDefs.h"
+#include "CTimingStatistics.h"
+
+#include <string>
+#include <vector>
+
+//! A small DAG of kernel launches and buffer transfers, connected by cl_events
+/*!
+	Nodes are added in a topological order: a node can only depend on nodes
+	that were added before it. Each node waits for the events of its
+	dependencies only, so independent branches (e.g. the color channels of an
+	image) are free to run concurrently and the host never calls clFinish()
+	between them.
+
+	The graph runs on an out-of-order queue if the device supports one, and on
+	a few in-order queues otherwise. A node without dependencies starts a new
+	branch on the next queue, a node continues on the queue of its first
+	dependency if it is the first one to do so. The environment variable
+	GPGPU_GRAPH_QUEUES=N forces N in-order queues (1 serializes the graph).
+
+	Kernel arguments that differ between nodes sharing one cl_kernel are
+	stored with SetKernelArg() and applied right before the launch (OpenCL
+	captures the arguments at enqueue time). Passes enqueued back to back are
+	ordered: the first nodes of a pass wait for the last nodes of the previous
+	one.
+
+	The graph uses its own queues, work in other queues has to be finished before.
+*/
+class CCommandGraph
+{
+public:
+	CCommandGraph();
+	~CCommandGraph();
+
+	//! Creates the queues in the context and device of CommandQueue, with the same profiling mode
+	bool Init(cl_command_queue CommandQueue);
+
+	void Release();
+
+	int AddKernel(const std::string& Name, cl_kernel Kernel, cl_uint Dimensions,
+		const size_t* pGlobalWorkSize, const size_t* pLocalWorkSize,
+		const std::vector<int>& Dependencies = std::vector<int>());
+
+	//! Argument of a kernel node, applied right before each launch of that node
+	bool SetKernelArg(int Node, cl_uint Index, size_t Size, const void* pValue);
+
+	int AddRead(const std::string& Name, cl_mem Buffer, size_t Offset, size_t Size, void* pHostPtr,
+		const std::vector<int>& Dependencies = std::vector<int>());
+
+	int AddWrite(const std::string& Name, cl_mem Buffer, size_t Offset, size_t Size, const void* pHostPtr,
+		const std::vector<int>& Dependencies = std::vector<int>());
+
+	int AddCopy(const std::string& Name, cl_mem Source, cl_mem Destination, size_t Size,
+		const std::vector<int>& Dependencies = std::vector<int>());
+
+	//! Enqueues one pass of the whole graph without waiting for it
+	bool Enqueue();
+
+	//! Waits for all enqueued passes and evaluates their timings
+	bool Finish();
+
+	//! Enqueues NIterations passes and waits once. Milliseconds is the average time of one pass.
+	bool Run(int NIterations, double& Milliseconds);
+
+	//! Time from the first start to the last end of the device commands of each pass (if profiling is enabled)
+	const CTimingStatistics& GetPassTimes() const { return m_PassTimes; }
+
+	size_t GetNodeCount() const { return m_Nodes.size(); }
+	size_t GetQueueCount() const { return m_Queues.size(); }
+	bool IsOutOfOrder() const { return m_OutOfOrder; }
+
+	//! Prints the nodes with their queues and dependencies
+	void Print(std::ostream& Stream) const;
+
+protected:
+	enum ENodeType
+	{
+		NODE_KERNEL,
+		NODE_READ,
+		NODE_WRITE,
+		NODE_COPY
+	};
+
+	struct CKernelArg
+	{
+		cl_uint						Index;
+		std::vector<unsigned char>	Value;
+		// __local memory arguments are passed with a NULL pointer
+		bool						IsNull;
+	};
+
+	struct CNode
+	{
+		ENodeType				Type;
+		std::string				Name;
+		std::vector<int>		Dependencies;
+		size_t					Queue;
+		// the number of nodes that depend on this one
+		int						Successors;
+
+		cl_kernel				Kernel;
+		cl_uint					Dimensions;
+		size_t					GlobalWorkSize[3];
+		size_t					LocalWorkSize[3];
+		// the launch configuration was passed to CKernelReport
+		bool					Analyzed;
+		bool					HasLocalWorkSize;
+		std::vector<CKernelArg>	Args;
+
+		cl_mem					Buffer;
+		cl_mem					Destination;
+		size_t					Offset;
+		size_t					Size;
+		void*					pHostPtr;
+	};
+
+	int AddNode(CNode& Node, const std::vector<int>& Dependencies);
+
+	cl_int EnqueueNode(const CNode& Node, cl_uint NumEvents, const cl_event* pWaitList, cl_event* pEvent);
+
+	void ReleasePass(std::vector<cl_event>& Events);
+
+	cl_context						m_Context;
+	std::vector<cl_command_queue>	m_Queues;
+	bool							m_OutOfOrder;
+	bool							m_Profiling;
+	size_t							m_NextQueue;
+
+	std::vector<CNode>				m_Nodes;
+
+	// one event per node and enqueued pass, until Finish()
+	std::vector<std::vector<cl_event> >	m_Passes;
+
+	CTimingStatistics				m_PassTimes;
+};
+
+#endif // _CCOMMAND_GRAPH_H
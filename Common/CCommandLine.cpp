@@ -0,0 +1,229 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CCommandLine.h"
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cctype>
+#include <climits>
+#include <algorithm>
+
+using namespace std;
+
+static std::vector<std::string> Split(const std::string& String, char Separator)
+{
+	vector<string> items;
+	stringstream ss(String);
+	string item;
+	while(getline(ss, item, Separator))
+		if(!item.empty())
+			items.push_back(item);
+	return items;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CCommandLine
+
+bool CCommandLine::Parse(int argc, char** argv, const std::vector<std::string>& KnownOptions)
+{
+	for(int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if(arg.compare(0, 2, "--") != 0)
+		{
+			cerr<<"Unexpected argument '"<<arg<<"', options start with '--'."<<endl;
+			return false;
+		}
+
+		size_t eq = arg.find('=');
+		string name = arg.substr(2, (eq == string::npos) ? string::npos : eq - 2);
+		if(find(KnownOptions.begin(), KnownOptions.end(), name) == KnownOptions.end())
+		{
+			// a typo must not silently run with the default
+			cerr<<"Unknown option '--"<<name<<"', use --help to see the available options."<<endl;
+			return false;
+		}
+
+		if(eq != string::npos)
+			m_Options[name] = arg.substr(eq + 1);
+		else if(i + 1 < argc && string(argv[i + 1]).compare(0, 2, "--") != 0)
+			m_Options[name] = argv[++i];
+		else
+			m_Options[name] = "";
+	}
+	return true;
+}
+
+bool CCommandLine::Has(const std::string& Name) const
+{
+	return m_Options.find(Name) != m_Options.end();
+}
+
+std::string CCommandLine::GetString(const std::string& Name, const std::string& Default) const
+{
+	map<string, string>::const_iterator it = m_Options.find(Name);
+	return (it == m_Options.end()) ? Default : it->second;
+}
+
+bool CCommandLine::GetUInt(const std::string& Name, unsigned int& Value) const
+{
+	if(!Has(Name))
+		return true;
+
+	size_t value;
+	if(!ParseSize(GetString(Name), value) || value > UINT_MAX)
+	{
+		cerr<<"Invalid value '"<<GetString(Name)<<"' for --"<<Name<<", expected a number."<<endl;
+		return false;
+	}
+	Value = (unsigned int)value;
+	return true;
+}
+
+std::vector<std::string> CCommandLine::GetList(const std::string& Name) const
+{
+	return Split(GetString(Name), ',');
+}
+
+bool CCommandLine::ParseSize(const std::string& String, size_t& Size)
+{
+	if(String.empty())
+		return false;
+
+	char* pEnd = nullptr;
+	unsigned long long value = strtoull(String.c_str(), &pEnd, 10);
+	if(pEnd == String.c_str())
+		return false;
+
+	string suffix = pEnd;
+	if(suffix == "K" || suffix == "k")
+		value <<= 10;
+	else if(suffix == "M" || suffix == "m")
+		value <<= 20;
+	else if(suffix == "G" || suffix == "g")
+		value <<= 30;
+	else if(!suffix.empty())
+		return false;
+
+	Size = (size_t)value;
+	return true;
+}
+
+std::string CCommandLine::SizeToString(size_t Size)
+{
+	stringstream ss;
+	if(Size >= (1 << 30) && Size % (1 << 30) == 0)
+		ss<<(Size >> 30)<<"G";
+	else if(Size >= (1 << 20) && Size % (1 << 20) == 0)
+		ss<<(Size >> 20)<<"M";
+	else if(Size >= (1 << 10) && Size % (1 << 10) == 0)
+		ss<<(Size >> 10)<<"K";
+	else
+		ss<<Size;
+	return ss.str();
+}
+
+bool CCommandLine::GetSizes(const std::string& Name, size_t MaxSize, std::vector<size_t>& Sizes) const
+{
+	Sizes.clear();
+
+	vector<string> items = GetList(Name);
+	for(size_t i = 0; i < items.size(); i++)
+	{
+		size_t range = items[i].find("..");
+		if(range == string::npos)
+		{
+			size_t size;
+			if(!ParseSize(items[i], size))
+				return false;
+			Sizes.push_back(size);
+			continue;
+		}
+
+		// geometric sweep first..last[:factor]
+		string last = items[i].substr(range + 2);
+		size_t factor = 2;
+		size_t colon = last.find(':');
+		if(colon != string::npos)
+		{
+			if(!ParseSize(last.substr(colon + 1), factor) || factor < 2)
+				return false;
+			last = last.substr(0, colon);
+		}
+
+		size_t first, end;
+		if(!ParseSize(items[i].substr(0, range), first) || first == 0)
+			return false;
+		if(last == "max")
+			end = MaxSize;
+		else if(!ParseSize(last, end))
+			return false;
+
+		for(size_t size = first; size <= end; size *= factor)
+		{
+			Sizes.push_back(size);
+			if(size > end / factor)
+				break;
+		}
+	}
+
+	return !Sizes.empty();
+}
+
+bool CCommandLine::GetLocalWorkSize(const std::string& Name, size_t LocalWorkSize[3]) const
+{
+	return ParseLocalWorkSize(GetString(Name), LocalWorkSize);
+}
+
+bool CCommandLine::ParseLocalWorkSize(const std::string& String, size_t LocalWorkSize[3], unsigned int* pDimensions)
+{
+	vector<string> dims = Split(String, 'x');
+	if(dims.empty() || dims.size() > 3)
+		return false;
+
+	for(size_t i = 0; i < 3; i++)
+	{
+		LocalWorkSize[i] = 1;
+		if(i < dims.size() && (!ParseSize(dims[i], LocalWorkSize[i]) || LocalWorkSize[i] == 0))
+			return false;
+	}
+	if(pDimensions)
+		*pDimensions = (unsigned int)dims.size();
+	return true;
+}
+
+bool CCommandLine::MatchPattern(const std::string& Pattern, const std::string& Name)
+{
+	// iterative matching, backtracking only to the last '*'
+	size_t p = 0, n = 0;
+	size_t starP = string::npos, starN = 0;
+	while(n < Name.size())
+	{
+		if(p < Pattern.size() && (Pattern[p] == '?' || tolower((unsigned char)Pattern[p]) == tolower((unsigned char)Name[n])))
+		{
+			p++;
+			n++;
+		}
+		else if(p < Pattern.size() && Pattern[p] == '*')
+		{
+			starP = p++;
+			starN = n;
+		}
+		else if(starP != string::npos)
+		{
+			p = starP + 1;
+			n = ++starN;
+		}
+		else
+			return false;
+	}
+	while(p < Pattern.size() && Pattern[p] == '*')
+		p++;
+	return p == Pattern.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
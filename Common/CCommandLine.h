@@ -0,0 +1,70 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CCOMMAND_LINE_H
+#define _CCOMMAND_LINE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+//! Minimal parser for "--name=value", "--name value" and "--flag" arguments
+/*!
+	Sizes accept the suffixes K, M and G (powers of 1024), e.g. "16M".
+	Size lists are comma separated and may contain geometric sweeps:
+	"1K..64M" doubles the size from 1K up to 64M, "1K..max:4" multiplies it
+	by 4 up to the limit passed by the caller (e.g. what fits into device memory).
+*/
+class CCommandLine
+{
+public:
+	//! Returns false (with a message) for arguments that are no options or not in KnownOptions
+	bool Parse(int argc, char** argv, const std::vector<std::string>& KnownOptions);
+
+	bool Has(const std::string& Name) const;
+
+	std::string GetString(const std::string& Name, const std::string& Default = "") const;
+
+	//! Leaves Value unchanged if the option is missing, returns false (with a message) if it is no number
+	bool GetUInt(const std::string& Name, unsigned int& Value) const;
+
+	//! Splits a comma separated value, empty if the option is missing
+	std::vector<std::string> GetList(const std::string& Name) const;
+
+	//! Expands a size list, MaxSize is the value of "max". Returns false on syntax errors.
+	bool GetSizes(const std::string& Name, size_t MaxSize, std::vector<size_t>& Sizes) const;
+
+	//! Parses "256", "16x16" or "8x8x4", missing dimensions are set to 1
+	bool GetLocalWorkSize(const std::string& Name, size_t LocalWorkSize[3]) const;
+
+	static bool ParseSize(const std::string& String, size_t& Size);
+
+	//! The parser of GetLocalWorkSize(), optionally returns the number of given dimensions
+	static bool ParseLocalWorkSize(const std::string& String, size_t LocalWorkSize[3], unsigned int* pDimensions = nullptr);
+
+	//! Case-insensitive wildcard match, '*' matches any sequence and '?' any single character
+	static bool MatchPattern(const std::string& Pattern, const std::string& Name);
+
+	static std::string SizeToString(size_t Size);
+
+protected:
+	std::map<std::string, std::string>	m_Options;
+};
+
+#endif // _CCOMMAND_LINE_H
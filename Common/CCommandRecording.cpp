@@ -0,0 +1,367 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CCommandRecording.h"
+
+#include "CLUtil.h"
+#include "CTracer.h"
+#include "CKernelReport.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+// The subset of cl_khr_command_buffer that is used here. The OpenCL headers of the
+// course do not know the extension, so the entry points are loaded at runtime.
+typedef struct _cl_command_buffer_khr* cl_command_buffer_khr;
+typedef cl_uint cl_sync_point_khr;
+typedef cl_ulong cl_command_buffer_properties_khr;
+typedef struct _cl_mutable_command_khr* cl_mutable_command_khr;
+
+#define GPGPU_COMMAND_BUFFER_FLAGS_KHR						0x1293
+#define GPGPU_COMMAND_BUFFER_SIMULTANEOUS_USE_KHR			(1 << 0)
+#define GPGPU_DEVICE_COMMAND_BUFFER_CAPABILITIES_KHR		0x12A9
+#define GPGPU_COMMAND_BUFFER_CAPABILITY_SIMULTANEOUS_USE_KHR	(1 << 2)
+
+typedef cl_command_buffer_khr (CL_API_CALL *PFNCreateCommandBuffer)(cl_uint NumQueues, const cl_command_queue* pQueues,
+	const cl_command_buffer_properties_khr* pProperties, cl_int* pError);
+typedef cl_int (CL_API_CALL *PFNCommandNDRangeKernel)(cl_command_buffer_khr CommandBuffer, cl_command_queue Queue,
+	const void* pProperties, cl_kernel Kernel, cl_uint Dimensions, const size_t* pOffset, const size_t* pGlobalWorkSize,
+	const size_t* pLocalWorkSize, cl_uint NumSyncPoints, const cl_sync_point_khr* pSyncPoints, cl_sync_point_khr* pSyncPoint,
+	cl_mutable_command_khr* pMutableHandle);
+typedef cl_int (CL_API_CALL *PFNFinalizeCommandBuffer)(cl_command_buffer_khr CommandBuffer);
+typedef cl_int (CL_API_CALL *PFNEnqueueCommandBuffer)(cl_uint NumQueues, cl_command_queue* pQueues, cl_command_buffer_khr CommandBuffer,
+	cl_uint NumEvents, const cl_event* pWaitList, cl_event* pEvent);
+typedef cl_int (CL_API_CALL *PFNReleaseCommandBuffer)(cl_command_buffer_khr CommandBuffer);
+
+struct CCommandBufferFunctions
+{
+	PFNCreateCommandBuffer		Create;
+	PFNCommandNDRangeKernel		NDRangeKernel;
+	PFNFinalizeCommandBuffer	Finalize;
+	PFNEnqueueCommandBuffer		Enqueue;
+	PFNReleaseCommandBuffer		Release;
+};
+
+// Returns the entry points if the device of Queue can replay a command buffer while it is still pending
+static bool GetCommandBufferFunctions(cl_command_queue Queue, CCommandBufferFunctions& Functions)
+{
+	const char* pEnv = getenv("GPGPU_COMMAND_BUFFER");
+	if(pEnv && (string(pEnv) == "0" || string(pEnv) == "off"))
+		return false;
+
+	cl_device_id device;
+	cl_platform_id platform;
+	if(clGetCommandQueueInfo(Queue, CL_QUEUE_DEVICE, sizeof(device), &device, NULL) != CL_SUCCESS ||
+		clGetDeviceInfo(device, CL_DEVICE_PLATFORM, sizeof(platform), &platform, NULL) != CL_SUCCESS)
+		return false;
+
+	size_t size = 0;
+	if(clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, 0, NULL, &size) != CL_SUCCESS || size == 0)
+		return false;
+	string extensions(size, '\0');
+	clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, size, &extensions[0], NULL);
+	if((" " + extensions + " ").find(" cl_khr_command_buffer ") == string::npos)
+		return false;
+
+	// the launches of a replay loop must not wait for the previous replay
+	cl_bitfield capabilities = 0;
+	if(clGetDeviceInfo(device, GPGPU_DEVICE_COMMAND_BUFFER_CAPABILITIES_KHR, sizeof(capabilities), &capabilities, NULL) != CL_SUCCESS ||
+		!(capabilities & GPGPU_COMMAND_BUFFER_CAPABILITY_SIMULTANEOUS_USE_KHR))
+		return false;
+
+	Functions.Create = (PFNCreateCommandBuffer)clGetExtensionFunctionAddressForPlatform(platform, "clCreateCommandBufferKHR");
+	Functions.NDRangeKernel = (PFNCommandNDRangeKernel)clGetExtensionFunctionAddressForPlatform(platform, "clCommandNDRangeKernelKHR");
+	Functions.Finalize = (PFNFinalizeCommandBuffer)clGetExtensionFunctionAddressForPlatform(platform, "clFinalizeCommandBufferKHR");
+	Functions.Enqueue = (PFNEnqueueCommandBuffer)clGetExtensionFunctionAddressForPlatform(platform, "clEnqueueCommandBufferKHR");
+	Functions.Release = (PFNReleaseCommandBuffer)clGetExtensionFunctionAddressForPlatform(platform, "clReleaseCommandBufferKHR");
+	return Functions.Create && Functions.NDRangeKernel && Functions.Finalize && Functions.Enqueue && Functions.Release;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CCommandRecording
+
+CCommandRecording::CCommandRecording()
+	: m_Queue(nullptr), m_Recording(false), m_Recorded(false), m_CommandBufferDirty(false), m_CommandBuffer(nullptr)
+{
+}
+
+CCommandRecording::~CCommandRecording()
+{
+	Clear();
+}
+
+void CCommandRecording::Clear()
+{
+	ReleaseCommandBuffer();
+
+	for(size_t i = 0; i < m_BoundKernels.size(); i++)
+		SAFE_RELEASE_KERNEL(m_BoundKernels[i].Kernel);
+	m_BoundKernels.clear();
+	m_Launches.clear();
+	m_CurrentArgs.clear();
+
+	if(m_Queue)
+		clReleaseCommandQueue(m_Queue);
+	m_Queue = nullptr;
+	m_Recording = false;
+	m_Recorded = false;
+	m_CommandBufferDirty = false;
+}
+
+bool CCommandRecording::Begin(cl_command_queue CommandQueue)
+{
+	Clear();
+	m_Queue = CommandQueue;
+	clRetainCommandQueue(m_Queue);
+	m_Recording = true;
+	return true;
+}
+
+bool CCommandRecording::SetKernelArg(cl_kernel Kernel, cl_uint Index, size_t Size, const void* pValue)
+{
+	if(!m_Recording)
+		return false;
+
+	CArgValue& arg = m_CurrentArgs[Kernel][Index];
+	arg.IsNull = pValue == nullptr;
+	arg.Value.assign(Size, 0);
+	if(pValue)
+		memcpy(&arg.Value[0], pValue, Size);
+	return true;
+}
+
+bool CCommandRecording::AddKernel(const char* Name, cl_kernel Kernel, cl_uint Dimensions,
+	const size_t* pGlobalWorkSize, const size_t* pLocalWorkSize)
+{
+	if(!m_Recording || Dimensions < 1 || Dimensions > 3)
+		return false;
+
+	CLaunch launch;
+	launch.Name = Name;
+	launch.Dimensions = Dimensions;
+	launch.HasLocalWorkSize = pLocalWorkSize != nullptr;
+	for(cl_uint i = 0; i < Dimensions; i++)
+	{
+		launch.GlobalWorkSize[i] = pGlobalWorkSize[i];
+		launch.LocalWorkSize[i] = pLocalWorkSize ? pLocalWorkSize[i] : 0;
+	}
+
+	// launches with the same kernel and arguments share one bound kernel
+	const ArgMap& args = m_CurrentArgs[Kernel];
+	launch.BoundKernel = m_BoundKernels.size();
+	for(size_t i = 0; i < m_BoundKernels.size(); i++)
+	{
+		if(m_BoundKernels[i].Original == Kernel && m_BoundKernels[i].Args == args)
+		{
+			launch.BoundKernel = i;
+			break;
+		}
+	}
+	if(launch.BoundKernel == m_BoundKernels.size())
+	{
+		CBoundKernel bound;
+		bound.Original = Kernel;
+		bound.Kernel = nullptr;
+		bound.Args = args;
+		m_BoundKernels.push_back(bound);
+	}
+
+	m_Launches.push_back(launch);
+	return true;
+}
+
+bool CCommandRecording::SetArg(cl_kernel Kernel, cl_uint Index, const CArgValue& Arg)
+{
+	return clSetKernelArg(Kernel, Index, Arg.Value.size(), Arg.IsNull ? NULL : &Arg.Value[0]) == CL_SUCCESS;
+}
+
+bool CCommandRecording::BindKernel(const CBoundKernel& Bound, cl_kernel& Kernel)
+{
+	cl_program program;
+	cl_uint numArgs;
+	V_RETURN_FALSE_CL(clGetKernelInfo(Bound.Original, CL_KERNEL_PROGRAM, sizeof(program), &program, NULL), "Failed to query the program of a recorded kernel.");
+	V_RETURN_FALSE_CL(clGetKernelInfo(Bound.Original, CL_KERNEL_NUM_ARGS, sizeof(numArgs), &numArgs, NULL), "Failed to query the arguments of a recorded kernel.");
+	string name = CLUtil::GetKernelInfoString(Bound.Original, CL_KERNEL_FUNCTION_NAME);
+	if(name.empty())
+	{
+		cerr << "Error: failed to query the name of a recorded kernel." << endl;
+		return false;
+	}
+
+	// the new kernel object only knows the recorded arguments
+	for(cl_uint i = 0; i < numArgs; i++)
+	{
+		if(Bound.Args.count(i) == 0)
+		{
+			cerr << "Error: argument " << i << " of the recorded kernel '" << name << "' was not set in the recording." << endl;
+			return false;
+		}
+	}
+
+	cl_int clError;
+	Kernel = clCreateKernel(program, name.c_str(), &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create a bound kernel for '" << name << "'.");
+
+	for(ArgMap::const_iterator it = Bound.Args.begin(); it != Bound.Args.end(); ++it)
+	{
+		if(!SetArg(Kernel, it->first, it->second))
+		{
+			cerr << "Error: invalid recorded argument " << it->first << " of kernel '" << name << "'." << endl;
+			SAFE_RELEASE_KERNEL(Kernel);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CCommandRecording::End()
+{
+	if(!m_Recording)
+		return false;
+	m_Recording = false;
+
+	for(size_t i = 0; i < m_BoundKernels.size(); i++)
+	{
+		if(!BindKernel(m_BoundKernels[i], m_BoundKernels[i].Kernel))
+		{
+			Clear();
+			return false;
+		}
+	}
+
+	for(size_t i = 0; i < m_Launches.size(); i++)
+	{
+		const CLaunch& launch = m_Launches[i];
+		CKernelReport::Analyze(m_BoundKernels[launch.BoundKernel].Kernel, m_Queue, launch.Dimensions, launch.GlobalWorkSize,
+			launch.HasLocalWorkSize ? launch.LocalWorkSize : NULL);
+	}
+
+	m_Recorded = true;
+	m_CommandBufferDirty = true;
+	return true;
+}
+
+bool CCommandRecording::RecordCommandBuffer()
+{
+	ReleaseCommandBuffer();
+	m_CommandBufferDirty = false;
+
+	CCommandBufferFunctions functions;
+	if(m_Launches.empty() || !GetCommandBufferFunctions(m_Queue, functions))
+		return false;
+
+	cl_command_buffer_properties_khr properties[] = {
+		GPGPU_COMMAND_BUFFER_FLAGS_KHR, GPGPU_COMMAND_BUFFER_SIMULTANEOUS_USE_KHR, 0
+	};
+	cl_int clError;
+	cl_command_buffer_khr commandBuffer = functions.Create(1, &m_Queue, properties, &clError);
+	if(clError != CL_SUCCESS)
+		return false;
+
+	// every launch waits for the previous one, like in an in-order queue
+	cl_sync_point_khr syncPoint = 0;
+	for(size_t i = 0; i < m_Launches.size() && clError == CL_SUCCESS; i++)
+	{
+		const CLaunch& launch = m_Launches[i];
+		clError = functions.NDRangeKernel(commandBuffer, NULL, NULL, m_BoundKernels[launch.BoundKernel].Kernel, launch.Dimensions, NULL,
+			launch.GlobalWorkSize, launch.HasLocalWorkSize ? launch.LocalWorkSize : NULL, i > 0 ? 1 : 0, i > 0 ? &syncPoint : NULL, &syncPoint, NULL);
+	}
+	if(clError == CL_SUCCESS)
+		clError = functions.Finalize(commandBuffer);
+
+	if(clError != CL_SUCCESS)
+	{
+		cerr << "Recording a command buffer failed [" << CLUtil::GetCLErrorString(clError) << "], replaying the launches one by one." << endl;
+		functions.Release(commandBuffer);
+		return false;
+	}
+
+	m_CommandBuffer = commandBuffer;
+	return true;
+}
+
+void CCommandRecording::ReleaseCommandBuffer()
+{
+	if(!m_CommandBuffer)
+		return;
+
+	CCommandBufferFunctions functions;
+	if(GetCommandBufferFunctions(m_Queue, functions))
+		functions.Release(m_CommandBuffer);
+	m_CommandBuffer = nullptr;
+}
+
+bool CCommandRecording::Replay(cl_command_queue CommandQueue, std::vector<cl_event>* pLaunchEvents)
+{
+	if(!m_Recorded)
+	{
+		cerr << "Error: replaying a command sequence that was not recorded." << endl;
+		return false;
+	}
+
+	if(m_CommandBufferDirty)
+		RecordCommandBuffer();
+
+	if(m_CommandBuffer && CommandQueue == m_Queue && !pLaunchEvents)
+	{
+		CCommandBufferFunctions functions;
+		if(GetCommandBufferFunctions(m_Queue, functions) &&
+			functions.Enqueue(1, &CommandQueue, m_CommandBuffer, 0, NULL, TRACE_CL(m_Launches[0].Name)) == CL_SUCCESS)
+			return true;
+
+		// e.g. not allowed while the previous replay is pending: stay with the replay loop
+		cerr << "Enqueueing the command buffer failed, replaying the launches one by one." << endl;
+		ReleaseCommandBuffer();
+	}
+
+	for(size_t i = 0; i < m_Launches.size(); i++)
+	{
+		const CLaunch& launch = m_Launches[i];
+		cl_event* pEvent = TRACE_CL(launch.Name);
+		if(pLaunchEvents)
+		{
+			pLaunchEvents->push_back(nullptr);
+			pEvent = &pLaunchEvents->back();
+		}
+		V_RETURN_FALSE_CL(clEnqueueNDRangeKernel(CommandQueue, m_BoundKernels[launch.BoundKernel].Kernel, launch.Dimensions, NULL,
+			launch.GlobalWorkSize, launch.HasLocalWorkSize ? launch.LocalWorkSize : NULL, 0, NULL, pEvent),
+			"Failed to replay the launch of '" << launch.Name << "'.");
+	}
+	return true;
+}
+
+bool CCommandRecording::UpdateKernelArg(cl_kernel Kernel, cl_uint Index, size_t Size, const void* pValue)
+{
+	CArgValue arg;
+	arg.IsNull = pValue == nullptr;
+	arg.Value.assign(Size, 0);
+	if(pValue)
+		memcpy(&arg.Value[0], pValue, Size);
+
+	for(size_t i = 0; i < m_BoundKernels.size(); i++)
+	{
+		CBoundKernel& bound = m_BoundKernels[i];
+		if(bound.Original != Kernel || bound.Args[Index] == arg)
+			continue;
+
+		bound.Args[Index] = arg;
+		if(bound.Kernel)
+		{
+			if(!SetArg(bound.Kernel, Index, arg))
+				return false;
+			// the command buffer captured the old value
+			m_CommandBufferDirty = m_CommandBufferDirty || m_CommandBuffer != nullptr;
+		}
+	}
+
+	if(m_Recording)
+		m_CurrentArgs[Kernel][Index] = arg;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,146 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CCOMMAND_RECORDING_H
+#define _CCOMMAND_RECORDING_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include "CommonDefs.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+// opaque handle of cl_khr_command_buffer, the functions are loaded at runtime
+struct _cl_command_buffer_khr;
+
+//! A sequence of kernel launches that is recorded once and replayed with minimal host work
+/*!
+	Record the launches like with the plain API: SetKernelArg() works like
+	clSetKernelArg() (the values stay set for later launches of the same
+	kernel) and AddKernel() takes the place of clEnqueueNDRangeKernel().
+	End() checks that every argument of every recorded kernel was set and
+	prepares the replay:
+
+	- Each distinct combination of kernel and argument values gets its own
+	  kernel object with the arguments bound once, so replaying is a plain
+	  loop of clEnqueueNDRangeKernel() calls without any clSetKernelArg().
+	- If the device supports cl_khr_command_buffer (with simultaneous use),
+	  the launches are also recorded into a command buffer and a replay is a
+	  single clEnqueueCommandBufferKHR(). GPGPU_COMMAND_BUFFER=0 disables this.
+
+	UpdateKernelArg() changes an argument of all recorded launches of a kernel,
+	e.g. a value that changes every frame. The command buffer is then recorded
+	again at the next replay, so only change what actually changed.
+
+	The original kernels are not modified. Names must be string literals or
+	otherwise outlive the recording.
+*/
+class CCommandRecording
+{
+public:
+	CCommandRecording();
+	~CCommandRecording();
+
+	CCommandRecording(const CCommandRecording&) = delete;
+	CCommandRecording& operator=(const CCommandRecording&) = delete;
+
+	//! Starts a new recording, the command buffer (if any) is created for CommandQueue
+	bool Begin(cl_command_queue CommandQueue);
+
+	bool SetKernelArg(cl_kernel Kernel, cl_uint Index, size_t Size, const void* pValue);
+
+	bool AddKernel(const char* Name, cl_kernel Kernel, cl_uint Dimensions,
+		const size_t* pGlobalWorkSize, const size_t* pLocalWorkSize);
+
+	//! Validates the recorded launches and prepares the replay
+	bool End();
+
+	bool IsRecorded() const { return m_Recorded; }
+
+	//! Enqueues all recorded launches. If pLaunchEvents is given, it receives one event
+	//! per launch (the caller releases them), which requires the replay loop.
+	bool Replay(cl_command_queue CommandQueue, std::vector<cl_event>* pLaunchEvents = nullptr);
+
+	bool UpdateKernelArg(cl_kernel Kernel, cl_uint Index, size_t Size, const void* pValue);
+
+	void Clear();
+
+	size_t GetLaunchCount() const { return m_Launches.size(); }
+	size_t GetBoundKernelCount() const { return m_BoundKernels.size(); }
+	bool UsesCommandBuffer() const { return m_CommandBuffer != nullptr; }
+
+protected:
+	struct CArgValue
+	{
+		std::vector<unsigned char>	Value;
+		// __local memory arguments are passed with a NULL pointer
+		bool						IsNull;
+
+		bool operator==(const CArgValue& Other) const { return IsNull == Other.IsNull && Value == Other.Value; }
+	};
+
+	typedef std::map<cl_uint, CArgValue> ArgMap;
+
+	struct CBoundKernel
+	{
+		cl_kernel		Original;
+		cl_kernel		Kernel;
+		ArgMap			Args;
+	};
+
+	struct CLaunch
+	{
+		const char*		Name;
+		size_t			BoundKernel;
+		cl_uint			Dimensions;
+		size_t			GlobalWorkSize[3];
+		size_t			LocalWorkSize[3];
+		bool			HasLocalWorkSize;
+	};
+
+	static bool SetArg(cl_kernel Kernel, cl_uint Index, const CArgValue& Arg);
+
+	bool BindKernel(const CBoundKernel& Bound, cl_kernel& Kernel);
+
+	bool RecordCommandBuffer();
+	void ReleaseCommandBuffer();
+
+	cl_command_queue				m_Queue;
+	bool							m_Recording;
+	bool							m_Recorded;
+	bool							m_CommandBufferDirty;
+
+	// arguments set so far, per original kernel
+	std::map<cl_kernel, ArgMap>		m_CurrentArgs;
+	std::vector<CBoundKernel>		m_BoundKernels;
+	std::vector<CLaunch>			m_Launches;
+
+	_cl_command_buffer_khr*			m_CommandBuffer;
+};
+
+#endif // _CCOMMAND_RECORDING_H
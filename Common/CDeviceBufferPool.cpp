@@ -0,0 +1,237 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CDeviceBufferPool.h"
+
+#include "CLUtil.h"
+#include "CDeviceMemoryTracker.h"
+
+#include <iostream>
+#include <cstdlib>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CPooledBuffer
+
+CPooledBuffer::CPooledBuffer()
+	: m_pPool(nullptr), m_Buffer(nullptr), m_Flags(0), m_Size(0), m_BucketSize(0)
+{
+}
+
+CPooledBuffer::~CPooledBuffer()
+{
+	Release();
+}
+
+CPooledBuffer::CPooledBuffer(CPooledBuffer&& Other)
+	: m_pPool(Other.m_pPool), m_Buffer(Other.m_Buffer), m_Flags(Other.m_Flags), m_Size(Other.m_Size), m_BucketSize(Other.m_BucketSize)
+{
+	Other.m_pPool = nullptr;
+	Other.m_Buffer = nullptr;
+}
+
+CPooledBuffer& CPooledBuffer::operator=(CPooledBuffer&& Other)
+{
+	if(this != &Other)
+	{
+		Release();
+		m_pPool = Other.m_pPool;
+		m_Buffer = Other.m_Buffer;
+		m_Flags = Other.m_Flags;
+		m_Size = Other.m_Size;
+		m_BucketSize = Other.m_BucketSize;
+		Other.m_pPool = nullptr;
+		Other.m_Buffer = nullptr;
+	}
+	return *this;
+}
+
+CPooledBuffer CPooledBuffer::Create(cl_context Context, cl_mem_flags Flags, size_t Size, cl_int* pError)
+{
+	CPooledBuffer buffer;
+	buffer.m_Buffer = CDeviceMemoryTracker::CreateBuffer(Context, Flags, Size, NULL, pError, "unpooled buffer");
+	buffer.m_Flags = Flags;
+	buffer.m_Size = buffer.m_BucketSize = Size;
+	return buffer;
+}
+
+void CPooledBuffer::Release()
+{
+	if(!m_Buffer)
+		return;
+
+	if(m_pPool)
+		m_pPool->Return(*this);
+	else
+		clReleaseMemObject(m_Buffer);
+
+	m_pPool = nullptr;
+	m_Buffer = nullptr;
+	m_Size = m_BucketSize = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CDeviceBufferPool
+
+CDeviceBufferPool::CDeviceBufferPool(cl_context Context, size_t MaxBytes)
+	: m_Context(Context), m_MaxBytes(MaxBytes),
+	m_UsedBytes(0), m_CachedBytes(0), m_PeakBytes(0), m_LiveBuffers(0),
+	m_TotalRequestedBytes(0.0), m_TotalHandedOutBytes(0.0),
+	m_Hits(0), m_Misses(0), m_Evictions(0)
+{
+	const char* pEnv = getenv("GPGPU_BUFFER_POOL_MB");
+	if(m_MaxBytes == 0 && pEnv && *pEnv)
+		m_MaxBytes = (size_t)atol(pEnv) << 20;
+}
+
+CDeviceBufferPool::~CDeviceBufferPool()
+{
+	if(m_LiveBuffers > 0)
+		cerr << "Warning: " << m_LiveBuffers << " pooled device buffers (" << m_UsedBytes << " bytes) are still in use while the pool is destroyed." << endl;
+
+	Trim();
+}
+
+size_t CDeviceBufferPool::GetBucketSize(size_t Size)
+{
+	// small buffers all share one class
+	const size_t c_MinBucket = 4096;
+	if(Size <= c_MinBucket)
+		return c_MinBucket;
+
+	// powers of two, each split into four steps: at most 25% are wasted
+	size_t pow2 = c_MinBucket;
+	while(pow2 * 2 < Size)
+		pow2 *= 2;
+	size_t step = pow2 / 4;
+	return ((Size + step - 1) / step) * step;
+}
+
+CPooledBuffer CDeviceBufferPool::Acquire(cl_mem_flags Flags, size_t Size, cl_int* pError)
+{
+	CPooledBuffer buffer;
+	size_t bucketSize = GetBucketSize(Size);
+	BucketKey key(Flags, bucketSize);
+
+	multimap<BucketKey, cl_mem>::iterator it = m_FreeBuffers.find(key);
+	if(it != m_FreeBuffers.end())
+	{
+		buffer.m_Buffer = it->second;
+		m_FreeBuffers.erase(it);
+		m_CachedBytes -= bucketSize;
+		m_Hits++;
+	}
+	else
+	{
+		m_Misses++;
+
+		if(!MakeRoom(bucketSize))
+		{
+			cerr << "Error: allocating " << bucketSize << " bytes would exceed the device buffer pool limit of " << m_MaxBytes << " bytes." << endl;
+			if(pError)
+				*pError = CL_MEM_OBJECT_ALLOCATION_FAILURE;
+			return buffer;
+		}
+
+		cl_int clError;
+		buffer.m_Buffer = CDeviceMemoryTracker::CreateBuffer(m_Context, Flags, bucketSize, NULL, &clError, "pooled buffer");
+		if(clError != CL_SUCCESS)
+		{
+			// the device might be out of memory: drop the cache and try once more
+			Trim();
+			buffer.m_Buffer = CDeviceMemoryTracker::CreateBuffer(m_Context, Flags, bucketSize, NULL, &clError, "pooled buffer");
+		}
+		if(pError)
+			*pError = clError;
+		if(clError != CL_SUCCESS)
+		{
+			buffer.m_Buffer = nullptr;
+			return buffer;
+		}
+	}
+
+	if(pError)
+		*pError = CL_SUCCESS;
+
+	buffer.m_pPool = this;
+	buffer.m_Flags = Flags;
+	buffer.m_Size = Size;
+	buffer.m_BucketSize = bucketSize;
+
+	m_UsedBytes += bucketSize;
+	m_LiveBuffers++;
+	m_TotalRequestedBytes += double(Size);
+	m_TotalHandedOutBytes += double(bucketSize);
+	m_PeakBytes = max(m_PeakBytes, GetFootprintBytes());
+
+	return buffer;
+}
+
+void CDeviceBufferPool::Return(CPooledBuffer& Buffer)
+{
+	m_UsedBytes -= Buffer.m_BucketSize;
+	m_LiveBuffers--;
+
+	m_FreeBuffers.insert(make_pair(BucketKey(Buffer.m_Flags, Buffer.m_BucketSize), Buffer.m_Buffer));
+	m_CachedBytes += Buffer.m_BucketSize;
+}
+
+bool CDeviceBufferPool::MakeRoom(size_t Bytes)
+{
+	if(m_MaxBytes == 0)
+		return true;
+
+	while(GetFootprintBytes() + Bytes > m_MaxBytes && !m_FreeBuffers.empty())
+	{
+		// release the largest cached buffer
+		multimap<BucketKey, cl_mem>::iterator largest = m_FreeBuffers.begin();
+		for(multimap<BucketKey, cl_mem>::iterator it = m_FreeBuffers.begin(); it != m_FreeBuffers.end(); ++it)
+			if(it->first.second > largest->first.second)
+				largest = it;
+
+		clReleaseMemObject(largest->second);
+		m_CachedBytes -= largest->first.second;
+		m_FreeBuffers.erase(largest);
+		m_Evictions++;
+	}
+
+	return GetFootprintBytes() + Bytes <= m_MaxBytes;
+}
+
+void CDeviceBufferPool::Trim()
+{
+	for(multimap<BucketKey, cl_mem>::iterator it = m_FreeBuffers.begin(); it != m_FreeBuffers.end(); ++it)
+		clReleaseMemObject(it->second);
+	m_FreeBuffers.clear();
+	m_CachedBytes = 0;
+}
+
+double CDeviceBufferPool::GetHitRate() const
+{
+	unsigned int requests = m_Hits + m_Misses;
+	return requests > 0 ? double(m_Hits) / double(requests) : 0.0;
+}
+
+double CDeviceBufferPool::GetFragmentation() const
+{
+	return m_TotalHandedOutBytes > 0.0 ? 1.0 - m_TotalRequestedBytes / m_TotalHandedOutBytes : 0.0;
+}
+
+void CDeviceBufferPool::PrintStatistics() const
+{
+	if(m_Hits + m_Misses == 0)
+		return;
+
+	cout << "Device buffer pool: " << m_Hits + m_Misses << " requests, hit rate " << 100.0 * GetHitRate() << "%, "
+		<< m_Evictions << " evictions" << endl;
+	cout << "  peak footprint: " << (m_PeakBytes >> 10) << " KB";
+	if(m_MaxBytes > 0)
+		cout << " (limit " << (m_MaxBytes >> 10) << " KB)";
+	cout << ", in use: " << (m_UsedBytes >> 10) << " KB, cached: " << (m_CachedBytes >> 10) << " KB, "
+		<< "fragmentation: " << 100.0 * GetFragmentation() << "%" << endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
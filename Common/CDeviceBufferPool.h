@@ -0,0 +1,149 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CDEVICE_BUFFER_POOL_H
+#define _CDEVICE_BUFFER_POOL_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include <map>
+#include <utility>
+
+class CDeviceBufferPool;
+
+//! RAII handle of a device buffer
+/*!
+	The buffer goes back to the pool it was acquired from (or is released,
+	if it was created without a pool) when the handle is destroyed or
+	Release() is called. Handles can be moved, but not copied.
+*/
+class CPooledBuffer
+{
+public:
+	CPooledBuffer();
+	~CPooledBuffer();
+
+	CPooledBuffer(CPooledBuffer&& Other);
+	CPooledBuffer& operator=(CPooledBuffer&& Other);
+
+	CPooledBuffer(const CPooledBuffer&) = delete;
+	CPooledBuffer& operator=(const CPooledBuffer&) = delete;
+
+	//! Creates a buffer that does not belong to any pool
+	static CPooledBuffer Create(cl_context Context, cl_mem_flags Flags, size_t Size, cl_int* pError = nullptr);
+
+	//! The reference can be passed to clSetKernelArg() directly
+	const cl_mem& Get() const { return m_Buffer; }
+
+	//! Requested size in bytes (the buffer itself might be larger)
+	size_t GetSize() const { return m_Size; }
+
+	explicit operator bool() const { return m_Buffer != nullptr; }
+
+	void Release();
+
+protected:
+	friend class CDeviceBufferPool;
+
+	CDeviceBufferPool*	m_pPool;
+	cl_mem				m_Buffer;
+	cl_mem_flags		m_Flags;
+	size_t				m_Size;
+	size_t				m_BucketSize;
+};
+
+//! Size-bucketed pool of device buffers, shared by all tasks of an assignment
+/*!
+	Requests are rounded up to size classes (powers of two, split into four
+	steps each) and released buffers are kept for the next request with the
+	same size class and flags. Back-to-back tasks of the same size thus do not
+	call clCreateBuffer() / clReleaseMemObject() at all.
+
+	The total footprint (buffers in use plus cached ones) can be capped; if a
+	new buffer would exceed the cap, cached buffers are released first and the
+	request fails if that is not enough. The cap can also be set with the
+	environment variable GPGPU_BUFFER_POOL_MB.
+*/
+class CDeviceBufferPool
+{
+public:
+	//! MaxBytes == 0: no limit (unless GPGPU_BUFFER_POOL_MB is set)
+	CDeviceBufferPool(cl_context Context, size_t MaxBytes = 0);
+
+	//! Releases all cached buffers. Buffers still in use are reported.
+	~CDeviceBufferPool();
+
+	CPooledBuffer Acquire(cl_mem_flags Flags, size_t Size, cl_int* pError = nullptr);
+
+	//! Releases all cached (unused) buffers
+	void Trim();
+
+	void SetMaxBytes(size_t MaxBytes) { m_MaxBytes = MaxBytes; }
+	size_t GetMaxBytes() const { return m_MaxBytes; }
+
+	//! Bytes of all buffers owned by the pool, in use or cached
+	size_t GetFootprintBytes() const { return m_UsedBytes + m_CachedBytes; }
+	size_t GetPeakBytes() const { return m_PeakBytes; }
+
+	//! Fraction of requests served from the cache
+	double GetHitRate() const;
+
+	//! Fraction of the handed out bytes that was wasted by rounding up to the size classes
+	double GetFragmentation() const;
+
+	void PrintStatistics() const;
+
+	static size_t GetBucketSize(size_t Size);
+
+protected:
+	friend class CPooledBuffer;
+
+	void Return(CPooledBuffer& Buffer);
+
+	//! Releases cached buffers (largest first) until Bytes more fit under the cap
+	bool MakeRoom(size_t Bytes);
+
+	typedef std::pair<cl_mem_flags, size_t> BucketKey;
+
+	cl_context							m_Context;
+	size_t								m_MaxBytes;
+
+	std::multimap<BucketKey, cl_mem>	m_FreeBuffers;
+
+	size_t								m_UsedBytes;
+	size_t								m_CachedBytes;
+	size_t								m_PeakBytes;
+	size_t								m_LiveBuffers;
+
+	double								m_TotalRequestedBytes;
+	double								m_TotalHandedOutBytes;
+
+	unsigned int						m_Hits;
+	unsigned int						m_Misses;
+	unsigned int						m_Evictions;
+};
+
+#endif // _CDEVICE_BUFFER_POOL_H
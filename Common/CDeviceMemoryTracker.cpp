@@ -0,0 +1,178 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CDeviceMemoryTracker.h"
+
+#include "CTimer.h"
+
+#include <algorithm>
+
+using namespace std;
+
+std::mutex								CDeviceMemoryTracker::s_Mutex;
+std::string								CDeviceMemoryTracker::s_Owner = "framework";
+std::map<size_t, CDeviceMemoryTracker::CAllocation>			CDeviceMemoryTracker::s_Live;
+std::map<std::string, CDeviceMemoryTracker::COwnerStatistics>	CDeviceMemoryTracker::s_Owners;
+size_t									CDeviceMemoryTracker::s_NextId = 1;
+size_t									CDeviceMemoryTracker::s_CurrentBytes = 0;
+size_t									CDeviceMemoryTracker::s_PeakBytes = 0;
+size_t									CDeviceMemoryTracker::s_Untracked = 0;
+size_t									CDeviceMemoryTracker::s_UntrackedBytes = 0;
+
+static double ToMB(size_t Bytes)
+{
+	return double(Bytes) / (1024.0 * 1024.0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CDeviceMemoryTracker
+
+cl_mem CDeviceMemoryTracker::CreateBuffer(cl_context Context, cl_mem_flags Flags, size_t Size, void* pHostPtr, cl_int* pError, const char* Name)
+{
+	cl_int clError;
+	cl_mem buffer = clCreateBuffer(Context, Flags, Size, pHostPtr, &clError);
+	if(pError)
+		*pError = clError;
+	if(clError == CL_SUCCESS)
+		Track(buffer, Name);
+	return buffer;
+}
+
+cl_mem CDeviceMemoryTracker::CreateFromGLBuffer(cl_context Context, cl_mem_flags Flags, cl_GLuint Buffer, cl_int* pError, const char* Name)
+{
+	cl_int clError;
+	cl_mem buffer = clCreateFromGLBuffer(Context, Flags, Buffer, &clError);
+	if(pError)
+		*pError = clError;
+	if(clError == CL_SUCCESS)
+		Track(buffer, Name);
+	return buffer;
+}
+
+void CDeviceMemoryTracker::Track(cl_mem Memory, const char* Name)
+{
+	if(!Memory)
+		return;
+
+	size_t bytes = 0;
+	clGetMemObjectInfo(Memory, CL_MEM_SIZE, sizeof(bytes), &bytes, NULL);
+
+	size_t id;
+	{
+		lock_guard<mutex> lock(s_Mutex);
+		id = s_NextId++;
+
+		CAllocation& allocation = s_Live[id];
+		allocation.Name = Name ? Name : "unnamed";
+		allocation.Owner = s_Owner;
+		allocation.Bytes = bytes;
+		allocation.CreatedMs = CTimer::GetTimestampMilliseconds();
+
+		COwnerStatistics& owner = s_Owners[s_Owner];
+		owner.Allocations++;
+		owner.CurrentBytes += bytes;
+		owner.PeakBytes = max(owner.PeakBytes, owner.CurrentBytes);
+
+		s_CurrentBytes += bytes;
+		s_PeakBytes = max(s_PeakBytes, s_CurrentBytes);
+	}
+
+	// OpenCL 1.0 has no destructor callbacks: the object counts towards the peaks, but not towards
+	// the current figures (its release would never be seen) and is not reported as a leak
+	if(clSetMemObjectDestructorCallback(Memory, OnMemObjectDestroyed, (void*)id) != CL_SUCCESS)
+	{
+		lock_guard<mutex> lock(s_Mutex);
+		map<size_t, CAllocation>::iterator it = s_Live.find(id);
+		s_Owners[it->second.Owner].CurrentBytes -= bytes;
+		s_CurrentBytes -= bytes;
+		s_Live.erase(it);
+		s_Untracked++;
+		s_UntrackedBytes += bytes;
+	}
+}
+
+void CL_CALLBACK CDeviceMemoryTracker::OnMemObjectDestroyed(cl_mem, void* pUserData)
+{
+	// may be called from a thread of the OpenCL runtime
+	lock_guard<mutex> lock(s_Mutex);
+	map<size_t, CAllocation>::iterator it = s_Live.find((size_t)pUserData);
+	if(it == s_Live.end())
+		return;
+
+	const CAllocation& allocation = it->second;
+	COwnerStatistics& owner = s_Owners[allocation.Owner];
+	owner.CurrentBytes -= allocation.Bytes;
+	owner.LongestLifetimeMs = max(owner.LongestLifetimeMs, CTimer::GetTimestampMilliseconds() - allocation.CreatedMs);
+	s_CurrentBytes -= allocation.Bytes;
+	s_Live.erase(it);
+}
+
+void CDeviceMemoryTracker::SetOwner(const std::string& Owner)
+{
+	lock_guard<mutex> lock(s_Mutex);
+	s_Owner = Owner;
+}
+
+std::string CDeviceMemoryTracker::GetOwner()
+{
+	lock_guard<mutex> lock(s_Mutex);
+	return s_Owner;
+}
+
+size_t CDeviceMemoryTracker::GetCurrentBytes()
+{
+	lock_guard<mutex> lock(s_Mutex);
+	return s_CurrentBytes;
+}
+
+size_t CDeviceMemoryTracker::GetPeakBytes()
+{
+	lock_guard<mutex> lock(s_Mutex);
+	return s_PeakBytes;
+}
+
+void CDeviceMemoryTracker::PrintStatistics(cl_device_id Device)
+{
+	lock_guard<mutex> lock(s_Mutex);
+	if(s_Owners.empty())
+		return;
+
+	cl_ulong globalMemSize = 0;
+	if(Device)
+		clGetDeviceInfo(Device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(globalMemSize), &globalMemSize, NULL);
+
+	cout << "Device memory: peak " << ToMB(s_PeakBytes) << " MB";
+	if(globalMemSize > 0)
+		cout << " (" << 100.0 * double(s_PeakBytes) / double(globalMemSize) << "% of " << ToMB((size_t)globalMemSize) << " MB)";
+	cout << ", currently " << ToMB(s_CurrentBytes) << " MB" << endl;
+
+	for(map<string, COwnerStatistics>::const_iterator it = s_Owners.begin(); it != s_Owners.end(); ++it)
+	{
+		const COwnerStatistics& owner = it->second;
+		cout << "  " << it->first << ": " << owner.Allocations << " allocations, peak " << ToMB(owner.PeakBytes) << " MB";
+		if(owner.CurrentBytes > 0)
+			cout << ", " << ToMB(owner.CurrentBytes) << " MB still allocated";
+		if(owner.LongestLifetimeMs > 0.0)
+			cout << ", longest lifetime " << owner.LongestLifetimeMs << " ms";
+		cout << endl;
+	}
+	if(s_Untracked > 0)
+		cout << "  (" << s_Untracked << " memory objects of " << ToMB(s_UntrackedBytes)
+			<< " MB without destructor callbacks, only included in the peaks)" << endl;
+}
+
+bool CDeviceMemoryTracker::CheckLeaks()
+{
+	lock_guard<mutex> lock(s_Mutex);
+	if(s_Live.empty())
+		return true;
+
+	cerr << "Warning: " << s_Live.size() << " device memory objects (" << ToMB(s_CurrentBytes) << " MB) were not released:" << endl;
+	for(map<size_t, CAllocation>::const_iterator it = s_Live.begin(); it != s_Live.end(); ++it)
+		cerr << "  " << it->second.Name << " of " << it->second.Owner << ": " << it->second.Bytes << " bytes" << endl;
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
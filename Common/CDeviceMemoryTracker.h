@@ -0,0 +1,136 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CDEVICE_MEMORY_TRACKER_H
+#define _CDEVICE_MEMORY_TRACKER_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+    #include <OpenCL/cl_gl.h>
+#else
+    #include <CL/cl.h>
+    #include <CL/cl_gl.h>
+#endif
+
+#include "CommonDefs.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <iostream>
+
+//! Accounting of all device memory objects: size, owner, lifetime, peak and current usage
+/*!
+	Create memory objects with CreateBuffer() / CreateFromGLBuffer() instead of
+	clCreateBuffer() / clCreateFromGLBuffer(), or pass objects created in any
+	other way (e.g. images) to Track(). The size is taken from CL_MEM_SIZE, so
+	padding by the runtime or the size of a GL buffer is accounted correctly.
+
+	The end of the lifetime is detected with clSetMemObjectDestructorCallback(),
+	i.e. when the runtime actually deletes the object, not when some
+	clReleaseMemObject() happens to be called. Objects are released with
+	SAFE_RELEASE_MEMOBJECT() as before. Without the callback (OpenCL 1.0) an object
+	only counts towards the peaks and is listed separately.
+
+	Every allocation is charged to the current owner. CAssignmentBase sets the
+	name of the running task (see CDeviceMemoryOwner), so the peak per owner
+	is the true footprint of a task. Memory objects that are still alive when
+	the context is released are reported as leaks.
+*/
+class CDeviceMemoryTracker
+{
+public:
+	static cl_mem CreateBuffer(cl_context Context, cl_mem_flags Flags, size_t Size, void* pHostPtr, cl_int* pError, const char* Name);
+
+	static cl_mem CreateFromGLBuffer(cl_context Context, cl_mem_flags Flags, cl_GLuint Buffer, cl_int* pError, const char* Name);
+
+	//! Starts tracking a memory object that was created elsewhere. Name must outlive the object.
+	static void Track(cl_mem Memory, const char* Name);
+
+	static void SetOwner(const std::string& Owner);
+	static std::string GetOwner();
+
+	static size_t GetCurrentBytes();
+	static size_t GetPeakBytes();
+
+	//! Prints the usage per owner, relative to the global memory of Device (if given)
+	static void PrintStatistics(cl_device_id Device = nullptr);
+
+	//! Reports all memory objects that are still alive, returns false if there are any
+	static bool CheckLeaks();
+
+protected:
+	struct CAllocation
+	{
+		const char*		Name;
+		std::string		Owner;
+		size_t			Bytes;
+		double			CreatedMs;
+	};
+
+	struct COwnerStatistics
+	{
+		size_t			Allocations;
+		size_t			CurrentBytes;
+		size_t			PeakBytes;
+		double			LongestLifetimeMs;
+	};
+
+	static void CL_CALLBACK OnMemObjectDestroyed(cl_mem Memory, void* pUserData);
+
+	static std::mutex						s_Mutex;
+	static std::string						s_Owner;
+	//! keyed by a serial number: the runtime may reuse a cl_mem handle before the callback of the old object ran
+	static std::map<size_t, CAllocation>	s_Live;
+	static std::map<std::string, COwnerStatistics>	s_Owners;
+	static size_t							s_NextId;
+	static size_t							s_CurrentBytes;
+	static size_t							s_PeakBytes;
+	//! objects whose release cannot be observed, not part of the current figures
+	static size_t							s_Untracked;
+	static size_t							s_UntrackedBytes;
+};
+
+//! Charges the device memory allocated during its lifetime to Owner
+class CDeviceMemoryOwner
+{
+public:
+	CDeviceMemoryOwner(const std::string& Owner)
+		: m_Previous(CDeviceMemoryTracker::GetOwner())
+	{
+		CDeviceMemoryTracker::SetOwner(Owner);
+	}
+
+	~CDeviceMemoryOwner()
+	{
+		CDeviceMemoryTracker::SetOwner(m_Previous);
+	}
+
+	CDeviceMemoryOwner(const CDeviceMemoryOwner&) = delete;
+	CDeviceMemoryOwner& operator=(const CDeviceMemoryOwner&) = delete;
+
+protected:
+	std::string		m_Previous;
+};
+
+#endif // _CDEVICE_MEMORY_TRACKER_H
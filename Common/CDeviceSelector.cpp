@@ -0,0 +1,318 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CDeviceSelector.h"
+
+#include "CLUtil.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cctype>
+
+using namespace std;
+
+#if defined (__APPLE__) || defined(MACOSX)
+   #define GL_SHARING_EXTENSION "cl_APPLE_gl_sharing"
+#else
+   #define GL_SHARING_EXTENSION "cl_khr_gl_sharing"
+#endif
+
+static string ToLower(string Str)
+{
+	transform(Str.begin(), Str.end(), Str.begin(), ::tolower);
+	return Str;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CDeviceSelector
+
+CDeviceSelector::CDeviceSelector()
+	: DeviceType(CL_DEVICE_TYPE_GPU), DeviceIndex(-1), Ranking(RANK_DEFAULT), AllowFallback(true), RequireGLSharing(false)
+{
+}
+
+bool CDeviceSelector::Parse(const std::string& Policy)
+{
+	// the settings only change if the whole policy is valid
+	CDeviceSelector parsed(*this);
+	stringstream stream(Policy);
+	string item;
+	while(getline(stream, item, ','))
+	{
+		if(item.empty())
+			continue;
+
+		size_t eq = item.find('=');
+		string key = ToLower(item.substr(0, eq));
+		string value = (eq == string::npos) ? "" : item.substr(eq + 1);
+		string lowerValue = ToLower(value);
+
+		if(key == "type")
+		{
+			if(lowerValue == "gpu")
+				parsed.DeviceType = CL_DEVICE_TYPE_GPU;
+			else if(lowerValue == "cpu")
+				parsed.DeviceType = CL_DEVICE_TYPE_CPU;
+			else if(lowerValue == "accelerator" || lowerValue == "acc")
+				parsed.DeviceType = CL_DEVICE_TYPE_ACCELERATOR;
+			else if(lowerValue == "all" || lowerValue == "any")
+				parsed.DeviceType = CL_DEVICE_TYPE_ALL;
+			else
+			{
+				cerr << "Unknown device type '" << value << "'." << endl;
+				return false;
+			}
+		}
+		else if(key == "platform")
+		{
+			parsed.PlatformSubstring = value;
+		}
+		else if(key == "index")
+		{
+			char* pEnd = NULL;
+			long index = strtol(value.c_str(), &pEnd, 10);
+			if(value.empty() || *pEnd != '\0' || index < 0)
+			{
+				cerr << "Invalid device index '" << value << "'." << endl;
+				return false;
+			}
+			parsed.DeviceIndex = int(index);
+		}
+		else if(key == "rank")
+		{
+			if(lowerValue == "default")
+				parsed.Ranking = RANK_DEFAULT;
+			else if(lowerValue == "units" || lowerValue == "compute_units")
+				parsed.Ranking = RANK_COMPUTE_UNITS;
+			else if(lowerValue == "memory" || lowerValue == "global_mem")
+				parsed.Ranking = RANK_GLOBAL_MEMORY;
+			else
+			{
+				cerr << "Unknown device ranking '" << value << "'." << endl;
+				return false;
+			}
+		}
+		else if(key == "fallback")
+		{
+			if(lowerValue == "1" || lowerValue == "true" || lowerValue == "on")
+				parsed.AllowFallback = true;
+			else if(lowerValue == "0" || lowerValue == "false" || lowerValue == "off")
+				parsed.AllowFallback = false;
+			else
+			{
+				cerr << "Invalid fallback value '" << value << "'." << endl;
+				return false;
+			}
+		}
+		else
+		{
+			cerr << "Unknown device selection key '" << key << "'." << endl;
+			return false;
+		}
+	}
+	*this = parsed;
+	return true;
+}
+
+bool CDeviceSelector::ParseEnvironment()
+{
+	const char* pEnv = getenv("GPGPU_DEVICE");
+	if(pEnv && *pEnv && !Parse(pEnv))
+	{
+		cerr << "Invalid device selection in GPGPU_DEVICE: '" << pEnv << "'." << endl;
+		return false;
+	}
+	return true;
+}
+
+bool CDeviceSelector::ParseCommandLine(int argc, char** argv)
+{
+	for(int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		string policy;
+		if(arg.compare(0, 9, "--device=") == 0)
+			policy = arg.substr(9);
+		else if(arg == "--device")
+		{
+			if(i + 1 >= argc)
+			{
+				cerr << "--device needs a policy." << endl;
+				return false;
+			}
+			policy = argv[++i];
+		}
+		else
+			continue;
+
+		if(!Parse(policy))
+		{
+			cerr << "Invalid device selection on the command line: '" << policy << "'." << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+int CDeviceSelector::GetTypeTier(cl_device_type Type) const
+{
+	if(DeviceType == CL_DEVICE_TYPE_ALL || (Type & DeviceType))
+		return 0;
+
+	// fallback order if the preferred type is not available
+	if(Type & CL_DEVICE_TYPE_GPU)
+		return 1;
+	if(Type & CL_DEVICE_TYPE_ACCELERATOR)
+		return 2;
+	if(Type & CL_DEVICE_TYPE_CPU)
+		return 3;
+	return 4;
+}
+
+bool CDeviceSelector::IsBetter(const SCandidate& A, const SCandidate& B) const
+{
+	if(A.TypeTier != B.TypeTier)
+		return A.TypeTier < B.TypeTier;
+
+	switch(Ranking)
+	{
+	case RANK_COMPUTE_UNITS:
+		{
+			cl_ulong a = (cl_ulong)A.ComputeUnits * max(A.ClockMHz, 1u);
+			cl_ulong b = (cl_ulong)B.ComputeUnits * max(B.ClockMHz, 1u);
+			if(a != b)
+				return a > b;
+		}
+		break;
+	case RANK_GLOBAL_MEMORY:
+		break;
+	default:
+		// a discrete device with its own memory is usually the faster one
+		if(A.UnifiedMemory != B.UnifiedMemory)
+			return !A.UnifiedMemory;
+		break;
+	}
+	return A.GlobalMemSize > B.GlobalMemSize;
+}
+
+const char* CDeviceSelector::GetTypeName(cl_device_type Type)
+{
+	if(Type & CL_DEVICE_TYPE_GPU)
+		return "GPU";
+	if(Type & CL_DEVICE_TYPE_CPU)
+		return "CPU";
+	if(Type & CL_DEVICE_TYPE_ACCELERATOR)
+		return "ACC";
+	return "other";
+}
+
+bool CDeviceSelector::Select(cl_platform_id& Platform, cl_device_id& Device) const
+{
+	cl_uint countPlatforms = 0;
+	V_RETURN_FALSE_CL(clGetPlatformIDs(0, NULL, &countPlatforms), "Failed to get CL platform ID");
+	if(countPlatforms == 0)
+	{
+		cerr << "No OpenCL platform found." << endl;
+		return false;
+	}
+	vector<cl_platform_id> platformIds(countPlatforms);
+	V_RETURN_FALSE_CL(clGetPlatformIDs(countPlatforms, &platformIds[0], NULL), "Failed to get CL platform ID");
+
+	vector<SCandidate> candidates;
+	for(size_t p = 0; p < platformIds.size(); p++)
+	{
+		string platformName = CLUtil::GetPlatformInfoString(platformIds[p], CL_PLATFORM_NAME);
+		if(!PlatformSubstring.empty())
+		{
+			string vendor = CLUtil::GetPlatformInfoString(platformIds[p], CL_PLATFORM_VENDOR);
+			string needle = ToLower(PlatformSubstring);
+			if(ToLower(platformName).find(needle) == string::npos && ToLower(vendor).find(needle) == string::npos)
+				continue;
+		}
+
+		cl_uint countDevices = 0;
+		if(clGetDeviceIDs(platformIds[p], CL_DEVICE_TYPE_ALL, 0, NULL, &countDevices) != CL_SUCCESS || countDevices == 0)
+			continue;
+		vector<cl_device_id> deviceIds(countDevices);
+		clGetDeviceIDs(platformIds[p], CL_DEVICE_TYPE_ALL, countDevices, &deviceIds[0], NULL);
+
+		for(size_t d = 0; d < deviceIds.size(); d++)
+		{
+			SCandidate c;
+			c.Platform = platformIds[p];
+			c.Device = deviceIds[d];
+			c.PlatformName = platformName;
+			c.DeviceName = CLUtil::GetDeviceInfoString(c.Device, CL_DEVICE_NAME);
+
+			cl_bool available = CL_TRUE;
+			cl_bool unified = CL_FALSE;
+			clGetDeviceInfo(c.Device, CL_DEVICE_AVAILABLE, sizeof(cl_bool), &available, NULL);
+			clGetDeviceInfo(c.Device, CL_DEVICE_TYPE, sizeof(cl_device_type), &c.Type, NULL);
+			clGetDeviceInfo(c.Device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &c.ComputeUnits, NULL);
+			clGetDeviceInfo(c.Device, CL_DEVICE_MAX_CLOCK_FREQUENCY, sizeof(cl_uint), &c.ClockMHz, NULL);
+			clGetDeviceInfo(c.Device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &c.GlobalMemSize, NULL);
+			clGetDeviceInfo(c.Device, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(cl_bool), &unified, NULL);
+			c.UnifiedMemory = (unified == CL_TRUE);
+			c.TypeTier = GetTypeTier(c.Type);
+
+			if(!available)
+				continue;
+			if(!AllowFallback && c.TypeTier != 0)
+				continue;
+			if(RequireGLSharing && CLUtil::GetDeviceInfoString(c.Device, CL_DEVICE_EXTENSIONS).find(GL_SHARING_EXTENSION) == string::npos)
+				continue;
+
+			candidates.push_back(c);
+		}
+	}
+
+	if(candidates.empty())
+	{
+		cerr << "No OpenCL device matches the selection policy." << endl;
+		return false;
+	}
+
+	stable_sort(candidates.begin(), candidates.end(),
+		[this](const SCandidate& A, const SCandidate& B) { return IsBetter(A, B); });
+
+	size_t selected = 0;
+	if(DeviceIndex >= 0)
+	{
+		if((size_t)DeviceIndex >= candidates.size())
+		{
+			cerr << "Device index " << DeviceIndex << " is out of range, only " << candidates.size() << " devices are available." << endl;
+			return false;
+		}
+		selected = (size_t)DeviceIndex;
+	}
+
+	cout << "OpenCL devices (ranked):" << endl << endl;
+	cout << "    #  type   CUs    MHz  global mem  unified  platform / device" << endl;
+	for(size_t i = 0; i < candidates.size(); i++)
+	{
+		const SCandidate& c = candidates[i];
+		cout << (i == selected ? "  * " : "    ") << i << "  "
+			<< left << setw(5) << GetTypeName(c.Type) << right
+			<< setw(5) << c.ComputeUnits
+			<< setw(7) << c.ClockMHz
+			<< setw(8) << (c.GlobalMemSize >> 20) << " MB"
+			<< setw(9) << (c.UnifiedMemory ? "yes" : "no")
+			<< "  " << c.PlatformName << " / " << c.DeviceName << endl;
+	}
+	cout << endl;
+
+	if(candidates[selected].TypeTier != 0)
+		cout << "No " << GetTypeName(DeviceType) << " device found, falling back to a " << GetTypeName(candidates[selected].Type) << " device." << endl << endl;
+
+	Platform = candidates[selected].Platform;
+	Device = candidates[selected].Device;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
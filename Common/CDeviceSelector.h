@@ -0,0 +1,110 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CDEVICE_SELECTOR_H
+#define _CDEVICE_SELECTOR_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include <string>
+#include <vector>
+
+//! Picks the OpenCL device an assignment runs on
+/*!
+	All devices of all platforms are enumerated, filtered and ranked; the
+	ranked list is printed so the choice is always visible in the log.
+
+	The policy is a comma-separated list of key=value pairs, read from the
+	environment variable GPGPU_DEVICE and the command line argument
+	--device=<policy> (the command line wins):
+
+		type=gpu|cpu|accelerator|all	preferred device type (default: gpu)
+		platform=<substring>			only platforms whose name or vendor contains this (case-insensitive)
+		index=<n>						take the n-th device (n >= 0) of the ranked list instead of the best one
+		rank=default|units|memory		ranking within a device type:
+											default: discrete devices first, then most global memory
+											units:   most compute units (x clock frequency)
+											memory:  most global memory
+		fallback=0|1					if no device of the preferred type exists, use any other type (default: 1)
+
+	Example: GPGPU_DEVICE=type=cpu,platform=intel
+*/
+class CDeviceSelector
+{
+public:
+	enum ERanking
+	{
+		RANK_DEFAULT,
+		RANK_COMPUTE_UNITS,
+		RANK_GLOBAL_MEMORY
+	};
+
+	CDeviceSelector();
+
+	//! Parses a policy string. Returns false on unknown keys or invalid values, none of the settings change then.
+	bool Parse(const std::string& Policy);
+
+	//! Reads the policy from GPGPU_DEVICE, if set. Returns false if it is invalid.
+	bool ParseEnvironment();
+
+	//! Reads the policy from --device=<policy> or --device <policy>, other arguments are ignored. Returns false if it is invalid.
+	bool ParseCommandLine(int argc, char** argv);
+
+	//! Enumerates, ranks and prints all devices and returns the selected one
+	bool Select(cl_platform_id& Platform, cl_device_id& Device) const;
+
+	cl_device_type		DeviceType;
+	std::string			PlatformSubstring;
+	int					DeviceIndex;
+	ERanking			Ranking;
+	bool				AllowFallback;
+
+	//! Only consider devices that can share objects with the current OpenGL context
+	bool				RequireGLSharing;
+
+protected:
+	struct SCandidate
+	{
+		cl_platform_id	Platform;
+		cl_device_id	Device;
+		cl_device_type	Type;
+		std::string		PlatformName;
+		std::string		DeviceName;
+		cl_uint			ComputeUnits;
+		cl_uint			ClockMHz;
+		cl_ulong		GlobalMemSize;
+		bool			UnifiedMemory;
+		int				TypeTier;
+	};
+
+	bool IsBetter(const SCandidate& A, const SCandidate& B) const;
+
+	int GetTypeTier(cl_device_type Type) const;
+
+	static const char* GetTypeName(cl_device_type Type);
+};
+
+#endif // _CDEVICE_SELECTOR_H
@@ -0,0 +1,174 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CHostBuffer.h"
+
+#include "CLUtil.h"
+#include "CDeviceMemoryTracker.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef _WIN32
+	#include <malloc.h>
+#endif
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CHostBuffer
+
+CHostBuffer::CHostBuffer()
+	: m_Mode(HOST_PAGEABLE), m_Size(0), m_pHost(nullptr), m_pAligned(nullptr), m_Mapped(false),
+	m_Buffer(nullptr), m_MapQueue(nullptr)
+{
+}
+
+CHostBuffer::~CHostBuffer()
+{
+	Release();
+}
+
+void* CHostBuffer::AlignedAlloc(size_t Alignment, size_t Size)
+{
+#ifdef _WIN32
+	return _aligned_malloc(Size, Alignment);
+#else
+	void* ptr = nullptr;
+	if(posix_memalign(&ptr, Alignment, Size) != 0)
+		return nullptr;
+	return ptr;
+#endif
+}
+
+void CHostBuffer::AlignedFree(void* Ptr)
+{
+#ifdef _WIN32
+	_aligned_free(Ptr);
+#else
+	free(Ptr);
+#endif
+}
+
+bool CHostBuffer::IsHostUnifiedMemory(cl_device_id Device)
+{
+	cl_bool unified = CL_FALSE;
+	clGetDeviceInfo(Device, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(cl_bool), &unified, NULL);
+	return unified == CL_TRUE;
+}
+
+const char* CHostBuffer::GetModeName(EMode Mode)
+{
+	switch(Mode)
+	{
+	case HOST_PINNED:		return "pinned";
+	case HOST_ZERO_COPY:	return "zero-copy";
+	default:				return "pageable";
+	}
+}
+
+bool CHostBuffer::Allocate(cl_device_id Device, cl_context Context, size_t Size, EMode Mode)
+{
+	Release();
+
+	if(Mode == HOST_ZERO_COPY && !IsHostUnifiedMemory(Device))
+	{
+		cout << "The device does not share memory with the host, using pinned memory instead of zero-copy." << endl;
+		Mode = HOST_PINNED;
+	}
+
+	m_Mode = Mode;
+	m_Size = Size;
+
+	// page alignment satisfies both DMA engines and CL_DEVICE_MEM_BASE_ADDR_ALIGN
+	cl_uint baseAlignBits = 0;
+	clGetDeviceInfo(Device, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(cl_uint), &baseAlignBits, NULL);
+	size_t alignment = max((size_t)4096, (size_t)baseAlignBits / 8);
+	// USE_HOST_PTR buffers additionally need a size that is a multiple of a cache line
+	size_t paddedSize = ((max(Size, (size_t)1) + 63) / 64) * 64;
+
+	if(Mode == HOST_PAGEABLE)
+	{
+		m_pAligned = AlignedAlloc(alignment, paddedSize);
+		m_pHost = m_pAligned;
+		return m_pHost != nullptr;
+	}
+
+	cl_int clError;
+	m_MapQueue = clCreateCommandQueue(Context, Device, 0, &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create the command queue for mapping host buffers.");
+
+	if(Mode == HOST_PINNED)
+	{
+		m_Buffer = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, paddedSize, NULL, &clError, "pinned host buffer");
+		V_RETURN_FALSE_CL(clError, "Failed to allocate pinned host memory.");
+	}
+	else
+	{
+		m_pAligned = AlignedAlloc(alignment, paddedSize);
+		if(!m_pAligned)
+			return false;
+		m_Buffer = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, paddedSize, m_pAligned, &clError, "host pointer buffer");
+		V_RETURN_FALSE_CL(clError, "Failed to create the zero-copy buffer.");
+	}
+
+	if(!MapForHost(m_MapQueue))
+	{
+		Release();
+		return false;
+	}
+	return true;
+}
+
+bool CHostBuffer::MapForHost(cl_command_queue CommandQueue)
+{
+	if(!m_Buffer || m_Mapped)
+		return true;
+
+	cl_int clError;
+	m_pHost = clEnqueueMapBuffer(CommandQueue, m_Buffer, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, m_Size, 0, NULL, NULL, &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to map the host buffer.");
+	m_Mapped = true;
+	return true;
+}
+
+bool CHostBuffer::UnmapForDevice(cl_command_queue CommandQueue)
+{
+	// a pinned buffer is only a transfer source/target and stays mapped
+	if(m_Mode != HOST_ZERO_COPY || !m_Mapped)
+		return true;
+
+	V_RETURN_FALSE_CL(clEnqueueUnmapMemObject(CommandQueue, m_Buffer, m_pHost, 0, NULL, NULL), "Failed to unmap the host buffer.");
+	m_Mapped = false;
+	return true;
+}
+
+void CHostBuffer::Release()
+{
+	if(m_Buffer && m_Mapped && m_MapQueue)
+	{
+		clEnqueueUnmapMemObject(m_MapQueue, m_Buffer, m_pHost, 0, NULL, NULL);
+		clFinish(m_MapQueue);
+	}
+	m_Mapped = false;
+
+	SAFE_RELEASE_MEMOBJECT(m_Buffer);
+	if(m_MapQueue)
+	{
+		clReleaseCommandQueue(m_MapQueue);
+		m_MapQueue = nullptr;
+	}
+
+	if(m_pAligned)
+	{
+		AlignedFree(m_pAligned);
+		m_pAligned = nullptr;
+	}
+	m_pHost = nullptr;
+	m_Size = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,108 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CHOST_BUFFER_H
+#define _CHOST_BUFFER_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include <cstddef>
+
+//! Host array for data that is transferred to or from the device
+/*!
+	HOST_PAGEABLE:	page-aligned memory from the C runtime. The driver has to copy
+					it into an internal staging buffer for every transfer.
+	HOST_PINNED:	a CL_MEM_ALLOC_HOST_PTR buffer that stays mapped for its whole
+					lifetime. Most drivers back it with page-locked memory, which can
+					be the source or target of a DMA transfer directly.
+	HOST_ZERO_COPY:	page-aligned host memory wrapped in a CL_MEM_USE_HOST_PTR buffer.
+					On devices with CL_DEVICE_HOST_UNIFIED_MEMORY the kernels can use
+					GetDeviceBuffer() directly, so there is no transfer at all. Between
+					host and device accesses, ownership has to be handed over with
+					UnmapForDevice() and MapForHost(). On other devices this falls back
+					to HOST_PINNED.
+
+	The memory is host-accessible right after Allocate().
+*/
+class CHostBuffer
+{
+public:
+	enum EMode
+	{
+		HOST_PAGEABLE,
+		HOST_PINNED,
+		HOST_ZERO_COPY
+	};
+
+	CHostBuffer();
+	~CHostBuffer();
+
+	bool Allocate(cl_device_id Device, cl_context Context, size_t Size, EMode Mode);
+
+	void Release();
+
+	void* GetPtr() const { return m_pHost; }
+
+	template<typename T>
+	T* As() const { return static_cast<T*>(m_pHost); }
+
+	size_t GetSize() const { return m_Size; }
+
+	//! The mode that was actually allocated (zero-copy might have fallen back to pinned)
+	EMode GetMode() const { return m_Mode; }
+
+	//! The buffer to pass to kernels in zero-copy mode, nullptr otherwise
+	cl_mem GetDeviceBuffer() const { return m_Mode == HOST_ZERO_COPY ? m_Buffer : nullptr; }
+
+	//! Hands a zero-copy buffer over to the device (no-op in the other modes)
+	bool UnmapForDevice(cl_command_queue CommandQueue);
+
+	//! Makes a zero-copy buffer accessible to the host again, blocking (no-op in the other modes)
+	bool MapForHost(cl_command_queue CommandQueue);
+
+	static bool IsHostUnifiedMemory(cl_device_id Device);
+
+	static const char* GetModeName(EMode Mode);
+
+protected:
+	CHostBuffer(const CHostBuffer&);
+	CHostBuffer& operator=(const CHostBuffer&);
+
+	static void* AlignedAlloc(size_t Alignment, size_t Size);
+	static void AlignedFree(void* Ptr);
+
+	EMode				m_Mode;
+	size_t				m_Size;
+	void*				m_pHost;
+	void*				m_pAligned;
+	bool				m_Mapped;
+
+	cl_mem				m_Buffer;
+	// used for the initial map and the final unmap
+	cl_command_queue	m_MapQueue;
+};
+
+#endif // _CHOST_BUFFER_H
@@ -0,0 +1,441 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CKernelLibrary.h"
+
+#include "CLUtil.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <sys/stat.h>
+
+using namespace std;
+
+// the shared kernel library, set by the CMake project; the assignments run in their source directory
+#ifndef GPGPU_KERNEL_DIRECTORY
+	#define GPGPU_KERNEL_DIRECTORY "../../Kernels"
+#endif
+
+// the output directory of the build-time SPIR-V compilation, set by the CMake project
+#ifndef GPGPU_SPIRV_DIRECTORY
+	#define GPGPU_SPIRV_DIRECTORY ""
+#endif
+
+// protects against include cycles that are not caught by the include-once rule (e.g. differently spelled paths)
+static const int		c_MaxIncludeDepth = 16;
+
+bool					CKernelLibrary::s_Initialized = false;
+std::vector<std::string> CKernelLibrary::s_IncludeDirectories;
+std::string				CKernelLibrary::s_SPIRVDirectory = GPGPU_SPIRV_DIRECTORY;
+std::map<CKernelLibrary::CProgramKey, cl_program> CKernelLibrary::s_Programs;
+
+unsigned int			CKernelLibrary::s_Hits = 0;
+unsigned int			CKernelLibrary::s_Misses = 0;
+unsigned int			CKernelLibrary::s_SPIRVPrograms = 0;
+
+static std::string GetDirectory(const std::string& Path)
+{
+	size_t pos = Path.find_last_of("/\\");
+	return pos == string::npos ? string() : Path.substr(0, pos + 1);
+}
+
+static bool FileExists(const std::string& Path)
+{
+	ifstream file(Path.c_str());
+	return file.is_open();
+}
+
+static bool GetModificationTime(const std::string& Path, time_t& Time)
+{
+	struct stat info;
+	if(stat(Path.c_str(), &info) != 0)
+		return false;
+	Time = info.st_mtime;
+	return true;
+}
+
+// the file name in a #line directive is a string literal, so avoid backslashes
+static std::string GetLineDirective(int Line, const std::string& Path)
+{
+	string path = Path;
+	replace(path.begin(), path.end(), '\\', '/');
+	stringstream directive;
+	directive << "#line " << Line << " \"" << path << "\"\n";
+	return directive.str();
+}
+
+// Returns the file name if the line is an #include directive. Block comments are tracked
+// across lines, so commented-out includes are ignored.
+static bool ParseIncludeDirective(const std::string& Line, bool& InBlockComment, std::string& Name)
+{
+	bool startsInComment = InBlockComment;
+	for(size_t i = 0; i + 1 < Line.size(); i++)
+	{
+		if(InBlockComment && Line[i] == '*' && Line[i + 1] == '/')
+		{
+			InBlockComment = false;
+			i++;
+		}
+		else if(!InBlockComment && Line[i] == '/' && Line[i + 1] == '/')
+			break;
+		else if(!InBlockComment && Line[i] == '/' && Line[i + 1] == '*')
+		{
+			InBlockComment = true;
+			i++;
+		}
+	}
+	if(startsInComment)
+		return false;
+
+	size_t pos = Line.find_first_not_of(" \t");
+	if(pos == string::npos || Line[pos] != '#')
+		return false;
+	pos = Line.find_first_not_of(" \t", pos + 1);
+	if(pos == string::npos || Line.compare(pos, 7, "include") != 0)
+		return false;
+	pos = Line.find_first_not_of(" \t", pos + 7);
+	if(pos == string::npos || (Line[pos] != '"' && Line[pos] != '<'))
+		return false;
+
+	size_t end = Line.find(Line[pos] == '"' ? '"' : '>', pos + 1);
+	if(end == string::npos)
+		return false;
+	Name = Line.substr(pos + 1, end - pos - 1);
+	return !Name.empty();
+}
+
+// enough digits to round-trip, always with a decimal point so that the 'f' suffix is valid
+static std::string FormatFloatingPoint(double Value, int Precision)
+{
+	stringstream value;
+	value << setprecision(Precision) << Value;
+	string text = value.str();
+	if(text.find_first_of(".eE") == string::npos)
+		text += ".0";
+	return text;
+}
+
+static bool IsPragmaOnce(const std::string& Line)
+{
+	stringstream tokens(Line);
+	string hash, pragma, once;
+	tokens >> hash;
+	if(hash == "#")
+		tokens >> pragma;
+	else if(hash == "#pragma")
+		pragma = "pragma";
+	tokens >> once;
+	return pragma == "pragma" && once == "once";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CKernelSpecialization
+
+CKernelSpecialization& CKernelSpecialization::Set(const std::string& Name, float Value)
+{
+	m_Constants[Name] = FormatFloatingPoint(Value, 9) + "f";
+	return *this;
+}
+
+CKernelSpecialization& CKernelSpecialization::Set(const std::string& Name, double Value)
+{
+	m_Constants[Name] = FormatFloatingPoint(Value, 17);
+	return *this;
+}
+
+CKernelSpecialization& CKernelSpecialization::Set(const std::string& Name, bool Value)
+{
+	m_Constants[Name] = Value ? "1" : "0";
+	return *this;
+}
+
+CKernelSpecialization& CKernelSpecialization::Set(const std::string& Name, const char* Value)
+{
+	m_Constants[Name] = Value;
+	return *this;
+}
+
+CKernelSpecialization& CKernelSpecialization::Set(const std::string& Name, const std::string& Value)
+{
+	m_Constants[Name] = Value;
+	return *this;
+}
+
+CKernelSpecialization& CKernelSpecialization::Define(const std::string& Name)
+{
+	m_Constants[Name] = "";
+	return *this;
+}
+
+CKernelSpecialization& CKernelSpecialization::AddOption(const std::string& Option)
+{
+	m_Options.insert(Option);
+	return *this;
+}
+
+std::string CKernelSpecialization::GetCompileOptions() const
+{
+	stringstream options;
+	for(set<string>::const_iterator it = m_Options.begin(); it != m_Options.end(); ++it)
+		options << (options.tellp() > 0 ? " " : "") << *it;
+	for(map<string, string>::const_iterator it = m_Constants.begin(); it != m_Constants.end(); ++it)
+	{
+		options << (options.tellp() > 0 ? " " : "") << "-D " << it->first;
+		if(!it->second.empty())
+			options << "=" << it->second;
+	}
+	return options.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CKernelLibrary
+
+bool CKernelLibrary::CProgramKey::operator<(const CProgramKey& Other) const
+{
+	if(Context != Other.Context)
+		return Context < Other.Context;
+	if(Device != Other.Device)
+		return Device < Other.Device;
+	if(Path != Other.Path)
+		return Path < Other.Path;
+	return CompileOptions < Other.CompileOptions;
+}
+
+void CKernelLibrary::InitFromEnvironment()
+{
+	if(s_Initialized)
+		return;
+	s_Initialized = true;
+
+	const char* pEnv = getenv("GPGPU_KERNEL_INCLUDE_PATH");
+	if(pEnv && *pEnv)
+	{
+		stringstream paths(pEnv);
+		string directory;
+		while(getline(paths, directory, ';'))
+			if(!directory.empty())
+				s_IncludeDirectories.push_back(directory);
+	}
+
+	// searched last, so the environment can override single files
+	s_IncludeDirectories.push_back(GPGPU_KERNEL_DIRECTORY);
+
+	pEnv = getenv("GPGPU_SPIRV");
+	if(pEnv && *pEnv)
+	{
+		string value = pEnv;
+		if(value == "off" || value == "0" || value == "false")
+			s_SPIRVDirectory.clear();
+		else
+			s_SPIRVDirectory = value;
+	}
+}
+
+void CKernelLibrary::AddIncludeDirectory(const std::string& Directory)
+{
+	InitFromEnvironment();
+	if(find(s_IncludeDirectories.begin(), s_IncludeDirectories.end(), Directory) == s_IncludeDirectories.end())
+		s_IncludeDirectories.push_back(Directory);
+}
+
+bool CKernelLibrary::FindInclude(const std::string& Name, const std::string& IncludingFile, std::string& Path)
+{
+	Path = GetDirectory(IncludingFile) + Name;
+	if(FileExists(Path))
+		return true;
+
+	for(size_t i = 0; i < s_IncludeDirectories.size(); i++)
+	{
+		const string& directory = s_IncludeDirectories[i];
+		char last = directory[directory.size() - 1];
+		Path = directory + ((last == '/' || last == '\\') ? "" : "/") + Name;
+		if(FileExists(Path))
+			return true;
+	}
+	return false;
+}
+
+bool CKernelLibrary::AppendFile(const std::string& Path, std::set<std::string>& IncludedFiles, std::string& SourceCode, int Depth)
+{
+	if(Depth > c_MaxIncludeDepth)
+	{
+		cerr << "Kernel includes nested too deeply at '" << Path << "'." << endl;
+		return false;
+	}
+
+	string fileCode;
+	if(!CLUtil::LoadProgramSourceToMemory(Path, fileCode))
+		return false;
+	IncludedFiles.insert(Path);
+
+	stringstream lines(fileCode);
+	string line;
+	int lineNumber = 0;
+	bool inBlockComment = false;
+	while(getline(lines, line))
+	{
+		lineNumber++;
+		if(!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+
+		string name;
+		if(ParseIncludeDirective(line, inBlockComment, name))
+		{
+			string includePath;
+			if(!FindInclude(name, Path, includePath))
+			{
+				cerr << Path << "(" << lineNumber << "): cannot find kernel include '" << name << "'." << endl;
+				return false;
+			}
+			if(IncludedFiles.count(includePath) == 0)
+			{
+				SourceCode += GetLineDirective(1, includePath);
+				if(!AppendFile(includePath, IncludedFiles, SourceCode, Depth + 1))
+					return false;
+			}
+			SourceCode += GetLineDirective(lineNumber + 1, Path);
+		}
+		else if(IsPragmaOnce(line))
+		{
+			// handled by the include-once rule, keep the line numbers
+			SourceCode += "\n";
+		}
+		else
+		{
+			SourceCode += line;
+			SourceCode += "\n";
+		}
+	}
+	return true;
+}
+
+bool CKernelLibrary::LoadSource(const std::string& Path, std::string& SourceCode, std::set<std::string>* pFiles)
+{
+	InitFromEnvironment();
+
+	SourceCode.clear();
+	set<string> includedFiles;
+
+	bool success = AppendFile(FindProgramFile(Path), includedFiles, SourceCode, 0);
+	if(pFiles)
+		pFiles->swap(includedFiles);
+	return success;
+}
+
+std::string CKernelLibrary::FindProgramFile(const std::string& Path)
+{
+	// files of the shared kernel library are found like includes
+	string path;
+	if(!FindInclude(Path, "", path))
+		path = Path;
+	return path;
+}
+
+cl_program CKernelLibrary::BuildFromSPIRV(cl_device_id Device, cl_context Context, const std::string& Path)
+{
+	InitFromEnvironment();
+	if(s_SPIRVDirectory.empty())
+		return nullptr;
+
+	// "Dir/Scan.cl" -> "<SPIR-V directory>/Scan.spv"
+	string name = Path.substr(Path.find_last_of("/\\") + 1);
+	name = name.substr(0, name.find_last_of('.'));
+	char last = s_SPIRVDirectory[s_SPIRVDirectory.size() - 1];
+	string modulePath = s_SPIRVDirectory + ((last == '/' || last == '\\') ? "" : "/") + name + ".spv";
+
+	time_t moduleTime, sourceTime;
+	if(!GetModificationTime(modulePath, moduleTime))
+		return nullptr;
+	// the module is stale if the program file or any file it includes changed after the build;
+	// includes that cannot be resolved fail the source build as well
+	string sourceCode;
+	set<string> files;
+	if(!LoadSource(Path, sourceCode, &files))
+		return nullptr;
+	for(set<string>::const_iterator it = files.begin(); it != files.end(); ++it)
+		if(GetModificationTime(*it, sourceTime) && sourceTime > moduleTime)
+		{
+			cout << modulePath << " is older than " << *it << ", building from source." << endl;
+			return nullptr;
+		}
+
+	ifstream file(modulePath.c_str(), ios::binary);
+	vector<unsigned char> module((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	cl_program program = CLUtil::BuildCLProgramFromIL(Device, Context, module);
+	if(program)
+		s_SPIRVPrograms++;
+	return program;
+}
+
+cl_program CKernelLibrary::GetProgram(cl_device_id Device, cl_context Context, const std::string& Path,
+	const CKernelSpecialization& Specialization)
+{
+	CProgramKey key;
+	key.Context = Context;
+	key.Device = Device;
+	key.Path = Path;
+	key.CompileOptions = Specialization.GetCompileOptions();
+
+	map<CProgramKey, cl_program>::iterator it = s_Programs.find(key);
+	if(it != s_Programs.end())
+	{
+		s_Hits++;
+		clRetainProgram(it->second);
+		return it->second;
+	}
+	s_Misses++;
+
+	// the offline modules are compiled without any host defines
+	cl_program program = nullptr;
+	if(key.CompileOptions.empty())
+		program = BuildFromSPIRV(Device, Context, Path);
+
+	if(program == nullptr)
+	{
+		string sourceCode;
+		if(!LoadSource(Path, sourceCode))
+			return nullptr;
+
+		program = CLUtil::BuildCLProgramFromMemory(Device, Context, sourceCode, key.CompileOptions);
+		if(program == nullptr)
+			return nullptr;
+	}
+
+	// one reference for the library, one for the caller
+	clRetainProgram(program);
+	s_Programs[key] = program;
+	return program;
+}
+
+void CKernelLibrary::ReleasePrograms(cl_context Context)
+{
+	map<CProgramKey, cl_program>::iterator it = s_Programs.begin();
+	while(it != s_Programs.end())
+	{
+		if(Context == nullptr || it->first.Context == Context)
+		{
+			clReleaseProgram(it->second);
+			s_Programs.erase(it++);
+		}
+		else
+			++it;
+	}
+}
+
+void CKernelLibrary::PrintStatistics()
+{
+	if(s_Hits + s_Misses == 0)
+		return;
+
+	cout << "Kernel library: " << s_Misses << " programs built";
+	if(s_SPIRVPrograms > 0)
+		cout << " (" << s_SPIRVPrograms << " from SPIR-V)";
+	cout << ", " << s_Hits << " reused specializations" << endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,164 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CKERNEL_LIBRARY_H
+#define _CKERNEL_LIBRARY_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include "CommonDefs.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <sstream>
+
+//! Compile-time constants of one specialized variant of a kernel program
+/*!
+	Every constant becomes a "-D NAME=VALUE" compiler option. The options are
+	generated in the order of the names, so two specializations with the same
+	constants always produce the same compile options (and share the cached program),
+	no matter in which order the constants were set.
+*/
+class CKernelSpecialization
+{
+public:
+	//! Integer constants (int, unsigned int, size_t, ...)
+	template<typename T>
+	CKernelSpecialization& Set(const std::string& Name, T Value)
+	{
+		std::stringstream value;
+		value << Value;
+		m_Constants[Name] = value.str();
+		return *this;
+	}
+
+	//! Float constants get the 'f' suffix, so they are not promoted to double in the kernel
+	CKernelSpecialization& Set(const std::string& Name, float Value);
+	CKernelSpecialization& Set(const std::string& Name, double Value);
+	//! Booleans become 1 or 0, to be used with #if
+	CKernelSpecialization& Set(const std::string& Name, bool Value);
+	//! Inserted verbatim, e.g. a type name: Set("T", "float4")
+	CKernelSpecialization& Set(const std::string& Name, const char* Value);
+	CKernelSpecialization& Set(const std::string& Name, const std::string& Value);
+
+	//! Defines a macro without a value, to be used with #ifdef
+	CKernelSpecialization& Define(const std::string& Name);
+
+	//! Any other compiler option, e.g. "-cl-fast-relaxed-math"
+	CKernelSpecialization& AddOption(const std::string& Option);
+
+	bool IsDefined(const std::string& Name) const { return m_Constants.count(Name) > 0; }
+
+	std::string GetCompileOptions() const;
+
+protected:
+	std::set<std::string>				m_Options;
+	// an empty value means a plain #define
+	std::map<std::string, std::string>	m_Constants;
+};
+
+//! Loads kernel sources with #include support and keeps the built programs of all specializations
+/*!
+	#include "File.cl" is resolved on the host: the file is searched next to the including
+	file first, then in the directories added with AddIncludeDirectory() or listed in the
+	environment variable GPGPU_KERNEL_INCLUDE_PATH (separated by ';') and finally in the
+	shared kernel library (Kernels/, the primitives used by several assignments).
+	Program files are looked up the same way if they are not in the working directory.
+	Each file is inserted only once per program (like #pragma once), #line directives keep
+	the line numbers of the compiler messages meaningful.
+	Includes are resolved regardless of surrounding #if blocks, so every included file has to exist.
+
+	GetProgram() builds a program once per context, device, file and specialization and
+	hands out additional references afterwards. Tasks release the returned program as before;
+	the library drops its own references in ReleasePrograms(), before the context is released.
+	Programs that are not in memory yet still go through CLUtil::BuildCLProgramFromMemory()
+	and thus the on-disk CProgramBinaryCache.
+
+	Programs without a specialization are loaded from the SPIR-V modules compiled at build
+	time (cmake/SPIRVKernels.cmake) if the device accepts SPIR-V, e.g. "Scan.cl" from
+	"<build directory>/SPIRV/Scan.spv". A module older than its source file or one of the
+	included files is ignored.
+	The environment variable GPGPU_SPIRV sets another directory, "off" always builds from source.
+*/
+class CKernelLibrary
+{
+public:
+	//! Loads a kernel source file and replaces its #include directives by the included files
+	//! (returned in pFiles together with the file itself)
+	static bool LoadSource(const std::string& Path, std::string& SourceCode, std::set<std::string>* pFiles = nullptr);
+
+	//! Returns a built program (with a reference owned by the caller) or nullptr
+	static cl_program GetProgram(cl_device_id Device, cl_context Context, const std::string& Path,
+		const CKernelSpecialization& Specialization = CKernelSpecialization());
+
+	static void AddIncludeDirectory(const std::string& Directory);
+
+	//! Releases the cached programs of one context, or of all contexts if Context is nullptr
+	static void ReleasePrograms(cl_context Context = nullptr);
+
+	static unsigned int GetHitCount() { return s_Hits; }
+	static unsigned int GetMissCount() { return s_Misses; }
+	static unsigned int GetSPIRVCount() { return s_SPIRVPrograms; }
+
+	static void PrintStatistics();
+
+protected:
+	struct CProgramKey
+	{
+		cl_context		Context;
+		cl_device_id	Device;
+		std::string		Path;
+		std::string		CompileOptions;
+
+		bool operator<(const CProgramKey& Other) const;
+	};
+
+	static void InitFromEnvironment();
+
+	static bool AppendFile(const std::string& Path, std::set<std::string>& IncludedFiles, std::string& SourceCode, int Depth);
+
+	static bool FindInclude(const std::string& Name, const std::string& IncludingFile, std::string& Path);
+
+	//! The working directory first, then the include directories
+	static std::string FindProgramFile(const std::string& Path);
+
+	//! Returns nullptr if there is no up-to-date module or the device cannot use it
+	static cl_program BuildFromSPIRV(cl_device_id Device, cl_context Context, const std::string& Path);
+
+	static bool						s_Initialized;
+	static std::vector<std::string>	s_IncludeDirectories;
+	//! Empty if the SPIR-V modules are not used
+	static std::string				s_SPIRVDirectory;
+	static std::map<CProgramKey, cl_program>	s_Programs;
+
+	static unsigned int				s_Hits;
+	static unsigned int				s_Misses;
+	static unsigned int				s_SPIRVPrograms;
+};
+
+#endif // _CKERNEL_LIBRARY_H
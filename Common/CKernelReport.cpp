@@ -0,0 +1,242 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CKernelReport.h"
+#include "CLUtil.h"
+
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+// what a GPU compute unit is assumed to hold at once, OpenCL has no query for it
+static const size_t		c_DefaultResidentWorkItems = 2048;
+static const size_t		c_ResidentWorkGroups = 16;
+
+std::vector<CKernelResources>	CKernelReport::s_Kernels;
+std::vector<CKernelOccupancy>	CKernelReport::s_Launches;
+
+static size_t GetResidentWorkItems()
+{
+	const char* pEnv = getenv("GPGPU_RESIDENT_WORK_ITEMS");
+	if(pEnv && atoi(pEnv) > 0)
+		return (size_t)atoi(pEnv);
+	return c_DefaultResidentWorkItems;
+}
+
+static std::string SizeToString(const size_t* pSize, cl_uint Dimensions)
+{
+	stringstream ss;
+	for(cl_uint i = 0; i < Dimensions; i++)
+		ss << (i > 0 ? "x" : "") << pSize[i];
+	return ss.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CKernelReport
+
+bool CKernelReport::QueryResources(cl_kernel Kernel, cl_device_id Device, CKernelResources& Resources)
+{
+	Resources.Name = CLUtil::GetKernelInfoString(Kernel, CL_KERNEL_FUNCTION_NAME);
+	Resources.Device = CLUtil::GetDeviceInfoString(Device, CL_DEVICE_NAME);
+	if(Resources.Device.empty())
+		Resources.Device = "unknown";
+	Resources.MaxWorkGroupSize = 0;
+	Resources.PreferredMultiple = 1;
+	Resources.LocalMemBytes = 0;
+	Resources.PrivateMemBytes = 0;
+
+	cl_int clError = clGetKernelWorkGroupInfo(Kernel, Device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &Resources.MaxWorkGroupSize, NULL);
+	clError |= clGetKernelWorkGroupInfo(Kernel, Device, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(size_t), &Resources.PreferredMultiple, NULL);
+	clError |= clGetKernelWorkGroupInfo(Kernel, Device, CL_KERNEL_LOCAL_MEM_SIZE, sizeof(cl_ulong), &Resources.LocalMemBytes, NULL);
+	clError |= clGetKernelWorkGroupInfo(Kernel, Device, CL_KERNEL_PRIVATE_MEM_SIZE, sizeof(cl_ulong), &Resources.PrivateMemBytes, NULL);
+	Resources.PreferredMultiple = max(Resources.PreferredMultiple, (size_t)1);
+	return clError == CL_SUCCESS && !Resources.Name.empty();
+}
+
+const CKernelResources* CKernelReport::FindKernel(const std::string& Name, const std::string& Device)
+{
+	for(size_t i = 0; i < s_Kernels.size(); i++)
+		if(s_Kernels[i].Name == Name && s_Kernels[i].Device == Device)
+			return &s_Kernels[i];
+	return nullptr;
+}
+
+void CKernelReport::RegisterProgram(cl_program Program, cl_device_id Device)
+{
+	cl_uint numKernels = 0;
+	if(clCreateKernelsInProgram(Program, 0, NULL, &numKernels) != CL_SUCCESS || numKernels == 0)
+		return;
+
+	vector<cl_kernel> kernels(numKernels, (cl_kernel)NULL);
+	if(clCreateKernelsInProgram(Program, numKernels, &kernels[0], NULL) != CL_SUCCESS)
+		return;
+
+	for(cl_uint i = 0; i < numKernels; i++)
+	{
+		CKernelResources resources;
+		// specializations of the same kernel are listed once, with the values of the first build
+		if(QueryResources(kernels[i], Device, resources) && !FindKernel(resources.Name, resources.Device))
+			s_Kernels.push_back(resources);
+		clReleaseKernel(kernels[i]);
+	}
+}
+
+const CKernelOccupancy* CKernelReport::Analyze(cl_kernel Kernel, cl_command_queue CommandQueue, cl_uint Dimensions,
+	const size_t* pGlobalWorkSize, const size_t* pLocalWorkSize)
+{
+	// without a local size the runtime picks one, there is nothing to rate
+	if(!pLocalWorkSize || Dimensions < 1 || Dimensions > 3)
+		return nullptr;
+
+	cl_device_id device;
+	if(clGetCommandQueueInfo(CommandQueue, CL_QUEUE_DEVICE, sizeof(device), &device, NULL) != CL_SUCCESS)
+		return nullptr;
+
+	// this already includes the __local arguments that are currently set
+	CKernelResources resources;
+	if(!QueryResources(Kernel, device, resources))
+		return nullptr;
+	if(!FindKernel(resources.Name, resources.Device))
+		s_Kernels.push_back(resources);
+
+	CKernelOccupancy launch;
+	launch.Name = resources.Name;
+	launch.Device = resources.Device;
+	launch.Dimensions = Dimensions;
+	launch.WorkGroupSize = 1;
+	launch.NumGroups = 1;
+	for(cl_uint i = 0; i < 3; i++)
+	{
+		launch.GlobalSize[i] = i < Dimensions ? pGlobalWorkSize[i] : 1;
+		launch.LocalSize[i] = i < Dimensions ? max(pLocalWorkSize[i], (size_t)1) : 1;
+		launch.WorkGroupSize *= launch.LocalSize[i];
+		launch.NumGroups *= (launch.GlobalSize[i] + launch.LocalSize[i] - 1) / launch.LocalSize[i];
+	}
+	launch.LocalMemBytes = resources.LocalMemBytes;
+
+	for(size_t i = 0; i < s_Launches.size(); i++)
+	{
+		const CKernelOccupancy& other = s_Launches[i];
+		if(other.Name == launch.Name && other.Device == launch.Device && other.Dimensions == launch.Dimensions &&
+			equal(other.GlobalSize, other.GlobalSize + 3, launch.GlobalSize) &&
+			equal(other.LocalSize, other.LocalSize + 3, launch.LocalSize) && other.LocalMemBytes == launch.LocalMemBytes)
+			return &s_Launches[i];
+	}
+
+	cl_device_type type = CL_DEVICE_TYPE_GPU;
+	cl_uint computeUnits = 1;
+	cl_ulong deviceLocalMem = 0;
+	clGetDeviceInfo(device, CL_DEVICE_TYPE, sizeof(type), &type, NULL);
+	clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(computeUnits), &computeUnits, NULL);
+	clGetDeviceInfo(device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(deviceLocalMem), &deviceLocalMem, NULL);
+
+	// a partially filled warp / wavefront still occupies all of its lanes
+	size_t multiple = resources.PreferredMultiple;
+	size_t paddedGroupSize = (launch.WorkGroupSize + multiple - 1) / multiple * multiple;
+	launch.LaneUtilization = double(launch.WorkGroupSize) / double(paddedGroupSize);
+
+	stringstream warning;
+	if(resources.MaxWorkGroupSize > 0 && launch.WorkGroupSize > resources.MaxWorkGroupSize)
+	{
+		warning << "work-group size " << launch.WorkGroupSize << " exceeds the maximum of " << resources.MaxWorkGroupSize << " for this kernel, the launch fails";
+		launch.Warnings.push_back(warning.str());
+	}
+	if(launch.WorkGroupSize % multiple != 0)
+	{
+		warning.str("");
+		warning << "work-group size " << launch.WorkGroupSize << " is not a multiple of " << multiple << ", "
+			<< fixed << setprecision(0) << 100.0 * (1.0 - launch.LaneUtilization) << "% of the SIMD lanes of a group idle";
+		launch.Warnings.push_back(warning.str());
+	}
+	if(deviceLocalMem > 0 && launch.LocalMemBytes > deviceLocalMem)
+	{
+		warning.str("");
+		warning << launch.LocalMemBytes << " bytes of local memory per group exceed the " << deviceLocalMem << " bytes of the device";
+		launch.Warnings.push_back(warning.str());
+	}
+	if(launch.NumGroups < computeUnits)
+	{
+		warning.str("");
+		warning << "only " << launch.NumGroups << " work-groups for " << computeUnits << " compute units";
+		launch.Warnings.push_back(warning.str());
+	}
+
+	if(type & CL_DEVICE_TYPE_GPU)
+	{
+		size_t residentWorkItems = GetResidentWorkItems();
+		size_t byWorkItems = residentWorkItems / paddedGroupSize;
+		size_t byLocalMem = launch.LocalMemBytes > 0 ? (size_t)(deviceLocalMem / launch.LocalMemBytes) : c_ResidentWorkGroups;
+
+		launch.GroupsPerComputeUnit = min(byWorkItems, min(byLocalMem, c_ResidentWorkGroups));
+		if(launch.GroupsPerComputeUnit == byLocalMem && byLocalMem < min(byWorkItems, c_ResidentWorkGroups))
+			launch.Limiter = "local memory";
+		else if(launch.GroupsPerComputeUnit == c_ResidentWorkGroups && c_ResidentWorkGroups < byWorkItems)
+			launch.Limiter = "work-groups";
+		else
+			launch.Limiter = "work-items";
+		launch.Occupancy = min(1.0, double(launch.GroupsPerComputeUnit * paddedGroupSize) / double(residentWorkItems));
+
+		if(launch.Occupancy < 0.5 && launch.Limiter != "work-items")
+		{
+			warning.str("");
+			warning << fixed << setprecision(0);
+			if(launch.Limiter == "local memory")
+				warning << launch.LocalMemBytes << " bytes of local memory per group";
+			else
+				warning << "work-groups of " << launch.WorkGroupSize << " work-items";
+			warning << " limit the occupancy to " << 100.0 * launch.Occupancy << "%";
+			launch.Warnings.push_back(warning.str());
+		}
+	}
+	else
+	{
+		// a CPU core runs one work-group after the other
+		launch.GroupsPerComputeUnit = 1;
+		launch.Limiter = "work-groups";
+		launch.Occupancy = 0.0;
+	}
+
+	s_Launches.push_back(launch);
+	return &s_Launches.back();
+}
+
+void CKernelReport::Clear()
+{
+	s_Kernels.clear();
+	s_Launches.clear();
+}
+
+void CKernelReport::Print(std::ostream& Stream)
+{
+	if(s_Launches.empty())
+		return;
+
+	Stream << "Kernel resources and estimated occupancy:" << endl;
+	for(size_t i = 0; i < s_Launches.size(); i++)
+	{
+		const CKernelOccupancy& launch = s_Launches[i];
+		const CKernelResources* pKernel = FindKernel(launch.Name, launch.Device);
+
+		Stream << "  " << launch.Name << " [" << SizeToString(launch.GlobalSize, launch.Dimensions)
+			<< " / " << SizeToString(launch.LocalSize, launch.Dimensions) << "]: ";
+		if(pKernel)
+			Stream << "max group " << pKernel->MaxWorkGroupSize << ", multiple " << pKernel->PreferredMultiple
+				<< ", private " << pKernel->PrivateMemBytes << " B, ";
+		Stream << "local " << launch.LocalMemBytes << " B";
+		if(launch.Occupancy > 0.0)
+			Stream << ", " << launch.GroupsPerComputeUnit << " groups/CU, occupancy "
+				<< (int)(100.0 * launch.Occupancy + 0.5) << "%"
+				<< " (" << launch.Limiter << ")";
+		Stream << endl;
+
+		for(size_t w = 0; w < launch.Warnings.size(); w++)
+			Stream << "    warning: " << launch.Warnings[w] << endl;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
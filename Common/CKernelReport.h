@@ -0,0 +1,124 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CKERNEL_REPORT_H
+#define _CKERNEL_REPORT_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include "CommonDefs.h"
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+//! Resource usage of a compiled kernel, as reported by clGetKernelWorkGroupInfo()
+struct CKernelResources
+{
+	std::string		Name;
+	std::string		Device;
+	//! CL_KERNEL_WORK_GROUP_SIZE: the largest work-group the kernel can be launched with
+	size_t			MaxWorkGroupSize;
+	//! CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE: usually the SIMD width (warp / wavefront)
+	size_t			PreferredMultiple;
+	//! __local memory declared in the kernel body (without __local arguments)
+	cl_ulong		LocalMemBytes;
+	//! private memory per work-item, non-zero usually means spilled registers or private arrays
+	cl_ulong		PrivateMemBytes;
+};
+
+//! Estimated occupancy of one launch configuration of a kernel
+struct CKernelOccupancy
+{
+	std::string		Name;
+	std::string		Device;
+	cl_uint			Dimensions;
+	size_t			GlobalSize[3];
+	size_t			LocalSize[3];
+	size_t			WorkGroupSize;
+	//! __local memory per work-group, including the __local arguments of the launch
+	cl_ulong		LocalMemBytes;
+	size_t			NumGroups;
+	size_t			GroupsPerComputeUnit;
+	//! the resource that bounds GroupsPerComputeUnit: "work-items", "work-groups" or "local memory"
+	std::string		Limiter;
+	//! resident work-items / work-items a compute unit can hold (0..1), 0 for CPU devices
+	double			Occupancy;
+	//! fraction of the SIMD lanes of the last warp / wavefront of a group that do work
+	double			LaneUtilization;
+	std::vector<std::string>	Warnings;
+};
+
+//! Collects the resource usage of every built kernel and rates the launch configurations
+/*!
+	CLUtil::BuildCLProgramFromMemory() registers all kernels of every program it
+	builds. CLUtil::ProfileKernel(), CCommandGraph and CCommandRecording pass the
+	launch configurations they run to Analyze(), after the kernel arguments are
+	set, so the __local arguments count towards the local memory of a group.
+
+	OpenCL does not expose how many work-items or work-groups a compute unit can
+	hold, so the occupancy is an estimate: GPUs are assumed to keep 2048
+	work-items and 16 work-groups per compute unit (typical for current NVIDIA
+	and AMD hardware; GPGPU_RESIDENT_WORK_ITEMS overrides the first) and to
+	share CL_DEVICE_LOCAL_MEM_SIZE between the resident groups. Configurations
+	that are likely to waste occupancy get warnings:
+	- work-groups larger than CL_KERNEL_WORK_GROUP_SIZE (the launch fails)
+	- work-group sizes that are not a multiple of the preferred multiple
+	- local memory or small groups that limit the occupancy to less than 50%
+	- fewer work-groups than compute units
+
+	Print() writes the summary to the console, CBenchmarkReporter::Flush()
+	adds the kernels and launch configurations to the benchmark output.
+*/
+class CKernelReport
+{
+public:
+	//! Queries the resources of all kernels in a program that was built for Device
+	static void RegisterProgram(cl_program Program, cl_device_id Device);
+
+	static bool QueryResources(cl_kernel Kernel, cl_device_id Device, CKernelResources& Resources);
+
+	//! Estimates the occupancy of a launch. Repeated configurations are only analyzed once.
+	static const CKernelOccupancy* Analyze(cl_kernel Kernel, cl_command_queue CommandQueue, cl_uint Dimensions,
+		const size_t* pGlobalWorkSize, const size_t* pLocalWorkSize);
+
+	static const std::vector<CKernelResources>& GetKernels() { return s_Kernels; }
+	static const std::vector<CKernelOccupancy>& GetLaunches() { return s_Launches; }
+
+	static void Clear();
+
+	static const CKernelResources* FindKernel(const std::string& Name, const std::string& Device);
+
+	//! Prints the analyzed launch configurations and their warnings
+	static void Print(std::ostream& Stream);
+
+protected:
+
+	static std::vector<CKernelResources>	s_Kernels;
+	static std::vector<CKernelOccupancy>	s_Launches;
+};
+
+#endif // _CKERNEL_REPORT_H
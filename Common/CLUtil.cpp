@@ -0,0 +1,389 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CLUtil.h"
+#include "CTimer.h"
+#include "CProgramBinaryCache.h"
+#include "CTracer.h"
+#include "CKernelReport.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdio>
+
+using namespace std;
+
+// SPIR-V is core in OpenCL 2.1 and available through cl_khr_il_program before that. The device
+// query has the same value in both and the functions are resolved at runtime, so the same binary
+// runs with a 1.2 ICD loader (which does not export clCreateProgramWithIL).
+#define GPGPU_DEVICE_IL_VERSION		0x105B
+
+typedef cl_program (CL_API_CALL *PFNCreateProgramWithIL)(cl_context Context, const void* pIL, size_t Length, cl_int* pError);
+
+///////////////////////////////////////////////////////////////////////////////
+// CLUtil
+
+size_t CLUtil::GetGlobalWorkSize(size_t DataElemCount, size_t LocalWorkSize)
+{
+	size_t r = DataElemCount % LocalWorkSize;
+	if(r == 0)
+		return DataElemCount;
+	else
+		return DataElemCount + LocalWorkSize - r;
+}
+
+bool CLUtil::LoadProgramSourceToMemory(const std::string& Path, std::string& SourceCode)
+{
+	ifstream sourceFile;
+	
+	sourceFile.open(Path.c_str());
+	if (!sourceFile.is_open())
+	{
+		cerr << "Failed to open file '" << Path << "'." << endl;
+		return false;
+	}
+
+	// read the entire file into a string
+	sourceFile.seekg(0, ios::end);
+	ifstream::pos_type fileSize = sourceFile.tellg();
+	sourceFile.seekg(0, ios::beg);
+
+	SourceCode.clear();
+	SourceCode.resize((size_t)fileSize);
+	sourceFile.read(&SourceCode[0], fileSize);
+
+	return true;
+}
+
+cl_program CLUtil::BuildCLProgramFromMemory(cl_device_id Device, cl_context Context, const std::string& SourceCode, const std::string& CompileOptions)
+{
+	
+	// Ignore the last parameter CompileOptions in assignment 1
+	// This may be used later to pass flags and macro definitions to the OpenCL compiler
+
+	cl_program prog = CProgramBinaryCache::Load(Device, Context, SourceCode, CompileOptions);
+	if(prog)
+	{
+		CKernelReport::RegisterProgram(prog, Device);
+		return prog;
+	}
+
+	CTimer timer;
+	timer.Start();
+
+		string srcSolution = SourceCode;
+
+	const char* src = srcSolution.c_str();
+	size_t length = srcSolution.size();
+
+	cl_int clError;
+	prog = clCreateProgramWithSource(Context, 1, &src, &length, &clError);
+	if(CL_SUCCESS != clError)
+	{
+		cerr<<"Failed to create CL program from source.";
+		return nullptr;
+	}
+
+	// program created, now build it:
+	const char* pCompileOptions = CompileOptions.size() > 0 ? CompileOptions.c_str() : nullptr;
+	clError = clBuildProgram(prog, 1, &Device, pCompileOptions, NULL, NULL);
+	PrintBuildLog(prog, Device);
+	if(CL_SUCCESS != clError)
+	{
+		cerr<<"Failed to build CL program.";
+		SAFE_RELEASE_PROGRAM(prog);
+		return nullptr;
+	}
+
+	timer.Stop();
+	CProgramBinaryCache::Store(Device, prog, SourceCode, CompileOptions, timer.GetElapsedMilliseconds());
+	CKernelReport::RegisterProgram(prog, Device);
+
+	return prog;
+}
+
+cl_program CLUtil::BuildCLProgramFromIL(cl_device_id Device, cl_context Context, const std::vector<unsigned char>& IL, const std::string& CompileOptions)
+{
+	if(IL.empty())
+		return nullptr;
+
+	// the offline modules are compiled for spir64
+	char ilVersion[256] = "";
+	cl_uint addressBits = 0;
+	if(clGetDeviceInfo(Device, GPGPU_DEVICE_IL_VERSION, sizeof(ilVersion) - 1, ilVersion, NULL) != CL_SUCCESS || string(ilVersion).find("SPIR-V") == string::npos)
+		return nullptr;
+	clGetDeviceInfo(Device, CL_DEVICE_ADDRESS_BITS, sizeof(cl_uint), &addressBits, NULL);
+	if(addressBits != 64)
+		return nullptr;
+
+	cl_platform_id platform;
+	V_RETURN_0_CL(clGetDeviceInfo(Device, CL_DEVICE_PLATFORM, sizeof(cl_platform_id), &platform, NULL), "Failed to query the platform of the device.");
+
+	// the core entry point of 2.1 devices if the platform hands it out, otherwise the extension
+	PFNCreateProgramWithIL pCreateProgramWithIL = nullptr;
+	char deviceVersion[256] = "";
+	int major = 0, minor = 0;
+	clGetDeviceInfo(Device, CL_DEVICE_VERSION, sizeof(deviceVersion) - 1, deviceVersion, NULL);
+	if(sscanf(deviceVersion, "OpenCL %d.%d", &major, &minor) == 2 && (major > 2 || (major == 2 && minor >= 1)))
+		pCreateProgramWithIL = (PFNCreateProgramWithIL)clGetExtensionFunctionAddressForPlatform(platform, "clCreateProgramWithIL");
+	if(pCreateProgramWithIL == nullptr)
+		pCreateProgramWithIL = (PFNCreateProgramWithIL)clGetExtensionFunctionAddressForPlatform(platform, "clCreateProgramWithILKHR");
+	if(pCreateProgramWithIL == nullptr)
+		return nullptr;
+
+	cl_int clError = CL_INVALID_OPERATION;
+	cl_program prog = pCreateProgramWithIL(Context, &IL[0], IL.size(), &clError);
+	if(CL_SUCCESS != clError || prog == nullptr)
+	{
+		cerr<<"Failed to create CL program from SPIR-V ["<<GetCLErrorString(clError)<<"]."<<endl;
+		return nullptr;
+	}
+
+	// this only translates the module to device code, the compiler front end already ran at build time
+	const char* pCompileOptions = CompileOptions.size() > 0 ? CompileOptions.c_str() : nullptr;
+	clError = clBuildProgram(prog, 1, &Device, pCompileOptions, NULL, NULL);
+	if(CL_SUCCESS != clError)
+	{
+		PrintBuildLog(prog, Device);
+		cerr<<"Failed to build CL program from SPIR-V."<<endl;
+		SAFE_RELEASE_PROGRAM(prog);
+		return nullptr;
+	}
+
+	CKernelReport::RegisterProgram(prog, Device);
+	return prog;
+}
+
+void CLUtil::PrintBuildLog(cl_program Program, cl_device_id Device)
+{
+	cl_build_status buildStatus;
+	clGetProgramBuildInfo(Program, Device, CL_PROGRAM_BUILD_STATUS, sizeof(cl_build_status), &buildStatus, NULL);
+
+	// let's print out possible warnings even if the kernel compiled..
+	//if(buildStatus == CL_SUCCESS)
+	//	return;
+
+	//there were some errors.
+	size_t logSize;
+	clGetProgramBuildInfo(Program, Device, CL_PROGRAM_BUILD_LOG, 0, NULL, &logSize);
+	string buildLog(logSize, ' ');
+
+	clGetProgramBuildInfo(Program, Device, CL_PROGRAM_BUILD_LOG, logSize, &buildLog[0], NULL);
+	buildLog[logSize] = '\0';
+
+	if(buildStatus != CL_SUCCESS)
+		cout<<"There were build errors!"<<endl;
+	cout<<"Build log:"<<endl;
+	cout<<buildLog<<endl;
+}
+
+std::string CLUtil::GetDeviceInfoString(cl_device_id Device, cl_device_info Param)
+{
+	size_t size = 0;
+	if(clGetDeviceInfo(Device, Param, 0, NULL, &size) != CL_SUCCESS || size == 0)
+		return "";
+
+	string value(size, '\0');
+	clGetDeviceInfo(Device, Param, size, &value[0], NULL);
+	// strip the terminating zero(s)
+	value.resize(value.find_last_not_of('\0') + 1);
+	return value;
+}
+
+std::string CLUtil::GetPlatformInfoString(cl_platform_id Platform, cl_platform_info Param)
+{
+	size_t size = 0;
+	if(clGetPlatformInfo(Platform, Param, 0, NULL, &size) != CL_SUCCESS || size == 0)
+		return "";
+
+	string value(size, '\0');
+	clGetPlatformInfo(Platform, Param, size, &value[0], NULL);
+	value.resize(value.find_last_not_of('\0') + 1);
+	return value;
+}
+
+std::string CLUtil::GetKernelInfoString(cl_kernel Kernel, cl_kernel_info Param)
+{
+	size_t size = 0;
+	if(clGetKernelInfo(Kernel, Param, 0, NULL, &size) != CL_SUCCESS || size == 0)
+		return "";
+
+	string value(size, '\0');
+	clGetKernelInfo(Kernel, Param, size, &value[0], NULL);
+	value.resize(value.find_last_not_of('\0') + 1);
+	return value;
+}
+
+bool CLUtil::IsProfilingEnabled(cl_command_queue CommandQueue)
+{
+	cl_command_queue_properties props = 0;
+	if(clGetCommandQueueInfo(CommandQueue, CL_QUEUE_PROPERTIES, sizeof(props), &props, NULL) != CL_SUCCESS)
+		return false;
+	return (props & CL_QUEUE_PROFILING_ENABLE) != 0;
+}
+
+double CLUtil::GetEventMilliseconds(cl_event Event)
+{
+	cl_ulong start = 0, end = 0;
+	cl_int clErr = clGetEventProfilingInfo(Event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+	clErr |= clGetEventProfilingInfo(Event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+	if(clErr != CL_SUCCESS || end < start)
+		return -1.0;
+	return 1.0e-6 * double(end - start);
+}
+
+double CLUtil::ProfileKernel(cl_command_queue CommandQueue, cl_kernel Kernel, cl_uint Dimensions, 
+		const size_t* pGlobalWorkSize, const size_t* pLocalWorkSize, int NIterations)
+{
+	CKernelReport::Analyze(Kernel, CommandQueue, Dimensions, pGlobalWorkSize, pLocalWorkSize);
+
+	// prefer the device timers, they are not affected by enqueue overhead or host jitter
+	if(IsProfilingEnabled(CommandQueue))
+	{
+		CKernelProfile profile;
+		if(!ProfileKernelEvents(CommandQueue, Kernel, Dimensions, pGlobalWorkSize, pLocalWorkSize, NIterations, std::max(1, NIterations / 10), profile))
+			return -1;
+		return profile.Execution.GetMean();
+	}
+
+	CTimer timer;
+	cl_int clErr;
+
+	// wait until the command queue is empty...
+	// Should not be used in production code, but this synchronizes HOST and DEVICE
+	clErr = clFinish(CommandQueue);
+
+	timer.Start();
+
+	// run the kernel N times for better average accuracy
+	for(int i = 0; i < NIterations; i++)
+	{
+		clErr |= clEnqueueNDRangeKernel(CommandQueue, Kernel, Dimensions, NULL, pGlobalWorkSize, pLocalWorkSize, 0, NULL, NULL);
+	}
+	// wait again to sync
+	clErr |= clFinish(CommandQueue);
+
+	timer.Stop();
+
+	if(clErr != CL_SUCCESS)
+	{
+		string errorString = GetCLErrorString(clErr);
+		cerr<<"Kernel execution failure: "<<errorString<<endl;
+		return -1;
+	}
+
+	return timer.GetElapsedMilliseconds() / double(NIterations);
+}
+
+bool CLUtil::ProfileKernelEvents(cl_command_queue CommandQueue, cl_kernel Kernel, cl_uint Dimensions, 
+		const size_t* pGlobalWorkSize, const size_t* pLocalWorkSize, int NIterations, int NWarmupIterations,
+		CKernelProfile& Profile, bool RejectOutliers)
+{
+	Profile.Clear();
+
+	TRACE_SCOPE("ProfileKernelEvents");
+
+	CKernelReport::Analyze(Kernel, CommandQueue, Dimensions, pGlobalWorkSize, pLocalWorkSize);
+
+	if(!IsProfilingEnabled(CommandQueue))
+	{
+		cerr<<"The command queue was not created with CL_QUEUE_PROFILING_ENABLE."<<endl;
+		return false;
+	}
+
+	V_RETURN_FALSE_CL(clFinish(CommandQueue), "Error finishing the queue!");
+
+	// warm-up runs (first launch overhead, caches, clocks ramping up) are not recorded
+	for(int i = 0; i < NWarmupIterations; i++)
+		V_RETURN_FALSE_CL(clEnqueueNDRangeKernel(CommandQueue, Kernel, Dimensions, NULL, pGlobalWorkSize, pLocalWorkSize, 0, NULL, NULL), "Error executing kernel!");
+	V_RETURN_FALSE_CL(clFinish(CommandQueue), "Error finishing the queue!");
+
+	std::vector<cl_event> events(NIterations, (cl_event)NULL);
+	cl_int clErr = CL_SUCCESS;
+	for(int i = 0; i < NIterations && clErr == CL_SUCCESS; i++)
+		clErr = clEnqueueNDRangeKernel(CommandQueue, Kernel, Dimensions, NULL, pGlobalWorkSize, pLocalWorkSize, 0, NULL, &events[i]);
+	cl_int finishErr = clFinish(CommandQueue);
+
+	bool success = (clErr == CL_SUCCESS && finishErr == CL_SUCCESS);
+	if(!success)
+		cerr<<"Kernel execution failure: "<<GetCLErrorString(clErr != CL_SUCCESS ? clErr : finishErr)<<endl;
+
+	for(int i = 0; i < NIterations; i++)
+	{
+		if(!events[i])
+			continue;
+		if(success && !Profile.AddEvent(events[i]))
+		{
+			cerr<<"Failed to query the event profiling info."<<endl;
+			success = false;
+		}
+		TRACE_CL_EVENT(CTracer::GetKernelName(Kernel), events[i]);
+		clReleaseEvent(events[i]);
+	}
+
+	Profile.Evaluate(RejectOutliers);
+
+	return success;
+}
+
+#define CL_ERROR(x) case (x): return #x;
+
+const char* CLUtil::GetCLErrorString(cl_int CLErrorCode)
+{
+	switch(CLErrorCode)
+	{
+        CL_ERROR(CL_SUCCESS);
+        CL_ERROR(CL_DEVICE_NOT_FOUND);
+        CL_ERROR(CL_DEVICE_NOT_AVAILABLE);
+        CL_ERROR(CL_COMPILER_NOT_AVAILABLE);
+        CL_ERROR(CL_MEM_OBJECT_ALLOCATION_FAILURE);
+        CL_ERROR(CL_OUT_OF_RESOURCES);
+        CL_ERROR(CL_OUT_OF_HOST_MEMORY);
+        CL_ERROR(CL_PROFILING_INFO_NOT_AVAILABLE);
+        CL_ERROR(CL_MEM_COPY_OVERLAP);
+        CL_ERROR(CL_IMAGE_FORMAT_MISMATCH);
+        CL_ERROR(CL_IMAGE_FORMAT_NOT_SUPPORTED);
+        CL_ERROR(CL_BUILD_PROGRAM_FAILURE);
+        CL_ERROR(CL_MAP_FAILURE);
+        CL_ERROR(CL_INVALID_VALUE);
+        CL_ERROR(CL_INVALID_DEVICE_TYPE);
+        CL_ERROR(CL_INVALID_PLATFORM);
+        CL_ERROR(CL_INVALID_DEVICE);
+        CL_ERROR(CL_INVALID_CONTEXT);
+        CL_ERROR(CL_INVALID_QUEUE_PROPERTIES);
+        CL_ERROR(CL_INVALID_COMMAND_QUEUE);
+        CL_ERROR(CL_INVALID_HOST_PTR);
+        CL_ERROR(CL_INVALID_MEM_OBJECT);
+        CL_ERROR(CL_INVALID_IMAGE_FORMAT_DESCRIPTOR);
+        CL_ERROR(CL_INVALID_IMAGE_SIZE);
+        CL_ERROR(CL_INVALID_SAMPLER);
+        CL_ERROR(CL_INVALID_BINARY);
+        CL_ERROR(CL_INVALID_BUILD_OPTIONS);
+        CL_ERROR(CL_INVALID_PROGRAM);
+        CL_ERROR(CL_INVALID_PROGRAM_EXECUTABLE);
+        CL_ERROR(CL_INVALID_KERNEL_NAME);
+        CL_ERROR(CL_INVALID_KERNEL_DEFINITION);
+        CL_ERROR(CL_INVALID_KERNEL);
+        CL_ERROR(CL_INVALID_ARG_INDEX);
+        CL_ERROR(CL_INVALID_ARG_VALUE);
+        CL_ERROR(CL_INVALID_ARG_SIZE);
+        CL_ERROR(CL_INVALID_KERNEL_ARGS);
+        CL_ERROR(CL_INVALID_WORK_DIMENSION);
+        CL_ERROR(CL_INVALID_WORK_GROUP_SIZE);
+        CL_ERROR(CL_INVALID_WORK_ITEM_SIZE);
+        CL_ERROR(CL_INVALID_GLOBAL_OFFSET);
+        CL_ERROR(CL_INVALID_EVENT_WAIT_LIST);
+        CL_ERROR(CL_INVALID_EVENT);
+        CL_ERROR(CL_INVALID_OPERATION);
+        CL_ERROR(CL_INVALID_GL_OBJECT);
+        CL_ERROR(CL_INVALID_BUFFER_SIZE);
+        CL_ERROR(CL_INVALID_MIP_LEVEL);
+        default:
+			return "Unknown error code";
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -30,8 +30,10 @@
 #endif 
 
 #include "CommonDefs.h"
+#include "CTimingStatistics.h"
 
 #include <string>
+#include <vector>
 #include <iostream>
 #include <algorithm>
 
@@ -49,8 +51,24 @@ public:
 	//! Builds a CL program
 	static cl_program BuildCLProgramFromMemory(cl_device_id Device, cl_context Context, const std::string& SourceCode, const std::string& CompileOptions = "");
 
+	//! Builds a CL program from a SPIR-V module (clCreateProgramWithIL or cl_khr_il_program)
+	/*!
+		Returns nullptr if the device does not accept SPIR-V for 64 bit addressing or the module
+		fails to build, so the caller can fall back to the source.
+	*/
+	static cl_program BuildCLProgramFromIL(cl_device_id Device, cl_context Context, const std::vector<unsigned char>& IL, const std::string& CompileOptions = "");
+
 	static void PrintBuildLog(cl_program Program, cl_device_id Device);
 
+	//! Returns a string property of a device (e.g. CL_DEVICE_NAME) without the terminating zero, or "" if the query fails
+	static std::string GetDeviceInfoString(cl_device_id Device, cl_device_info Param);
+
+	//! Returns a string property of a platform (e.g. CL_PLATFORM_NAME), or "" if the query fails
+	static std::string GetPlatformInfoString(cl_platform_id Platform, cl_platform_info Param);
+
+	//! Returns a string property of a kernel (e.g. CL_KERNEL_FUNCTION_NAME), or "" if the query fails
+	static std::string GetKernelInfoString(cl_kernel Kernel, cl_kernel_info Param);
+
 	//! Measures the execution time of a kernel by executing it N times and returning the average time in milliseconds.
 	/*!
 		The scheduling cost of the kernel can be amortized if we enqueue
@@ -59,6 +77,25 @@ public:
 	static double ProfileKernel(cl_command_queue CommandQueue, cl_kernel Kernel, cl_uint Dimensions, 
 		const size_t* pGlobalWorkSize, const size_t* pLocalWorkSize, int NIterations);
 
+	//! Measures every single launch of a kernel with the device timers (OpenCL events).
+	/*!
+		Requires a command queue created with CL_QUEUE_PROFILING_ENABLE.
+		The first NWarmupIterations launches are not recorded. Profile receives the
+		execution times and the idle gaps between the remaining NIterations launches.
+		If the queue supports profiling, ProfileKernel() uses this as well and returns
+		the mean execution time; the host timer is only used without profiling.
+		Both return -1 if a launch fails.
+	*/
+	static bool ProfileKernelEvents(cl_command_queue CommandQueue, cl_kernel Kernel, cl_uint Dimensions, 
+		const size_t* pGlobalWorkSize, const size_t* pLocalWorkSize, int NIterations, int NWarmupIterations,
+		CKernelProfile& Profile, bool RejectOutliers = true);
+
+	//! Returns true if the command queue was created with CL_QUEUE_PROFILING_ENABLE
+	static bool IsProfilingEnabled(cl_command_queue CommandQueue);
+
+	//! Returns the device-side duration (START to END) of a finished command in ms, or -1 if not available
+	static double GetEventMilliseconds(cl_event Event);
+
 	static const char* GetCLErrorString(cl_int CLErrorCode);
 };
 
@@ -0,0 +1,568 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CMatrixTransform.h"
+
+#include "CLUtil.h"
+#include "CKernelLibrary.h"
+#include "CThreadPool.h"
+#include "CDeviceBufferPool.h"
+#include "CTimer.h"
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+using namespace std;
+
+// same order as CMatrixTransform::ETransform
+static const char* g_KernelNames[CMatrixTransform::TRANSFORM_COUNT] = {
+	"MatrixTranspose", "MatrixRotate90", "MatrixRotate180", "MatrixRotate270", "MatrixFlipH", "MatrixFlipV"
+};
+static const char* g_BatchKernelNames[CMatrixTransform::TRANSFORM_COUNT] = {
+	"MatrixBatchTranspose", "MatrixBatchRotate90", "MatrixBatchRotate180", "MatrixBatchRotate270", "MatrixBatchFlipH", "MatrixBatchFlipV"
+};
+static const char* g_InPlaceKernelNames[CMatrixTransform::TRANSFORM_COUNT] = {
+	"MatrixTransposeInPlace", "MatrixRotate90InPlace", nullptr, "MatrixRotate270InPlace", nullptr, nullptr
+};
+static const char* g_TransformNames[CMatrixTransform::TRANSFORM_COUNT] = {
+	"Transpose", "Rotate90", "Rotate180", "Rotate270", "FlipH", "FlipV"
+};
+
+// same order as CMatrixTransform::EElementType; the kernels move half as ushort
+static const char* g_TypeNames[CMatrixTransform::ELEMENT_TYPE_COUNT] = { "float", "int", "half", "float4" };
+static const char* g_KernelTypes[CMatrixTransform::ELEMENT_TYPE_COUNT] = { "float", "int", "ushort", "float4" };
+static const size_t g_ElementSizes[CMatrixTransform::ELEMENT_TYPE_COUNT] = { 4, 4, 2, 16 };
+
+// edge of the blocks of the CPU reference
+static const size_t c_CPUBlockSize = 32;
+// the recursion of the in-place CPU reference stops at blocks of this many elements
+static const size_t c_CPUInPlaceBlockElements = 256;
+// local memory the batched kernels stage small matrices in (at least one tile)
+static const size_t c_BatchLocalBytes = 16384;
+
+template<size_t N>
+struct CElement
+{
+	unsigned char Bytes[N];
+};
+
+// blocked, so both the reads and the (possibly transposed) writes of a block stay in the cache
+template<typename E>
+static void TransformBlocked(CMatrixTransform::ETransform Transform, const E* pIn, E* pOut, size_t SizeX, size_t SizeY)
+{
+	CThreadPool::ParallelFor(0, (SizeY + c_CPUBlockSize - 1) / c_CPUBlockSize, [=](size_t BlockBegin, size_t BlockEnd) {
+		for(size_t by = BlockBegin * c_CPUBlockSize; by < std::min(BlockEnd * c_CPUBlockSize, SizeY); by += c_CPUBlockSize)
+		{
+			size_t yEnd = std::min(by + c_CPUBlockSize, SizeY);
+			for(size_t bx = 0; bx < SizeX; bx += c_CPUBlockSize)
+			{
+				size_t xEnd = std::min(bx + c_CPUBlockSize, SizeX);
+				for(size_t y = by; y < yEnd; y++)
+					for(size_t x = bx; x < xEnd; x++)
+						pOut[CMatrixTransform::GetOutputIndex(Transform, x, y, SizeX, SizeY)] = pIn[y * SizeX + x];
+			}
+		}
+	});
+}
+
+// swaps the block [C0, C0 + Cols) x [R0, R0 + Rows) with its mirror image at the diagonal
+template<typename E>
+static void SwapTransposed(E* pMatrix, size_t N, size_t R0, size_t C0, size_t Rows, size_t Cols)
+{
+	if(Rows * Cols <= c_CPUInPlaceBlockElements)
+	{
+		for(size_t r = R0; r < R0 + Rows; r++)
+			for(size_t c = C0; c < C0 + Cols; c++)
+				std::swap(pMatrix[r * N + c], pMatrix[c * N + r]);
+	}
+	else if(Rows >= Cols)
+	{
+		SwapTransposed(pMatrix, N, R0, C0, Rows / 2, Cols);
+		SwapTransposed(pMatrix, N, R0 + Rows / 2, C0, Rows - Rows / 2, Cols);
+	}
+	else
+	{
+		SwapTransposed(pMatrix, N, R0, C0, Rows, Cols / 2);
+		SwapTransposed(pMatrix, N, R0, C0 + Cols / 2, Rows, Cols - Cols / 2);
+	}
+}
+
+// cache-oblivious: halves the diagonal block [X0, X0 + Size)^2 until the blocks fit into any cache
+template<typename E>
+static void TransposeInPlace(E* pMatrix, size_t N, size_t X0, size_t Size)
+{
+	if(Size * Size <= c_CPUInPlaceBlockElements)
+	{
+		for(size_t r = X0 + 1; r < X0 + Size; r++)
+			for(size_t c = X0; c < r; c++)
+				std::swap(pMatrix[r * N + c], pMatrix[c * N + r]);
+		return;
+	}
+	size_t half = Size / 2;
+	TransposeInPlace(pMatrix, N, X0, half);
+	TransposeInPlace(pMatrix, N, X0 + half, Size - half);
+	SwapTransposed(pMatrix, N, X0 + half, X0, Size - half, half);
+}
+
+// the rotations are a transpose followed by mirroring the columns (90) or the rows (270)
+template<typename E>
+static void TransformInPlace(CMatrixTransform::ETransform Transform, E* pMatrix, size_t N)
+{
+	TransposeInPlace(pMatrix, N, 0, N);
+	if(Transform == CMatrixTransform::ROTATE_90)
+	{
+		CThreadPool::ParallelFor(0, N, [=](size_t Begin, size_t End) {
+			for(size_t y = Begin; y < End; y++)
+				std::reverse(pMatrix + y * N, pMatrix + (y + 1) * N);
+		});
+	}
+	else if(Transform == CMatrixTransform::ROTATE_270)
+	{
+		CThreadPool::ParallelFor(0, N / 2, [=](size_t Begin, size_t End) {
+			for(size_t y = Begin; y < End; y++)
+				std::swap_ranges(pMatrix + y * N, pMatrix + (y + 1) * N, pMatrix + (N - 1 - y) * N);
+		});
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CMatrixTransform
+
+CMatrixTransform::CMatrixTransform()
+	: m_Type(ELEMENT_FLOAT), m_Tile(0), m_Rows(0), m_BatchLocal(0), m_InPlaceTile(0), m_InPlaceRows(0), m_Program(nullptr), m_InPlaceProgram(nullptr)
+{
+	for(int i = 0; i < TRANSFORM_COUNT; i++)
+		m_Kernels[i] = m_BatchKernels[i] = m_InPlaceKernels[i] = nullptr;
+}
+
+CMatrixTransform::~CMatrixTransform()
+{
+	Release();
+}
+
+bool CMatrixTransform::Init(cl_device_id Device, cl_context Context, EElementType Type, unsigned int Tile, unsigned int Rows)
+{
+	Release();
+
+	size_t maxWorkGroupSize = 0;
+	cl_ulong localMemSize = 0;
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &maxWorkGroupSize, NULL), "Failed to query the maximum work-group size.");
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &localMemSize, NULL), "Failed to query the local memory size.");
+
+	// Tile and Rows are powers of two: smaller tiles for small local memories,
+	// more rows per work-item for small work-groups
+	Rows = std::max(1u, std::min(Rows, Tile));
+	while(Tile > 1 && cl_ulong(Tile * (Tile + 1) * GetElementSize(Type)) > localMemSize)
+		Tile /= 2;
+	Rows = std::min(Rows, Tile);
+	while(Tile * Tile / Rows > maxWorkGroupSize)
+	{
+		if(Rows < Tile)
+			Rows *= 2;
+		else
+			Tile /= 2;
+	}
+
+	m_Type = Type;
+	m_Tile = Tile;
+	m_Rows = Rows;
+	m_BatchLocal = std::max<size_t>(Tile * (Tile + 1), std::min<size_t>(c_BatchLocalBytes, size_t(localMemSize / 2)) / GetElementSize(Type));
+
+	// only the in-place kernels pay for their second tile
+	m_InPlaceTile = Tile;
+	while(m_InPlaceTile > 1 && cl_ulong(2 * m_InPlaceTile * (m_InPlaceTile + 1) * GetElementSize(Type)) > localMemSize)
+		m_InPlaceTile /= 2;
+	m_InPlaceRows = std::min(Rows, m_InPlaceTile);
+
+	CKernelSpecialization specialization;
+	specialization.Set("T", g_KernelTypes[Type]).Set("TILE", m_Tile).Set("ROWS", m_Rows).Set("BATCH_LOCAL", m_BatchLocal);
+	m_Program = CKernelLibrary::GetProgram(Device, Context, "MatrixTransform.cl", specialization);
+	if(m_Program == nullptr)
+		return false;
+
+	CKernelSpecialization inPlaceSpecialization;
+	inPlaceSpecialization.Set("T", g_KernelTypes[Type]).Set("TILE_INPLACE", m_InPlaceTile).Set("ROWS", m_InPlaceRows);
+	m_InPlaceProgram = CKernelLibrary::GetProgram(Device, Context, "MatrixTransform.cl", inPlaceSpecialization);
+	if(m_InPlaceProgram == nullptr)
+		return false;
+
+	cl_int clError;
+	for(int i = 0; i < TRANSFORM_COUNT; i++)
+	{
+		m_Kernels[i] = clCreateKernel(m_Program, g_KernelNames[i], &clError);
+		V_RETURN_FALSE_CL(clError, "Failed to create kernel: " << g_KernelNames[i]);
+		m_BatchKernels[i] = clCreateKernel(m_Program, g_BatchKernelNames[i], &clError);
+		V_RETURN_FALSE_CL(clError, "Failed to create kernel: " << g_BatchKernelNames[i]);
+		if(g_InPlaceKernelNames[i])
+		{
+			m_InPlaceKernels[i] = clCreateKernel(m_InPlaceProgram, g_InPlaceKernelNames[i], &clError);
+			V_RETURN_FALSE_CL(clError, "Failed to create kernel: " << g_InPlaceKernelNames[i]);
+		}
+	}
+	return true;
+}
+
+void CMatrixTransform::Release()
+{
+	for(int i = 0; i < TRANSFORM_COUNT; i++)
+	{
+		SAFE_RELEASE_KERNEL(m_Kernels[i]);
+		SAFE_RELEASE_KERNEL(m_BatchKernels[i]);
+		SAFE_RELEASE_KERNEL(m_InPlaceKernels[i]);
+	}
+	SAFE_RELEASE_PROGRAM(m_Program);
+	SAFE_RELEASE_PROGRAM(m_InPlaceProgram);
+}
+
+cl_kernel CMatrixTransform::Prepare(ETransform Transform, cl_mem In, cl_mem Out, unsigned int SizeX, unsigned int SizeY,
+	size_t GlobalWorkSize[2], size_t LocalWorkSize[2])
+{
+	cl_kernel kernel = m_Kernels[Transform];
+	cl_int clError = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&In);
+	clError |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&Out);
+	clError |= clSetKernelArg(kernel, 2, sizeof(cl_uint), (void*)&SizeX);
+	clError |= clSetKernelArg(kernel, 3, sizeof(cl_uint), (void*)&SizeY);
+	V_RETURN_0_CL(clError, "Failed to set the arguments of " << g_KernelNames[Transform]);
+
+	// one work-group per tile of the input
+	LocalWorkSize[0] = m_Tile;
+	LocalWorkSize[1] = m_Tile / m_Rows;
+	GlobalWorkSize[0] = CLUtil::GetGlobalWorkSize(SizeX, m_Tile);
+	GlobalWorkSize[1] = CLUtil::GetGlobalWorkSize(SizeY, m_Tile) / m_Rows;
+	return kernel;
+}
+
+cl_int CMatrixTransform::Enqueue(cl_command_queue CommandQueue, ETransform Transform, cl_mem In, cl_mem Out,
+	unsigned int SizeX, unsigned int SizeY, cl_uint NWaitEvents, const cl_event* pWaitEvents, cl_event* pEvent)
+{
+	size_t globalWorkSize[2], localWorkSize[2];
+	cl_kernel kernel = Prepare(Transform, In, Out, SizeX, SizeY, globalWorkSize, localWorkSize);
+	if(kernel == nullptr)
+		return CL_INVALID_KERNEL;
+	return clEnqueueNDRangeKernel(CommandQueue, kernel, 2, NULL, globalWorkSize, localWorkSize, NWaitEvents, pWaitEvents, pEvent);
+}
+
+cl_kernel CMatrixTransform::PrepareBatch(ETransform Transform, cl_mem In, cl_mem Out, cl_mem Matrices, cl_uint NMatrices, cl_uint MatricesPerGroup,
+	size_t GlobalWorkSize[2], size_t LocalWorkSize[2])
+{
+	MatricesPerGroup = std::max(1u, MatricesPerGroup);
+
+	cl_kernel kernel = m_BatchKernels[Transform];
+	cl_int clError = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&In);
+	clError |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&Out);
+	clError |= clSetKernelArg(kernel, 2, sizeof(cl_mem), (void*)&Matrices);
+	clError |= clSetKernelArg(kernel, 3, sizeof(cl_uint), (void*)&NMatrices);
+	clError |= clSetKernelArg(kernel, 4, sizeof(cl_uint), (void*)&MatricesPerGroup);
+	V_RETURN_0_CL(clError, "Failed to set the arguments of " << g_BatchKernelNames[Transform]);
+
+	// one work-group per MatricesPerGroup matrices
+	LocalWorkSize[0] = m_Tile;
+	LocalWorkSize[1] = m_Tile / m_Rows;
+	GlobalWorkSize[0] = ((NMatrices + MatricesPerGroup - 1) / MatricesPerGroup) * LocalWorkSize[0];
+	GlobalWorkSize[1] = LocalWorkSize[1];
+	return kernel;
+}
+
+cl_int CMatrixTransform::EnqueueBatch(cl_command_queue CommandQueue, ETransform Transform, cl_mem In, cl_mem Out, cl_mem Matrices, cl_uint NMatrices,
+	cl_uint MatricesPerGroup, cl_uint NWaitEvents, const cl_event* pWaitEvents, cl_event* pEvent)
+{
+	if(NMatrices == 0)
+		return CL_SUCCESS;
+
+	size_t globalWorkSize[2], localWorkSize[2];
+	cl_kernel kernel = PrepareBatch(Transform, In, Out, Matrices, NMatrices, MatricesPerGroup, globalWorkSize, localWorkSize);
+	if(kernel == nullptr)
+		return CL_INVALID_KERNEL;
+	return clEnqueueNDRangeKernel(CommandQueue, kernel, 2, NULL, globalWorkSize, localWorkSize, NWaitEvents, pWaitEvents, pEvent);
+}
+
+cl_kernel CMatrixTransform::PrepareInPlace(ETransform Transform, cl_mem Matrix, unsigned int N, size_t GlobalWorkSize[2], size_t LocalWorkSize[2])
+{
+	if(!SupportsInPlace(Transform))
+	{
+		cerr<<GetName(Transform)<<" cannot be done in place."<<endl;
+		return nullptr;
+	}
+
+	cl_kernel kernel = m_InPlaceKernels[Transform];
+	cl_int clError = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&Matrix);
+	clError |= clSetKernelArg(kernel, 1, sizeof(cl_uint), (void*)&N);
+	V_RETURN_0_CL(clError, "Failed to set the arguments of " << g_InPlaceKernelNames[Transform]);
+
+	// the transpose launches a group per tile (the ones above the diagonal return right away),
+	// the rotations a group per tile of the top left (N + 1) / 2 x N / 2 quarter
+	size_t groupsX = (N + m_InPlaceTile - 1) / m_InPlaceTile, groupsY = groupsX;
+	if(Transform != TRANSPOSE)
+	{
+		groupsX = ((N + 1) / 2 + m_InPlaceTile - 1) / m_InPlaceTile;
+		groupsY = std::max<size_t>(1, (N / 2 + m_InPlaceTile - 1) / m_InPlaceTile);
+	}
+	LocalWorkSize[0] = m_InPlaceTile;
+	LocalWorkSize[1] = m_InPlaceTile / m_InPlaceRows;
+	GlobalWorkSize[0] = groupsX * LocalWorkSize[0];
+	GlobalWorkSize[1] = groupsY * LocalWorkSize[1];
+	return kernel;
+}
+
+cl_int CMatrixTransform::EnqueueInPlace(cl_command_queue CommandQueue, ETransform Transform, cl_mem Matrix, unsigned int N,
+	cl_uint NWaitEvents, const cl_event* pWaitEvents, cl_event* pEvent)
+{
+	if(N < 2 && SupportsInPlace(Transform))
+		return CL_SUCCESS;
+
+	size_t globalWorkSize[2], localWorkSize[2];
+	cl_kernel kernel = PrepareInPlace(Transform, Matrix, N, globalWorkSize, localWorkSize);
+	if(kernel == nullptr)
+		return CL_INVALID_KERNEL;
+	return clEnqueueNDRangeKernel(CommandQueue, kernel, 2, NULL, globalWorkSize, localWorkSize, NWaitEvents, pWaitEvents, pEvent);
+}
+
+bool CMatrixTransform::TransformOutOfCore(cl_command_queue CommandQueue, ETransform Transform, const void* pIn, void* pOut, size_t SizeX, size_t SizeY,
+	size_t WorkingSetBytes, unsigned int NBuffers, COutOfCoreStatistics* pStatistics)
+{
+	cl_context context;
+	cl_device_id device;
+	cl_ulong maxAllocSize = 0;
+	V_RETURN_FALSE_CL(clGetCommandQueueInfo(CommandQueue, CL_QUEUE_CONTEXT, sizeof(cl_context), &context, NULL), "Failed to query the context of the command queue.");
+	V_RETURN_FALSE_CL(clGetCommandQueueInfo(CommandQueue, CL_QUEUE_DEVICE, sizeof(cl_device_id), &device, NULL), "Failed to query the device of the command queue.");
+	V_RETURN_FALSE_CL(clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &maxAllocSize, NULL), "Failed to query the maximum allocation size.");
+
+	// NBuffers sets of an input and an output block
+	const size_t elementSize = GetElementSize(m_Type);
+	NBuffers = std::max(2u, std::min(NBuffers, 3u));
+	size_t blockElements = std::min<size_t>(WorkingSetBytes / (2 * NBuffers * elementSize), size_t(maxAllocSize / elementSize));
+	if(blockElements < size_t(m_Tile) * m_Tile)
+	{
+		cerr<<"A working set of "<<WorkingSetBytes<<" bytes is too small for the out-of-core transform."<<endl;
+		return false;
+	}
+
+	// whole rows as long as a tile of them fits, square blocks otherwise (both a multiple of the tile)
+	size_t blockX, blockY;
+	if(SizeX * m_Tile <= blockElements)
+	{
+		blockX = SizeX;
+		blockY = (blockElements / SizeX) / m_Tile * m_Tile;
+	}
+	else
+		blockX = blockY = size_t(sqrt(double(blockElements))) / m_Tile * m_Tile;
+	blockX = std::min(blockX, SizeX);
+	blockY = std::min(blockY, SizeY);
+	const size_t nBlocksX = (SizeX + blockX - 1) / blockX;
+	const size_t nBlocks = nBlocksX * ((SizeY + blockY - 1) / blockY);
+
+	// one in-order queue per pipeline stage: upload, transform, download
+	cl_int clErr = CL_SUCCESS;
+	cl_command_queue queues[3] = { nullptr, nullptr, nullptr };
+	for(int q = 0; q < 3 && clErr == CL_SUCCESS; q++)
+		queues[q] = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &clErr);
+	if(clErr != CL_SUCCESS)
+	{
+		cerr<<"Error: Failed to create the out-of-core command queues. ["<<CLUtil::GetCLErrorString(clErr)<<"]"<<endl;
+		for(int q = 0; q < 3; q++)
+			if(queues[q])
+				clReleaseCommandQueue(queues[q]);
+		return false;
+	}
+	cl_command_queue uploadQueue = queues[0], computeQueue = queues[1], downloadQueue = queues[2];
+
+	// block i uses buffer set i % NBuffers; the first error code is kept, combined codes mean nothing
+	std::vector<CPooledBuffer> dIn(NBuffers), dOut(NBuffers);
+	const size_t blockBytes = blockX * blockY * elementSize;
+	for(unsigned int k = 0; k < NBuffers && clErr == CL_SUCCESS; k++)
+	{
+		dIn[k] = CPooledBuffer::Create(context, CL_MEM_READ_ONLY, blockBytes, &clErr);
+		if(clErr == CL_SUCCESS)
+			dOut[k] = CPooledBuffer::Create(context, CL_MEM_WRITE_ONLY, blockBytes, &clErr);
+	}
+
+	std::vector<cl_event> evUpload(nBlocks, nullptr), evCompute(nBlocks, nullptr), evDownload(nBlocks, nullptr);
+	const size_t outPitch = SwapsDimensions(Transform) ? SizeY : SizeX;
+	const size_t bufferOrigin[3] = { 0, 0, 0 };
+
+	CTimer timer;
+	timer.Start();
+
+	for(size_t i = 0; i < nBlocks && clErr == CL_SUCCESS; i++)
+	{
+		unsigned int k = (unsigned int)(i % NBuffers);
+		size_t x0 = (i % nBlocksX) * blockX, y0 = (i / nBlocksX) * blockY;
+		size_t w = std::min(blockX, SizeX - x0), h = std::min(blockY, SizeY - y0);
+
+		// the buffer set can be reused as soon as the block that used it before has been downloaded
+		cl_uint nWait = (i >= NBuffers) ? 1 : 0;
+		const cl_event* pWait = nWait ? &evDownload[i - NBuffers] : NULL;
+
+		size_t hostOrigin[3] = { x0 * elementSize, y0, 0 };
+		size_t region[3] = { w * elementSize, h, 1 };
+		clErr = clEnqueueWriteBufferRect(uploadQueue, dIn[k].Get(), CL_FALSE, bufferOrigin, hostOrigin, region,
+			w * elementSize, 0, SizeX * elementSize, 0, pIn, nWait, pWait, &evUpload[i]);
+
+		if(clErr == CL_SUCCESS)
+			clErr = Enqueue(computeQueue, Transform, dIn[k].Get(), dOut[k].Get(), (unsigned int)w, (unsigned int)h, 1, &evUpload[i], &evCompute[i]);
+
+		size_t outW = SwapsDimensions(Transform) ? h : w, outH = SwapsDimensions(Transform) ? w : h;
+		size_t outX, outY;
+		GetOutputOrigin(Transform, x0, y0, w, h, SizeX, SizeY, outX, outY);
+		size_t outOrigin[3] = { outX * elementSize, outY, 0 };
+		size_t outRegion[3] = { outW * elementSize, outH, 1 };
+		if(clErr == CL_SUCCESS)
+			clErr = clEnqueueReadBufferRect(downloadQueue, dOut[k].Get(), CL_FALSE, bufferOrigin, outOrigin, outRegion,
+				outW * elementSize, 0, outPitch * elementSize, 0, pOut, 1, &evCompute[i], &evDownload[i]);
+
+		// make sure all three stages are submitted to the device right away
+		for(int q = 0; q < 3; q++)
+			clFlush(queues[q]);
+	}
+
+	// all queues have to drain before the events and buffers are released, even after an error
+	for(int q = 0; q < 3; q++)
+	{
+		cl_int finishErr = clFinish(queues[q]);
+		if(clErr == CL_SUCCESS)
+			clErr = finishErr;
+	}
+
+	timer.Stop();
+
+	if(clErr != CL_SUCCESS)
+		cerr<<"Error in the out-of-core transform: "<<CLUtil::GetCLErrorString(clErr)<<endl;
+	else if(pStatistics)
+	{
+		pStatistics->BlockSizeX = blockX;
+		pStatistics->BlockSizeY = blockY;
+		pStatistics->NBlocks = nBlocks;
+		pStatistics->WorkingSetBytes = 2 * NBuffers * blockBytes;
+		pStatistics->Milliseconds = timer.GetElapsedMilliseconds();
+		pStatistics->UploadMs = pStatistics->ComputeMs = pStatistics->DownloadMs = 0.0;
+		for(size_t i = 0; i < nBlocks; i++)
+		{
+			pStatistics->UploadMs += std::max(0.0, CLUtil::GetEventMilliseconds(evUpload[i]));
+			pStatistics->ComputeMs += std::max(0.0, CLUtil::GetEventMilliseconds(evCompute[i]));
+			pStatistics->DownloadMs += std::max(0.0, CLUtil::GetEventMilliseconds(evDownload[i]));
+		}
+	}
+
+	for(size_t i = 0; i < nBlocks; i++)
+	{
+		if(evUpload[i]) clReleaseEvent(evUpload[i]);
+		if(evCompute[i]) clReleaseEvent(evCompute[i]);
+		if(evDownload[i]) clReleaseEvent(evDownload[i]);
+	}
+	for(int q = 0; q < 3; q++)
+		clReleaseCommandQueue(queues[q]);
+
+	return clErr == CL_SUCCESS;
+}
+
+void CMatrixTransform::GetOutputOrigin(ETransform Transform, size_t X, size_t Y, size_t BlockX, size_t BlockY, size_t SizeX, size_t SizeY,
+	size_t& OutX, size_t& OutY)
+{
+	switch(Transform)
+	{
+	case TRANSPOSE:		OutX = Y;						OutY = X; break;
+	case ROTATE_90:		OutX = SizeY - Y - BlockY;		OutY = X; break;
+	case ROTATE_270:	OutX = Y;						OutY = SizeX - X - BlockX; break;
+	case ROTATE_180:	OutX = SizeX - X - BlockX;		OutY = SizeY - Y - BlockY; break;
+	case FLIP_H:		OutX = SizeX - X - BlockX;		OutY = Y; break;
+	default:			OutX = X;						OutY = SizeY - Y - BlockY; break;
+	}
+}
+
+unsigned int CMatrixTransform::GetMatricesPerGroup(unsigned int SizeX, unsigned int SizeY) const
+{
+	size_t staged = size_t(SizeY) * (SizeX + 1);
+	return (unsigned int)std::max<size_t>(1, m_BatchLocal / std::max<size_t>(staged, 1));
+}
+
+std::vector<CMatrixTransform::CBatchMatrix> CMatrixTransform::MakeUniformBatch(size_t NMatrices, unsigned int SizeX, unsigned int SizeY,
+	size_t InStride, size_t OutStride)
+{
+	size_t elements = size_t(SizeX) * SizeY;
+	InStride = std::max(InStride, elements);
+	OutStride = std::max(OutStride, elements);
+
+	vector<CBatchMatrix> matrices(NMatrices);
+	for(size_t i = 0; i < NMatrices; i++)
+	{
+		matrices[i].InOffset = cl_uint(i * InStride);
+		matrices[i].OutOffset = cl_uint(i * OutStride);
+		matrices[i].SizeX = SizeX;
+		matrices[i].SizeY = SizeY;
+	}
+	return matrices;
+}
+
+size_t CMatrixTransform::GetElementSize(EElementType Type)
+{
+	return g_ElementSizes[Type];
+}
+
+const char* CMatrixTransform::GetName(ETransform Transform)
+{
+	return g_TransformNames[Transform];
+}
+
+const char* CMatrixTransform::GetTypeName(EElementType Type)
+{
+	return g_TypeNames[Type];
+}
+
+void CMatrixTransform::TransformCPU(ETransform Transform, const void* pIn, void* pOut, unsigned int SizeX, unsigned int SizeY, size_t ElementSize)
+{
+	switch(ElementSize)
+	{
+	case 2: TransformBlocked(Transform, (const CElement<2>*)pIn, (CElement<2>*)pOut, SizeX, SizeY); break;
+	case 4: TransformBlocked(Transform, (const CElement<4>*)pIn, (CElement<4>*)pOut, SizeX, SizeY); break;
+	case 8: TransformBlocked(Transform, (const CElement<8>*)pIn, (CElement<8>*)pOut, SizeX, SizeY); break;
+	case 16: TransformBlocked(Transform, (const CElement<16>*)pIn, (CElement<16>*)pOut, SizeX, SizeY); break;
+	default:
+		{
+			const unsigned char* pSrc = (const unsigned char*)pIn;
+			unsigned char* pDst = (unsigned char*)pOut;
+			for(size_t y = 0; y < SizeY; y++)
+				for(size_t x = 0; x < SizeX; x++)
+					memcpy(pDst + GetOutputIndex(Transform, x, y, SizeX, SizeY) * ElementSize, pSrc + (y * SizeX + x) * ElementSize, ElementSize);
+		}
+	}
+}
+
+void CMatrixTransform::TransformBatchCPU(ETransform Transform, const void* pIn, void* pOut, const std::vector<CBatchMatrix>& Matrices, size_t ElementSize)
+{
+	// one matrix per chunk, TransformCPU() runs serially inside of a chunk
+	const CBatchMatrix* pMatrices = Matrices.empty() ? nullptr : &Matrices[0];
+	CThreadPool::ParallelFor(0, Matrices.size(), [=](size_t Begin, size_t End) {
+		for(size_t i = Begin; i < End; i++)
+		{
+			const CBatchMatrix& m = pMatrices[i];
+			TransformCPU(Transform, (const unsigned char*)pIn + m.InOffset * ElementSize, (unsigned char*)pOut + m.OutOffset * ElementSize,
+				m.SizeX, m.SizeY, ElementSize);
+		}
+	}, 16);
+}
+
+bool CMatrixTransform::TransformInPlaceCPU(ETransform Transform, void* pMatrix, unsigned int N, size_t ElementSize)
+{
+	if(!SupportsInPlace(Transform))
+	{
+		cerr<<GetName(Transform)<<" cannot be done in place."<<endl;
+		return false;
+	}
+
+	switch(ElementSize)
+	{
+	case 2: TransformInPlace(Transform, (CElement<2>*)pMatrix, N); break;
+	case 4: TransformInPlace(Transform, (CElement<4>*)pMatrix, N); break;
+	case 8: TransformInPlace(Transform, (CElement<8>*)pMatrix, N); break;
+	case 16: TransformInPlace(Transform, (CElement<16>*)pMatrix, N); break;
+	default:
+		cerr<<"The in-place transform does not support elements of "<<ElementSize<<" bytes."<<endl;
+		return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,214 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CMATRIX_TRANSFORM_H
+#define _CMATRIX_TRANSFORM_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include "CommonDefs.h"
+
+#include <cstddef>
+#include <vector>
+
+//! Layout transforms of row-major matrices (Kernels/MatrixTransform.cl)
+/*!
+	The input has SizeX columns and SizeY rows. Transposes and rotations by 90 and 270
+	degrees go through padded (TILE + 1) local memory tiles, so both the reads and the
+	writes are coalesced; the 180 degree rotation and the flips are mirrored copies.
+	Every work-item moves ROWS elements of a column of the tile. Sizes that are not a
+	multiple of the tile (e.g. 2048 x 1025) are handled by the kernels.
+
+	Init() builds the kernels for one element type; the tile and the rows per work-item
+	are reduced if the device cannot run the default work-group or lacks local memory.
+	The in-place kernels are a program of their own with a tile that may be smaller.
+
+	Batches of small matrices (CBatchMatrix, e.g. thousands of 16 x 16 to 128 x 128 tiles)
+	are transformed in one launch: every work-group handles MatricesPerGroup matrices and
+	stages as many of them as fit into its local memory together, larger ones tile by tile.
+
+	TransformOutOfCore() transforms host matrices larger than the device memory: the input
+	is split into blocks of whole rows (or square blocks for very wide matrices) that
+	stream through a bounded working set of 2 or 3 buffer sets. Upload, transform and
+	download of consecutive blocks overlap on three in-order queues, every transformed
+	block is read back straight into its final place in the output with clEnqueueReadBufferRect.
+	The host matrices should be pinned (CHostBuffer::HOST_PINNED) for the transfers to overlap.
+
+	Square matrices can be transposed and rotated by 90 or 270 degrees in place, which halves
+	the device memory: a work-group swaps a tile with its mirror image at the diagonal, or
+	moves the four blocks that a rotation cycles through two local tiles, so every element
+	is read and written once.
+*/
+class CMatrixTransform
+{
+public:
+	enum ETransform
+	{
+		TRANSPOSE,
+		ROTATE_90,		//!< clockwise
+		ROTATE_180,
+		ROTATE_270,
+		FLIP_H,			//!< mirrors the columns
+		FLIP_V,			//!< mirrors the rows
+		TRANSFORM_COUNT
+	};
+
+	enum EElementType
+	{
+		ELEMENT_FLOAT,
+		ELEMENT_INT,
+		ELEMENT_HALF,
+		ELEMENT_FLOAT4,
+		ELEMENT_TYPE_COUNT
+	};
+
+	//! One matrix of a batch, offsets and sizes in elements (a uint4 in the kernels)
+	struct CBatchMatrix
+	{
+		cl_uint		InOffset;
+		cl_uint		OutOffset;
+		cl_uint		SizeX;
+		cl_uint		SizeY;
+	};
+
+	//! Result of TransformOutOfCore()
+	struct COutOfCoreStatistics
+	{
+		size_t		BlockSizeX;
+		size_t		BlockSizeY;
+		size_t		NBlocks;
+		//! device memory of all buffer sets
+		size_t		WorkingSetBytes;
+		//! host time of the whole transform
+		double		Milliseconds;
+		//! device time of each stage, summed over all blocks
+		double		UploadMs;
+		double		ComputeMs;
+		double		DownloadMs;
+	};
+
+	CMatrixTransform();
+	~CMatrixTransform();
+
+	bool Init(cl_device_id Device, cl_context Context, EElementType Type, unsigned int Tile = 32, unsigned int Rows = 4);
+
+	void Release();
+
+	//! Binds the arguments and returns the kernel with its NDRange, e.g. for CLUtil::ProfileKernel()
+	cl_kernel Prepare(ETransform Transform, cl_mem In, cl_mem Out, unsigned int SizeX, unsigned int SizeY,
+		size_t GlobalWorkSize[2], size_t LocalWorkSize[2]);
+
+	//! Out = Transform(In), the buffers must not overlap
+	cl_int Enqueue(cl_command_queue CommandQueue, ETransform Transform, cl_mem In, cl_mem Out,
+		unsigned int SizeX, unsigned int SizeY, cl_uint NWaitEvents = 0, const cl_event* pWaitEvents = nullptr, cl_event* pEvent = nullptr);
+
+	//! Binds the arguments of a batched transform, Matrices is a buffer of NMatrices CBatchMatrix
+	cl_kernel PrepareBatch(ETransform Transform, cl_mem In, cl_mem Out, cl_mem Matrices, cl_uint NMatrices, cl_uint MatricesPerGroup,
+		size_t GlobalWorkSize[2], size_t LocalWorkSize[2]);
+
+	//! Transforms all matrices of a batch, the inputs and outputs must not overlap
+	cl_int EnqueueBatch(cl_command_queue CommandQueue, ETransform Transform, cl_mem In, cl_mem Out, cl_mem Matrices, cl_uint NMatrices,
+		cl_uint MatricesPerGroup, cl_uint NWaitEvents = 0, const cl_event* pWaitEvents = nullptr, cl_event* pEvent = nullptr);
+
+	//! Out = Transform(In) for host matrices of any size, with at most WorkingSetBytes of device memory
+	bool TransformOutOfCore(cl_command_queue CommandQueue, ETransform Transform, const void* pIn, void* pOut, size_t SizeX, size_t SizeY,
+		size_t WorkingSetBytes, unsigned int NBuffers = 2, COutOfCoreStatistics* pStatistics = nullptr);
+
+	//! Binds the arguments of an in-place transform of the N x N matrix in Matrix
+	cl_kernel PrepareInPlace(ETransform Transform, cl_mem Matrix, unsigned int N, size_t GlobalWorkSize[2], size_t LocalWorkSize[2]);
+
+	//! Matrix = Transform(Matrix) for a square matrix, see SupportsInPlace()
+	cl_int EnqueueInPlace(cl_command_queue CommandQueue, ETransform Transform, cl_mem Matrix, unsigned int N,
+		cl_uint NWaitEvents = 0, const cl_event* pWaitEvents = nullptr, cl_event* pEvent = nullptr);
+
+	//! How many SizeX x SizeY matrices a work-group can stage together (at least 1)
+	unsigned int GetMatricesPerGroup(unsigned int SizeX, unsigned int SizeY) const;
+
+	EElementType GetElementType() const { return m_Type; }
+	unsigned int GetTile() const { return m_Tile; }
+	unsigned int GetRows() const { return m_Rows; }
+	unsigned int GetInPlaceTile() const { return m_InPlaceTile; }
+
+	//! Transposes and rotations by 90 and 270 degrees swap the dimensions
+	static bool SwapsDimensions(ETransform Transform) { return Transform == TRANSPOSE || Transform == ROTATE_90 || Transform == ROTATE_270; }
+
+	//! Index of the element (X, Y) of the input in the output
+	static size_t GetOutputIndex(ETransform Transform, size_t X, size_t Y, size_t SizeX, size_t SizeY)
+	{
+		switch(Transform)
+		{
+		case TRANSPOSE:		return X * SizeY + Y;
+		case ROTATE_90:		return X * SizeY + (SizeY - 1 - Y);
+		case ROTATE_270:	return (SizeX - 1 - X) * SizeY + Y;
+		case ROTATE_180:	return (SizeY - 1 - Y) * SizeX + (SizeX - 1 - X);
+		case FLIP_H:		return Y * SizeX + (SizeX - 1 - X);
+		default:			return (SizeY - 1 - Y) * SizeX + X;
+		}
+	}
+
+	//! Transforms that have an in-place kernel
+	static bool SupportsInPlace(ETransform Transform) { return Transform == TRANSPOSE || Transform == ROTATE_90 || Transform == ROTATE_270; }
+
+	static size_t GetElementSize(EElementType Type);
+
+	static const char* GetName(ETransform Transform);
+
+	static const char* GetTypeName(EElementType Type);
+
+	//! NMatrices matrices of SizeX x SizeY, InStride and OutStride elements apart (0: contiguous)
+	static std::vector<CBatchMatrix> MakeUniformBatch(size_t NMatrices, unsigned int SizeX, unsigned int SizeY, size_t InStride = 0, size_t OutStride = 0);
+
+	//! Multithreaded CPU reference for elements of any size
+	static void TransformCPU(ETransform Transform, const void* pIn, void* pOut, unsigned int SizeX, unsigned int SizeY, size_t ElementSize);
+
+	static void TransformBatchCPU(ETransform Transform, const void* pIn, void* pOut, const std::vector<CBatchMatrix>& Matrices, size_t ElementSize);
+
+	//! Cache-oblivious in-place CPU reference for square matrices of 2, 4, 8 or 16 byte elements
+	static bool TransformInPlaceCPU(ETransform Transform, void* pMatrix, unsigned int N, size_t ElementSize);
+
+protected:
+	//! Top left corner of the block [X, X + BlockX) x [Y, Y + BlockY) of the input in the output
+	static void GetOutputOrigin(ETransform Transform, size_t X, size_t Y, size_t BlockX, size_t BlockY, size_t SizeX, size_t SizeY,
+		size_t& OutX, size_t& OutY);
+
+	EElementType		m_Type;
+	unsigned int		m_Tile;
+	unsigned int		m_Rows;
+	//! elements of the local buffer of the batched kernels
+	size_t				m_BatchLocal;
+	//! the in-place kernels need two tiles of local memory
+	unsigned int		m_InPlaceTile;
+	unsigned int		m_InPlaceRows;
+
+	cl_program			m_Program;
+	cl_program			m_InPlaceProgram;
+	cl_kernel			m_Kernels[TRANSFORM_COUNT];
+	cl_kernel			m_BatchKernels[TRANSFORM_COUNT];
+	//! only for the transforms of SupportsInPlace()
+	cl_kernel			m_InPlaceKernels[TRANSFORM_COUNT];
+};
+
+#endif // _CMATRIX_TRANSFORM_H
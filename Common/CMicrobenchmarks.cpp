@@ -0,0 +1,317 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CMicrobenchmarks.h"
+
+#include "CLUtil.h"
+#include "CDeviceMemoryTracker.h"
+#include "CTimingStatistics.h"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+// bytes of each STREAM array (less if the device cannot allocate that much)
+static const size_t		c_StreamArrayBytes = 64 * 1024 * 1024;
+// loop iterations of the local memory and the multiply-add kernels
+static const int		c_LocalIterations = 1024;
+static const int		c_FlopIterations = 512;
+// independent multiply-add chains per work-item (float4 each, a to d in PeakMad), so the latency of one chain is hidden
+#define FLOP_CHAINS		4
+// multiply-adds per chain and loop iteration (STEPs in PeakMad)
+#define FLOP_UNROLL		8
+
+static const char* c_MicrobenchmarkSource =
+	"__kernel void Copy(__global const float4* a, __global float4* b)\n"
+	"{\n"
+	"	size_t i = get_global_id(0);\n"
+	"	b[i] = a[i];\n"
+	"}\n"
+	"__kernel void Scale(__global const float4* a, __global float4* b, float s)\n"
+	"{\n"
+	"	size_t i = get_global_id(0);\n"
+	"	b[i] = s * a[i];\n"
+	"}\n"
+	"__kernel void Triad(__global const float4* b, __global const float4* c, __global float4* a, float s)\n"
+	"{\n"
+	"	size_t i = get_global_id(0);\n"
+	"	a[i] = b[i] + s * c[i];\n"
+	"}\n"
+	// the local size must be a power of two; two reads per iteration, from different banks
+	"__kernel void LocalRead(__global float* out, __local float4* tile, int nIterations)\n"
+	"{\n"
+	"	uint lid = get_local_id(0);\n"
+	"	uint mask = get_local_size(0) - 1;\n"
+	"	tile[lid] = (float4)(lid);\n"
+	"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+	"	float4 acc0 = 0.0f, acc1 = 0.0f;\n"
+	"	for(int i = 0; i < nIterations; i++)\n"
+	"	{\n"
+	"		acc0 += tile[(lid + i) & mask];\n"
+	"		acc1 += tile[(lid + i + 7) & mask];\n"
+	"	}\n"
+	"	float4 acc = acc0 + acc1;\n"
+	"	out[get_global_id(0)] = acc.x + acc.y + acc.z + acc.w;\n"
+	"}\n"
+	"#define MAD4(x) x = mad(x, s, t)\n"
+	"#define STEP MAD4(a); MAD4(b); MAD4(c); MAD4(d);\n"
+	"__kernel void PeakMad(__global float* out, float s, float t, int nIterations)\n"
+	"{\n"
+	"	float4 a = (float4)(get_global_id(0));\n"
+	"	float4 b = a + 1.0f, c = a + 2.0f, d = a + 3.0f;\n"
+	"	for(int i = 0; i < nIterations; i++)\n"
+	"	{\n"
+	"		STEP STEP STEP STEP STEP STEP STEP STEP\n"
+	"	}\n"
+	"	float4 r = a + b + c + d;\n"
+	"	out[get_global_id(0)] = r.x + r.y + r.z + r.w;\n"
+	"}\n";
+
+///////////////////////////////////////////////////////////////////////////////
+// CDevicePeaks
+
+double CDevicePeaks::GetBandwidth() const
+{
+	return std::max(CopyGBs, std::max(ScaleGBs, TriadGBs));
+}
+
+void CDevicePeaks::Print(std::ostream& Stream) const
+{
+	Stream<<"Device peaks: copy "<<CopyGBs<<" GB/s, scale "<<ScaleGBs<<" GB/s, triad "<<TriadGBs<<" GB/s, "
+		<<"local memory "<<LocalGBs<<" GB/s, "<<GFlops<<" GFLOP/s (ridge point "<<GetRidgePoint()<<" flop/byte)"<<endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CMicrobenchmarks
+
+std::string CMicrobenchmarks::GetDatabasePath()
+{
+	const char* pEnv = getenv("GPGPU_DEVICE_PEAKS");
+	return (pEnv && *pEnv) ? string(pEnv) : string("DevicePeaks.txt");
+}
+
+std::string CMicrobenchmarks::GetDeviceKey(cl_device_id Device)
+{
+	string key = CLUtil::GetDeviceInfoString(Device, CL_DEVICE_NAME) + "|" + CLUtil::GetDeviceInfoString(Device, CL_DRIVER_VERSION);
+	for(size_t i = 0; i < key.size(); i++)
+		if(key[i] == '\t' || key[i] == '\n' || key[i] == '\r')
+			key[i] = ' ';
+	return key;
+}
+
+bool CMicrobenchmarks::Load(const std::string& Key, CDevicePeaks& Peaks)
+{
+	ifstream file(GetDatabasePath().c_str());
+	if(!file.is_open())
+		return false;
+
+	string line;
+	while(getline(file, line))
+	{
+		if(!line.empty() && line[line.size() - 1] == '\r')
+			line.resize(line.size() - 1);
+
+		size_t tab = line.find('\t');
+		if(tab == string::npos || line.compare(0, tab, Key) != 0 || tab != Key.size())
+			continue;
+
+		CDevicePeaks peaks;
+		stringstream values(line.substr(tab + 1));
+		if(values>>peaks.CopyGBs>>peaks.ScaleGBs>>peaks.TriadGBs>>peaks.LocalGBs>>peaks.GFlops && peaks.IsValid())
+		{
+			Peaks = peaks;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool CMicrobenchmarks::Store(const std::string& Key, const CDevicePeaks& Peaks)
+{
+	string path = GetDatabasePath();
+
+	// keep the entries of the other devices
+	vector<string> lines;
+	{
+		ifstream file(path.c_str());
+		string line;
+		while(getline(file, line))
+		{
+			if(!line.empty() && line[line.size() - 1] == '\r')
+				line.resize(line.size() - 1);
+			if(!line.empty() && line.compare(0, Key.size() + 1, Key + "\t") != 0)
+				lines.push_back(line);
+		}
+	}
+
+	string tmpPath = path + ".tmp";
+	{
+		ofstream file(tmpPath.c_str(), ios::trunc);
+		if(!file.is_open())
+		{
+			cerr<<"Failed to write the device peaks '"<<tmpPath<<"'."<<endl;
+			return false;
+		}
+		for(size_t i = 0; i < lines.size(); i++)
+			file<<lines[i]<<"\n";
+		file<<Key<<"\t"<<Peaks.CopyGBs<<"\t"<<Peaks.ScaleGBs<<"\t"<<Peaks.TriadGBs<<"\t"<<Peaks.LocalGBs<<"\t"<<Peaks.GFlops<<"\n";
+	}
+
+	remove(path.c_str());
+	if(rename(tmpPath.c_str(), path.c_str()) != 0)
+	{
+		remove(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool CMicrobenchmarks::GetPeaks(cl_device_id Device, cl_context Context, cl_command_queue CommandQueue, CDevicePeaks& Peaks, bool ForceMeasure)
+{
+	const char* pEnv = getenv("GPGPU_REMEASURE_PEAKS");
+	if(pEnv && *pEnv && string(pEnv) != "0")
+		ForceMeasure = true;
+
+	string key = GetDeviceKey(Device);
+	if(!ForceMeasure && Load(key, Peaks))
+		return true;
+
+	cout<<"Measuring the peak bandwidth and throughput of the device (stored in "<<GetDatabasePath()<<")..."<<endl;
+	if(!Measure(Device, Context, CommandQueue, Peaks))
+		return false;
+
+	Store(key, Peaks);
+	return true;
+}
+
+double CMicrobenchmarks::TimeKernel(cl_command_queue CommandQueue, cl_kernel Kernel, size_t GlobalWorkSize, const size_t* pLocalWorkSize)
+{
+	const int nIterations = 10;
+
+	if(!CLUtil::IsProfilingEnabled(CommandQueue))
+		return CLUtil::ProfileKernel(CommandQueue, Kernel, 1, &GlobalWorkSize, pLocalWorkSize, nIterations);
+
+	CKernelProfile profile;
+	if(!CLUtil::ProfileKernelEvents(CommandQueue, Kernel, 1, &GlobalWorkSize, pLocalWorkSize, nIterations, 2, profile))
+		return 0.0;
+	return profile.Execution.GetMedian();
+}
+
+bool CMicrobenchmarks::Measure(cl_device_id Device, cl_context Context, cl_command_queue CommandQueue, CDevicePeaks& Peaks)
+{
+	cl_ulong maxAlloc = 0, globalMem = 0;
+	cl_uint computeUnits = 1;
+	size_t maxWorkGroupSize = 1;
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &maxAlloc, NULL), "Failed to query the device.");
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &globalMem, NULL), "Failed to query the device.");
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &computeUnits, NULL), "Failed to query the device.");
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &maxWorkGroupSize, NULL), "Failed to query the device.");
+
+	cl_program program = CLUtil::BuildCLProgramFromMemory(Device, Context, c_MicrobenchmarkSource);
+	if(program == nullptr)
+		return false;
+
+	cl_int clError = CL_SUCCESS, clErr;
+	cl_kernel copyKernel = clCreateKernel(program, "Copy", &clErr); clError |= clErr;
+	cl_kernel scaleKernel = clCreateKernel(program, "Scale", &clErr); clError |= clErr;
+	cl_kernel triadKernel = clCreateKernel(program, "Triad", &clErr); clError |= clErr;
+	cl_kernel localKernel = clCreateKernel(program, "LocalRead", &clErr); clError |= clErr;
+	cl_kernel madKernel = clCreateKernel(program, "PeakMad", &clErr); clError |= clErr;
+
+	// three arrays for the triad, leave room for whatever else lives on the device
+	size_t arrayBytes = (size_t)std::min<cl_ulong>(c_StreamArrayBytes, std::min<cl_ulong>(maxAlloc, globalMem / 4));
+	arrayBytes -= arrayBytes % (16 * 1024);
+	size_t nVectors = arrayBytes / sizeof(cl_float4);
+
+	// the results of the local memory and mad kernels, one float per work-item
+	size_t localSize = 1;
+	while(localSize * 2 <= std::min<size_t>(256, maxWorkGroupSize))
+		localSize *= 2;
+	size_t localGlobalSize = computeUnits * localSize * 16;
+	size_t madGlobalSize = computeUnits * localSize * 64;
+
+	cl_mem a = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, arrayBytes, NULL, &clErr, "microbenchmark a"); clError |= clErr;
+	cl_mem b = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, arrayBytes, NULL, &clErr, "microbenchmark b"); clError |= clErr;
+	cl_mem c = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_READ_WRITE, arrayBytes, NULL, &clErr, "microbenchmark c"); clError |= clErr;
+	cl_mem out = CDeviceMemoryTracker::CreateBuffer(Context, CL_MEM_WRITE_ONLY, std::max(localGlobalSize, madGlobalSize) * sizeof(cl_float), NULL, &clErr, "microbenchmark results"); clError |= clErr;
+
+	bool success = (clError == CL_SUCCESS);
+	if(!success)
+		cerr<<"Error: Failed to create the microbenchmark kernels and buffers ["<<CLUtil::GetCLErrorString(clError)<<"]"<<endl;
+
+	if(success)
+	{
+		// the contents do not matter, but they should be valid floats
+		float zero = 0.0f, scale = 0.999f, offset = 0.001f;
+		int localIterations = c_LocalIterations, flopIterations = c_FlopIterations;
+		vector<float> zeros(arrayBytes / sizeof(float), zero);
+		clError  = clEnqueueWriteBuffer(CommandQueue, a, CL_FALSE, 0, arrayBytes, &zeros[0], 0, NULL, NULL);
+		clError |= clEnqueueWriteBuffer(CommandQueue, b, CL_FALSE, 0, arrayBytes, &zeros[0], 0, NULL, NULL);
+		clError |= clEnqueueWriteBuffer(CommandQueue, c, CL_FALSE, 0, arrayBytes, &zeros[0], 0, NULL, NULL);
+
+		clError |= clSetKernelArg(copyKernel, 0, sizeof(cl_mem), &a);
+		clError |= clSetKernelArg(copyKernel, 1, sizeof(cl_mem), &b);
+		clError |= clSetKernelArg(scaleKernel, 0, sizeof(cl_mem), &b);
+		clError |= clSetKernelArg(scaleKernel, 1, sizeof(cl_mem), &c);
+		clError |= clSetKernelArg(scaleKernel, 2, sizeof(float), &scale);
+		clError |= clSetKernelArg(triadKernel, 0, sizeof(cl_mem), &b);
+		clError |= clSetKernelArg(triadKernel, 1, sizeof(cl_mem), &c);
+		clError |= clSetKernelArg(triadKernel, 2, sizeof(cl_mem), &a);
+		clError |= clSetKernelArg(triadKernel, 3, sizeof(float), &scale);
+		clError |= clSetKernelArg(localKernel, 0, sizeof(cl_mem), &out);
+		clError |= clSetKernelArg(localKernel, 1, localSize * sizeof(cl_float4), NULL);
+		clError |= clSetKernelArg(localKernel, 2, sizeof(int), &localIterations);
+		clError |= clSetKernelArg(madKernel, 0, sizeof(cl_mem), &out);
+		clError |= clSetKernelArg(madKernel, 1, sizeof(float), &scale);
+		clError |= clSetKernelArg(madKernel, 2, sizeof(float), &offset);
+		clError |= clSetKernelArg(madKernel, 3, sizeof(int), &flopIterations);
+		// the uploads read from zeros, so wait before it goes out of scope
+		clError |= clFinish(CommandQueue);
+		success = (clError == CL_SUCCESS);
+		if(!success)
+			cerr<<"Error: Failed to set up the microbenchmarks ["<<CLUtil::GetCLErrorString(clError)<<"]"<<endl;
+	}
+
+	if(success)
+	{
+		double copyMs = TimeKernel(CommandQueue, copyKernel, nVectors, NULL);
+		double scaleMs = TimeKernel(CommandQueue, scaleKernel, nVectors, NULL);
+		double triadMs = TimeKernel(CommandQueue, triadKernel, nVectors, NULL);
+		double localMs = TimeKernel(CommandQueue, localKernel, localGlobalSize, &localSize);
+		double madMs = TimeKernel(CommandQueue, madKernel, madGlobalSize, &localSize);
+
+		Peaks.CopyGBs = (copyMs > 0.0) ? 1.0e-6 * 2.0 * arrayBytes / copyMs : 0.0;
+		Peaks.ScaleGBs = (scaleMs > 0.0) ? 1.0e-6 * 2.0 * arrayBytes / scaleMs : 0.0;
+		Peaks.TriadGBs = (triadMs > 0.0) ? 1.0e-6 * 3.0 * arrayBytes / triadMs : 0.0;
+		Peaks.LocalGBs = (localMs > 0.0) ? 1.0e-6 * 2.0 * double(localGlobalSize) * c_LocalIterations * sizeof(cl_float4) / localMs : 0.0;
+		// 2 flops per mad, 4 lanes per float4
+		double flops = double(madGlobalSize) * c_FlopIterations * FLOP_UNROLL * FLOP_CHAINS * 4 * 2;
+		Peaks.GFlops = (madMs > 0.0) ? 1.0e-6 * flops / madMs : 0.0;
+
+		success = Peaks.IsValid();
+		if(!success)
+			cerr<<"Error: The microbenchmarks did not produce valid timings."<<endl;
+	}
+
+	SAFE_RELEASE_MEMOBJECT(a);
+	SAFE_RELEASE_MEMOBJECT(b);
+	SAFE_RELEASE_MEMOBJECT(c);
+	SAFE_RELEASE_MEMOBJECT(out);
+	SAFE_RELEASE_KERNEL(copyKernel);
+	SAFE_RELEASE_KERNEL(scaleKernel);
+	SAFE_RELEASE_KERNEL(triadKernel);
+	SAFE_RELEASE_KERNEL(localKernel);
+	SAFE_RELEASE_KERNEL(madKernel);
+	SAFE_RELEASE_PROGRAM(program);
+
+	return success;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,94 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CMICROBENCHMARKS_H
+#define _CMICROBENCHMARKS_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include "CommonDefs.h"
+
+#include <string>
+#include <iostream>
+
+//! Measured ceilings of a device
+struct CDevicePeaks
+{
+	CDevicePeaks() : CopyGBs(0.0), ScaleGBs(0.0), TriadGBs(0.0), LocalGBs(0.0), GFlops(0.0) {}
+
+	bool IsValid() const { return GetBandwidth() > 0.0 && GFlops > 0.0; }
+
+	//! Best of the three STREAM kernels, the practical peak of the global memory
+	double GetBandwidth() const;
+
+	//! Arithmetic intensity (flop/byte) above which a kernel can be compute-bound
+	double GetRidgePoint() const { return GetBandwidth() > 0.0 ? GFlops / GetBandwidth() : 0.0; }
+
+	void Print(std::ostream& Stream) const;
+
+	//! STREAM copy (b = a), scale (b = s * a) and triad (a = b + s * c), counting every read and write
+	double		CopyGBs;
+	double		ScaleGBs;
+	double		TriadGBs;
+	//! Reads from local memory, summed over all compute units
+	double		LocalGBs;
+	//! Single precision multiply-add throughput, one mad counts as 2 flops
+	double		GFlops;
+};
+
+//! Microbenchmarks that measure the peak bandwidth and throughput of a device
+/*!
+	The results are stored per device and driver version in a small text
+	file, so the benchmarks only run once. The file defaults to
+	"DevicePeaks.txt" in the working directory and can be changed with the
+	environment variable GPGPU_DEVICE_PEAKS. Setting GPGPU_REMEASURE_PEAKS=1
+	ignores stored results.
+
+	Every line of the file is "<key>\t<copy>\t<scale>\t<triad>\t<local>\t<gflops>".
+*/
+class CMicrobenchmarks
+{
+public:
+	//! Returns the stored peaks of the device, or measures and stores them
+	static bool GetPeaks(cl_device_id Device, cl_context Context, cl_command_queue CommandQueue, CDevicePeaks& Peaks, bool ForceMeasure = false);
+
+	//! Runs all microbenchmarks
+	static bool Measure(cl_device_id Device, cl_context Context, cl_command_queue CommandQueue, CDevicePeaks& Peaks);
+
+protected:
+	static std::string GetDatabasePath();
+
+	static std::string GetDeviceKey(cl_device_id Device);
+
+	static bool Load(const std::string& Key, CDevicePeaks& Peaks);
+
+	static bool Store(const std::string& Key, const CDevicePeaks& Peaks);
+
+	//! Median device time of a kernel launch in ms, or 0 on errors
+	static double TimeKernel(cl_command_queue CommandQueue, cl_kernel Kernel, size_t GlobalWorkSize, const size_t* pLocalWorkSize);
+};
+
+#endif // _CMICROBENCHMARKS_H
@@ -0,0 +1,250 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CProgramBinaryCache.h"
+
+#include "CLUtil.h"
+#include "CTimer.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+
+#ifdef _WIN32
+	#include <direct.h>
+	#define MAKE_DIRECTORY(path) _mkdir(path)
+#else
+	#include <sys/stat.h>
+	#include <sys/types.h>
+	#define MAKE_DIRECTORY(path) mkdir(path, 0755)
+#endif
+
+using namespace std;
+
+// every cache file starts with this tag, followed by the raw program binary
+static const char		c_CacheFileMagic[8] = { 'G', 'P', 'G', 'P', 'U', 'B', 'I', 'N' };
+
+bool					CProgramBinaryCache::s_Initialized = false;
+bool					CProgramBinaryCache::s_Enabled = true;
+std::string				CProgramBinaryCache::s_CacheDirectory = "KernelCache";
+
+unsigned int			CProgramBinaryCache::s_Hits = 0;
+unsigned int			CProgramBinaryCache::s_Misses = 0;
+unsigned int			CProgramBinaryCache::s_Rejected = 0;
+double					CProgramBinaryCache::s_LoadMilliseconds = 0.0;
+double					CProgramBinaryCache::s_BuildMilliseconds = 0.0;
+
+// 64 bit FNV-1a, good enough to address a few hundred cache entries
+static uint64_t HashString(const std::string& Data, uint64_t Hash = 14695981039346656037ULL)
+{
+	for(size_t i = 0; i < Data.size(); i++)
+	{
+		Hash ^= (unsigned char)Data[i];
+		Hash *= 1099511628211ULL;
+	}
+	// separate consecutive strings, so ("ab", "c") and ("a", "bc") differ
+	Hash ^= 0xff;
+	Hash *= 1099511628211ULL;
+	return Hash;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CProgramBinaryCache
+
+void CProgramBinaryCache::InitFromEnvironment()
+{
+	if(s_Initialized)
+		return;
+	s_Initialized = true;
+
+	const char* pEnv = getenv("GPGPU_KERNEL_CACHE");
+	if(pEnv && *pEnv)
+	{
+		string value = pEnv;
+		if(value == "off" || value == "0" || value == "false")
+			s_Enabled = false;
+		else
+			s_CacheDirectory = value;
+	}
+}
+
+void CProgramBinaryCache::SetCacheDirectory(const std::string& Path)
+{
+	InitFromEnvironment();
+	s_CacheDirectory = Path;
+}
+
+const std::string& CProgramBinaryCache::GetCacheDirectory()
+{
+	InitFromEnvironment();
+	return s_CacheDirectory;
+}
+
+void CProgramBinaryCache::SetEnabled(bool Enabled)
+{
+	InitFromEnvironment();
+	s_Enabled = Enabled;
+}
+
+bool CProgramBinaryCache::IsEnabled()
+{
+	InitFromEnvironment();
+	return s_Enabled;
+}
+
+std::string CProgramBinaryCache::GetEntryPath(cl_device_id Device, const std::string& SourceCode, const std::string& CompileOptions)
+{
+	uint64_t hash = HashString(SourceCode);
+	hash = HashString(CompileOptions, hash);
+	hash = HashString(CLUtil::GetDeviceInfoString(Device, CL_DEVICE_NAME), hash);
+	hash = HashString(CLUtil::GetDeviceInfoString(Device, CL_DEVICE_VERSION), hash);
+	hash = HashString(CLUtil::GetDeviceInfoString(Device, CL_DRIVER_VERSION), hash);
+
+	stringstream path;
+	path << s_CacheDirectory << "/" << hex << setw(16) << setfill('0') << hash << ".bin";
+	return path.str();
+}
+
+cl_program CProgramBinaryCache::Load(cl_device_id Device, cl_context Context, const std::string& SourceCode, const std::string& CompileOptions)
+{
+	if(!IsEnabled())
+		return nullptr;
+
+	CTimer timer;
+	timer.Start();
+
+	string path = GetEntryPath(Device, SourceCode, CompileOptions);
+
+	ifstream file(path.c_str(), ios::binary);
+	if(!file.is_open())
+	{
+		s_Misses++;
+		return nullptr;
+	}
+
+	file.seekg(0, ios::end);
+	size_t fileSize = (size_t)file.tellg();
+	file.seekg(0, ios::beg);
+
+	char magic[sizeof(c_CacheFileMagic)];
+	vector<unsigned char> binary;
+	if(fileSize > sizeof(magic))
+	{
+		file.read(magic, sizeof(magic));
+		binary.resize(fileSize - sizeof(magic));
+		file.read((char*)&binary[0], binary.size());
+	}
+	file.close();
+
+	if(binary.empty() || !equal(magic, magic + sizeof(magic), c_CacheFileMagic))
+	{
+		cerr << "Discarding corrupt program cache entry '" << path << "'." << endl;
+		remove(path.c_str());
+		s_Rejected++;
+		s_Misses++;
+		return nullptr;
+	}
+
+	const unsigned char* pBinary = &binary[0];
+	size_t binarySize = binary.size();
+	cl_int binaryStatus = CL_SUCCESS;
+	cl_int clError;
+	cl_program prog = clCreateProgramWithBinary(Context, 1, &Device, &binarySize, &pBinary, &binaryStatus, &clError);
+	if(CL_SUCCESS == clError && CL_SUCCESS == binaryStatus)
+	{
+		// a program created from a binary still has to be built (linked) for the device
+		const char* pCompileOptions = CompileOptions.size() > 0 ? CompileOptions.c_str() : nullptr;
+		clError = clBuildProgram(prog, 1, &Device, pCompileOptions, NULL, NULL);
+	}
+	else if(CL_SUCCESS == clError)
+	{
+		clError = binaryStatus;
+	}
+
+	if(CL_SUCCESS != clError)
+	{
+		// typically CL_INVALID_BINARY after a driver update: fall back to the source
+		cerr << "Rejected cached program binary '" << path << "' [" << CLUtil::GetCLErrorString(clError) << "], rebuilding from source." << endl;
+		SAFE_RELEASE_PROGRAM(prog);
+		remove(path.c_str());
+		s_Rejected++;
+		s_Misses++;
+		return nullptr;
+	}
+
+	timer.Stop();
+	s_LoadMilliseconds += timer.GetElapsedMilliseconds();
+	s_Hits++;
+
+	return prog;
+}
+
+bool CProgramBinaryCache::Store(cl_device_id Device, cl_program Program, const std::string& SourceCode, const std::string& CompileOptions, double BuildMilliseconds)
+{
+	s_BuildMilliseconds += BuildMilliseconds;
+
+	if(!IsEnabled())
+		return false;
+
+	// the program was built for exactly one device
+	size_t binarySize = 0;
+	V_RETURN_FALSE_CL(clGetProgramInfo(Program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &binarySize, NULL), "Failed to query the program binary size.");
+	if(binarySize == 0)
+		return false;
+
+	vector<unsigned char> binary(binarySize);
+	unsigned char* pBinary = &binary[0];
+	V_RETURN_FALSE_CL(clGetProgramInfo(Program, CL_PROGRAM_BINARIES, sizeof(unsigned char*), &pBinary, NULL), "Failed to query the program binary.");
+
+	// the directory might already exist, which is fine
+	MAKE_DIRECTORY(s_CacheDirectory.c_str());
+
+	// write to a temporary file first, so concurrent runs never see half-written entries
+	string path = GetEntryPath(Device, SourceCode, CompileOptions);
+	string tmpPath = path + ".tmp";
+	{
+		ofstream file(tmpPath.c_str(), ios::binary | ios::trunc);
+		if(!file.is_open())
+		{
+			cerr << "Failed to write program cache entry '" << tmpPath << "'." << endl;
+			return false;
+		}
+		file.write(c_CacheFileMagic, sizeof(c_CacheFileMagic));
+		file.write((const char*)pBinary, binarySize);
+		if(!file.good())
+		{
+			file.close();
+			remove(tmpPath.c_str());
+			return false;
+		}
+	}
+
+	remove(path.c_str());
+	if(rename(tmpPath.c_str(), path.c_str()) != 0)
+	{
+		remove(tmpPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+void CProgramBinaryCache::PrintStatistics()
+{
+	if(s_Hits + s_Misses == 0)
+		return;
+
+	cout << "Program binary cache (" << (IsEnabled() ? s_CacheDirectory : string("disabled")) << "): "
+		<< s_Hits << " hits, " << s_Misses << " misses, " << s_Rejected << " rejected binaries" << endl;
+	cout << "  loading cached programs: " << s_LoadMilliseconds << " ms, compiling from source: " << s_BuildMilliseconds << " ms" << endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
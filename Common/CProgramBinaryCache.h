@@ -0,0 +1,89 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CPROGRAM_BINARY_CACHE_H
+#define _CPROGRAM_BINARY_CACHE_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include "CommonDefs.h"
+
+#include <string>
+
+//! Persistent on-disk cache of compiled OpenCL program binaries
+/*!
+	CLUtil::BuildCLProgramFromMemory() asks the cache first and only invokes
+	the OpenCL compiler on a miss. Entries are content-addressed: the file name
+	is a hash of the source code, the compile options, the device name and the
+	driver version, so any change to one of them simply produces a new entry.
+
+	Binaries that the driver refuses to load (CL_INVALID_BINARY, e.g. after a
+	driver update that did not change the version string) are deleted and the
+	program is rebuilt from source.
+
+	The cache directory defaults to "KernelCache" in the working directory and
+	can be changed with the environment variable GPGPU_KERNEL_CACHE.
+	Setting it to "off" disables the cache.
+*/
+class CProgramBinaryCache
+{
+public:
+	//! Creates and builds a program from a cached binary. Returns nullptr on a cache miss.
+	static cl_program Load(cl_device_id Device, cl_context Context, const std::string& SourceCode, const std::string& CompileOptions);
+
+	//! Writes the binary of a successfully built program to the cache
+	static bool Store(cl_device_id Device, cl_program Program, const std::string& SourceCode, const std::string& CompileOptions, double BuildMilliseconds);
+
+	static void SetCacheDirectory(const std::string& Path);
+	static const std::string& GetCacheDirectory();
+
+	static void SetEnabled(bool Enabled);
+	static bool IsEnabled();
+
+	static unsigned int GetHitCount() { return s_Hits; }
+	static unsigned int GetMissCount() { return s_Misses; }
+	static unsigned int GetRejectedCount() { return s_Rejected; }
+
+	//! Prints hit/miss counters and the time spent loading and compiling programs
+	static void PrintStatistics();
+
+protected:
+	static void InitFromEnvironment();
+
+	static std::string GetEntryPath(cl_device_id Device, const std::string& SourceCode, const std::string& CompileOptions);
+
+	static bool				s_Initialized;
+	static bool				s_Enabled;
+	static std::string		s_CacheDirectory;
+
+	static unsigned int		s_Hits;
+	static unsigned int		s_Misses;
+	static unsigned int		s_Rejected;
+	static double			s_LoadMilliseconds;
+	static double			s_BuildMilliseconds;
+};
+
+#endif // _CPROGRAM_BINARY_CACHE_H
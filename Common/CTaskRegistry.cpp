@@ -0,0 +1,82 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CTaskRegistry.h"
+
+#include "CCommandLine.h"
+
+#include <iomanip>
+#include <algorithm>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CTaskRegistry
+
+void CTaskRegistry::Register(const CTaskEntry& Entry)
+{
+	if(Find(Entry.Name))
+	{
+		cerr<<"Task '"<<Entry.Name<<"' is registered twice, ignoring the second entry."<<endl;
+		return;
+	}
+	m_Tasks.push_back(Entry);
+}
+
+void CTaskRegistry::Register(const std::string& Name, const std::string& Description, size_t DefaultSize,
+	const size_t DefaultLocalWorkSize[3], TaskFactory Factory, double DeviceBytesPerElement, double BufferBytesPerElement)
+{
+	CTaskEntry entry;
+	entry.Name = Name;
+	entry.Description = Description;
+	entry.Factory = Factory;
+	entry.DefaultSize = DefaultSize;
+	for(int i = 0; i < 3; i++)
+		entry.DefaultLocalWorkSize[i] = DefaultLocalWorkSize[i];
+	entry.DeviceBytesPerElement = DeviceBytesPerElement;
+	entry.BufferBytesPerElement = BufferBytesPerElement;
+	Register(entry);
+}
+
+const CTaskEntry* CTaskRegistry::Find(const std::string& Name) const
+{
+	for(size_t i = 0; i < m_Tasks.size(); i++)
+		if(m_Tasks[i].Name == Name)
+			return &m_Tasks[i];
+	return nullptr;
+}
+
+size_t CTaskRegistry::GetMaxProblemSize(const CTaskEntry& Entry, cl_device_id Device) const
+{
+	if(Entry.DeviceBytesPerElement <= 0.0)
+		return 0;
+
+	cl_ulong globalMem = 0, maxAlloc = 0;
+	clGetDeviceInfo(Device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &globalMem, NULL);
+	clGetDeviceInfo(Device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &maxAlloc, NULL);
+
+	// leave some room for the driver, the program and other tasks' pooled buffers
+	double maxSize = 0.9 * double(globalMem) / Entry.DeviceBytesPerElement;
+	if(Entry.BufferBytesPerElement > 0.0)
+		maxSize = std::min(maxSize, double(maxAlloc) / Entry.BufferBytesPerElement);
+
+	return (size_t)maxSize;
+}
+
+void CTaskRegistry::Print(std::ostream& Stream) const
+{
+	for(size_t i = 0; i < m_Tasks.size(); i++)
+	{
+		const CTaskEntry& entry = m_Tasks[i];
+		Stream<<"  "<<left<<setw(20)<<entry.Name<<right<<entry.Description;
+		if(entry.DeviceBytesPerElement > 0.0)
+			Stream<<" [size "<<CCommandLine::SizeToString(entry.DefaultSize)<<"]";
+		if(!entry.DefaultInputFile.empty())
+			Stream<<" [input "<<entry.DefaultInputFile<<"]";
+		Stream<<endl;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,96 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CTASK_REGISTRY_H
+#define _CTASK_REGISTRY_H
+
+#include "IComputeTask.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <iostream>
+
+//! Parameters of a single task run, filled from the registry defaults and the command line
+struct CTaskOptions
+{
+	CTaskOptions() : ProblemSize(0), Iterations(0), LocalWorkSizeSet(false)
+	{
+		LocalWorkSize[0] = LocalWorkSize[1] = LocalWorkSize[2] = 1;
+	}
+
+	size_t			ProblemSize;
+	size_t			LocalWorkSize[3];
+	//! 0 keeps the default of the task
+	unsigned int	Iterations;
+	std::string		InputFile;
+	//! True if the local size was given on the command line, e.g. to skip autotuning
+	bool			LocalWorkSizeSet;
+};
+
+//! Creates a task for the given options. It may adjust the options, e.g. to a tuned local size.
+typedef std::function<IComputeTask*(CTaskOptions& Options)> TaskFactory;
+
+//! A named task an assignment can run
+struct CTaskEntry
+{
+	CTaskEntry() : DefaultSize(0), DeviceBytesPerElement(0.0), BufferBytesPerElement(0.0)
+	{
+		DefaultLocalWorkSize[0] = DefaultLocalWorkSize[1] = DefaultLocalWorkSize[2] = 1;
+	}
+
+	std::string				Name;
+	std::string				Description;
+	TaskFactory				Factory;
+
+	//! Problem size of the default run
+	size_t					DefaultSize;
+	size_t					DefaultLocalWorkSize[3];
+	std::string				DefaultInputFile;
+
+	//! Device memory per problem element, in total and for the largest single buffer.
+	//! Used to find the largest size for "max" sweeps, 0 if the problem size is fixed (e.g. by the input image).
+	double					DeviceBytesPerElement;
+	double					BufferBytesPerElement;
+};
+
+//! Name -> task factory table of an assignment, in registration order
+class CTaskRegistry
+{
+public:
+	void Register(const CTaskEntry& Entry);
+
+	//! Convenience overload for the common case
+	void Register(const std::string& Name, const std::string& Description, size_t DefaultSize,
+		const size_t DefaultLocalWorkSize[3], TaskFactory Factory, double DeviceBytesPerElement = 0.0, double BufferBytesPerElement = 0.0);
+
+	const std::vector<CTaskEntry>& GetTasks() const { return m_Tasks; }
+
+	const CTaskEntry* Find(const std::string& Name) const;
+
+	//! Largest problem size of the task that fits into the device memory, 0 for fixed-size tasks
+	size_t GetMaxProblemSize(const CTaskEntry& Entry, cl_device_id Device) const;
+
+	void Print(std::ostream& Stream) const;
+
+protected:
+	std::vector<CTaskEntry>	m_Tasks;
+};
+
+#endif // _CTASK_REGISTRY_H
@@ -0,0 +1,163 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CThreadPool.h"
+
+#include <algorithm>
+#include <memory>
+#include <cstdlib>
+
+using namespace std;
+
+// set on the worker threads and while the calling thread executes chunks, to serialize nested calls
+static thread_local bool s_InsideJob = false;
+
+///////////////////////////////////////////////////////////////////////////////
+// CThreadPool
+
+CThreadPool::CThreadPool(unsigned int NThreads)
+	: m_pJob(nullptr), m_NChunks(0), m_NextChunk(0), m_FinishedChunks(0),
+	m_ActiveWorkers(0), m_Generation(0), m_Stop(false)
+{
+	for(unsigned int i = 1; i < NThreads; i++)
+		m_Workers.push_back(thread(&CThreadPool::WorkerLoop, this));
+}
+
+CThreadPool::~CThreadPool()
+{
+	{
+		lock_guard<mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_WakeUp.notify_all();
+
+	for(size_t i = 0; i < m_Workers.size(); i++)
+		m_Workers[i].join();
+}
+
+size_t CThreadPool::ProcessChunks(const std::function<void(size_t)>* pJob, size_t NChunks)
+{
+	size_t done = 0;
+	for(size_t chunk = m_NextChunk++; chunk < NChunks; chunk = m_NextChunk++)
+	{
+		(*pJob)(chunk);
+		done++;
+	}
+	return done;
+}
+
+void CThreadPool::WorkerLoop()
+{
+	s_InsideJob = true;
+
+	unsigned int seenGeneration = 0;
+	for(;;)
+	{
+		const function<void(size_t)>* pJob;
+		size_t nChunks;
+		{
+			unique_lock<mutex> lock(m_Mutex);
+			m_WakeUp.wait(lock, [&]() { return m_Stop || m_Generation != seenGeneration; });
+			if(m_Stop)
+				return;
+
+			seenGeneration = m_Generation;
+			pJob = m_pJob;
+			nChunks = m_NChunks;
+			m_ActiveWorkers++;
+		}
+
+		size_t done = ProcessChunks(pJob, nChunks);
+
+		{
+			lock_guard<mutex> lock(m_Mutex);
+			m_FinishedChunks += done;
+			m_ActiveWorkers--;
+		}
+		m_Done.notify_all();
+	}
+}
+
+void CThreadPool::Run(size_t NChunks, const std::function<void(size_t)>& Job)
+{
+	if(NChunks == 0)
+		return;
+
+	// nested or trivial jobs, or no workers: run on this thread
+	if(s_InsideJob || NChunks == 1 || m_Workers.empty())
+	{
+		for(size_t i = 0; i < NChunks; i++)
+			Job(i);
+		return;
+	}
+
+	{
+		unique_lock<mutex> lock(m_Mutex);
+		// a worker that woke up late for the previous job must have checked out before the counters are reset
+		m_Done.wait(lock, [&]() { return m_ActiveWorkers == 0; });
+
+		m_pJob = &Job;
+		m_NChunks = NChunks;
+		m_NextChunk = 0;
+		m_FinishedChunks = 0;
+		m_Generation++;
+	}
+	m_WakeUp.notify_all();
+
+	s_InsideJob = true;
+	size_t done = ProcessChunks(&Job, NChunks);
+	s_InsideJob = false;
+
+	unique_lock<mutex> lock(m_Mutex);
+	m_FinishedChunks += done;
+	m_Done.wait(lock, [&]() { return m_FinishedChunks == m_NChunks && m_ActiveWorkers == 0; });
+	m_pJob = nullptr;
+}
+
+unsigned int CThreadPool::GetDefaultThreadCount()
+{
+	const char* pEnv = getenv("GPGPU_CPU_THREADS");
+	if(pEnv && atoi(pEnv) > 0)
+		return (unsigned int)atoi(pEnv);
+
+	unsigned int nThreads = thread::hardware_concurrency();
+	return nThreads > 0 ? nThreads : 1;
+}
+
+CThreadPool& CThreadPool::GetShared()
+{
+	static unique_ptr<CThreadPool> s_pPool(new CThreadPool(GetDefaultThreadCount()));
+	return *s_pPool;
+}
+
+void CThreadPool::ParallelFor(size_t Begin, size_t End, const std::function<void(size_t, size_t)>& Body, size_t MinChunk)
+{
+	if(End <= Begin)
+		return;
+
+	// a few chunks per thread balance uneven chunks without much scheduling overhead
+	size_t count = End - Begin;
+	size_t nChunks = std::min<size_t>(4 * GetShared().GetThreadCount(), (count + MinChunk - 1) / std::max<size_t>(MinChunk, 1));
+	nChunks = std::max<size_t>(nChunks, 1);
+
+	ParallelChunks(count, nChunks, [&](size_t, size_t ChunkBegin, size_t ChunkEnd) {
+		Body(Begin + ChunkBegin, Begin + ChunkEnd);
+	});
+}
+
+void CThreadPool::ParallelChunks(size_t Count, size_t NChunks, const std::function<void(size_t, size_t, size_t)>& Body)
+{
+	if(Count == 0 || NChunks == 0)
+		return;
+
+	GetShared().Run(NChunks, [&](size_t Chunk) {
+		size_t chunkBegin = Count * Chunk / NChunks;
+		size_t chunkEnd = Count * (Chunk + 1) / NChunks;
+		if(chunkBegin < chunkEnd)
+			Body(Chunk, chunkBegin, chunkEnd);
+	});
+}
+
+///////////////////////////////////////////////////////////////////////////////
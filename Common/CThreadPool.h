@@ -0,0 +1,92 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CTHREAD_POOL_H
+#define _CTHREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+//! Persistent worker threads for the CPU reference implementations
+/*!
+	ParallelFor() splits an index range into chunks and processes them on the
+	shared pool; the calling thread works on chunks as well and returns when
+	all of them are done. Calls from inside a running chunk are executed
+	serially on the calling thread.
+
+	The CPU references only parallelize over independent output elements and
+	keep the order of every floating point accumulation, so their results are
+	bit-identical to a single-threaded run. Integer reductions (sums,
+	histograms) are combined per chunk, which is exact as well. Setting the
+	environment variable GPGPU_CPU_THREADS=1 restores the serial execution,
+	e.g. to compare the timings.
+*/
+class CThreadPool
+{
+public:
+	//! Creates NThreads - 1 workers, the caller of Run() is the last thread
+	explicit CThreadPool(unsigned int NThreads);
+
+	~CThreadPool();
+
+	unsigned int GetThreadCount() const { return (unsigned int)m_Workers.size() + 1; }
+
+	//! Calls Job(i) for every i in [0, NChunks) and waits for all of them
+	void Run(size_t NChunks, const std::function<void(size_t)>& Job);
+
+	//! The pool used by ParallelFor(), created on first use
+	static CThreadPool& GetShared();
+
+	//! GPGPU_CPU_THREADS, or the number of hardware threads
+	static unsigned int GetDefaultThreadCount();
+
+	//! Calls Body(ChunkBegin, ChunkEnd) for chunks of at least MinChunk indices covering [Begin, End)
+	static void ParallelFor(size_t Begin, size_t End, const std::function<void(size_t, size_t)>& Body, size_t MinChunk = 1);
+
+	//! Splits [0, Count) into exactly NChunks contiguous chunks and calls Body(Chunk, ChunkBegin, ChunkEnd).
+	//! Useful for reductions with one partial result per chunk.
+	static void ParallelChunks(size_t Count, size_t NChunks, const std::function<void(size_t, size_t, size_t)>& Body);
+
+protected:
+	void WorkerLoop();
+
+	//! Processes chunks of the current job until none are left, returns how many it did
+	size_t ProcessChunks(const std::function<void(size_t)>* pJob, size_t NChunks);
+
+	std::vector<std::thread>			m_Workers;
+
+	std::mutex							m_Mutex;
+	std::condition_variable				m_WakeUp;
+	std::condition_variable				m_Done;
+
+	const std::function<void(size_t)>*	m_pJob;
+	size_t								m_NChunks;
+	std::atomic<size_t>					m_NextChunk;
+	size_t								m_FinishedChunks;
+	//! workers that are still working on (or checking out of) the current job
+	unsigned int						m_ActiveWorkers;
+	unsigned int						m_Generation;
+	bool								m_Stop;
+};
+
+#endif // _CTHREAD_POOL_H
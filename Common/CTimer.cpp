@@ -45,4 +45,18 @@ double CTimer::GetElapsedMilliseconds()
 #endif
 }
 
+double CTimer::GetTimestampMilliseconds()
+{
+#ifdef _WIN32
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+	return 1000.0 * double(now.QuadPart) / double(freq.QuadPart);
+#else
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return 1000.0 * (double)now.tv_sec + 1.0e-3 * (double)now.tv_usec;
+#endif
+}
+
 ///////////////////////////////////////////////////////////////////////////////
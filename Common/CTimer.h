@@ -65,6 +65,9 @@ public:
 	//! Returns the elapsed time between Start() and Stop() in ms.
 	double GetElapsedMilliseconds();
 
+	//! Returns the current time in ms, relative to an arbitrary (but fixed) point in time.
+	static double GetTimestampMilliseconds();
+
 protected:
 
 #ifdef WIN32
@@ -0,0 +1,157 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CTimingStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CTimingStatistics
+
+CTimingStatistics::CTimingStatistics()
+	: m_Rejected(0), m_Mean(0.0), m_StdDev(0.0), m_Sum(0.0)
+{
+}
+
+void CTimingStatistics::AddSample(double Milliseconds)
+{
+	m_Samples.push_back(Milliseconds);
+}
+
+void CTimingStatistics::Clear()
+{
+	m_Samples.clear();
+	m_Accepted.clear();
+	m_Rejected = 0;
+	m_Mean = m_StdDev = m_Sum = 0.0;
+}
+
+static double PercentileOfSorted(const vector<double>& Sorted, double P)
+{
+	if(Sorted.empty())
+		return 0.0;
+
+	double pos = (P / 100.0) * double(Sorted.size() - 1);
+	size_t lower = (size_t)pos;
+	size_t upper = min(lower + 1, Sorted.size() - 1);
+	double frac = pos - double(lower);
+	return Sorted[lower] * (1.0 - frac) + Sorted[upper] * frac;
+}
+
+void CTimingStatistics::Evaluate(bool RejectOutliers)
+{
+	vector<double> sorted = m_Samples;
+	sort(sorted.begin(), sorted.end());
+
+	m_Accepted.clear();
+	m_Rejected = 0;
+
+	// the fences need a few samples to be meaningful
+	if(RejectOutliers && sorted.size() >= 8)
+	{
+		double q1 = PercentileOfSorted(sorted, 25.0);
+		double q3 = PercentileOfSorted(sorted, 75.0);
+		double iqr = q3 - q1;
+		double lowerFence = q1 - 3.0 * iqr;
+		double upperFence = q3 + 3.0 * iqr;
+
+		for(size_t i = 0; i < sorted.size(); i++)
+		{
+			if(sorted[i] >= lowerFence && sorted[i] <= upperFence)
+				m_Accepted.push_back(sorted[i]);
+			else
+				m_Rejected++;
+		}
+	}
+	else
+	{
+		m_Accepted = sorted;
+	}
+
+	m_Sum = 0.0;
+	for(size_t i = 0; i < m_Accepted.size(); i++)
+		m_Sum += m_Accepted[i];
+	m_Mean = m_Accepted.empty() ? 0.0 : m_Sum / double(m_Accepted.size());
+
+	double variance = 0.0;
+	for(size_t i = 0; i < m_Accepted.size(); i++)
+		variance += (m_Accepted[i] - m_Mean) * (m_Accepted[i] - m_Mean);
+	m_StdDev = m_Accepted.size() > 1 ? sqrt(variance / double(m_Accepted.size() - 1)) : 0.0;
+}
+
+double CTimingStatistics::GetMin() const
+{
+	return m_Accepted.empty() ? 0.0 : m_Accepted.front();
+}
+
+double CTimingStatistics::GetMax() const
+{
+	return m_Accepted.empty() ? 0.0 : m_Accepted.back();
+}
+
+double CTimingStatistics::GetPercentile(double P) const
+{
+	return PercentileOfSorted(m_Accepted, P);
+}
+
+void CTimingStatistics::Print(std::ostream& Stream, const std::string& Title) const
+{
+	Stream << "  " << left << setw(16) << Title << right
+		<< " min: " << GetMin()
+		<< " ms, median: " << GetMedian()
+		<< " ms, mean: " << GetMean()
+		<< " ms, p95: " << GetPercentile(95.0)
+		<< " ms, p99: " << GetPercentile(99.0)
+		<< " ms, stddev: " << GetStdDev() << " ms";
+	if(m_Rejected > 0)
+		Stream << " (" << m_Rejected << " of " << m_Samples.size() << " samples rejected)";
+	Stream << endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CKernelProfile
+
+void CKernelProfile::Clear()
+{
+	IdleGap.Clear();
+	Execution.Clear();
+	m_LastEnd = 0;
+}
+
+void CKernelProfile::Evaluate(bool RejectOutliers)
+{
+	IdleGap.Evaluate(RejectOutliers);
+	Execution.Evaluate(RejectOutliers);
+}
+
+bool CKernelProfile::AddEvent(cl_event Event)
+{
+	cl_ulong start, end;
+	if(clGetEventProfilingInfo(Event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL) != CL_SUCCESS ||
+		clGetEventProfilingInfo(Event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL) != CL_SUCCESS)
+		return false;
+
+	// the counters are in ns; overlapping launches (or runtimes that report
+	// slightly out-of-order values) have no gap, so clamp to zero
+	if(m_LastEnd != 0)
+		IdleGap.AddSample(start > m_LastEnd ? 1.0e-6 * double(start - m_LastEnd) : 0.0);
+	Execution.AddSample(end > start ? 1.0e-6 * double(end - start) : 0.0);
+	m_LastEnd = end;
+
+	return true;
+}
+
+void CKernelProfile::Print(std::ostream& Stream, bool PrintIdleGaps) const
+{
+	Execution.Print(Stream, "execution:");
+	if(PrintIdleGaps && IdleGap.GetSampleCount() > 0)
+		IdleGap.Print(Stream, "idle gap:");
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,122 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CTIMING_STATISTICS_H
+#define _CTIMING_STATISTICS_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include <vector>
+#include <string>
+#include <iostream>
+
+//! Collects timing samples (in ms) and evaluates robust statistics on them
+/*!
+	Call AddSample() for every measured interval and Evaluate() once all
+	samples are in. Evaluate() sorts the samples and, if requested, rejects
+	outliers outside the Tukey fences [Q1 - 3 IQR, Q3 + 3 IQR], e.g. launches
+	that were interrupted by the OS or the display driver. All statistics
+	refer to the accepted samples only.
+
+	Warm-up runs should simply never be added.
+*/
+class CTimingStatistics
+{
+public:
+	CTimingStatistics();
+
+	void AddSample(double Milliseconds);
+
+	void Clear();
+
+	void Evaluate(bool RejectOutliers = true);
+
+	size_t GetSampleCount() const { return m_Accepted.size(); }
+	size_t GetRejectedCount() const { return m_Rejected; }
+
+	double GetMin() const;
+	double GetMax() const;
+	double GetMean() const { return m_Mean; }
+	double GetStdDev() const { return m_StdDev; }
+	double GetSum() const { return m_Sum; }
+
+	//! Returns the P-th percentile (0 <= P <= 100) of the accepted samples, interpolating linearly
+	double GetPercentile(double P) const;
+	double GetMedian() const { return GetPercentile(50.0); }
+
+	//! Prints one line: min / median / mean / p95 / p99 / stddev
+	void Print(std::ostream& Stream, const std::string& Title) const;
+
+protected:
+	std::vector<double>		m_Samples;
+	std::vector<double>		m_Accepted;
+	size_t					m_Rejected;
+
+	double					m_Mean;
+	double					m_StdDev;
+	double					m_Sum;
+};
+
+//! Device-side timings of a series of kernel launches, obtained from OpenCL events
+/*!
+	Execution is the start -> end interval of each launch. The launches of a
+	sequence are enqueued back to back, so their queued and submit counters
+	only tell how far the host was ahead of the device. What the device loses
+	between the launches is the idle gap from the end of one launch to the
+	start of the next one; if it is in the order of the execution time, the
+	sequence is launch-bound.
+
+	The events of a sequence have to be added in launch order (in-order queue).
+	Call BeginSequence() before the events of the next sequence, the device
+	may have waited for the host in between.
+*/
+class CKernelProfile
+{
+public:
+	CKernelProfile() : m_LastEnd(0) {}
+
+	void Clear();
+
+	//! The next event starts a new sequence, its gap to the previous one is not recorded
+	void BeginSequence() { m_LastEnd = 0; }
+
+	void Evaluate(bool RejectOutliers = true);
+
+	//! Adds the timings of a finished, profiled event. Returns false if no profiling info is available.
+	bool AddEvent(cl_event Event);
+
+	//! Prints the execution times, the idle gaps only on request
+	void Print(std::ostream& Stream, bool PrintIdleGaps = false) const;
+
+	CTimingStatistics		IdleGap;
+	CTimingStatistics		Execution;
+
+protected:
+	//! END counter of the previous launch of the sequence, 0 before the first one
+	cl_ulong				m_LastEnd;
+};
+
+#endif // _CTIMING_STATISTICS_H
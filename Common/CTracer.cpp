@@ -0,0 +1,331 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CTracer.h"
+
+#include "CLUtil.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+// look for finished events every time this many commands have been recorded
+static const size_t		c_ResolveBatch = 4096;
+
+std::atomic<bool>				CTracer::s_Enabled(false);
+std::string						CTracer::s_Path;
+std::mutex						CTracer::s_Mutex;
+std::vector<CTracer::CZone>		CTracer::s_Zones;
+std::deque<CTracer::CDeviceCommand>	CTracer::s_Commands;
+size_t							CTracer::s_FirstPending = 0;
+size_t							CTracer::s_NextResolve = c_ResolveBatch;
+std::vector<CTracer::CQueueClock>	CTracer::s_Clocks;
+std::set<std::string>			CTracer::s_Names;
+
+static string EscapeJSON(const char* pString)
+{
+	string escaped;
+	for(const char* p = pString; *p; p++)
+	{
+		if(*p == '"' || *p == '\\')
+			escaped += '\\';
+		escaped += *p;
+	}
+	return escaped;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CTracer
+
+void CTracer::Start(const std::string& Path)
+{
+	lock_guard<mutex> lock(s_Mutex);
+	s_Path = Path.empty() ? "trace.json" : Path;
+	s_Enabled = true;
+
+	s_Zones.reserve(65536);
+}
+
+void CTracer::InitFromEnvironment()
+{
+	const char* pEnv = getenv("GPGPU_TRACE");
+	if(pEnv && *pEnv && !s_Enabled)
+		Start(pEnv);
+}
+
+unsigned int CTracer::GetThreadIndex()
+{
+	// small consecutive ids read better in the viewers than hashed thread ids
+	static unsigned int s_NextThread = 0;
+	static thread_local unsigned int s_Thread = ~0u;
+	if(s_Thread == ~0u)
+		s_Thread = s_NextThread++;
+	return s_Thread;
+}
+
+void CTracer::AddZone(const char* Name, double StartMs, double EndMs)
+{
+	lock_guard<mutex> lock(s_Mutex);
+	if(!s_Enabled)
+		return;
+
+	CZone zone = { Name, StartMs, EndMs, GetThreadIndex() };
+	s_Zones.push_back(zone);
+}
+
+cl_event* CTracer::EventSlot(const char* Name)
+{
+	if(!s_Enabled)
+		return NULL;
+
+	lock_guard<mutex> lock(s_Mutex);
+	// Flush() may have stopped the recording in the meantime
+	if(!s_Enabled)
+		return NULL;
+	if(s_Commands.size() >= s_NextResolve)
+	{
+		ResolveEvents(false);
+		s_NextResolve = s_Commands.size() + c_ResolveBatch;
+	}
+
+	CDeviceCommand command = { Name, CTimer::GetTimestampMilliseconds(), GetThreadIndex(), true, NULL, NULL, 0, 0, 0, 0, false };
+	s_Commands.push_back(command);
+	// the deque never moves its elements, the enqueue call writes the event after the lock is released
+	return &s_Commands.back().Event;
+}
+
+void CTracer::AddEvent(const char* Name, cl_event Event)
+{
+	if(!s_Enabled || !Event)
+		return;
+
+	lock_guard<mutex> lock(s_Mutex);
+	if(!s_Enabled)
+		return;
+	if(s_Commands.size() >= s_NextResolve)
+	{
+		ResolveEvents(false);
+		s_NextResolve = s_Commands.size() + c_ResolveBatch;
+	}
+
+	// the event may have been enqueued long ago, it cannot calibrate the clock of its queue
+	cl_command_queue queue = NULL;
+	if(clGetEventInfo(Event, CL_EVENT_COMMAND_QUEUE, sizeof(cl_command_queue), &queue, NULL) == CL_SUCCESS)
+		CalibrateQueue(queue);
+
+	clRetainEvent(Event);
+	CDeviceCommand command = { Name, CTimer::GetTimestampMilliseconds(), GetThreadIndex(), false, Event, NULL, 0, 0, 0, 0, false };
+	s_Commands.push_back(command);
+}
+
+const char* CTracer::Intern(const std::string& Name)
+{
+	// the nodes of a std::set never move
+	lock_guard<mutex> lock(s_Mutex);
+	return s_Names.insert(Name).first->c_str();
+}
+
+const char* CTracer::GetKernelName(cl_kernel Kernel)
+{
+	string name = CLUtil::GetKernelInfoString(Kernel, CL_KERNEL_FUNCTION_NAME);
+	if(name.empty())
+		return "kernel";
+	return Intern(name);
+}
+
+void CTracer::ResolveEvents(bool Wait)
+{
+	// s_Mutex is locked by the caller
+	unsigned int thread = GetThreadIndex();
+	for(size_t i = s_FirstPending; i < s_Commands.size(); i++)
+	{
+		CDeviceCommand& command = s_Commands[i];
+		if(command.Resolved || (!Wait && command.Thread != thread))
+			continue;
+		if(!command.Event)
+		{
+			// the enqueue call failed
+			command.Resolved = true;
+			continue;
+		}
+
+		cl_int status = CL_COMPLETE;
+		clGetEventInfo(command.Event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+		if(status > CL_COMPLETE)
+		{
+			if(!Wait)
+				continue;
+			clWaitForEvents(1, &command.Event);
+		}
+
+		clGetEventInfo(command.Event, CL_EVENT_COMMAND_QUEUE, sizeof(cl_command_queue), &command.Queue, NULL);
+		clGetEventProfilingInfo(command.Event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &command.Queued, NULL);
+		clGetEventProfilingInfo(command.Event, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &command.Submit, NULL);
+		clGetEventProfilingInfo(command.Event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &command.Start, NULL);
+		clGetEventProfilingInfo(command.Event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &command.End, NULL);
+		clReleaseEvent(command.Event);
+		command.Event = NULL;
+		command.Resolved = true;
+
+		if(command.Calibrates && command.Queue)
+			UpdateClock(command.Queue, command.RecordMs - 1.0e-6 * double(command.Queued));
+	}
+
+	while(s_FirstPending < s_Commands.size() && s_Commands[s_FirstPending].Resolved)
+		s_FirstPending++;
+}
+
+void CTracer::UpdateClock(cl_command_queue Queue, double OffsetMs)
+{
+	// s_Mutex is locked by the caller
+	for(size_t i = 0; i < s_Clocks.size(); i++)
+		if(s_Clocks[i].Queue == Queue)
+		{
+			s_Clocks[i].OffsetMs = std::max(s_Clocks[i].OffsetMs, OffsetMs);
+			return;
+		}
+
+	CQueueClock clock = { Queue, OffsetMs };
+	s_Clocks.push_back(clock);
+}
+
+void CTracer::CalibrateQueue(cl_command_queue Queue)
+{
+	// s_Mutex is locked by the caller
+	for(size_t i = 0; i < s_Clocks.size(); i++)
+		if(s_Clocks[i].Queue == Queue)
+			return;
+
+	// the marker is queued after the host time was taken, like a TRACE_CL command
+	double hostMs = CTimer::GetTimestampMilliseconds();
+	cl_event marker = NULL;
+	if(clEnqueueMarkerWithWaitList(Queue, 0, NULL, &marker) != CL_SUCCESS)
+		return;
+
+	cl_ulong queued = 0;
+	cl_int clErr = clWaitForEvents(1, &marker);
+	if(clErr == CL_SUCCESS)
+		clErr = clGetEventProfilingInfo(marker, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &queued, NULL);
+	clReleaseEvent(marker);
+
+	if(clErr == CL_SUCCESS)
+		UpdateClock(Queue, hostMs - 1.0e-6 * double(queued));
+}
+
+size_t CTracer::GetQueueIndex(const CDeviceCommand& Command)
+{
+	for(size_t i = 0; i < s_Clocks.size(); i++)
+		if(s_Clocks[i].Queue == Command.Queue)
+			return i;
+
+	// the marker failed; a recorded event has usually finished, so its END bounds the offset
+	CQueueClock clock = { Command.Queue, Command.RecordMs - 1.0e-6 * double(Command.End) };
+	s_Clocks.push_back(clock);
+	return s_Clocks.size() - 1;
+}
+
+void CTracer::WriteJSON(std::ostream& Stream)
+{
+	// s_Mutex is locked by the caller, all events are resolved
+	const int hostPid = 1, devicePid = 2;
+
+	// the viewers handle small numbers better, so start the time line at the first record
+	double originMs = 0.0;
+	bool hasOrigin = false;
+	for(size_t i = 0; i < s_Zones.size(); i++)
+		if(!hasOrigin || s_Zones[i].StartMs < originMs)
+		{
+			originMs = s_Zones[i].StartMs;
+			hasOrigin = true;
+		}
+	for(size_t i = 0; i < s_Commands.size(); i++)
+		if(!hasOrigin || s_Commands[i].RecordMs < originMs)
+		{
+			originMs = s_Commands[i].RecordMs;
+			hasOrigin = true;
+		}
+
+	Stream << fixed << setprecision(3);
+	Stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << endl;
+	Stream << "{\"ph\": \"M\", \"name\": \"process_name\", \"pid\": " << hostPid << ", \"tid\": 0, \"args\": {\"name\": \"Host\"}}," << endl;
+	Stream << "{\"ph\": \"M\", \"name\": \"process_name\", \"pid\": " << devicePid << ", \"tid\": 0, \"args\": {\"name\": \"OpenCL device\"}}";
+
+	// ts and dur are in microseconds
+	for(size_t i = 0; i < s_Zones.size(); i++)
+	{
+		const CZone& zone = s_Zones[i];
+		Stream << "," << endl << "{\"ph\": \"X\", \"name\": \"" << EscapeJSON(zone.Name) << "\", \"cat\": \"host\", \"pid\": " << hostPid
+			<< ", \"tid\": " << zone.Thread << ", \"ts\": " << 1000.0 * (zone.StartMs - originMs)
+			<< ", \"dur\": " << 1000.0 * (zone.EndMs - zone.StartMs) << "}";
+	}
+
+	for(size_t i = 0; i < s_Commands.size(); i++)
+	{
+		const CDeviceCommand& command = s_Commands[i];
+		if(!command.Queue || command.End < command.Start)
+			continue;
+
+		size_t queue = GetQueueIndex(command);
+		double offsetMs = s_Clocks[queue].OffsetMs - originMs;
+		double queuedUs = 1000.0 * (1.0e-6 * double(command.Queued) + offsetMs);
+		double submitUs = 1000.0 * (1.0e-6 * double(command.Submit) + offsetMs);
+		double startUs = 1000.0 * (1.0e-6 * double(command.Start) + offsetMs);
+		double endUs = 1000.0 * (1.0e-6 * double(command.End) + offsetMs);
+
+		Stream << "," << endl << "{\"ph\": \"X\", \"name\": \"" << EscapeJSON(command.Name) << "\", \"cat\": \"device\", \"pid\": " << devicePid
+			<< ", \"tid\": " << 2 * queue << ", \"ts\": " << startUs << ", \"dur\": " << endUs - startUs
+			<< ", \"args\": {\"queued_us\": " << queuedUs << ", \"submit_us\": " << submitUs << "}}";
+		if(command.Start > command.Queued)
+		{
+			Stream << "," << endl << "{\"ph\": \"X\", \"name\": \"" << EscapeJSON(command.Name) << "\", \"cat\": \"queue\", \"pid\": " << devicePid
+				<< ", \"tid\": " << 2 * queue + 1 << ", \"ts\": " << queuedUs << ", \"dur\": " << startUs - queuedUs << "}";
+		}
+	}
+
+	for(size_t q = 0; q < s_Clocks.size(); q++)
+	{
+		Stream << "," << endl << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": " << devicePid << ", \"tid\": " << 2 * q
+			<< ", \"args\": {\"name\": \"queue " << q << " execution\"}}";
+		Stream << "," << endl << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": " << devicePid << ", \"tid\": " << 2 * q + 1
+			<< ", \"args\": {\"name\": \"queue " << q << " waiting\"}}";
+	}
+
+	Stream << endl << "]}" << endl;
+}
+
+bool CTracer::Flush()
+{
+	lock_guard<mutex> lock(s_Mutex);
+	if(!s_Enabled)
+		return true;
+	s_Enabled = false;
+
+	ResolveEvents(true);
+
+	ofstream file(s_Path.c_str(), ios::trunc);
+	if(!file.is_open())
+	{
+		cerr << "Failed to open trace file '" << s_Path << "'." << endl;
+		return false;
+	}
+	WriteJSON(file);
+	if(!file.good())
+		return false;
+
+	cout << "Trace with " << s_Zones.size() << " host zones and " << s_Commands.size() << " device commands written to " << s_Path << endl;
+
+	s_Zones.clear();
+	s_Commands.clear();
+	s_FirstPending = 0;
+	s_NextResolve = c_ResolveBatch;
+	s_Clocks.clear();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
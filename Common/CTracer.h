@@ -0,0 +1,204 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+#ifndef _CTRACER_H
+#define _CTRACER_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include "CTimer.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <set>
+#include <iostream>
+
+// Compile with -DGPGPU_ENABLE_TRACING=0 to remove all tracing code from the build
+#ifndef GPGPU_ENABLE_TRACING
+	#define GPGPU_ENABLE_TRACING 1
+#endif
+
+//! Timeline of host and device activity in the Chrome trace event format
+/*!
+	The trace contains host zones (TRACE_SCOPE) and OpenCL commands
+	(TRACE_CL / TRACE_CL_EVENT). Load the written JSON file in
+	chrome://tracing or https://ui.perfetto.dev.
+
+	Host zones are shown per thread. Every command queue gets two tracks: the
+	execution of the commands (START to END) and the time they waited in the
+	queue (QUEUED to START). The device timestamps are moved onto the host
+	time line with a clock offset per queue. A TRACE_CL command takes its
+	host timestamp right before the enqueue call, so its QUEUED counter can
+	only be later; each of them bounds the offset from below and the largest
+	bound is kept. Events recorded with TRACE_CL_EVENT are only seen after
+	the fact, so their queue is calibrated once with a marker instead.
+
+	Recording is enabled with Start(), the command line option --trace=FILE or
+	the environment variable GPGPU_TRACE=FILE. While it is disabled, a zone
+	costs one branch and TRACE_CL evaluates to NULL. Recording a zone takes a
+	mutex and appends to a deque, which keeps the event slots in place while
+	other threads record. Events are resolved when the trace is written (or in
+	batches while recording, so long runs do not hold on to thousands of
+	cl_events); a thread only resolves its own commands in between, the slots
+	of the others may still be written by their enqueue calls. Names must be
+	string literals or otherwise outlive the tracer.
+*/
+class CTracer
+{
+public:
+	//! Starts recording, Flush() writes the trace to Path (trace.json if empty)
+	static void Start(const std::string& Path);
+
+	//! Reads GPGPU_TRACE
+	static void InitFromEnvironment();
+
+	static bool IsEnabled() { return s_Enabled; }
+
+	//! Records a finished host zone
+	static void AddZone(const char* Name, double StartMs, double EndMs);
+
+	//! Returns a cl_event* for the event parameter of an enqueue call, or NULL if
+	//! tracing is disabled. The tracer owns (and releases) the returned event.
+	static cl_event* EventSlot(const char* Name);
+
+	//! Records an event that the caller keeps using (it is retained)
+	static void AddEvent(const char* Name, cl_event Event);
+
+	//! Returns a pointer to a copy of Name that stays valid as long as the program runs
+	static const char* Intern(const std::string& Name);
+
+	//! Interned function name of a kernel
+	static const char* GetKernelName(cl_kernel Kernel);
+
+	//! Writes the trace file and stops recording. Waits for all recorded commands.
+	static bool Flush();
+
+	static void WriteJSON(std::ostream& Stream);
+
+protected:
+	struct CZone
+	{
+		const char*		Name;
+		double			StartMs;
+		double			EndMs;
+		unsigned int	Thread;
+	};
+
+	struct CDeviceCommand
+	{
+		const char*		Name;
+		//! host time when the command was recorded
+		double			RecordMs;
+		unsigned int	Thread;
+		//! RecordMs was taken before the enqueue call, so it calibrates the device clock
+		bool			Calibrates;
+		cl_event		Event;
+		cl_command_queue Queue;
+		cl_ulong		Queued, Submit, Start, End;
+		bool			Resolved;
+	};
+
+	struct CQueueClock
+	{
+		cl_command_queue Queue;
+		//! host ms = device ns * 1e-6 + Offset
+		double			OffsetMs;
+	};
+
+	//! Reads the profiling info of finished commands and releases their events
+	/*!
+		Wait blocks on unfinished commands and resolves those of all threads,
+		otherwise only the commands of the calling thread are resolved.
+	*/
+	static void ResolveEvents(bool Wait);
+
+	static unsigned int GetThreadIndex();
+
+	//! Raises the clock offset of Queue to OffsetMs (a lower bound of it), adds the clock if needed
+	static void UpdateClock(cl_command_queue Queue, double OffsetMs);
+
+	//! Calibrates the clock of Queue with a marker, unless it already has one
+	static void CalibrateQueue(cl_command_queue Queue);
+
+	//! Clock of the queue of Command; a queue that was never calibrated is estimated from the recording time
+	static size_t GetQueueIndex(const CDeviceCommand& Command);
+
+	static std::atomic<bool>			s_Enabled;
+	static std::string					s_Path;
+	static std::mutex					s_Mutex;
+	static std::vector<CZone>			s_Zones;
+	static std::deque<CDeviceCommand>	s_Commands;
+	//! commands before this one are all resolved
+	static size_t						s_FirstPending;
+	static size_t						s_NextResolve;
+	static std::vector<CQueueClock>		s_Clocks;
+	static std::set<std::string>		s_Names;
+};
+
+#if GPGPU_ENABLE_TRACING
+
+//! RAII zone, recorded when it goes out of scope
+class CTraceZone
+{
+public:
+	explicit CTraceZone(const char* Name)
+		: m_Name(Name), m_StartMs(CTracer::IsEnabled() ? CTimer::GetTimestampMilliseconds() : 0.0)
+	{
+	}
+
+	~CTraceZone()
+	{
+		if(CTracer::IsEnabled())
+			CTracer::AddZone(m_Name, m_StartMs, CTimer::GetTimestampMilliseconds());
+	}
+
+protected:
+	const char*		m_Name;
+	double			m_StartMs;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+//! Records the enclosing scope as a host zone
+#define TRACE_SCOPE(Name) CTraceZone TRACE_CONCAT(traceZone, __LINE__)(Name)
+//! Event parameter for an enqueue call that otherwise passes NULL
+#define TRACE_CL(Name) CTracer::EventSlot(Name)
+//! Records an event the caller created anyway
+#define TRACE_CL_EVENT(Name, Event) do { if(CTracer::IsEnabled()) CTracer::AddEvent(Name, Event); } while(0)
+
+#else
+
+#define TRACE_SCOPE(Name) do {} while(0)
+#define TRACE_CL(Name) NULL
+#define TRACE_CL_EVENT(Name, Event) do {} while(0)
+
+#endif // GPGPU_ENABLE_TRACING
+
+#endif // _CTRACER_H
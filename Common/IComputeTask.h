@@ -30,6 +30,11 @@
 #endif 
 
 #include "CommonDefs.h"
+#include "CDeviceBufferPool.h"
+#include "CCommandLine.h"
+
+#include <string>
+#include <vector>
 
 //! Common interface for the tasks within the assignment.
 /*!
@@ -40,7 +45,18 @@ class IComputeTask
 {
 public:
 
+	IComputeTask() : m_pBufferPool(nullptr), m_Iterations(0) {};
+
 	virtual ~IComputeTask() {};
+
+	//! Set by the assignment before InitResources(). Tasks allocate their device buffers with AcquireBuffer().
+	void SetBufferPool(CDeviceBufferPool* pBufferPool) { m_pBufferPool = pBufferPool; }
+
+	//! Number of timed repetitions of each kernel, 0 selects the default of the task
+	void SetIterations(unsigned int Iterations) { m_Iterations = Iterations; }
+
+	//! Restricts the kernel variants a task runs to those matching one of the patterns (see IsVariantSelected()), empty runs all
+	void SetVariantFilter(const std::vector<std::string>& Patterns) { m_VariantFilter = Patterns; }
 	
 	//! Init any resources specific to the current task
 	virtual bool InitResources(cl_device_id Device, cl_context Context) = 0;
@@ -56,6 +72,33 @@ public:
 
 	//! Compare the GPU solution to the "golden" solution
 	virtual bool ValidateResults() = 0;
+
+protected:
+	//! Takes a buffer from the pool, or creates a standalone one if there is no pool
+	CPooledBuffer AcquireBuffer(cl_context Context, cl_mem_flags Flags, size_t Size, cl_int* pError = nullptr)
+	{
+		if(m_pBufferPool)
+			return m_pBufferPool->Acquire(Flags, Size, pError);
+		return CPooledBuffer::Create(Context, Flags, Size, pError);
+	}
+
+	unsigned int GetIterations(unsigned int Default) const { return m_Iterations ? m_Iterations : Default; }
+
+	//! Tasks with several kernel variants skip (and do not validate) the ones the filter excludes.
+	//! A pattern matches the variant name alone or "Task/Variant", e.g. "scanNaive" or "Reduction/*Decomposition*".
+	bool IsVariantSelected(const std::string& Task, const std::string& Variant) const
+	{
+		if(m_VariantFilter.empty())
+			return true;
+		for(size_t i = 0; i < m_VariantFilter.size(); i++)
+			if(CCommandLine::MatchPattern(m_VariantFilter[i], Variant) || CCommandLine::MatchPattern(m_VariantFilter[i], Task + "/" + Variant))
+				return true;
+		return false;
+	}
+
+	CDeviceBufferPool*			m_pBufferPool;
+	unsigned int				m_Iterations;
+	std::vector<std::string>	m_VariantFilter;
 };
 
 #endif // _ICOMPUTE_TASK_H
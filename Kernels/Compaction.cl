@@ -0,0 +1,20 @@
+#pragma once
+
+//Stream compaction with the prefix sum of Scan.cl (included with CKernelLibrary).
+//
+//flags holds 1 for every element that is kept and 0 otherwise, offsets the inclusive prefix sum
+//of the flags (Scan_WorkEfficient + Scan_WorkEfficientAdd). The number of kept elements is offsets[N - 1].
+//The element type is uint unless the host defines COMPACTION_TYPE, e.g. "-D COMPACTION_TYPE=float4".
+
+#ifndef COMPACTION_TYPE
+	#define COMPACTION_TYPE uint
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+__kernel void Compaction_Scatter(const __global uint* flags, const __global uint* offsets,
+	const __global COMPACTION_TYPE* inArray, __global COMPACTION_TYPE* outArray, uint N)
+{
+	uint GID = get_global_id(0);
+	if (GID < N && flags[GID])
+		outArray[offsets[GID] - 1] = inArray[GID];
+}
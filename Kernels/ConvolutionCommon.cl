@@ -0,0 +1,25 @@
+#pragma once
+
+//Shared by the separable and the bilateral convolution (included with CKernelLibrary).
+
+/* These macros will be defined dynamically during building the program
+
+#define KERNEL_RADIUS 2
+
+//horizontal kernel
+#define H_GROUPSIZE_X		32
+#define H_GROUPSIZE_Y		4
+#define H_RESULT_STEPS		8
+
+//vertical kernel
+#define V_GROUPSIZE_X		32
+#define V_GROUPSIZE_Y		16
+#define V_RESULT_STEPS		9
+
+*/
+
+#ifndef KERNEL_RADIUS
+	#error "KERNEL_RADIUS has to be set by the host (see CConvolutionSeparableTask::GetSpecialization)"
+#endif
+
+#define KERNEL_LENGTH (2 * KERNEL_RADIUS + 1)
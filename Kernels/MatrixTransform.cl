@@ -0,0 +1,357 @@
+#pragma once
+
+//Layout transforms of a row-major SizeX x SizeY matrix, used through CMatrixTransform.
+//
+//The host specializes the program with
+//	T		the element type. A reordering only moves bits, so half is moved as ushort
+//			and needs no cl_khr_fp16.
+//	TILE	the edge of the square tile of the input a work-group processes
+//	ROWS	rows of the tile per work-item, the work-group is TILE x (TILE / ROWS)
+//
+//The matrix does not have to be a multiple of the tile in either direction, the
+//work-items outside of the matrix only take part in the barrier.
+//
+//Output of the element (x, y) of the input:
+//	MatrixTranspose		(y, x)					SizeY x SizeX
+//	MatrixRotate90		(SizeY - 1 - y, x)		SizeY x SizeX, clockwise
+//	MatrixRotate270		(y, SizeX - 1 - x)		SizeY x SizeX
+//	MatrixRotate180		(SizeX - 1 - x, SizeY - 1 - y)
+//	MatrixFlipH			(SizeX - 1 - x, y)
+//	MatrixFlipV			(x, SizeY - 1 - y)
+//
+//MatrixBatch<Transform> transform many small matrices in one launch, see TransformBatch().
+//Matrix<Transform>InPlace transpose or rotate a square matrix in place. They need two tiles of
+//local memory and are built as a program of their own: the host passes TILE_INPLACE instead of
+//TILE, and only the in-place kernels are compiled.
+
+#ifdef TILE_INPLACE
+	#define TILE TILE_INPLACE
+#endif
+#ifndef T
+	#define T float
+#endif
+#ifndef TILE
+	#define TILE 32
+#endif
+#ifndef ROWS
+	#define ROWS 4
+#endif
+
+#define GROUP_ROWS (TILE / ROWS)
+// one extra column, so the TILE elements of a tile column are in different banks
+#define TILE_PITCH (TILE + 1)
+
+// same order as CMatrixTransform::ETransform
+#define OP_TRANSPOSE	0
+#define OP_ROTATE_90	1
+#define OP_ROTATE_180	2
+#define OP_ROTATE_270	3
+#define OP_FLIP_H		4
+#define OP_FLIP_V		5
+
+#define SWAPS_DIMENSIONS(op) ((op) == OP_TRANSPOSE || (op) == OP_ROTATE_90 || (op) == OP_ROTATE_270)
+
+// Position of the input element that ends up at (ox, oy) of the output in the staged matrix (rows pitch elements apart)
+inline uint GetStagedIndex(const int op, uint ox, uint oy, uint SizeX, uint SizeY, uint pitch)
+{
+	uint x, y;
+	switch (op)
+	{
+	case OP_TRANSPOSE:	x = oy; y = ox; break;
+	case OP_ROTATE_90:	x = oy; y = SizeY - 1 - ox; break;
+	case OP_ROTATE_270:	x = SizeX - 1 - oy; y = ox; break;
+	case OP_ROTATE_180:	x = SizeX - 1 - ox; y = SizeY - 1 - oy; break;
+	case OP_FLIP_H:		x = SizeX - 1 - ox; y = oy; break;
+	default:			x = ox; y = SizeY - 1 - oy; break;
+	}
+	return y * pitch + x;
+}
+
+#ifndef TILE_INPLACE
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The rows of the output are the columns of the input: the tile is read row by row and written
+// column by column through local memory, so both global accesses are coalesced.
+inline void TransposeTile(__global const T* in, __global T* out, uint SizeX, uint SizeY, __local T* tile, const int op, int bx, int by)
+{
+	int lx = get_local_id(0);
+
+	for (int r = get_local_id(1); r < TILE; r += GROUP_ROWS)
+	{
+		int x = bx + lx, y = by + r;
+		if (x < SizeX && y < SizeY)
+			tile[r * TILE_PITCH + lx] = in[y * SizeX + x];
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// r is the column of the tile (a row of the output), consecutive work-items write consecutive columns
+	// of the output. The rotation by 90 degrees mirrors the rows of the input, so it walks the tile bottom-up.
+	int yl = (op == OP_ROTATE_90) ? TILE - 1 - lx : lx;
+	for (int r = get_local_id(1); r < TILE; r += GROUP_ROWS)
+	{
+		int x = bx + r, y = by + yl;
+		if (x < SizeX && y < SizeY)
+		{
+			uint row = (op == OP_ROTATE_270) ? SizeX - 1 - x : x;
+			uint col = (op == OP_ROTATE_90) ? SizeY - 1 - y : y;
+			out[row * SizeY + col] = tile[yl * TILE_PITCH + r];
+		}
+	}
+}
+
+// The rows stay rows, a mirrored row still falls into the same memory segments, so these
+// are plain copies without local memory.
+inline void MirrorTile(__global const T* in, __global T* out, uint SizeX, uint SizeY, const bool mirrorX, const bool mirrorY, int bx, int by)
+{
+	int x = bx + get_local_id(0);
+	if (x >= SizeX)
+		return;
+	uint col = mirrorX ? SizeX - 1 - x : x;
+	for (int r = get_local_id(1); r < TILE; r += GROUP_ROWS)
+	{
+		int y = by + r;
+		if (y < SizeY)
+			out[(mirrorY ? SizeY - 1 - y : y) * SizeX + col] = in[y * SizeX + x];
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+__kernel __attribute__((reqd_work_group_size(TILE, GROUP_ROWS, 1)))
+void MatrixTranspose(__global const T* in, __global T* out, uint SizeX, uint SizeY)
+{
+	__local T tile[TILE * TILE_PITCH];
+	TransposeTile(in, out, SizeX, SizeY, tile, OP_TRANSPOSE, get_group_id(0) * TILE, get_group_id(1) * TILE);
+}
+
+__kernel __attribute__((reqd_work_group_size(TILE, GROUP_ROWS, 1)))
+void MatrixRotate90(__global const T* in, __global T* out, uint SizeX, uint SizeY)
+{
+	__local T tile[TILE * TILE_PITCH];
+	TransposeTile(in, out, SizeX, SizeY, tile, OP_ROTATE_90, get_group_id(0) * TILE, get_group_id(1) * TILE);
+}
+
+__kernel __attribute__((reqd_work_group_size(TILE, GROUP_ROWS, 1)))
+void MatrixRotate270(__global const T* in, __global T* out, uint SizeX, uint SizeY)
+{
+	__local T tile[TILE * TILE_PITCH];
+	TransposeTile(in, out, SizeX, SizeY, tile, OP_ROTATE_270, get_group_id(0) * TILE, get_group_id(1) * TILE);
+}
+
+__kernel __attribute__((reqd_work_group_size(TILE, GROUP_ROWS, 1)))
+void MatrixRotate180(__global const T* in, __global T* out, uint SizeX, uint SizeY)
+{
+	MirrorTile(in, out, SizeX, SizeY, true, true, get_group_id(0) * TILE, get_group_id(1) * TILE);
+}
+
+__kernel __attribute__((reqd_work_group_size(TILE, GROUP_ROWS, 1)))
+void MatrixFlipH(__global const T* in, __global T* out, uint SizeX, uint SizeY)
+{
+	MirrorTile(in, out, SizeX, SizeY, true, false, get_group_id(0) * TILE, get_group_id(1) * TILE);
+}
+
+__kernel __attribute__((reqd_work_group_size(TILE, GROUP_ROWS, 1)))
+void MatrixFlipV(__global const T* in, __global T* out, uint SizeX, uint SizeY)
+{
+	MirrorTile(in, out, SizeX, SizeY, false, true, get_group_id(0) * TILE, get_group_id(1) * TILE);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Batches
+//
+// matrices holds one uint4 per matrix: the element offsets of its input and output, SizeX and SizeY.
+// Work-group g transforms the matrices [g * matricesPerGroup, (g + 1) * matricesPerGroup). As many
+// of them as fit into BATCH_LOCAL elements are staged in local memory together (rows padded by one
+// element): the group reads them in order, which is one coalesced read for matrices that follow
+// each other in memory, and writes the outputs in order. Larger matrices go tile by tile.
+// The host makes sure that BATCH_LOCAL holds at least one tile.
+
+#ifndef BATCH_LOCAL
+	#define BATCH_LOCAL (TILE * TILE_PITCH)
+#endif
+
+// The descriptors are the same for all work-items, so every barrier is reached by the whole group.
+inline void TransformBatch(__global const T* in, __global T* out, __global const uint4* matrices, uint nMatrices,
+	uint matricesPerGroup, __local T* buffer, const int op)
+{
+	uint lid = get_local_id(1) * TILE + get_local_id(0);
+	uint groupSize = TILE * GROUP_ROWS;
+	uint m = get_group_id(0) * matricesPerGroup;
+	uint last = min(m + matricesPerGroup, nMatrices);
+
+	while (m < last)
+	{
+		uint4 matrix = matrices[m];
+		if (matrix.w * (matrix.z + 1) > BATCH_LOCAL)
+		{
+			for (uint by = 0; by < matrix.w; by += TILE)
+			{
+				for (uint bx = 0; bx < matrix.z; bx += TILE)
+				{
+					if (SWAPS_DIMENSIONS(op))
+						TransposeTile(in + matrix.x, out + matrix.y, matrix.z, matrix.w, buffer, op, bx, by);
+					else
+						MirrorTile(in + matrix.x, out + matrix.y, matrix.z, matrix.w,
+							op == OP_ROTATE_180 || op == OP_FLIP_H, op == OP_ROTATE_180 || op == OP_FLIP_V, bx, by);
+					// the next tile reuses the buffer
+					barrier(CLK_LOCAL_MEM_FENCE);
+				}
+			}
+			m++;
+			continue;
+		}
+
+		// stage the matrices [m, end)
+		uint end = m, used = 0;
+		while (end < last && used + matrices[end].w * (matrices[end].z + 1) <= BATCH_LOCAL)
+		{
+			used += matrices[end].w * (matrices[end].z + 1);
+			end++;
+		}
+
+		uint base = 0;
+		for (uint k = m; k < end; k++)
+		{
+			matrix = matrices[k];
+			uint n = matrix.z * matrix.w;
+			for (uint i = lid; i < n; i += groupSize)
+				buffer[base + (i / matrix.z) * (matrix.z + 1) + i % matrix.z] = in[matrix.x + i];
+			base += matrix.w * (matrix.z + 1);
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		base = 0;
+		for (uint k = m; k < end; k++)
+		{
+			matrix = matrices[k];
+			uint n = matrix.z * matrix.w;
+			uint outSizeX = SWAPS_DIMENSIONS(op) ? matrix.w : matrix.z;
+			for (uint o = lid; o < n; o += groupSize)
+				out[matrix.y + o] = buffer[base + GetStagedIndex(op, o % outSizeX, o / outSizeX, matrix.z, matrix.w, matrix.z + 1)];
+			base += matrix.w * (matrix.z + 1);
+		}
+		// the next matrices reuse the buffer
+		barrier(CLK_LOCAL_MEM_FENCE);
+		m = end;
+	}
+}
+
+#define BATCH_KERNEL(name, op) \
+__kernel __attribute__((reqd_work_group_size(TILE, GROUP_ROWS, 1))) \
+void name(__global const T* in, __global T* out, __global const uint4* matrices, uint nMatrices, uint matricesPerGroup) \
+{ \
+	__local T buffer[BATCH_LOCAL]; \
+	TransformBatch(in, out, matrices, nMatrices, matricesPerGroup, buffer, op); \
+}
+
+BATCH_KERNEL(MatrixBatchTranspose, OP_TRANSPOSE)
+BATCH_KERNEL(MatrixBatchRotate90, OP_ROTATE_90)
+BATCH_KERNEL(MatrixBatchRotate180, OP_ROTATE_180)
+BATCH_KERNEL(MatrixBatchRotate270, OP_ROTATE_270)
+BATCH_KERNEL(MatrixBatchFlipH, OP_FLIP_H)
+BATCH_KERNEL(MatrixBatchFlipV, OP_FLIP_V)
+
+#else // TILE_INPLACE
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// In place (square N x N matrices)
+//
+// The blocks of the matrix form orbits under the transform: pairs of tiles mirrored at the diagonal
+// for the transpose, four blocks for the rotations. A work-group moves one orbit through two local
+// tiles, so every block is read and written exactly once and all global accesses are rows of a block.
+
+// Rows of the block [x0, x0 + w) x [y0, y0 + h) into a tile
+inline void LoadBlock(__global const T* m, uint N, uint x0, uint y0, uint w, uint h, __local T* tile)
+{
+	uint lx = get_local_id(0);
+	for (uint r = get_local_id(1); r < h; r += GROUP_ROWS)
+		if (lx < w)
+			tile[r * TILE_PITCH + lx] = m[(y0 + r) * N + x0 + lx];
+}
+
+// Writes the image of a block (w x h, staged in tile) to the block [x0, x0 + imageW) x [y0, y0 + imageH)
+inline void StoreImage(__global T* m, uint N, const int op, uint x0, uint y0, uint imageW, uint imageH, __local const T* tile, uint w, uint h)
+{
+	uint lx = get_local_id(0);
+	for (uint r = get_local_id(1); r < imageH; r += GROUP_ROWS)
+		if (lx < imageW)
+			m[(y0 + r) * N + x0 + lx] = tile[GetStagedIndex(op, lx, r, w, h, TILE_PITCH)];
+}
+
+// Top left corner of the image of the block [x, x + w) x [y, y + h), the image is h x w
+inline uint2 GetImageOrigin(const int op, uint N, uint x, uint y, uint w, uint h)
+{
+	return (op == OP_ROTATE_90) ? (uint2)(N - y - h, x) : (uint2)(y, N - x - w);
+}
+
+// Group (bx, by) with bx <= by swaps the tile (bx, by) with the tile (by, bx), the tiles on the diagonal are
+// transposed on their own. The groups above the diagonal have nothing to do.
+__kernel __attribute__((reqd_work_group_size(TILE, GROUP_ROWS, 1)))
+void MatrixTransposeInPlace(__global T* m, uint N)
+{
+	__local T tile0[TILE * TILE_PITCH];
+	__local T tile1[TILE * TILE_PITCH];
+
+	uint bx = get_group_id(0), by = get_group_id(1);
+	if (bx > by)
+		return;
+	uint x0 = bx * TILE, y0 = by * TILE;
+	uint w = min((uint)TILE, N - x0), h = min((uint)TILE, N - y0);
+
+	LoadBlock(m, N, x0, y0, w, h, tile0);
+	if (bx != by)
+		LoadBlock(m, N, y0, x0, h, w, tile1);
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	StoreImage(m, N, OP_TRANSPOSE, y0, x0, h, w, tile0, w, h);
+	if (bx != by)
+		StoreImage(m, N, OP_TRANSPOSE, x0, y0, w, h, tile1, h, w);
+}
+
+// The blocks of [0, (N + 1) / 2) x [0, N / 2) and their three images cover the matrix exactly once
+// (except the center of an odd N, which stays where it is). Each block moves to its image:
+// R0 -> R1 -> R2 -> R3 -> R0, with one tile holding the block that is overwritten next.
+inline void RotateInPlace(__global T* m, uint N, __local T* tile0, __local T* tile1, const int op)
+{
+	uint x0 = get_group_id(0) * TILE, y0 = get_group_id(1) * TILE;
+	uint domainX = (N + 1) / 2, domainY = N / 2;
+	if (x0 >= domainX || y0 >= domainY)
+		return;
+	uint w = min((uint)TILE, domainX - x0), h = min((uint)TILE, domainY - y0);
+
+	uint2 r0 = (uint2)(x0, y0);
+	uint2 r1 = GetImageOrigin(op, N, r0.x, r0.y, w, h);
+	uint2 r2 = GetImageOrigin(op, N, r1.x, r1.y, h, w);
+	uint2 r3 = GetImageOrigin(op, N, r2.x, r2.y, w, h);
+
+	LoadBlock(m, N, r0.x, r0.y, w, h, tile0);
+	LoadBlock(m, N, r1.x, r1.y, h, w, tile1);
+	barrier(CLK_LOCAL_MEM_FENCE);
+	StoreImage(m, N, op, r1.x, r1.y, h, w, tile0, w, h);
+	barrier(CLK_LOCAL_MEM_FENCE);
+	LoadBlock(m, N, r2.x, r2.y, w, h, tile0);
+	barrier(CLK_LOCAL_MEM_FENCE);
+	StoreImage(m, N, op, r2.x, r2.y, w, h, tile1, h, w);
+	barrier(CLK_LOCAL_MEM_FENCE);
+	LoadBlock(m, N, r3.x, r3.y, h, w, tile1);
+	barrier(CLK_LOCAL_MEM_FENCE);
+	StoreImage(m, N, op, r3.x, r3.y, h, w, tile0, w, h);
+	StoreImage(m, N, op, r0.x, r0.y, w, h, tile1, h, w);
+}
+
+__kernel __attribute__((reqd_work_group_size(TILE, GROUP_ROWS, 1)))
+void MatrixRotate90InPlace(__global T* m, uint N)
+{
+	__local T tile0[TILE * TILE_PITCH];
+	__local T tile1[TILE * TILE_PITCH];
+	RotateInPlace(m, N, tile0, tile1, OP_ROTATE_90);
+}
+
+__kernel __attribute__((reqd_work_group_size(TILE, GROUP_ROWS, 1)))
+void MatrixRotate270InPlace(__global T* m, uint N)
+{
+	__local T tile0[TILE * TILE_PITCH];
+	__local T tile1[TILE * TILE_PITCH];
+	RotateInPlace(m, N, tile0, tile1, OP_ROTATE_270);
+}
+
+#endif // TILE_INPLACE
@@ -1,3 +1,6 @@
+# the template is next to this module (inside the function CMAKE_CURRENT_LIST_DIR is the caller's directory)
+set(WORKING_DIRECTORY_TEMPLATE ${CMAKE_CURRENT_LIST_DIR}/WorkingDirectory.vcxproj.user.in)
+
 function(change_workingdir EXE WorkingDir)
 	#add a user file to auto config the working directory for debugging
 	if (MSVC)
@@ -7,7 +10,7 @@ function(change_workingdir EXE WorkingDir)
 		endif (CMAKE_CL_64)
 				
 		configure_file (
-			${CMAKE_SOURCE_DIR}/../cmake/WorkingDirectory.vcxproj.user.in
+			${WORKING_DIRECTORY_TEMPLATE}
 			${CMAKE_CURRENT_BINARY_DIR}/${EXE}.vcxproj.user 
 			@ONLY
 			)
@@ -20,7 +20,7 @@ SET (OPENCL_VERSION_MAJOR 0)
 SET (OPENCL_VERSION_MINOR 1)
 SET (OPENCL_VERSION_PATCH 0)
 
-include(${CMAKE_SOURCE_DIR}/../cmake/TargetArch.cmake)
+include(${CMAKE_CURRENT_LIST_DIR}/TargetArch.cmake)
 target_architecture(TARGET_ARCH)
 
 
@@ -0,0 +1,63 @@
+# Offline compilation of OpenCL kernels to SPIR-V modules.
+#
+# add_spirv_kernels(<target> <file.cl> ...) compiles each program with clang
+# (spir64 target) and llvm-spirv into ${GPGPU_SPIRV_DIRECTORY}/<name>.spv before
+# <target> is built. Relative files are searched in the current source directory,
+# then in the shared kernel library. CKernelLibrary loads these modules at runtime and
+# falls back to the .cl source if a module is missing, stale or not supported.
+#
+# Only programs that are built without host-side defines can be compiled here.
+# The step is skipped if clang or llvm-spirv cannot be found.
+
+option(GPGPU_SPIRV "Compile OpenCL kernels to SPIR-V at build time" ON)
+
+find_program(CLANG_EXECUTABLE NAMES clang)
+find_program(LLVM_SPIRV_EXECUTABLE NAMES llvm-spirv)
+
+get_filename_component(SPIRV_KERNEL_LIBRARY "${CMAKE_CURRENT_LIST_DIR}/../Kernels" ABSOLUTE)
+set(GPGPU_SPIRV_DIRECTORY "${CMAKE_BINARY_DIR}/SPIRV")
+
+if (GPGPU_SPIRV)
+	if (CLANG_EXECUTABLE AND LLVM_SPIRV_EXECUTABLE)
+		message(STATUS "Compiling kernels to SPIR-V with ${CLANG_EXECUTABLE}")
+	else ()
+		message(STATUS "clang or llvm-spirv not found, kernels are built from source at runtime")
+	endif ()
+endif ()
+
+function(add_spirv_kernels TARGET)
+	if (NOT GPGPU_SPIRV OR NOT CLANG_EXECUTABLE OR NOT LLVM_SPIRV_EXECUTABLE)
+		return()
+	endif ()
+
+	file(GLOB LibrarySources ${SPIRV_KERNEL_LIBRARY}/*.cl)
+	set(Modules)
+	foreach (KernelFile ${ARGN})
+		if (IS_ABSOLUTE "${KernelFile}")
+			set(KernelPath "${KernelFile}")
+		elseif (EXISTS "${CMAKE_CURRENT_SOURCE_DIR}/${KernelFile}")
+			set(KernelPath "${CMAKE_CURRENT_SOURCE_DIR}/${KernelFile}")
+		else ()
+			set(KernelPath "${SPIRV_KERNEL_LIBRARY}/${KernelFile}")
+		endif ()
+		get_filename_component(KernelDir ${KernelPath} PATH)
+		get_filename_component(KernelName ${KernelFile} NAME_WE)
+		set(Bitcode "${GPGPU_SPIRV_DIRECTORY}/${KernelName}.bc")
+		set(Module "${GPGPU_SPIRV_DIRECTORY}/${KernelName}.spv")
+
+		add_custom_command(OUTPUT ${Module}
+			COMMAND ${CMAKE_COMMAND} -E make_directory ${GPGPU_SPIRV_DIRECTORY}
+			COMMAND ${CLANG_EXECUTABLE} -c -x cl -cl-std=CL1.2 -target spir64-unknown-unknown
+				-emit-llvm -Xclang -finclude-default-header
+				-I${KernelDir} -I${SPIRV_KERNEL_LIBRARY}
+				-o ${Bitcode} ${KernelPath}
+			COMMAND ${LLVM_SPIRV_EXECUTABLE} ${Bitcode} -o ${Module}
+			DEPENDS ${KernelPath} ${LibrarySources}
+			COMMENT "Compiling ${KernelFile} to SPIR-V"
+			VERBATIM)
+		list(APPEND Modules ${Module})
+	endforeach ()
+
+	add_custom_target(${TARGET}_spirv ALL DEPENDS ${Modules})
+	add_dependencies(${TARGET} ${TARGET}_spirv)
+endfunction()